@@ -19,6 +19,7 @@
 #include "sw/redis++/errors.h"
 #include "sw/redis++/async_shards_pool.h"
 #include "sw/redis++/cmd_formatter.h"
+#include "sw/redis++/reply_arena.h"
 
 #ifdef _MSC_VER
 
@@ -116,6 +117,7 @@ AsyncConnection::AsyncConnection(const ConnectionOptions &opts,
         const EventLoopWPtr &loop,
         AsyncConnectionMode mode) :
     _opts(opts),
+    _metrics(opts.metrics),
     _loop(loop),
     _create_time(std::chrono::steady_clock::now()),
     _last_active(std::chrono::steady_clock::now().time_since_epoch()) {
@@ -144,6 +146,12 @@ void AsyncConnection::send(AsyncEventUPtr event) {
         _events.push_back(std::move(event));
     }
 
+    if (_scheduled.load(std::memory_order_acquire)) {
+        // The event loop has not handled this connection yet,
+        // and it will send the new event with other pending events.
+        return;
+    }
+
     auto loop = _loop.lock();
     if (loop) {
         loop->add(shared_from_this());
@@ -274,21 +282,35 @@ void AsyncConnection::_send() {
         auto &event = events[idx];
         try {
             if (event->handle(ctx)) {
-                // CommandEvent::_reply_callback will release the memory.
+                // The reply callback will release the memory.
                 event.release();
             }
         } catch (...) {
             // Failed to send command, fail subsequent events.
             auto err = std::current_exception();
-            for (; idx != events.size(); ++idx) {
-                events[idx]->set_exception(err);
+            for (auto cur = idx; cur != events.size(); ++cur) {
+                events[cur]->set_exception(err);
             }
 
             disconnect(err);
 
-            break;
+            // Notify the owners after the connection has been cleaned up.
+            for (; idx != events.size(); ++idx) {
+                events[idx].release()->done();
+            }
+
+            return;
         }
     }
+
+    // Reuse the buffer for later events, so that sending commands does not allocate.
+    events.clear();
+
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    if (_events.empty()) {
+        _events.swap(events);
+    }
 }
 
 std::vector<AsyncEventUPtr> AsyncConnection::_get_events() {
@@ -313,6 +335,12 @@ void AsyncConnection::_clean_up() {
 
         event->set_exception(_err);
     }
+
+    // Notify the owners after all events have been failed, since an owner, e.g. a coroutine,
+    // might send new events with this connection, once it's notified.
+    for (auto &event : events) {
+        event.release()->done();
+    }
 }
 
 void AsyncConnection::_fail_events(std::exception_ptr err) {
@@ -584,6 +612,11 @@ AsyncConnection::AsyncContextUPtr AsyncConnection::_connect(const ConnectionOpti
         throw_error(ctx->c, "failed to connect to Redis (" + opts._server_info() + ")");
     }
 
+    if (opts.reply_arena) {
+        // hiredis frees replies with the reader's functions after calling callbacks.
+        ReplyArena::install(*(ctx->c.reader));
+    }
+
     ctx->data = new AsyncContext(shared_from_this());
     ctx->dataCleanup = _clean_async_context;
 
@@ -21,6 +21,7 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <chrono>
 #include <exception>
 #include <vector>
 #include <hiredis/async.h>
@@ -59,6 +60,27 @@ public:
     virtual void set_exception(std::exception_ptr err) = 0;
 
     virtual void set_value(redisReply & /*reply*/) {}
+
+    // Release the event's memory. Events are created on heap by default.
+    // Override it, if the event is owned by others, e.g. embedded in a coroutine awaiter.
+    // NOTE: the event might have been destroyed after calling this method.
+    virtual void destroy() noexcept {
+        delete this;
+    }
+
+    // Called once `set_value` or `set_exception` has been called, and the connection
+    // no longer refers to the event. An event dropped before being done, e.g. when
+    // sending it throws, is only released with `destroy`.
+    // NOTE: the event might have been destroyed after calling this method.
+    virtual void done() noexcept {
+        destroy();
+    }
+};
+
+struct AsyncEventDeleter {
+    void operator()(AsyncEvent *event) const noexcept {
+        event->destroy();
+    }
 };
 
 // This event is used for updating node-slot mapping.
@@ -80,7 +102,7 @@ public:
     }
 };
 
-using AsyncEventUPtr = std::unique_ptr<AsyncEvent>;
+using AsyncEventUPtr = std::unique_ptr<AsyncEvent, AsyncEventDeleter>;
 
 enum class AsyncConnectionMode {
     SINGLE = 0,
@@ -116,6 +138,16 @@ public:
         return _last_active;
     }
 
+    // The event loop that this connection is attached to.
+    const EventLoopWPtr& loop() const noexcept {
+        return _loop;
+    }
+
+    // Hook to collect metrics, or null if metrics is disabled.
+    const MetricsHookSPtr& metrics() const noexcept {
+        return _metrics;
+    }
+
     void disconnect(std::exception_ptr err);
 
     template <typename Result, typename ResultParser>
@@ -164,6 +196,8 @@ public:
 #endif
 
 private:
+    friend class EventLoop;
+
     enum class State {
         BROKEN = 0,
         NOT_CONNECTED,
@@ -227,7 +261,7 @@ private:
 
     void _send();
 
-    std::vector<std::unique_ptr<AsyncEvent>> _get_events();
+    std::vector<AsyncEventUPtr> _get_events();
 
     void _clean_up();
 
@@ -248,6 +282,9 @@ private:
 
     ConnectionOptions _opts;
 
+    // A copy of `_opts.metrics`, which can be accessed without locking `_mtx`.
+    MetricsHookSPtr _metrics;
+
     EventLoopWPtr _loop;
 
     tls::TlsContextUPtr _tls_ctx;
@@ -264,7 +301,7 @@ private:
     // since time_point's constructor is non-trival.
     std::atomic<std::chrono::steady_clock::duration> _last_active{};
 
-    std::vector<std::unique_ptr<AsyncEvent>> _events;
+    std::vector<AsyncEventUPtr> _events;
 
     std::atomic<State> _state{State::NOT_CONNECTED};
 
@@ -273,6 +310,16 @@ private:
     AsyncSubscriberImplUPtr _subscriber_impl;
 
     std::mutex _mtx;
+
+    // Whether the connection has been scheduled in the event loop, but not handled yet.
+    // Only the first `send` after the connection is handled needs to wake up the event loop.
+    std::atomic<bool> _scheduled{false};
+
+    // Next scheduled connection in EventLoop's intrusive list.
+    AsyncConnection *_next_scheduled = nullptr;
+
+    // Keep the connection alive while it's scheduled.
+    std::shared_ptr<AsyncConnection> _scheduled_self;
 };
 
 using AsyncConnectionSPtr = std::shared_ptr<AsyncConnection>;
@@ -285,29 +332,21 @@ struct AsyncContext {
     bool run_disconnect_callback = true;
 };
 
-template <typename Result, typename ResultParser>
-class CommandEvent : public AsyncEvent {
+// Send a formatted command, and pass the reply to `set_value` or `set_exception`.
+// Derived classes decide how to save the result.
+class CommandEventBase : public AsyncEvent {
 public:
-    explicit CommandEvent(FormattedCommand cmd) : _cmd(std::move(cmd)) {}
-
-    Future<Result> get_future() {
-        return _pro.get_future();
-    }
+    explicit CommandEventBase(FormattedCommand cmd) : _cmd(std::move(cmd)) {}
 
     virtual bool handle(redisAsyncContext &ctx) override {
         _handle(ctx, _reply_callback);
         return true;
     }
 
-    virtual void set_exception(std::exception_ptr err) override {
-        _pro.set_exception(err);
-    }
-
-    template <typename T>
-    struct ResultType {};
-
-    virtual void set_value(redisReply &reply) override {
-        _set_value(reply, ResultType<Result>{});
+    // Send the command, and ignore its reply, e.g. commands queued in a transaction,
+    // whose results are returned with the reply of EXEC.
+    void handle_without_reply(redisAsyncContext &ctx) {
+        _handle(ctx, nullptr);
     }
 
 protected:
@@ -318,15 +357,41 @@ protected:
                     callback, this, _cmd.data(), _cmd.size()) != REDIS_OK) {
             throw_error(ctx.c, "failed to send command");
         }
+
+        _on_send(ctx);
+    }
+
+    void _on_send(redisAsyncContext &ctx) {
+        auto *context = static_cast<AsyncContext *>(ctx.data);
+        if (context == nullptr || !context->connection->metrics()) {
+            return;
+        }
+
+        _metrics = context->connection->metrics();
+        _send_time = std::chrono::steady_clock::now();
+
+        _metrics->on_bytes_sent(_cmd.size());
+    }
+
+    void _on_reply(redisReply *reply) {
+        if (!_metrics || reply == nullptr) {
+            // Metrics is disabled, or the command failed without a reply.
+            return;
+        }
+
+        _metrics->on_bytes_received(resp::reply_size(*reply));
+        _metrics->on_command(resp::command_name(_cmd.data(), _cmd.size()),
+                std::chrono::steady_clock::now() - _send_time);
     }
 
     static void _reply_callback(redisAsyncContext *ctx, void *r, void *privdata) {
-        auto event = static_cast<CommandEvent<Result, ResultParser> *>(privdata);
+        auto event = static_cast<CommandEventBase *>(privdata);
 
         assert(event != nullptr && ctx != nullptr);
 
         try {
             redisReply *reply = static_cast<redisReply *>(r);
+            event->_on_reply(reply);
             if (reply == nullptr) {
                 throw_error(ctx->c, "null reply");
             } else if (reply::is_error(*reply)) {
@@ -342,9 +407,40 @@ protected:
             event->set_exception(std::current_exception());
         }
 
-        delete event;
+        event->done();
+    }
+
+    FormattedCommand _cmd;
+
+    // Only set when metrics is enabled.
+    MetricsHookSPtr _metrics;
+
+    std::chrono::time_point<std::chrono::steady_clock> _send_time{};
+};
+
+using CommandEventBaseUPtr = std::unique_ptr<CommandEventBase, AsyncEventDeleter>;
+
+template <typename Result, typename ResultParser>
+class CommandEvent : public CommandEventBase {
+public:
+    explicit CommandEvent(FormattedCommand cmd) : CommandEventBase(std::move(cmd)) {}
+
+    Future<Result> get_future() {
+        return _pro.get_future();
+    }
+
+    virtual void set_exception(std::exception_ptr err) override {
+        _pro.set_exception(err);
+    }
+
+    template <typename T>
+    struct ResultType {};
+
+    virtual void set_value(redisReply &reply) override {
+        _set_value(reply, ResultType<Result>{});
     }
 
+protected:
     template <typename T>
     void _set_value(redisReply &reply, ResultType<T>) {
         ResultParser parser;
@@ -358,13 +454,11 @@ protected:
         _pro.set_value();
     }
 
-    FormattedCommand _cmd;
-
     Promise<Result> _pro;
 };
 
 template <typename Result, typename ResultParser>
-using CommandEventUPtr = std::unique_ptr<CommandEvent<Result, ResultParser>>;
+using CommandEventUPtr = std::unique_ptr<CommandEvent<Result, ResultParser>, AsyncEventDeleter>;
 
 template <typename Result, typename ResultParser, typename Callback>
 class CallbackEvent : public CommandEvent<Result, ResultParser> {
@@ -395,7 +489,8 @@ private:
 };
 
 template <typename Result, typename ResultParser, typename Callback>
-using CallbackEventUPtr = std::unique_ptr<CallbackEvent<Result, ResultParser, Callback>>;
+using CallbackEventUPtr = std::unique_ptr<CallbackEvent<Result, ResultParser, Callback>,
+                                    AsyncEventDeleter>;
 
 class AskingEvent : public AsyncEvent {
 public:
@@ -403,7 +498,7 @@ public:
 
     ~AskingEvent() {
         if (_event != nullptr) {
-            delete _event;
+            _event->destroy();
         }
     }
 
@@ -427,6 +522,17 @@ public:
         }
     }
 
+    virtual void done() noexcept override {
+        if (_event != nullptr) {
+            // The wrapped event has been failed, and it's done as well.
+            auto *event = _event;
+            _event = nullptr;
+            event->done();
+        }
+
+        destroy();
+    }
+
 private:
     static void _asking_callback(redisAsyncContext *ctx, void *r, void *privdata) {
         auto event = static_cast<AskingEvent *>(privdata);
@@ -452,7 +558,7 @@ private:
             event->set_exception(std::current_exception());
         }
 
-        delete event;
+        event->done();
     }
 
     AsyncEvent *_event = nullptr;
@@ -537,6 +643,7 @@ private:
 
         try {
             redisReply *reply = static_cast<redisReply *>(r);
+            event->_on_reply(reply);
             if (reply == nullptr) {
                 throw_error(ctx->c, "null reply");
             } else if (reply::is_error(*reply)) {
@@ -550,6 +657,8 @@ private:
                     detail::update_shards(event->_key, event->_pool, AsyncEventUPtr(event));
                     return;
                 } catch (const MovedError &) {
+                    event->_on_redirect(RedirectType::MOVED);
+
                     switch (event->_state) {
                     case State::MOVED:
                         throw Error("too many moved error");
@@ -565,6 +674,8 @@ private:
                     detail::update_shards(event->_key, event->_pool, AsyncEventUPtr(event));
                     return;
                 } catch (const AskError &err) {
+                    event->_on_redirect(RedirectType::ASK);
+
                     event->_state = State::ASKING;
                     auto pool = event->_pool->fetch(err.node());
                     assert(pool);
@@ -581,7 +692,13 @@ private:
             event->set_exception(std::current_exception());
         }
 
-        delete event;
+        event->done();
+    }
+
+    void _on_redirect(RedirectType type) {
+        if (this->_metrics) {
+            this->_metrics->on_redirect(type);
+        }
     }
 
     std::shared_ptr<AsyncShardsPool> _pool;
@@ -592,7 +709,7 @@ private:
 };
 
 template <typename Result, typename ResultParser>
-using ClusterEventUPtr = std::unique_ptr<ClusterEvent<Result, ResultParser>>;
+using ClusterEventUPtr = std::unique_ptr<ClusterEvent<Result, ResultParser>, AsyncEventDeleter>;
 
 template <typename Result, typename ResultParser, typename Callback>
 class CallbackClusterEvent : public ClusterEvent<Result, ResultParser> {
@@ -627,7 +744,8 @@ private:
 };
 
 template <typename Result, typename ResultParser, typename Callback>
-using CallbackClusterEventUPtr = std::unique_ptr<CallbackClusterEvent<Result, ResultParser, Callback>>;
+using CallbackClusterEventUPtr = std::unique_ptr<CallbackClusterEvent<Result, ResultParser, Callback>,
+                                    AsyncEventDeleter>;
 
 template <typename Result, typename ResultParser>
 Future<Result> AsyncConnection::send(FormattedCommand cmd) {
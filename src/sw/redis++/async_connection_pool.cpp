@@ -54,10 +54,10 @@ AsyncConnectionSPtr SimpleAsyncSentinel::create(const ConnectionOptions &opts,
     return connection;
 }
 
-AsyncConnectionPool::AsyncConnectionPool(const EventLoopWPtr &loop,
+AsyncConnectionPool::AsyncConnectionPool(const EventLoopGroupWPtr &loops,
         const ConnectionPoolOptions &pool_opts,
         const ConnectionOptions &connection_opts) :
-            _loop(loop),
+            _loops(loops),
             _opts(connection_opts),
             _pool_opts(pool_opts) {
     if (_pool_opts.size == 0) {
@@ -68,10 +68,10 @@ AsyncConnectionPool::AsyncConnectionPool(const EventLoopWPtr &loop,
 }
 
 AsyncConnectionPool::AsyncConnectionPool(SimpleAsyncSentinel sentinel,
-                                const EventLoopWPtr &loop,
+                                const EventLoopGroupWPtr &loops,
                                 const ConnectionPoolOptions &pool_opts,
                                 const ConnectionOptions &connection_opts) :
-                                    _loop(loop),
+                                    _loops(loops),
                                     _opts(connection_opts),
                                     _pool_opts(pool_opts),
                                     _sentinel(std::move(sentinel)) {
@@ -92,7 +92,7 @@ AsyncConnectionPool::AsyncConnectionPool(SimpleAsyncSentinel sentinel,
 }
 
 AsyncConnectionPool::~AsyncConnectionPool() {
-    if (_loop.expired()) {
+    if (_loops.expired()) {
         // This should not happen.
         return;
     }
@@ -102,7 +102,7 @@ AsyncConnectionPool::~AsyncConnectionPool() {
     // all borrowed connections should have been returned.
     for (auto &connection : _pool) {
         // TODO: what if some connection has never been watched? Is it possible?
-        auto loop = _loop.lock();
+        auto loop = connection->loop().lock();
         if (loop) {
             loop->unwatch(std::move(connection));
         } // else EventLoop has been destroyed. Do nothing.
@@ -139,12 +139,15 @@ AsyncConnectionSPtr AsyncConnectionPool::fetch() {
         lock.unlock();
 
         if (role_changed || _need_reconnect(*connection, connection_lifetime, connection_idle_time)) {
+            _on_reconnect(*connection);
+
             try {
-                auto loop = _get_loop();
-                auto tmp_connection = sentinel.create(opts, shared_from_this(), _loop);
+                auto tmp_connection = sentinel.create(opts, shared_from_this(), _next_loop());
 
                 std::swap(tmp_connection, connection);
 
+                auto loop = _get_loop(*tmp_connection);
+
                 // Release expired connection.
                 // TODO: If `unwatch` throw, we will leak the connection.
                 loop->unwatch(std::move(tmp_connection));
@@ -163,6 +166,8 @@ AsyncConnectionSPtr AsyncConnectionPool::fetch() {
     assert(connection);
 
     if (_need_reconnect(*connection, connection_lifetime, connection_idle_time)) {
+        _on_reconnect(*connection);
+
         try {
             auto tmp_connection = _create();
 
@@ -170,7 +175,7 @@ AsyncConnectionSPtr AsyncConnectionPool::fetch() {
 
             // Release expired connection.
             // TODO: If `unwatch` throw, we will leak the connection.
-            auto loop = _get_loop();
+            auto loop = _get_loop(*tmp_connection);
             loop->unwatch(std::move(tmp_connection));
         } catch (const Error &) {
             // Failed, return it to the pool, and retry latter.
@@ -210,11 +215,11 @@ AsyncConnectionSPtr AsyncConnectionPool::create() {
 
         lock.unlock();
 
-        return sentinel.create(opts, shared_from_this(), _loop);
+        return sentinel.create(opts, shared_from_this(), _next_loop());
     } else {
         lock.unlock();
 
-        return std::make_shared<AsyncConnection>(opts, _loop);
+        return std::make_shared<AsyncConnection>(opts, _next_loop());
     }
 }
 
@@ -229,11 +234,11 @@ AsyncConnectionPoolSPtr AsyncConnectionPool::clone() {
 
         lock.unlock();
 
-        return std::make_shared<AsyncConnectionPool>(sentinel, _loop, pool_opts, opts);
+        return std::make_shared<AsyncConnectionPool>(sentinel, _loops, pool_opts, opts);
     } else {
         lock.unlock();
 
-        return std::make_shared<AsyncConnectionPool>(_loop, pool_opts, opts);
+        return std::make_shared<AsyncConnectionPool>(_loops, pool_opts, opts);
     }
 }
 
@@ -248,13 +253,13 @@ void AsyncConnectionPool::update_node_info(const std::string &host,
 
     connection->update_node_info(host, port);
 
-    auto loop = _get_loop();
+    auto loop = _get_loop(*connection);
     loop->add(connection);
 }
 
 void AsyncConnectionPool::update_node_info(AsyncConnectionSPtr &connection,
         std::exception_ptr err) {
-    auto loop = _get_loop();
+    auto loop = _get_loop(*connection);
     loop->unwatch(connection, err);
 }
 
@@ -262,10 +267,10 @@ AsyncConnectionSPtr AsyncConnectionPool::_create() {
     if (_sentinel) {
         // Get Redis host and port info from sentinel.
         // In this case, the mutex has been locked.
-        return _sentinel.create(_opts, shared_from_this(), _loop);
+        return _sentinel.create(_opts, shared_from_this(), _next_loop());
     }
 
-    return std::make_shared<AsyncConnection>(_opts, _loop);
+    return std::make_shared<AsyncConnection>(_opts, _next_loop());
 }
 
 AsyncConnectionSPtr AsyncConnectionPool::_fetch() {
@@ -278,12 +283,16 @@ AsyncConnectionSPtr AsyncConnectionPool::_fetch() {
 }
 
 void AsyncConnectionPool::_wait_for_connection(std::unique_lock<std::mutex> &lock) {
+    auto start = std::chrono::steady_clock::now();
+
     auto timeout = _pool_opts.wait_timeout;
     if (timeout > std::chrono::milliseconds(0)) {
         // Wait until _pool is no longer empty or timeout.
         if (!_cv.wait_for(lock,
                     timeout,
                     [this] { return !(this->_pool).empty(); })) {
+            _on_pool_wait(start);
+
             throw Error("Failed to fetch a connection in "
                     + std::to_string(timeout.count()) + " milliseconds");
         }
@@ -291,6 +300,23 @@ void AsyncConnectionPool::_wait_for_connection(std::unique_lock<std::mutex> &loc
         // Wait forever.
         _cv.wait(lock, [this] { return !(this->_pool).empty(); });
     }
+
+    _on_pool_wait(start);
+}
+
+void AsyncConnectionPool::_on_pool_wait(
+        const std::chrono::time_point<std::chrono::steady_clock> &start) const {
+    // `_opts` is protected by `_mutex`, which is held by the caller.
+    if (_opts.metrics) {
+        _opts.metrics->on_pool_wait(std::chrono::steady_clock::now() - start);
+    }
+}
+
+void AsyncConnectionPool::_on_reconnect(const AsyncConnection &connection) const {
+    const auto &metrics = connection.metrics();
+    if (metrics) {
+        metrics->on_reconnect();
+    }
 }
 
 bool AsyncConnectionPool::_need_reconnect(const AsyncConnection &connection,
@@ -325,8 +351,17 @@ bool AsyncConnectionPool::_role_changed(const ConnectionOptions &opts) const {
     return opts.port != _opts.port || opts.host != _opts.host;
 }
 
-EventLoopSPtr AsyncConnectionPool::_get_loop() {
-    auto loop = _loop.lock();
+EventLoopWPtr AsyncConnectionPool::_next_loop() {
+    auto loops = _loops.lock();
+    if (!loops) {
+        throw Error("EventLoop has been destroyed");
+    }
+
+    return loops->next();
+}
+
+EventLoopSPtr AsyncConnectionPool::_get_loop(const AsyncConnection &connection) {
+    auto loop = connection.loop().lock();
     if (!loop) {
         throw Error("EventLoop has been destroyed");
     }
@@ -18,6 +18,7 @@
 #define SEWENEW_REDISPLUSPLUS_ASYNC_CONNECTION_POOL_H
 
 #include <cassert>
+#include <atomic>
 #include <unordered_set>
 #include <chrono>
 #include <mutex>
@@ -70,12 +71,13 @@ private:
 
 class AsyncConnectionPool : public std::enable_shared_from_this<AsyncConnectionPool> {
 public:
-    AsyncConnectionPool(const EventLoopWPtr &loop,
+    // Connections are spread across event loops of the `loops` group.
+    AsyncConnectionPool(const EventLoopGroupWPtr &loops,
                     const ConnectionPoolOptions &pool_opts,
                     const ConnectionOptions &connection_opts);
 
     AsyncConnectionPool(SimpleAsyncSentinel sentinel,
-                    const EventLoopWPtr &loop,
+                    const EventLoopGroupWPtr &loops,
                     const ConnectionPoolOptions &pool_opts,
                     const ConnectionOptions &connection_opts);
 
@@ -115,6 +117,12 @@ private:
 
     void _wait_for_connection(std::unique_lock<std::mutex> &lock);
 
+    // Report the time spent waiting for a connection, if metrics is enabled.
+    void _on_pool_wait(const std::chrono::time_point<std::chrono::steady_clock> &start) const;
+
+    // Report that the connection is going to be reconnected, if metrics is enabled.
+    void _on_reconnect(const AsyncConnection &connection) const;
+
     bool _need_reconnect(const AsyncConnection &connection,
                             const std::chrono::milliseconds &connection_lifetime,
                             const std::chrono::milliseconds &connection_idle_time) const;
@@ -126,9 +134,13 @@ private:
 
     bool _role_changed(const ConnectionOptions &opts) const;
 
-    EventLoopSPtr _get_loop();
+    // Pick an event loop for a new connection.
+    EventLoopWPtr _next_loop();
+
+    // Get the event loop that the connection is attached to.
+    static EventLoopSPtr _get_loop(const AsyncConnection &connection);
 
-    EventLoopWPtr _loop;
+    EventLoopGroupWPtr _loops;
 
     ConnectionOptions _opts;
 
@@ -0,0 +1,119 @@
+/**************************************************************************
+   Copyright (c) 2021 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/async_pipeline.h"
+#include <cassert>
+#include "sw/redis++/errors.h"
+
+namespace sw {
+
+namespace redis {
+
+void PipelineState::finish(std::exception_ptr err) {
+    if (err) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (!_err) {
+            _err = err;
+        }
+    }
+
+    if (--_cmd_num == 0) {
+        // All commands have been done.
+        std::exception_ptr first_err;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            first_err = _err;
+        }
+
+        if (first_err) {
+            _pro.set_exception(first_err);
+        } else {
+            _pro.set_value();
+        }
+    }
+}
+
+bool PipelineEvent::handle(redisAsyncContext &ctx) {
+    for (auto &event : _events) {
+        assert(event);
+
+        // If it throws, `AsyncConnection` calls `set_exception` to fail the remaining events.
+        if (event->handle(ctx)) {
+            // The reply callback will release the memory.
+            event.release();
+        }
+
+        event.reset();
+    }
+
+    // All sub-events have been sent, and this event can be released.
+    return false;
+}
+
+void PipelineEvent::set_exception(std::exception_ptr err) {
+    for (auto &event : _events) {
+        if (event) {
+            event->set_exception(err);
+        }
+    }
+}
+
+Future<void> AsyncPipeline::exec() {
+    if (_events.empty()) {
+        Promise<void> pro;
+        pro.set_value();
+
+        return pro.get_future();
+    }
+
+    assert(_state);
+
+    if (_connection) {
+        // Single connection mode.
+        auto &connection = _connection->connection();
+        if (connection.broken()) {
+            throw Error("connection is broken");
+        }
+
+        auto fut = _state->get_future();
+        connection.send(_release_event());
+
+        return fut;
+    }
+
+    assert(_pool);
+    SafeAsyncConnection connection(*_pool);
+
+    auto fut = _state->get_future();
+    connection.connection().send(_release_event());
+
+    return fut;
+}
+
+AsyncEventUPtr AsyncPipeline::_release_event() {
+    auto event = AsyncEventUPtr(new PipelineEvent(std::move(_events)));
+
+    _events.clear();
+    _state.reset();
+
+    return event;
+}
+
+}
+
+}
@@ -0,0 +1,270 @@
+/**************************************************************************
+   Copyright (c) 2021 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_ASYNC_PIPELINE_H
+#define SEWENEW_REDISPLUSPLUS_ASYNC_PIPELINE_H
+
+#include <cassert>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "sw/redis++/async_connection.h"
+#include "sw/redis++/async_connection_pool.h"
+#include "sw/redis++/cmd_formatter.h"
+#include "sw/redis++/command_args.h"
+#include "sw/redis++/utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// Shared by all commands of a pipeline, so that the future returned by
+// `AsyncPipeline::exec` becomes ready when the last reply has been received.
+class PipelineState {
+public:
+    Future<void> get_future() {
+        return _pro.get_future();
+    }
+
+    // Called when a command is queued.
+    void add() {
+        ++_cmd_num;
+    }
+
+    // Called when a command has been done, either successfully or with an error.
+    void finish(std::exception_ptr err = nullptr);
+
+private:
+    std::atomic<std::size_t> _cmd_num{0};
+
+    std::mutex _mutex;
+
+    // The first error.
+    std::exception_ptr _err;
+
+    Promise<void> _pro;
+};
+
+using PipelineStateSPtr = std::shared_ptr<PipelineState>;
+
+template <typename Result, typename ResultParser>
+class PipelineCommandEvent : public CommandEvent<Result, ResultParser> {
+public:
+    PipelineCommandEvent(FormattedCommand cmd, PipelineStateSPtr state) :
+        CommandEvent<Result, ResultParser>(std::move(cmd)), _state(std::move(state)) {}
+
+    virtual void set_exception(std::exception_ptr err) override {
+        CommandEvent<Result, ResultParser>::set_exception(err);
+
+        _state->finish(err);
+    }
+
+    virtual void set_value(redisReply &reply) override {
+        // If it fails to parse the reply, CommandEventBase::_reply_callback calls
+        // `set_exception` with the parsing error.
+        CommandEvent<Result, ResultParser>::set_value(reply);
+
+        _state->finish();
+    }
+
+private:
+    PipelineStateSPtr _state;
+};
+
+// Send all commands of a pipeline with a single event, i.e. the event loop is
+// woken up only once, and all commands are appended to the hiredis context in
+// a single callback, and written to the socket together.
+class PipelineEvent : public AsyncEvent {
+public:
+    explicit PipelineEvent(std::vector<AsyncEventUPtr> events) : _events(std::move(events)) {}
+
+    virtual bool handle(redisAsyncContext &ctx) override;
+
+    virtual void set_exception(std::exception_ptr err) override;
+
+private:
+    std::vector<AsyncEventUPtr> _events;
+};
+
+class AsyncPipeline {
+public:
+    AsyncPipeline(const AsyncPipeline &) = delete;
+    AsyncPipeline& operator=(const AsyncPipeline &) = delete;
+
+    AsyncPipeline(AsyncPipeline &&) = default;
+    AsyncPipeline& operator=(AsyncPipeline &&) = default;
+
+    ~AsyncPipeline() = default;
+
+    // Send all queued commands to Redis with a single event.
+    // The returned future is ready when replies of all commands have been received.
+    // If any command fails, the future holds the first exception, and the future
+    // of the failed command holds the exception too.
+    Future<void> exec();
+
+    // Discard all queued commands. Futures of these commands will be broken.
+    void discard() {
+        _events.clear();
+        _state.reset();
+    }
+
+    // Number of queued commands.
+    std::size_t size() const {
+        return _events.size();
+    }
+
+    template <typename Result, typename ...Args>
+    Future<Result> command(const StringView &cmd_name, Args &&...args) {
+        CmdArgs cmd_args;
+        cmd_args.append(cmd_name, std::forward<Args>(args)...);
+
+        return _command<Result>(fmt::format_cmd(cmd_args));
+    }
+
+    template <typename Result, typename Input>
+    auto command(Input first, Input last)
+        -> typename std::enable_if<IsIter<Input>::value, Future<Result>>::type {
+        CmdArgs cmd_args;
+        while (first != last) {
+            cmd_args.append_copy(*first);
+            ++first;
+        }
+
+        return _command<Result>(fmt::format_cmd(cmd_args));
+    }
+
+    // KEY commands.
+
+    Future<long long> del(const StringView &key) {
+        return _command<long long>(fmt::del(key));
+    }
+
+    Future<long long> exists(const StringView &key) {
+        return _command<long long>(fmt::exists(key));
+    }
+
+    Future<bool> expire(const StringView &key, const std::chrono::seconds &timeout) {
+        return _command<bool>(fmt::expire(key, timeout));
+    }
+
+    Future<bool> pexpire(const StringView &key, const std::chrono::milliseconds &timeout) {
+        return _command<bool>(fmt::pexpire(key, timeout));
+    }
+
+    // STRING commands.
+
+    Future<OptionalString> get(const StringView &key) {
+        return _command<OptionalString>(fmt::get(key));
+    }
+
+    Future<long long> incr(const StringView &key) {
+        return _command<long long>(fmt::incr(key));
+    }
+
+    Future<long long> incrby(const StringView &key, long long increment) {
+        return _command<long long>(fmt::incrby(key, increment));
+    }
+
+    Future<bool> set(const StringView &key,
+                const StringView &val,
+                const std::chrono::milliseconds &ttl = std::chrono::milliseconds(0),
+                UpdateType type = UpdateType::ALWAYS) {
+        return _command<bool, fmt::SetResultParser>(fmt::set(key, val, ttl, type));
+    }
+
+    // LIST commands.
+
+    Future<long long> lpush(const StringView &key, const StringView &val) {
+        return _command<long long>(fmt::lpush(key, val));
+    }
+
+    Future<long long> rpush(const StringView &key, const StringView &val) {
+        return _command<long long>(fmt::rpush(key, val));
+    }
+
+    // HASH commands.
+
+    Future<long long> hdel(const StringView &key, const StringView &field) {
+        return _command<long long>(fmt::hdel(key, field));
+    }
+
+    Future<OptionalString> hget(const StringView &key, const StringView &field) {
+        return _command<OptionalString>(fmt::hget(key, field));
+    }
+
+    Future<long long> hset(const StringView &key, const StringView &field, const StringView &val) {
+        return _command<long long>(fmt::hset(key, field, val));
+    }
+
+    // SET commands.
+
+    Future<long long> sadd(const StringView &key, const StringView &member) {
+        return _command<long long>(fmt::sadd(key, member));
+    }
+
+    // PUBSUB commands.
+
+    Future<long long> publish(const StringView &channel, const StringView &message) {
+        return _command<long long>(fmt::publish(channel, message));
+    }
+
+private:
+    friend class AsyncRedis;
+    friend class AsyncRedisCluster;
+
+    explicit AsyncPipeline(const AsyncConnectionPoolSPtr &pool) : _pool(pool) {
+        assert(_pool);
+    }
+
+    explicit AsyncPipeline(const GuardedAsyncConnectionSPtr &connection) : _connection(connection) {
+        assert(_connection);
+    }
+
+    AsyncEventUPtr _release_event();
+
+    template <typename Result, typename ResultParser = DefaultResultParser<Result>>
+    Future<Result> _command(FormattedCommand cmd) {
+        if (!_state) {
+            _state = std::make_shared<PipelineState>();
+        }
+
+        _state->add();
+
+        auto event = std::unique_ptr<PipelineCommandEvent<Result, ResultParser>, AsyncEventDeleter>(
+                new PipelineCommandEvent<Result, ResultParser>(std::move(cmd), _state));
+
+        auto fut = event->get_future();
+
+        _events.push_back(std::move(event));
+
+        return fut;
+    }
+
+    AsyncConnectionPoolSPtr _pool;
+
+    GuardedAsyncConnectionSPtr _connection;
+
+    std::vector<AsyncEventUPtr> _events;
+
+    PipelineStateSPtr _state;
+};
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_ASYNC_PIPELINE_H
@@ -26,12 +26,21 @@ AsyncRedis::AsyncRedis(const Uri &uri) :
 
 AsyncRedis::AsyncRedis(const ConnectionOptions &opts,
         const ConnectionPoolOptions &pool_opts,
-        const EventLoopSPtr &loop) : _loop(loop) {
-    if (!_loop) {
-        _loop = std::make_shared<EventLoop>();
+        const EventLoopSPtr &loop) {
+    _loops = std::make_shared<EventLoopGroup>(
+            std::vector<EventLoopSPtr>{loop ? loop : std::make_shared<EventLoop>()});
+
+    _pool = std::make_shared<AsyncConnectionPool>(_loops, pool_opts, opts);
+}
+
+AsyncRedis::AsyncRedis(const EventLoopGroupSPtr &loops,
+        const ConnectionOptions &opts,
+        const ConnectionPoolOptions &pool_opts) : _loops(loops) {
+    if (!_loops) {
+        throw Error("event loop group cannot be null");
     }
 
-    _pool = std::make_shared<AsyncConnectionPool>(_loop, pool_opts, opts);
+    _pool = std::make_shared<AsyncConnectionPool>(_loops, pool_opts, opts);
 }
 
 AsyncRedis::AsyncRedis(const std::shared_ptr<AsyncSentinel> &sentinel,
@@ -39,13 +48,12 @@ AsyncRedis::AsyncRedis(const std::shared_ptr<AsyncSentinel> &sentinel,
         Role role,
         const ConnectionOptions &opts,
         const ConnectionPoolOptions &pool_opts,
-        const EventLoopSPtr &loop) : _loop(loop) {
-    if (!_loop) {
-        _loop = std::make_shared<EventLoop>();
-    }
+        const EventLoopSPtr &loop) {
+    _loops = std::make_shared<EventLoopGroup>(
+            std::vector<EventLoopSPtr>{loop ? loop : std::make_shared<EventLoop>()});
 
     _pool = std::make_shared<AsyncConnectionPool>(SimpleAsyncSentinel(sentinel, master_name, role),
-                                                    _loop,
+                                                    _loops,
                                                     pool_opts,
                                                     opts);
 }
@@ -64,7 +72,31 @@ AsyncSubscriber AsyncRedis::subscriber() {
     auto connection = _pool->create();
     connection->set_subscriber_mode();
 
-    return AsyncSubscriber(_loop, std::move(connection));
+    // The connection might be attached to any loop of the group.
+    auto loop = connection->loop();
+
+    return AsyncSubscriber(loop, std::move(connection));
+}
+
+AsyncPipeline AsyncRedis::pipeline() {
+    if (_connection) {
+        // Single connection mode.
+        return AsyncPipeline(_connection);
+    }
+
+    assert(_pool);
+
+    return AsyncPipeline(_pool);
+}
+
+AsyncTransaction AsyncRedis::transaction() {
+    // WATCH state belongs to the connection. In single connection mode, the connection
+    // is shared with other commands and transactions, which might drop the watched keys.
+    if (!_pool) {
+        throw Error("cannot create transaction in single connection mode");
+    }
+
+    return AsyncTransaction(std::make_shared<GuardedAsyncConnection>(_pool));
 }
 
 }
@@ -19,8 +19,10 @@
 
 #include "sw/redis++/async_connection.h"
 #include "sw/redis++/async_connection_pool.h"
+#include "sw/redis++/async_pipeline.h"
 #include "sw/redis++/async_sentinel.h"
 #include "sw/redis++/async_subscriber.h"
+#include "sw/redis++/async_transaction.h"
 #include "sw/redis++/event_loop.h"
 #include "sw/redis++/utils.h"
 #include "sw/redis++/command.h"
@@ -41,6 +43,13 @@ public:
 
     explicit AsyncRedis(const std::string &uri) : AsyncRedis(Uri(uri)) {}
 
+    // Connections of the pool are spread across event loops of the given group,
+    // so that replies are parsed, and callbacks are called, by multiple threads.
+    // Callbacks of commands sent with the same connection are called in the same thread.
+    AsyncRedis(const EventLoopGroupSPtr &loops,
+                const ConnectionOptions &opts,
+                const ConnectionPoolOptions &pool_opts = {});
+
     AsyncRedis(const std::shared_ptr<AsyncSentinel> &sentinel,
                 const std::string &master_name,
                 Role role,
@@ -58,6 +67,53 @@ public:
 
     AsyncSubscriber subscriber();
 
+    // Create a pipeline. Commands queued in the pipeline are sent to Redis
+    // with a single event when `AsyncPipeline::exec` is called.
+    AsyncPipeline pipeline();
+
+    // Create a transaction, which owns a connection fetched from the pool, until it's
+    // destroyed. Commands queued in the transaction are sent with MULTI and EXEC
+    // in a single event, when `AsyncTransaction::exec` is called.
+    // Throw Error, if it's in single connection mode.
+    AsyncTransaction transaction();
+
+    // Run a transaction with optimistic locking, without blocking. `func` takes an
+    // `AsyncTransaction &` and a `TransactionExec`. It watches keys, reads them with
+    // `AsyncTransaction::redis()` and callbacks, queues commands, and then calls the
+    // `TransactionExec` to execute the transaction. If watched keys have been modified,
+    // `func` is called again, in the event loop thread, with the same transaction. `cb`
+    // takes a `Future<void>`, which holds a WatchError, if it still fails after `max_retries`
+    // retries, or any other exception thrown by `func` or the transaction.
+    // Throw Error, if it's in single connection mode.
+    // NOTE: do NOT block in `func` or `cb`, since they might run in the event loop thread.
+    template <typename Func, typename Callback>
+    void transaction(Func &&func, std::size_t max_retries, Callback &&cb) {
+        using Retry = detail::TransactionRetry<typename std::decay<Func>::type,
+                                                typename std::decay<Callback>::type>;
+
+        auto retry = std::make_shared<Retry>(transaction(),
+                std::forward<Func>(func), max_retries, std::forward<Callback>(cb));
+
+        retry->run();
+    }
+
+    template <typename Func>
+    Future<void> transaction(Func &&func, std::size_t max_retries = 3) {
+        auto pro = std::make_shared<Promise<void>>();
+        auto fut = pro->get_future();
+
+        transaction(std::forward<Func>(func), max_retries, [pro](Future<void> &&res) {
+                    try {
+                        res.get();
+                        pro->set_value();
+                    } catch (...) {
+                        pro->set_exception(std::current_exception());
+                    }
+                });
+
+        return fut;
+    }
+
     template <typename Result, typename ...Args>
     auto command(const StringView &cmd_name, Args &&...args)
         -> typename std::enable_if<!IsInvocable<typename LastType<Args...>::type,
@@ -87,7 +143,7 @@ public:
         auto formatter = [](Input start, Input stop) {
             CmdArgs cmd_args;
             while (start != stop) {
-                cmd_args.append(*start);
+                cmd_args.append_copy(*start);
                 ++start;
             }
             return fmt::format_cmd(cmd_args);
@@ -102,7 +158,7 @@ public:
         auto formatter = [](Input start, Input stop) {
             CmdArgs cmd_args;
             while (start != stop) {
-                cmd_args.append(*start);
+                cmd_args.append_copy(*start);
                 ++start;
             }
             return fmt::format_cmd(cmd_args);
@@ -1928,8 +1984,19 @@ public:
                 std::move(cmd), std::forward<Callback>(cb));
     }
 
+    // Send an event owned by the caller, e.g. an event embedded in a coroutine awaiter.
+    // The event's `done` method is called, once the connection no longer uses it.
+    // If it throws, the event has NOT been queued.
+    void co_send(AsyncEvent &event) {
+        assert(_pool);
+        SafeAsyncConnection connection(*_pool);
+
+        connection.connection().send(AsyncEventUPtr(&event));
+    }
+
 private:
     friend class AsyncRedisCluster;
+    friend class AsyncTransaction;
 
     explicit AsyncRedis(const GuardedAsyncConnectionSPtr &connection);
 
@@ -2040,7 +2107,7 @@ private:
         _callback_score_command<Result>(typename IsKvPair<typename Result::value_type>::type(), std::forward<Callback>(cb), formatter, std::forward<Args>(args)...);
     }
 
-    EventLoopSPtr _loop;
+    EventLoopGroupSPtr _loops;
 
     AsyncConnectionPoolSPtr _pool;
 
@@ -27,24 +27,30 @@ AsyncRedisCluster::AsyncRedisCluster(const Uri &uri) :
 AsyncRedisCluster::AsyncRedisCluster(const ConnectionOptions &opts,
         const ConnectionPoolOptions &pool_opts,
         Role role,
-        const EventLoopSPtr &loop) : _loop(loop) {
-    if (!_loop) {
-        _loop = std::make_shared<EventLoop>();
-    }
-
-    _pool = std::make_shared<AsyncShardsPool>(_loop, pool_opts, opts, role, ClusterOptions{});
-}
+        const EventLoopSPtr &loop) :
+            AsyncRedisCluster(opts, pool_opts, role, ClusterOptions{}, loop) {}
 
 AsyncRedisCluster::AsyncRedisCluster(const ConnectionOptions &opts,
         const ConnectionPoolOptions &pool_opts,
         Role role,
         const ClusterOptions &cluster_opts,
-        const EventLoopSPtr &loop) : _loop(loop) {
-    if (!_loop) {
-        _loop = std::make_shared<EventLoop>();
+        const EventLoopSPtr &loop) {
+    _loops = std::make_shared<EventLoopGroup>(
+            std::vector<EventLoopSPtr>{loop ? loop : std::make_shared<EventLoop>()});
+
+    _pool = std::make_shared<AsyncShardsPool>(_loops, pool_opts, opts, role, cluster_opts);
+}
+
+AsyncRedisCluster::AsyncRedisCluster(const EventLoopGroupSPtr &loops,
+        const ConnectionOptions &opts,
+        const ConnectionPoolOptions &pool_opts,
+        Role role,
+        const ClusterOptions &cluster_opts) : _loops(loops) {
+    if (!_loops) {
+        throw Error("event loop group cannot be null");
     }
 
-    _pool = std::make_shared<AsyncShardsPool>(_loop, pool_opts, opts, role, cluster_opts);
+    _pool = std::make_shared<AsyncShardsPool>(_loops, pool_opts, opts, role, cluster_opts);
 }
 
 AsyncRedis AsyncRedisCluster::redis(const StringView &hash_tag, bool new_connection) {
@@ -59,15 +65,34 @@ AsyncRedis AsyncRedisCluster::redis(const StringView &hash_tag, bool new_connect
     return AsyncRedis(std::make_shared<GuardedAsyncConnection>(pool));
 }
 
+AsyncPipeline AsyncRedisCluster::pipeline(const StringView &hash_tag) {
+    assert(_pool);
+
+    auto pool = _pool->fetch(hash_tag);
+    assert(pool);
+
+    return AsyncPipeline(pool);
+}
+
+AsyncTransaction AsyncRedisCluster::transaction(const StringView &hash_tag) {
+    assert(_pool);
+
+    auto pool = _pool->fetch(hash_tag);
+    assert(pool);
+
+    return AsyncTransaction(std::make_shared<GuardedAsyncConnection>(pool));
+}
+
 AsyncSubscriber AsyncRedisCluster::subscriber() {
     assert(_pool);
 
     auto opts = _pool->connection_options();
 
-    auto connection = std::make_shared<AsyncConnection>(opts, _loop);
+    auto loop = _loops->next();
+    auto connection = std::make_shared<AsyncConnection>(opts, loop);
     connection->set_subscriber_mode();
 
-    return AsyncSubscriber(_loop, std::move(connection));
+    return AsyncSubscriber(loop, std::move(connection));
 }
 
 AsyncSubscriber AsyncRedisCluster::subscriber(const StringView &hash_tag) {
@@ -75,10 +100,11 @@ AsyncSubscriber AsyncRedisCluster::subscriber(const StringView &hash_tag) {
 
     auto opts = _pool->connection_options(hash_tag);
 
-    auto connection = std::make_shared<AsyncConnection>(opts, _loop);
+    auto loop = _loops->next();
+    auto connection = std::make_shared<AsyncConnection>(opts, loop);
     connection->set_subscriber_mode();
 
-    return AsyncSubscriber(_loop, std::move(connection));
+    return AsyncSubscriber(loop, std::move(connection));
 }
 
 }
@@ -47,6 +47,14 @@ public:
 
     explicit AsyncRedisCluster(const std::string &uri) : AsyncRedisCluster(Uri(uri)) {}
 
+    // Connections are spread across event loops of the given group.
+    // See `AsyncRedis` for details.
+    AsyncRedisCluster(const EventLoopGroupSPtr &loops,
+            const ConnectionOptions &opts,
+            const ConnectionPoolOptions &pool_opts = {},
+            Role role = Role::MASTER,
+            const ClusterOptions &cluster_opts = {});
+
     AsyncRedisCluster(const AsyncRedisCluster &) = delete;
     AsyncRedisCluster& operator=(const AsyncRedisCluster &) = delete;
 
@@ -57,6 +65,16 @@ public:
 
     AsyncRedis redis(const StringView &hash_tag, bool new_connection = true);
 
+    // Create a pipeline to the node where the slot of `hash_tag` is located.
+    // All keys of the queued commands should be located on that node,
+    // and MOVED or ASK errors are NOT handled, i.e. they're set to the futures.
+    AsyncPipeline pipeline(const StringView &hash_tag);
+
+    // Create a transaction to the node where the slot of `hash_tag` is located.
+    // Like pipeline, all keys should be located on that node, and MOVED or ASK
+    // errors are NOT handled.
+    AsyncTransaction transaction(const StringView &hash_tag);
+
     AsyncSubscriber subscriber();
 
     AsyncSubscriber subscriber(const StringView &hash_tag);
@@ -99,7 +117,7 @@ public:
             CmdArgs cmd_args;
             cmd_args.append(cmd_name);
             while (start != stop) {
-                cmd_args.append(*start);
+                cmd_args.append_copy(*start);
                 ++start;
             }
             return fmt::format_cmd(cmd_args);
@@ -122,7 +140,7 @@ public:
             CmdArgs cmd_args;
             cmd_args.append(cmd_name);
             while (start != stop) {
-                cmd_args.append(*start);
+                cmd_args.append_copy(*start);
                 ++start;
             }
             return fmt::format_cmd(cmd_args);
@@ -1440,7 +1458,7 @@ private:
                 std::forward<Callback>(cb), formatter, std::forward<Key>(key), std::forward<Args>(args)...);
     }
 
-    EventLoopSPtr _loop;
+    EventLoopGroupSPtr _loops;
 
     AsyncShardsPoolSPtr _pool;
 };
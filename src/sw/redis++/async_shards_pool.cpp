@@ -16,6 +16,7 @@
 
 #include "sw/redis++/async_shards_pool.h"
 #include <cassert>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include "sw/redis++/errors.h"
@@ -24,9 +25,16 @@ namespace sw {
 
 namespace redis {
 
+namespace {
+
+// Same as ShardsPool, a table retired for this period is no longer used by readers.
+const auto SLOT_TABLE_GRACE_PERIOD = std::chrono::seconds(1);
+
+}
+
 const std::size_t AsyncShardsPool::SHARDS;
 
-AsyncShardsPool::AsyncShardsPool(const EventLoopSPtr &loop,
+AsyncShardsPool::AsyncShardsPool(const EventLoopGroupSPtr &loops,
         const ConnectionPoolOptions &pool_opts,
         const ConnectionOptions &connection_opts,
         Role role,
@@ -35,8 +43,8 @@ AsyncShardsPool::AsyncShardsPool(const EventLoopSPtr &loop,
             _connection_opts(connection_opts),
             _role(role),
             _cluster_opts(cluster_opts),
-            _loop(loop) {
-    assert(loop);
+            _loops(loops) {
+    assert(loops);
 
     if (_connection_opts.type != ConnectionType::TCP) {
         throw Error("Only support TCP connection for Redis Cluster");
@@ -47,7 +55,9 @@ AsyncShardsPool::AsyncShardsPool(const EventLoopSPtr &loop,
     auto node = Node{_connection_opts.host, _connection_opts.port};
     _shards.emplace(SlotRange{0U, SHARDS}, node);
     _pools.emplace(node,
-            std::make_shared<AsyncConnectionPool>(_loop, _pool_opts, _connection_opts));
+            std::make_shared<AsyncConnectionPool>(_loops, _pool_opts, _connection_opts));
+
+    _publish(_build_slot_table());
 
     _worker = std::thread([this]() { this->_run(); });
 
@@ -94,6 +104,14 @@ void AsyncShardsPool::update(const std::string &key, AsyncEventUPtr event) {
     {
         std::lock_guard<std::mutex> lock(_mutex);
 
+        // If the worker is updating the slot-node mapping, the event piggybacks on that
+        // update, i.e. single-flight, so that lots of events failed at the same time,
+        // e.g. a node is down, won't trigger lots of CLUSTER SLOTS commands.
+        // A null event stops the worker, and it doesn't need an update.
+        if (event && !_updating) {
+            _update_needed = true;
+        }
+
         _events.push(RedeliverEvent{key, std::move(event)});
     }
 
@@ -117,9 +135,7 @@ ConnectionOptions AsyncShardsPool::connection_options() {
 }
 
 ConnectionOptions AsyncShardsPool::_connection_options(Slot slot) {
-    std::lock_guard<std::mutex> lock(_mutex);
-
-    auto &pool = _get_pool(slot);
+    auto pool = _fetch(slot);
 
     assert(pool);
 
@@ -127,33 +143,7 @@ ConnectionOptions AsyncShardsPool::_connection_options(Slot slot) {
 }
 
 Slot AsyncShardsPool::_slot(const StringView &key) const {
-    // The following code is copied from: https://redis.io/topics/cluster-spec
-    // And I did some minor changes.
-
-    const auto *k = key.data();
-    auto keylen = static_cast<int>(key.size());
-
-    // start-end indexes of { and }.
-    int s = 0;
-    int e = 0;
-
-    // Search the first occurrence of '{'.
-    for (s = 0; s < keylen; s++)
-        if (k[s] == '{') break;
-
-    // No '{' ? Hash the whole key. This is the base case.
-    if (s == keylen) return crc16(k, keylen) & SHARDS;
-
-    // '{' found? Check if we have the corresponding '}'.
-    for (e = s + 1; e < keylen; e++)
-        if (k[e] == '}') break;
-
-    // No '}' or nothing between {} ? Hash the whole key.
-    if (e == keylen || e == s + 1) return crc16(k, keylen) & SHARDS;
-
-    // If we are here there is both a { and a } on its right. Hash
-    // what is in the middle between { and }.
-    return crc16(k + s + 1, e - s - 1) & SHARDS;
+    return key_slot(key);
 }
 
 Slot AsyncShardsPool::_slot() const {
@@ -161,32 +151,32 @@ Slot AsyncShardsPool::_slot() const {
 }
 
 AsyncConnectionPoolSPtr AsyncShardsPool::_fetch(Slot slot) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    // The table won't be freed while we're using it, see `_publish`.
+    const auto *table = _slot_table.load(std::memory_order_acquire);
 
-    return _get_pool(slot);
-}
+    assert(table && slot < table->size());
 
-AsyncConnectionPoolSPtr& AsyncShardsPool::_get_pool(Slot slot) {
-    const auto &node = _get_node(slot);
-
-    auto node_iter = _pools.find(node);
-    if (node_iter == _pools.end()) {
+    const auto &pool = (*table)[slot];
+    if (!pool) {
         throw SlotUncoveredError(slot);
     }
 
-    return node_iter->second;
+    return pool;
 }
 
 void AsyncShardsPool::_run() {
     while (true) {
-        auto events = _fetch_events();
+        auto need_update = false;
+        auto events = _fetch_events(need_update);
 
         assert(!events.empty());
 
         try {
-            // TODO: when we try to stop the worker thread,
-            // we don't need to call `_update_shards`
-            _update_shards();
+            if (need_update) {
+                _update_shards();
+
+                _finish_update();
+            }
 
             // if _redeliver_events or _fail_events returns true if there's a null event,
             // and we exit the thread loop.
@@ -194,6 +184,8 @@ void AsyncShardsPool::_run() {
                 break;
             }
         } catch (...) {
+            _finish_update();
+
             if (_fail_events(events, std::current_exception())) {
                 break;
             }
@@ -206,7 +198,7 @@ void AsyncShardsPool::_run() {
     }
 }
 
-auto AsyncShardsPool::_fetch_events() -> std::queue<RedeliverEvent> {
+auto AsyncShardsPool::_fetch_events(bool &need_update) -> std::queue<RedeliverEvent> {
     std::queue<RedeliverEvent> events;
 
     std::unique_lock<std::mutex> lock(_mutex);
@@ -216,13 +208,25 @@ auto AsyncShardsPool::_fetch_events() -> std::queue<RedeliverEvent> {
             [this]() { return !(this->_events).empty(); })) {
         // Reach timeout, but there's still no event, put an update event.
         _events.push(RedeliverEvent{{}, AsyncEventUPtr(new UpdateShardsEvent)});
+        _update_needed = true;
     }
 
     events.swap(_events);
 
+    // Events queued from now on piggyback on this update.
+    need_update = _update_needed;
+    _updating = _update_needed;
+    _update_needed = false;
+
     return events;
 }
 
+void AsyncShardsPool::_finish_update() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _updating = false;
+}
+
 std::size_t AsyncShardsPool::_random(std::size_t min, std::size_t max) const {
     static thread_local std::default_random_engine engine;
 
@@ -294,6 +298,8 @@ void AsyncShardsPool::_update_shards() {
                 }
             }
 
+            _publish(_build_slot_table());
+
             // Update successfully.
             return;
         } catch (const Error &) {
@@ -315,7 +321,45 @@ auto AsyncShardsPool::_add_node(const Node &node) -> NodeMap::iterator {
     }
 
     return _pools.emplace(node,
-            std::make_shared<AsyncConnectionPool>(_loop, _pool_opts, opts)).first;
+            std::make_shared<AsyncConnectionPool>(_loops, _pool_opts, opts)).first;
+}
+
+auto AsyncShardsPool::_build_slot_table() const -> SlotTableUPtr {
+    std::unique_ptr<SlotTable> table(new SlotTable(SHARDS + 1));
+    for (const auto &shard : _shards) {
+        auto iter = _pools.find(shard.second);
+        if (iter == _pools.end()) {
+            continue;
+        }
+
+        const auto &range = shard.first;
+        auto max_slot = std::min<Slot>(range.max, SHARDS);
+        for (auto slot = range.min; slot <= max_slot; ++slot) {
+            (*table)[slot] = iter->second;
+        }
+    }
+
+    return SlotTableUPtr(std::move(table));
+}
+
+void AsyncShardsPool::_publish(SlotTableUPtr table) {
+    assert(table);
+
+    auto now = std::chrono::steady_clock::now();
+
+    auto iter = _retired_tables.begin();
+    while (iter != _retired_tables.end() && now - iter->first >= SLOT_TABLE_GRACE_PERIOD) {
+        ++iter;
+    }
+    _retired_tables.erase(_retired_tables.begin(), iter);
+
+    _slot_table.store(table.get(), std::memory_order_release);
+
+    if (_current_table) {
+        _retired_tables.emplace_back(now, std::move(_current_table));
+    }
+
+    _current_table = std::move(table);
 }
 
 bool AsyncShardsPool::_redeliver_events(std::queue<RedeliverEvent> &events) {
@@ -337,7 +381,11 @@ bool AsyncShardsPool::_redeliver_events(std::queue<RedeliverEvent> &events) {
 
             connection.connection().send(std::move(async_event));
         } catch (...) {
-            event.event->set_exception(std::current_exception());
+            // If `send` throws, the event has already been released.
+            if (event.event) {
+                event.event->set_exception(std::current_exception());
+                event.event.release()->done();
+            }
         }
         events.pop();
     }
@@ -355,6 +403,7 @@ bool AsyncShardsPool::_fail_events(std::queue<RedeliverEvent> &events,
             should_stop_worker = true;
         } else {
             async_event->set_exception(err);
+            async_event.release()->done();
         }
         events.pop();
     }
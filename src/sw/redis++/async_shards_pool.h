@@ -17,12 +17,15 @@
 #ifndef SEWENEW_REDISPLUSPLUS_ASYNC_SHARDS_POOL_H
 #define SEWENEW_REDISPLUSPLUS_ASYNC_SHARDS_POOL_H
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <exception>
 #include <thread>
 #include <queue>
 #include <memory>
+#include <vector>
 #include "sw/redis++/shards_pool.h"
 #include "sw/redis++/async_connection_pool.h"
 
@@ -40,7 +43,7 @@ public:
 
     ~AsyncShardsPool();
 
-    AsyncShardsPool(const EventLoopSPtr &loop,
+    AsyncShardsPool(const EventLoopGroupSPtr &loops,
                 const ConnectionPoolOptions &pool_opts,
                 const ConnectionOptions &connection_opts,
                 Role role,
@@ -74,7 +77,10 @@ private:
 
     Slot _slot() const;
 
-    std::queue<RedeliverEvent> _fetch_events();
+    // Fetch events to be redelivered, and check if the slot-node mapping should be updated.
+    std::queue<RedeliverEvent> _fetch_events(bool &need_update);
+
+    void _finish_update();
 
     void _update_shards();
 
@@ -90,10 +96,20 @@ private:
 
     const Node& _get_node(Slot slot) const;
 
-    AsyncConnectionPoolSPtr& _get_pool(Slot slot);
-
     ConnectionOptions _connection_options(Slot slot);
 
+    // Same as ShardsPool, slot -> connection pool, published with an atomic raw pointer.
+    using SlotTable = std::vector<AsyncConnectionPoolSPtr>;
+
+    using SlotTableUPtr = std::unique_ptr<const SlotTable>;
+
+    // NOTE: `_mutex` should be held, if the worker thread has been started.
+    SlotTableUPtr _build_slot_table() const;
+
+    // Same as ShardsPool::_publish.
+    // NOTE: `_mutex` should be held, if the worker thread has been started.
+    void _publish(SlotTableUPtr table);
+
     Shards _get_shards(const std::string &host, int port);
 
     ConnectionPoolOptions _pool_opts;
@@ -108,7 +124,15 @@ private:
 
     NodeMap _pools;
 
-    EventLoopWPtr _loop;
+    // Loaded by `_fetch` without lock, and it points to `_current_table`.
+    std::atomic<const SlotTable *> _slot_table{nullptr};
+
+    SlotTableUPtr _current_table;
+
+    // Old tables with the time they're retired, see ShardsPool::_retired_tables.
+    std::vector<std::pair<std::chrono::steady_clock::time_point, SlotTableUPtr>> _retired_tables;
+
+    EventLoopGroupWPtr _loops;
 
     std::thread _worker;
 
@@ -118,6 +142,12 @@ private:
 
     std::queue<RedeliverEvent> _events;
 
+    // Whether the worker thread is updating the slot-node mapping.
+    bool _updating = false;
+
+    // Whether an event, which is queued when no update is in flight, needs an update.
+    bool _update_needed = false;
+
     static const std::size_t SHARDS = 16383;
 };
 
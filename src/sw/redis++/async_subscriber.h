@@ -36,7 +36,7 @@ private:
     static void _subscribe_callback(redisAsyncContext *ctx, void *r, void * /*privdata*/);
 };
 
-using SubscribeEventUPtr = std::unique_ptr<SubscribeEvent>;
+using SubscribeEventUPtr = std::unique_ptr<SubscribeEvent, AsyncEventDeleter>;
 
 class AsyncSubscriber {
 public:
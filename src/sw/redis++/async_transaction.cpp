@@ -0,0 +1,248 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+
+#include "sw/redis++/async_transaction.h"
+#include <cassert>
+#include "sw/redis++/async_redis.h"
+#include "sw/redis++/errors.h"
+#include "sw/redis++/reply.h"
+
+namespace sw {
+
+namespace redis {
+
+bool TransactionEventBase::handle(redisAsyncContext &ctx) {
+    if (redisAsyncCommand(&ctx, nullptr, nullptr, "MULTI") != REDIS_OK) {
+        throw_error(ctx.c, "failed to send MULTI command");
+    }
+
+    for (auto &event : _events) {
+        assert(event);
+
+        event->handle_without_reply(ctx);
+    }
+
+    // If it fails to send any command above, the connection will be closed, and
+    // callbacks of MULTI and queued commands, which are null, will never be called.
+    if (redisAsyncCommand(&ctx, _exec_callback, this, "EXEC") != REDIS_OK) {
+        throw_error(ctx.c, "failed to send EXEC command");
+    }
+
+    return true;
+}
+
+void TransactionEventBase::set_exception(std::exception_ptr err) {
+    for (auto &event : _events) {
+        event->set_exception(err);
+    }
+
+    _set_result(err);
+}
+
+void TransactionEventBase::set_value(redisReply &reply) {
+    if (reply::is_nil(reply)) {
+        // Execution has been aborted, i.e. watched key has been modified.
+        throw WatchError();
+    }
+
+    if (!reply::is_array(reply)) {
+        throw ProtoError("Expect ARRAY reply");
+    }
+
+    if (reply.elements != _events.size() || (reply.elements > 0 && reply.element == nullptr)) {
+        throw ProtoError("Mismatched number of replies of EXEC");
+    }
+
+    std::exception_ptr first_err;
+    for (std::size_t idx = 0; idx != _events.size(); ++idx) {
+        auto &event = _events[idx];
+        auto *sub_reply = reply.element[idx];
+
+        try {
+            if (sub_reply == nullptr) {
+                throw ProtoError("Null reply of EXEC");
+            }
+
+            if (reply::is_error(*sub_reply)) {
+                throw_error(*sub_reply);
+            }
+
+            event->set_value(*sub_reply);
+        } catch (...) {
+            auto err = std::current_exception();
+            event->set_exception(err);
+
+            if (!first_err) {
+                first_err = err;
+            }
+        }
+    }
+
+    _set_result(first_err);
+}
+
+void TransactionEventBase::_exec_callback(redisAsyncContext *ctx, void *r, void *privdata) {
+    auto event = static_cast<TransactionEventBase *>(privdata);
+
+    assert(event != nullptr && ctx != nullptr);
+
+    try {
+        redisReply *reply = static_cast<redisReply *>(r);
+        if (reply == nullptr) {
+            throw_error(ctx->c, "null reply");
+        } else if (reply::is_error(*reply)) {
+            // e.g. EXECABORT, if any command fails to be queued.
+            throw_error(*reply);
+        } else {
+            event->set_value(*reply);
+        }
+    } catch (...) {
+        event->set_exception(std::current_exception());
+    }
+
+    event->done();
+}
+
+void TransactionEvent::_set_result(std::exception_ptr err) {
+    if (err) {
+        _pro.set_exception(err);
+    } else {
+        _pro.set_value();
+    }
+}
+
+AsyncTransaction::AsyncTransaction(AsyncTransaction &&that) noexcept :
+    _connection(std::move(that._connection)),
+    _events(std::move(that._events)),
+    _watching(that._watching) {
+    that._events.clear();
+    that._watching = false;
+}
+
+AsyncTransaction& AsyncTransaction::operator=(AsyncTransaction &&that) noexcept {
+    if (this != &that) {
+        _reset();
+
+        _connection = std::move(that._connection);
+        _events = std::move(that._events);
+        _watching = that._watching;
+
+        that._events.clear();
+        that._watching = false;
+    }
+
+    return *this;
+}
+
+AsyncTransaction::~AsyncTransaction() {
+    _reset();
+}
+
+Future<void> AsyncTransaction::exec() {
+    if (_events.empty()) {
+        Promise<void> pro;
+        pro.set_value();
+
+        return pro.get_future();
+    }
+
+    auto &connection = _fetch_connection();
+
+    auto event = TransactionEventUPtr(new TransactionEvent(std::move(_events)));
+
+    _events.clear();
+    _watching = false;
+
+    auto fut = event->get_future();
+
+    connection.send(std::move(event));
+
+    return fut;
+}
+
+bool AsyncTransaction::co_exec(TransactionEventBase &event) {
+    if (_events.empty()) {
+        return false;
+    }
+
+    auto &connection = _fetch_connection();
+
+    event._events = std::move(_events);
+
+    _events.clear();
+    _watching = false;
+
+    connection.send(AsyncEventUPtr(&event));
+
+    return true;
+}
+
+AsyncRedis AsyncTransaction::redis() {
+    return AsyncRedis(_connection);
+}
+
+Future<void> AsyncTransaction::watch(const StringView &key) {
+    auto fut = _send(fmt::watch(key));
+
+    _watching = true;
+
+    return fut;
+}
+
+Future<void> AsyncTransaction::unwatch() {
+    auto fut = _send(fmt::unwatch());
+
+    _watching = false;
+
+    return fut;
+}
+
+AsyncConnection& AsyncTransaction::_fetch_connection() {
+    assert(_connection);
+
+    auto &connection = _connection->connection();
+    if (connection.broken()) {
+        throw Error("connection is broken");
+    }
+
+    return connection;
+}
+
+void AsyncTransaction::_reset() noexcept {
+    // Futures of discarded commands will be broken.
+    _events.clear();
+
+    if (!_connection || !_watching) {
+        return;
+    }
+
+    // The connection will be returned to the pool, and keys watched
+    // by this transaction should not abort other transactions.
+    try {
+        unwatch();
+    } catch (...) {
+        // Connection is broken, and it will be reconnected.
+    }
+}
+
+Future<void> AsyncTransaction::_send(FormattedCommand cmd) {
+    return _fetch_connection().send<void, DefaultResultParser<void>>(std::move(cmd));
+}
+
+}
+
+}
@@ -0,0 +1,467 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+
+#ifndef SEWENEW_REDISPLUSPLUS_ASYNC_TRANSACTION_H
+#define SEWENEW_REDISPLUSPLUS_ASYNC_TRANSACTION_H
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+#include "sw/redis++/async_connection.h"
+#include "sw/redis++/cmd_formatter.h"
+#include "sw/redis++/command_args.h"
+#include "sw/redis++/errors.h"
+#include "sw/redis++/utils.h"
+
+namespace sw {
+
+namespace redis {
+
+class AsyncRedis;
+
+// Send MULTI, all queued commands and EXEC with a single event. Replies of MULTI
+// and queued commands, i.e. +QUEUED, are ignored, and the reply of EXEC is dispatched
+// to the queued commands. If any command fails to be queued, EXEC fails with EXECABORT.
+// The result of the transaction, i.e. the first error, is set with `_set_result`.
+class TransactionEventBase : public AsyncEvent {
+public:
+    TransactionEventBase() = default;
+
+    explicit TransactionEventBase(std::vector<CommandEventBaseUPtr> events) :
+        _events(std::move(events)) {}
+
+    virtual bool handle(redisAsyncContext &ctx) override;
+
+    virtual void set_exception(std::exception_ptr err) override;
+
+    virtual void set_value(redisReply &reply) override;
+
+protected:
+    virtual void _set_result(std::exception_ptr err) = 0;
+
+private:
+    friend class AsyncTransaction;
+
+    static void _exec_callback(redisAsyncContext *ctx, void *r, void *privdata);
+
+    std::vector<CommandEventBaseUPtr> _events;
+};
+
+class TransactionEvent : public TransactionEventBase {
+public:
+    explicit TransactionEvent(std::vector<CommandEventBaseUPtr> events) :
+        TransactionEventBase(std::move(events)) {}
+
+    Future<void> get_future() {
+        return _pro.get_future();
+    }
+
+protected:
+    virtual void _set_result(std::exception_ptr err) override;
+
+private:
+    Promise<void> _pro;
+};
+
+using TransactionEventUPtr = std::unique_ptr<TransactionEvent, AsyncEventDeleter>;
+
+template <typename Callback>
+class CallbackTransactionEvent : public TransactionEvent {
+public:
+    CallbackTransactionEvent(std::vector<CommandEventBaseUPtr> events, Callback &&cb) :
+        TransactionEvent(std::move(events)), _cb(std::forward<Callback>(cb)) {}
+
+protected:
+    virtual void _set_result(std::exception_ptr err) override {
+        TransactionEvent::_set_result(err);
+        _run_callback();
+    }
+
+private:
+    void _run_callback() {
+        try {
+            _cb(TransactionEvent::get_future());
+        } catch (...) {
+            // Catch all possible exceptions thrown by user defined callbacks.
+        }
+    }
+
+    Callback _cb;
+};
+
+// A transaction owns a connection, which is fetched from the pool, until it's destroyed.
+// So that keys can be watched, and read with `AsyncTransaction::redis()`, before
+// queued commands are sent with MULTI and EXEC.
+class AsyncTransaction {
+public:
+    AsyncTransaction(const AsyncTransaction &) = delete;
+    AsyncTransaction& operator=(const AsyncTransaction &) = delete;
+
+    AsyncTransaction(AsyncTransaction &&that) noexcept;
+
+    // Keys watched by this transaction are unwatched, and queued commands are discarded,
+    // before taking over the connection of `that`.
+    AsyncTransaction& operator=(AsyncTransaction &&that) noexcept;
+
+    ~AsyncTransaction();
+
+    // Send all queued commands with MULTI and EXEC in a single event.
+    // The returned future is ready when the reply of EXEC has been received, and
+    // futures of queued commands are ready before that. If any command fails, the
+    // future holds the first exception. If watched keys have been modified, the
+    // transaction is aborted, and both the returned future and futures of queued
+    // commands hold a WatchError.
+    Future<void> exec();
+
+    template <typename Callback>
+    void exec(Callback &&cb);
+
+    // Send queued commands with an event owned by the caller, e.g. an event embedded
+    // in a coroutine awaiter. Check `AsyncRedis::co_send` for detail. Return false,
+    // if there's no queued command, and the event is NOT sent.
+    bool co_exec(TransactionEventBase &event);
+
+    // Discard all queued commands. Futures of these commands will be broken.
+    void discard() {
+        _events.clear();
+    }
+
+    // Number of queued commands.
+    std::size_t size() const {
+        return _events.size();
+    }
+
+    // Get an AsyncRedis object, which sends commands with the connection of
+    // this transaction immediately, e.g. read watched keys.
+    AsyncRedis redis();
+
+    // WATCH and UNWATCH are sent immediately, instead of being queued.
+
+    Future<void> watch(const StringView &key);
+
+    template <typename Input>
+    Future<void> watch(Input first, Input last) {
+        range_check("WATCH", first, last);
+
+        auto fut = _send(fmt::watch_range(first, last));
+
+        _watching = true;
+
+        return fut;
+    }
+
+    template <typename T>
+    Future<void> watch(std::initializer_list<T> il) {
+        return watch(il.begin(), il.end());
+    }
+
+    Future<void> unwatch();
+
+    template <typename Result, typename ...Args>
+    Future<Result> command(const StringView &cmd_name, Args &&...args) {
+        CmdArgs cmd_args;
+        cmd_args.append(cmd_name, std::forward<Args>(args)...);
+
+        return _command<Result>(fmt::format_cmd(cmd_args));
+    }
+
+    template <typename Result, typename Input>
+    auto command(Input first, Input last)
+        -> typename std::enable_if<IsIter<Input>::value, Future<Result>>::type {
+        CmdArgs cmd_args;
+        while (first != last) {
+            cmd_args.append_copy(*first);
+            ++first;
+        }
+
+        return _command<Result>(fmt::format_cmd(cmd_args));
+    }
+
+    // KEY commands.
+
+    Future<long long> del(const StringView &key) {
+        return _command<long long>(fmt::del(key));
+    }
+
+    Future<long long> exists(const StringView &key) {
+        return _command<long long>(fmt::exists(key));
+    }
+
+    Future<bool> expire(const StringView &key, const std::chrono::seconds &timeout) {
+        return _command<bool>(fmt::expire(key, timeout));
+    }
+
+    Future<bool> pexpire(const StringView &key, const std::chrono::milliseconds &timeout) {
+        return _command<bool>(fmt::pexpire(key, timeout));
+    }
+
+    // STRING commands.
+
+    Future<OptionalString> get(const StringView &key) {
+        return _command<OptionalString>(fmt::get(key));
+    }
+
+    Future<long long> incr(const StringView &key) {
+        return _command<long long>(fmt::incr(key));
+    }
+
+    Future<long long> incrby(const StringView &key, long long increment) {
+        return _command<long long>(fmt::incrby(key, increment));
+    }
+
+    Future<bool> set(const StringView &key,
+                const StringView &val,
+                const std::chrono::milliseconds &ttl = std::chrono::milliseconds(0),
+                UpdateType type = UpdateType::ALWAYS) {
+        return _command<bool, fmt::SetResultParser>(fmt::set(key, val, ttl, type));
+    }
+
+    // LIST commands.
+
+    Future<long long> lpush(const StringView &key, const StringView &val) {
+        return _command<long long>(fmt::lpush(key, val));
+    }
+
+    Future<long long> rpush(const StringView &key, const StringView &val) {
+        return _command<long long>(fmt::rpush(key, val));
+    }
+
+    // HASH commands.
+
+    Future<long long> hdel(const StringView &key, const StringView &field) {
+        return _command<long long>(fmt::hdel(key, field));
+    }
+
+    Future<OptionalString> hget(const StringView &key, const StringView &field) {
+        return _command<OptionalString>(fmt::hget(key, field));
+    }
+
+    Future<long long> hset(const StringView &key, const StringView &field, const StringView &val) {
+        return _command<long long>(fmt::hset(key, field, val));
+    }
+
+    // SET commands.
+
+    Future<long long> sadd(const StringView &key, const StringView &member) {
+        return _command<long long>(fmt::sadd(key, member));
+    }
+
+    // PUBSUB commands.
+
+    Future<long long> publish(const StringView &channel, const StringView &message) {
+        return _command<long long>(fmt::publish(channel, message));
+    }
+
+private:
+    friend class AsyncRedis;
+    friend class AsyncRedisCluster;
+
+    explicit AsyncTransaction(const GuardedAsyncConnectionSPtr &connection) : _connection(connection) {
+        assert(_connection);
+    }
+
+    AsyncConnection& _fetch_connection();
+
+    // Unwatch keys and discard queued commands, before the connection is released.
+    void _reset() noexcept;
+
+    Future<void> _send(FormattedCommand cmd);
+
+    template <typename Result, typename ResultParser = DefaultResultParser<Result>>
+    Future<Result> _command(FormattedCommand cmd) {
+        auto event = CommandEventUPtr<Result, ResultParser>(
+                new CommandEvent<Result, ResultParser>(std::move(cmd)));
+
+        auto fut = event->get_future();
+
+        _events.push_back(std::move(event));
+
+        return fut;
+    }
+
+    GuardedAsyncConnectionSPtr _connection;
+
+    std::vector<CommandEventBaseUPtr> _events;
+
+    // Whether keys are being watched, i.e. WATCH has been sent without EXEC or UNWATCH.
+    bool _watching = false;
+};
+
+template <typename Callback>
+void AsyncTransaction::exec(Callback &&cb) {
+    if (_events.empty()) {
+        Promise<void> pro;
+        pro.set_value();
+
+        cb(pro.get_future());
+
+        return;
+    }
+
+    auto &connection = _fetch_connection();
+
+    auto event = TransactionEventUPtr(new CallbackTransactionEvent<Callback>(std::move(_events),
+                std::forward<Callback>(cb)));
+
+    _events.clear();
+    _watching = false;
+
+    connection.send(std::move(event));
+}
+
+// Passed to the function run by `AsyncRedis::transaction(func, max_retries, cb)`. Call it
+// after commands have been queued, e.g. in the callback of reading watched keys, to execute
+// the transaction. Call it with an exception to abort the transaction instead. Only the first
+// call takes effect, and calls after the transaction has finished are ignored.
+class TransactionExec {
+public:
+    explicit TransactionExec(std::function<void (std::exception_ptr)> exec) :
+        _exec(std::move(exec)) {}
+
+    void operator()() const {
+        _exec(nullptr);
+    }
+
+    void operator()(std::exception_ptr err) const {
+        _exec(err);
+    }
+
+private:
+    std::function<void (std::exception_ptr)> _exec;
+};
+
+namespace detail {
+
+// Run a transaction with `func`, and run it again, with the same connection, if watched keys
+// have been modified. It's kept alive by the callbacks of its commands, and never blocks,
+// so that retries run in the event loop thread.
+template <typename Func, typename Callback>
+class TransactionRetry : public std::enable_shared_from_this<TransactionRetry<Func, Callback>> {
+public:
+    template <typename F, typename C>
+    TransactionRetry(AsyncTransaction tx, F &&func, std::size_t max_retries, C &&cb) :
+        _tx(std::move(tx)),
+        _func(std::forward<F>(func)),
+        _max_retries(max_retries),
+        _cb(std::forward<C>(cb)) {}
+
+    void run() {
+        auto self = this->shared_from_this();
+
+        // Each attempt has its own flag, which is set by the first call of its
+        // `TransactionExec`, or by an exception thrown by `func`. Later calls, including
+        // stale ones of previous attempts, are ignored, since the attempt has finished.
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+
+        try {
+            _func(_tx, TransactionExec([self, finished](std::exception_ptr err) {
+                            if (!finished->exchange(true)) {
+                                self->_exec(err);
+                            }
+                        }));
+        } catch (...) {
+            // If `TransactionExec` has been called, its result is reported instead.
+            if (!finished->exchange(true)) {
+                _done(std::current_exception());
+            }
+        }
+    }
+
+private:
+    void _exec(std::exception_ptr err) {
+        if (err) {
+            // Keys are unwatched when the transaction is destroyed.
+            _tx.discard();
+            _done(err);
+            return;
+        }
+
+        auto self = this->shared_from_this();
+
+        try {
+            _tx.exec([self](Future<void> &&fut) {
+                        self->_on_exec(std::move(fut));
+                    });
+        } catch (...) {
+            _done(std::current_exception());
+        }
+    }
+
+    void _on_exec(Future<void> &&fut) {
+        try {
+            fut.get();
+        } catch (const WatchError &) {
+            if (_retries < _max_retries) {
+                ++_retries;
+                run();
+            } else {
+                _done(std::current_exception());
+            }
+
+            return;
+        } catch (...) {
+            _done(std::current_exception());
+            return;
+        }
+
+        _done(nullptr);
+    }
+
+    void _done(std::exception_ptr err) {
+        {
+            // Return the connection to the pool, before the callback creates another
+            // transaction, e.g. a resumed coroutine, with a pool of a single connection.
+            auto tx = std::move(_tx);
+        }
+
+        Promise<void> pro;
+        if (err) {
+            pro.set_exception(err);
+        } else {
+            pro.set_value();
+        }
+
+        try {
+            _cb(pro.get_future());
+        } catch (...) {
+            // Catch all possible exceptions thrown by user defined callbacks.
+        }
+    }
+
+    AsyncTransaction _tx;
+
+    Func _func;
+
+    std::size_t _max_retries = 0;
+
+    std::size_t _retries = 0;
+
+    Callback _cb;
+};
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_ASYNC_TRANSACTION_H
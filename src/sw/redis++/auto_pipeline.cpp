@@ -0,0 +1,136 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/auto_pipeline.h"
+#include <cassert>
+#include "sw/redis++/errors.h"
+
+namespace sw {
+
+namespace redis {
+
+AutoPipeline::AutoPipeline(const ConnectionPoolSPtr &pool, std::size_t max_batches) :
+                            _pool(pool), _max_batches(max_batches) {
+    assert(_pool);
+
+    if (_max_batches == 0) {
+        throw Error("max number of batches of auto pipeline should be positive");
+    }
+}
+
+ReplyUPtr AutoPipeline::_command(Request &request) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _queue.push_back(&request);
+
+    while (!request.done) {
+        if (request.taken || _batches == _max_batches) {
+            // Wait for the reply, or a chance to lead the next batch.
+            request.cv.wait(lock);
+            continue;
+        }
+
+        // Lead a batch with all queued requests, including this one.
+        std::vector<Request *> batch;
+        batch.swap(_queue);
+        for (auto *req : batch) {
+            req->taken = true;
+        }
+
+        ++_batches;
+
+        lock.unlock();
+
+        _run_batch(batch);
+
+        lock.lock();
+
+        --_batches;
+
+        for (auto *req : batch) {
+            req->done = true;
+            if (req != &request) {
+                req->cv.notify_one();
+            }
+        }
+
+        if (!_queue.empty()) {
+            // Let a waiting caller lead the next batch.
+            _queue.front()->cv.notify_one();
+        }
+    }
+
+    lock.unlock();
+
+    if (request.err) {
+        std::rethrow_exception(request.err);
+    }
+
+    assert(request.reply);
+
+    if (reply::is_error(*request.reply)) {
+        throw_error(*request.reply);
+    }
+
+    return std::move(request.reply);
+}
+
+void AutoPipeline::_run_batch(const std::vector<Request *> &batch) {
+    try {
+        SafeConnection safe_connection(*_pool);
+        auto &connection = safe_connection.connection();
+
+        for (auto *req : batch) {
+            try {
+                req->send(connection);
+                req->sent = true;
+            } catch (...) {
+                req->err = std::current_exception();
+                if (connection.broken()) {
+                    _fail_batch(batch, req->err);
+                    return;
+                }
+            }
+        }
+
+        // Commands are buffered, and written to the socket with a single write,
+        // before receiving the first reply.
+        for (auto *req : batch) {
+            if (!req->sent) {
+                continue;
+            }
+
+            // Error replies are thrown by the caller.
+            req->reply = connection.recv(false);
+        }
+    } catch (...) {
+        // Failed to fetch a connection, or the connection is broken. Since replies
+        // are matched in order, none of the remaining replies can be received.
+        _fail_batch(batch, std::current_exception());
+    }
+}
+
+void AutoPipeline::_fail_batch(const std::vector<Request *> &batch, std::exception_ptr err) {
+    for (auto *req : batch) {
+        if (!req->reply && !req->err) {
+            req->err = err;
+        }
+    }
+}
+
+}
+
+}
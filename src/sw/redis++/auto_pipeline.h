@@ -0,0 +1,135 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_AUTO_PIPELINE_H
+#define SEWENEW_REDISPLUSPLUS_AUTO_PIPELINE_H
+
+#include <cstddef>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "sw/redis++/connection.h"
+#include "sw/redis++/connection_pool.h"
+#include "sw/redis++/reply.h"
+
+namespace sw {
+
+namespace redis {
+
+// Implicitly pipeline commands sent by concurrent callers.
+//
+// A caller queues its command, and if less than `max_batches` batches are in flight,
+// it becomes the leader of a batch: it takes all queued commands, including commands
+// of other callers, fetches a connection from the pool, sends these commands with
+// a single write, and receives replies in FIFO order. Other callers block until their
+// replies are received, or one of them becomes the leader of the next batch.
+//
+// Without contention, each batch has a single command, and it costs the same as sending
+// the command with a connection fetched from the pool.
+class AutoPipeline {
+public:
+    AutoPipeline(const ConnectionPoolSPtr &pool, std::size_t max_batches);
+
+    AutoPipeline(const AutoPipeline &) = delete;
+    AutoPipeline& operator=(const AutoPipeline &) = delete;
+
+    AutoPipeline(AutoPipeline &&) = delete;
+    AutoPipeline& operator=(AutoPipeline &&) = delete;
+
+    ~AutoPipeline() = default;
+
+    // Send the command with the next batch, and block until its reply is received.
+    // If the reply is an error reply, it's thrown as an exception.
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr command(Cmd cmd, Args &&...args);
+
+private:
+    class Request {
+    public:
+        template <typename Send>
+        explicit Request(Send &send) :
+            _send(&send),
+            _invoke([](void *ctx, Connection &connection) {
+                        (*static_cast<Send *>(ctx))(connection);
+                    }) {}
+
+        void send(Connection &connection) {
+            _invoke(_send, connection);
+        }
+
+        ReplyUPtr reply;
+
+        std::exception_ptr err;
+
+        // Whether it has been taken by a leader.
+        bool taken = false;
+
+        // Whether `reply` or `err` has been set.
+        bool done = false;
+
+        // Whether it has been written to the connection, and a reply is expected.
+        bool sent = false;
+
+        std::condition_variable cv;
+
+    private:
+        void *_send;
+
+        void (*_invoke)(void *, Connection &);
+    };
+
+    ReplyUPtr _command(Request &request);
+
+    // Send commands of the batch, and receive their replies.
+    void _run_batch(const std::vector<Request *> &batch);
+
+    // Fail all requests in the batch, which have no reply.
+    void _fail_batch(const std::vector<Request *> &batch, std::exception_ptr err);
+
+    ConnectionPoolSPtr _pool;
+
+    std::size_t _max_batches;
+
+    std::mutex _mutex;
+
+    // Requests which have not been taken by any leader.
+    std::vector<Request *> _queue;
+
+    // Number of batches in flight.
+    std::size_t _batches = 0;
+};
+
+using AutoPipelineSPtr = std::shared_ptr<AutoPipeline>;
+
+template <typename Cmd, typename ...Args>
+ReplyUPtr AutoPipeline::command(Cmd cmd, Args &&...args) {
+    // The caller blocks until the command has been sent, so arguments can be referenced.
+    auto send = [&cmd, &args...](Connection &connection) {
+        cmd(connection, std::forward<Args>(args)...);
+    };
+
+    Request request(send);
+
+    return _command(request);
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_AUTO_PIPELINE_H
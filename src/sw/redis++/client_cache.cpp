@@ -0,0 +1,488 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/client_cache.h"
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include "sw/redis++/errors.h"
+
+namespace sw {
+
+namespace redis {
+
+bool CachedReply::cacheable(redisReply &reply) {
+    if (reply::is_nil(reply) || reply::is_string(reply)) {
+        return true;
+    }
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    if (!reply::is_array(reply) && !reply::is_map(reply) && !reply::is_set(reply)) {
+#else
+    if (!reply::is_array(reply)) {
+#endif
+        return false;
+    }
+
+    for (std::size_t idx = 0; idx != reply.elements; ++idx) {
+        auto *sub_reply = reply.element[idx];
+        if (sub_reply == nullptr
+                || !(reply::is_nil(*sub_reply) || reply::is_string(*sub_reply))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+CachedReply::CachedReply(redisReply &reply) {
+    assert(cacheable(reply));
+
+    if (reply::is_nil(reply) || reply::is_string(reply)) {
+        _copy(reply, _reply, _str);
+        return;
+    }
+
+    _reply.type = reply.type;
+    _reply.elements = reply.elements;
+
+    if (reply.elements == 0) {
+        return;
+    }
+
+    // These vectors are never resized again, so that pointers to their elements are stable.
+    _strs.resize(reply.elements);
+    _elements.resize(reply.elements);
+    _element_ptrs.resize(reply.elements);
+    for (std::size_t idx = 0; idx != reply.elements; ++idx) {
+        _copy(*(reply.element[idx]), _elements[idx], _strs[idx]);
+        _element_ptrs[idx] = &_elements[idx];
+    }
+
+    _reply.element = _element_ptrs.data();
+}
+
+void CachedReply::_copy(redisReply &from, redisReply &to, std::string &str) {
+    to = redisReply{};
+    to.type = from.type;
+
+    if (reply::is_string(from)) {
+        str.assign(from.str, from.len);
+        to.str = &str[0];
+        to.len = from.len;
+    }
+}
+
+ClientCache::ClientCache(const ClientCacheOptions &opts, const ConnectionPoolSPtr &pool) :
+    _opts(opts), _pool(pool) {
+    assert(_pool);
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    if (_opts.max_entries == 0 || _opts.shards == 0) {
+        throw Error("client cache: max_entries and shards must be positive");
+    }
+
+    if (_opts.mode != ClientTrackingMode::BCAST && !_opts.prefixes.empty()) {
+        throw Error("client cache: prefixes can only be used in BCAST mode");
+    }
+
+    auto shards = std::min(_opts.shards, _opts.max_entries);
+    _shard_capacity = _opts.max_entries / shards;
+
+    _shards.reserve(shards);
+    for (std::size_t idx = 0; idx != shards; ++idx) {
+        _shards.emplace_back(new Shard);
+    }
+
+    _listener = std::thread([this]() { this->_listen(); });
+#else
+    throw Error("client side caching requires hiredis with RESP3 support");
+#endif
+}
+
+ClientCache::~ClientCache() {
+    {
+        std::lock_guard<std::mutex> lock(_stop_mtx);
+
+        _stop = true;
+    }
+
+    _stop_cv.notify_all();
+
+    if (_listener.joinable()) {
+        _listener.join();
+    }
+}
+
+CachedReplySPtr ClientCache::command(CmdArgs &args) {
+    assert(args.size() >= 2);
+
+    const auto *argv = args.argv();
+    const auto *argv_len = args.argv_len();
+
+    std::string key(argv[1], argv_len[1]);
+
+    // Command name and arguments other than the key, each prefixed with its length,
+    // e.g. 4:HGET5:field.
+    std::string subkey;
+    for (std::size_t idx = 0; idx != args.size(); ++idx) {
+        if (idx == 1) {
+            continue;
+        }
+
+        subkey.append(std::to_string(argv_len[idx]));
+        subkey.push_back(':');
+        subkey.append(argv[idx], argv_len[idx]);
+    }
+
+    auto &shard = _shard(key);
+
+    std::uint64_t token = 0;
+    long long tracking_id = -1;
+    CachedReplySPtr cached_reply;
+    if (_trackable(key)) {
+        cached_reply = _get(shard, key, subkey, token, tracking_id);
+        if (cached_reply) {
+            return cached_reply;
+        }
+    }
+
+    auto tracked = false;
+    try {
+        auto reply = _fetch(args, token != 0 ? tracking_id : -1, tracked);
+
+        assert(reply);
+
+        if (!CachedReply::cacheable(*reply)) {
+            throw ParseError("STRING or NIL or ARRAY of STRING", *reply);
+        }
+
+        cached_reply = std::make_shared<const CachedReply>(*reply);
+    } catch (...) {
+        if (token != 0) {
+            _fill(shard, key, subkey, token, nullptr);
+        }
+
+        throw;
+    }
+
+    if (token != 0) {
+        // Without tracking, the reply might be stale at any time, and cannot be cached.
+        _fill(shard, key, subkey, token, tracked ? cached_reply : nullptr);
+    }
+
+    return cached_reply;
+}
+
+void ClientCache::flush() {
+    for (auto &shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard->mtx);
+
+        shard->entries.clear();
+        shard->lru.clear();
+        shard->size = 0;
+    }
+}
+
+ClientCache::Shard& ClientCache::_shard(const std::string &key) {
+    assert(!_shards.empty());
+
+    return *_shards[std::hash<std::string>{}(key) % _shards.size()];
+}
+
+bool ClientCache::_trackable(const std::string &key) const {
+    if (_opts.mode != ClientTrackingMode::BCAST || _opts.prefixes.empty()) {
+        return true;
+    }
+
+    for (const auto &prefix : _opts.prefixes) {
+        if (key.compare(0, prefix.size(), prefix) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+CachedReplySPtr ClientCache::_get(Shard &shard,
+                                    const std::string &key,
+                                    const std::string &subkey,
+                                    std::uint64_t &token,
+                                    long long &tracking_id) {
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    auto iter = shard.entries.find(key);
+    if (iter != shard.entries.end()) {
+        auto &entry = iter->second;
+        auto value_iter = entry.values.find(subkey);
+        if (value_iter != entry.values.end() && value_iter->second.reply) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+
+            return value_iter->second.reply;
+        }
+    }
+
+    // Since `_reset_tracking` resets `_tracking_id` before flushing all shards,
+    // we either get an invalid id, or get a reservation which will be flushed
+    // if the invalidation connection is broken.
+    tracking_id = _tracking_id.load();
+    if (tracking_id < 0) {
+        token = 0;
+        return nullptr;
+    }
+
+    token = ++_token;
+
+    if (iter == shard.entries.end()) {
+        shard.lru.push_front(key);
+        iter = shard.entries.emplace(key, Entry{}).first;
+        iter->second.lru = shard.lru.begin();
+    } else {
+        shard.lru.splice(shard.lru.begin(), shard.lru, iter->second.lru);
+    }
+
+    auto &values = iter->second.values;
+    auto value_iter = values.find(subkey);
+    if (value_iter == values.end()) {
+        value_iter = values.emplace(subkey, Value{}).first;
+        ++shard.size;
+    }
+
+    // If another thread is fetching the same reply, its reservation is replaced.
+    value_iter->second.token = token;
+
+    _evict(shard);
+
+    return nullptr;
+}
+
+void ClientCache::_fill(Shard &shard,
+                        const std::string &key,
+                        const std::string &subkey,
+                        std::uint64_t token,
+                        CachedReplySPtr reply) {
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    auto iter = shard.entries.find(key);
+    if (iter == shard.entries.end()) {
+        // Invalidated or evicted.
+        return;
+    }
+
+    auto &values = iter->second.values;
+    auto value_iter = values.find(subkey);
+    if (value_iter == values.end()
+            || value_iter->second.token != token
+            || value_iter->second.reply) {
+        return;
+    }
+
+    if (reply) {
+        value_iter->second.reply = std::move(reply);
+    } else {
+        values.erase(value_iter);
+        --shard.size;
+
+        if (values.empty()) {
+            _erase(shard, iter);
+        }
+    }
+}
+
+void ClientCache::_evict(Shard &shard) {
+    // Never evict the most recently used key.
+    while (shard.size > _shard_capacity && shard.lru.size() > 1) {
+        auto iter = shard.entries.find(shard.lru.back());
+        assert(iter != shard.entries.end());
+
+        _erase(shard, iter);
+    }
+}
+
+void ClientCache::_erase(Shard &shard, std::unordered_map<std::string, Entry>::iterator iter) {
+    assert(iter != shard.entries.end());
+
+    auto &entry = iter->second;
+
+    assert(shard.size >= entry.values.size());
+    shard.size -= entry.values.size();
+
+    shard.lru.erase(entry.lru);
+    shard.entries.erase(iter);
+}
+
+void ClientCache::_invalidate(const std::string &key) {
+    auto &shard = _shard(key);
+
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    auto iter = shard.entries.find(key);
+    if (iter != shard.entries.end()) {
+        _erase(shard, iter);
+    }
+}
+
+ReplyUPtr ClientCache::_fetch(CmdArgs &args, long long tracking_id, bool &tracked) {
+    SafeConnection safe_connection(*_pool);
+    auto &connection = safe_connection.connection();
+
+    if (tracking_id < 0 || _opts.mode != ClientTrackingMode::DEFAULT) {
+        // In BCAST mode, keys are tracked by the invalidation connection.
+        tracked = (tracking_id >= 0);
+
+        connection.send(args);
+
+        return connection.recv();
+    }
+
+    // Redirect invalidation messages to the invalidation connection,
+    // and only track keys read by the following command, i.e. OPTIN.
+    CmdArgs tracking_args;
+    tracking_args << "CLIENT" << "TRACKING" << "ON" << "REDIRECT" << tracking_id << "OPTIN";
+    connection.send(tracking_args);
+
+    CmdArgs caching_args;
+    caching_args << "CLIENT" << "CACHING" << "YES";
+    connection.send(caching_args);
+
+    connection.send(args);
+
+    auto tracking_reply = connection.recv(false);
+    auto caching_reply = connection.recv(false);
+    auto reply = connection.recv();
+
+    // If tracking fails, e.g. the invalidation connection has been closed,
+    // the key is not tracked.
+    tracked = !reply::is_error(*tracking_reply) && !reply::is_error(*caching_reply);
+
+    return reply;
+}
+
+void ClientCache::_listen() {
+    while (!_stop) {
+        try {
+            auto connection = _connect();
+
+            while (!_stop) {
+                ReplyUPtr reply;
+                try {
+                    reply = connection.recv(false);
+                } catch (const TimeoutError &) {
+                    connection.reset();
+                    continue;
+                }
+
+                assert(reply);
+
+                _handle_invalidation(*reply);
+            }
+        } catch (const Error &) {
+            // Invalidation messages might have been lost, and we cannot trust
+            // the cached replies any more.
+            _reset_tracking();
+
+            std::unique_lock<std::mutex> lock(_stop_mtx);
+            _stop_cv.wait_for(lock, _opts.retry_interval, [this]() { return this->_stop.load(); });
+        }
+    }
+
+    _reset_tracking();
+}
+
+Connection ClientCache::_connect() {
+    auto opts = _pool->connection_options();
+
+    // Invalidation messages are received with the push channel of RESP3.
+    opts.resp = 3;
+    opts.socket_timeout = _opts.listener_timeout;
+
+    auto connection = _pool->create(opts);
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    // Return push messages as normal replies.
+    connection.set_push_callback(nullptr);
+#endif
+
+    CmdArgs id_args;
+    id_args << "CLIENT" << "ID";
+    connection.send(id_args);
+
+    auto id = reply::parse<long long>(*connection.recv());
+
+    if (_opts.mode == ClientTrackingMode::BCAST) {
+        CmdArgs tracking_args;
+        tracking_args << "CLIENT" << "TRACKING" << "ON" << "BCAST";
+        for (const auto &prefix : _opts.prefixes) {
+            tracking_args << "PREFIX" << prefix;
+        }
+
+        connection.send(tracking_args);
+
+        reply::parse<void>(*connection.recv());
+    }
+
+    _tracking_id = id;
+
+    return connection;
+}
+
+void ClientCache::_handle_invalidation(redisReply &reply) {
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    // Invalidation message: >2 $10 invalidate *<n> <key1> ... <keyn>
+    if (!reply::is_push(reply) || reply.elements != 2 || reply.element == nullptr) {
+        return;
+    }
+
+    auto *type = reply.element[0];
+    auto *keys = reply.element[1];
+    if (type == nullptr || keys == nullptr
+            || !reply::is_string(*type)
+            || std::string(type->str, type->len) != "invalidate") {
+        return;
+    }
+
+    if (reply::is_nil(*keys)) {
+        // FLUSHALL or FLUSHDB, or the server is running out of memory for the tracking table.
+        flush();
+        return;
+    }
+
+    if (!reply::is_array(*keys)) {
+        throw ProtoError("invalid invalidation message");
+    }
+
+    for (std::size_t idx = 0; idx != keys->elements; ++idx) {
+        auto *key = keys->element[idx];
+        if (key == nullptr || !reply::is_string(*key)) {
+            throw ProtoError("invalid key in invalidation message");
+        }
+
+        _invalidate(std::string(key->str, key->len));
+    }
+#else
+    (void)reply;
+#endif
+}
+
+void ClientCache::_reset_tracking() {
+    _tracking_id = -1;
+
+    flush();
+}
+
+}
+
+}
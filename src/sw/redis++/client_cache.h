@@ -0,0 +1,237 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_CLIENT_CACHE_H
+#define SEWENEW_REDISPLUSPLUS_CLIENT_CACHE_H
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "sw/redis++/command_args.h"
+#include "sw/redis++/connection.h"
+#include "sw/redis++/connection_pool.h"
+#include "sw/redis++/reply.h"
+#include "sw/redis++/utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// Mode of CLIENT TRACKING, see https://redis.io/docs/manual/client-side-caching/
+enum class ClientTrackingMode {
+    // Redis remembers keys read by the client, and only invalidates these keys.
+    DEFAULT = 0,
+
+    // Redis broadcasts invalidations of all keys matching `ClientCacheOptions::prefixes`.
+    BCAST
+};
+
+struct ClientCacheOptions {
+    // Max number of cached replies.
+    std::size_t max_entries = 10000;
+
+    // Number of shards. Each shard is an LRU cache protected by its own mutex.
+    std::size_t shards = 16;
+
+    ClientTrackingMode mode = ClientTrackingMode::DEFAULT;
+
+    // Key prefixes to be tracked in `ClientTrackingMode::BCAST` mode.
+    // If it's empty, all keys are tracked.
+    std::vector<std::string> prefixes;
+
+    // Socket timeout of the connection receiving invalidation messages. The listening
+    // thread checks whether it should stop, each time the timeout expires.
+    std::chrono::milliseconds listener_timeout{100};
+
+    // Time to wait before reconnecting, if the invalidation connection is broken.
+    std::chrono::milliseconds retry_interval{100};
+};
+
+// A copy of a string reply, a nil reply, or an aggregate reply of strings,
+// which can be parsed with `reply::parse` or `reply::to_array` as a normal reply.
+class CachedReply {
+public:
+    // Whether the reply can be cached.
+    static bool cacheable(redisReply &reply);
+
+    explicit CachedReply(redisReply &reply);
+
+    CachedReply(const CachedReply &) = delete;
+    CachedReply& operator=(const CachedReply &) = delete;
+
+    CachedReply(CachedReply &&) = delete;
+    CachedReply& operator=(CachedReply &&) = delete;
+
+    ~CachedReply() = default;
+
+    // NOTE: parsing a reply never modifies it, so it's safe to share
+    // the cached reply among threads.
+    redisReply& reply() const {
+        return const_cast<redisReply &>(_reply);
+    }
+
+private:
+    static void _copy(redisReply &from, redisReply &to, std::string &str);
+
+    redisReply _reply{};
+
+    std::string _str;
+
+    std::vector<std::string> _strs;
+
+    std::vector<redisReply> _elements;
+
+    std::vector<redisReply *> _element_ptrs;
+};
+
+using CachedReplySPtr = std::shared_ptr<const CachedReply>;
+
+// A size-bounded, sharded LRU cache of read-only commands' replies, e.g. GET, HGET
+// and HGETALL. It's kept coherent with CLIENT TRACKING: a dedicated RESP3 connection
+// receives invalidation messages with the push channel in a background thread.
+//
+// In DEFAULT mode, connections reading keys enable tracking with REDIRECT to the
+// invalidation connection. In BCAST mode, the invalidation connection enables tracking
+// for the given prefixes by itself.
+//
+// NOTE: invalidation is asynchronous, i.e. after a write returns, a read might still get
+// the old value from cache, until the invalidation message has been received.
+class ClientCache {
+public:
+    ClientCache(const ClientCacheOptions &opts, const ConnectionPoolSPtr &pool);
+
+    ClientCache(const ClientCache &) = delete;
+    ClientCache& operator=(const ClientCache &) = delete;
+
+    ClientCache(ClientCache &&) = delete;
+    ClientCache& operator=(ClientCache &&) = delete;
+
+    ~ClientCache();
+
+    // Return the cached reply if any. Otherwise, send the command with a connection
+    // from the pool, and cache the reply. The second argument MUST be the key.
+    CachedReplySPtr command(CmdArgs &args);
+
+    // Remove all cached replies.
+    void flush();
+
+private:
+    struct Value {
+        // Reservation of a cache miss, and the reply can only be filled
+        // if the reservation has not been invalidated.
+        std::uint64_t token = 0;
+
+        // Null if the reply is still being fetched.
+        CachedReplySPtr reply;
+    };
+
+    struct Entry {
+        // Cached replies of the key, indexed by command and arguments other than the key.
+        std::unordered_map<std::string, Value> values;
+
+        // Position in the LRU list.
+        std::list<std::string>::iterator lru;
+    };
+
+    struct Shard {
+        std::mutex mtx;
+
+        std::unordered_map<std::string, Entry> entries;
+
+        // Most recently used keys are at front.
+        std::list<std::string> lru;
+
+        // Number of cached (or being fetched) replies.
+        std::size_t size = 0;
+    };
+
+    Shard& _shard(const std::string &key);
+
+    // Whether invalidation messages of the key will be received. In BCAST mode,
+    // only keys matching one of the prefixes are tracked.
+    bool _trackable(const std::string &key) const;
+
+    // Return the cached reply. If it's not cached, reserve a slot, and return
+    // the reservation token, or 0 if tracking is not ready. Also return the
+    // id of invalidation connection for the reservation.
+    CachedReplySPtr _get(Shard &shard,
+                            const std::string &key,
+                            const std::string &subkey,
+                            std::uint64_t &token,
+                            long long &tracking_id);
+
+    // Fill the reserved slot. If `reply` is null, cancel the reservation.
+    void _fill(Shard &shard,
+                const std::string &key,
+                const std::string &subkey,
+                std::uint64_t token,
+                CachedReplySPtr reply);
+
+    void _evict(Shard &shard);
+
+    void _erase(Shard &shard, std::unordered_map<std::string, Entry>::iterator iter);
+
+    void _invalidate(const std::string &key);
+
+    // Send the command. If `tracking_id` is valid, ensure the key is tracked,
+    // and set `tracked` to true on success.
+    ReplyUPtr _fetch(CmdArgs &args, long long tracking_id, bool &tracked);
+
+    void _listen();
+
+    Connection _connect();
+
+    void _handle_invalidation(redisReply &reply);
+
+    void _reset_tracking();
+
+    ClientCacheOptions _opts;
+
+    ConnectionPoolSPtr _pool;
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+
+    std::size_t _shard_capacity = 0;
+
+    std::atomic<std::uint64_t> _token{0};
+
+    // Client id of the invalidation connection, or -1 if tracking is not ready.
+    std::atomic<long long> _tracking_id{-1};
+
+    std::atomic<bool> _stop{false};
+
+    std::mutex _stop_mtx;
+
+    std::condition_variable _stop_cv;
+
+    std::thread _listener;
+};
+
+using ClientCacheSPtr = std::shared_ptr<ClientCache>;
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_CLIENT_CACHE_H
@@ -0,0 +1,330 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/cluster_pipeline.h"
+#include <cassert>
+#include <unordered_map>
+#include "sw/redis++/shards.h"
+
+namespace {
+
+// Max number of times to re-route commands, which get MOVED or ASK errors,
+// or which fail to be sent.
+constexpr std::size_t MAX_REDIRECTIONS = 3;
+
+}
+
+namespace sw {
+
+namespace redis {
+
+QueuedReplies ClusterPipeline::exec() {
+    std::vector<ReplyUPtr> replies(_cmds.size());
+
+    try {
+        _exec(replies);
+    } catch (...) {
+        discard();
+        throw;
+    }
+
+    auto set_cmd_indexes = std::move(_set_cmd_indexes);
+
+    discard();
+
+    return QueuedReplies(std::move(replies), std::move(set_cmd_indexes));
+}
+
+void ClusterPipeline::discard() {
+    _buffer.clear();
+    _cmds.clear();
+    _set_cmd_indexes.clear();
+}
+
+ClusterPipeline& ClusterPipeline::set(const StringView &key,
+                                        const StringView &val,
+                                        const std::chrono::milliseconds &ttl,
+                                        UpdateType type) {
+    CmdArgs cmd_args;
+    cmd_args << "SET" << key << val;
+
+    if (ttl > std::chrono::milliseconds(0)) {
+        cmd_args << "PX" << ttl.count();
+    }
+
+    cmd::detail::set_update_type(cmd_args, type);
+
+    _set_cmd_indexes.insert(_cmds.size());
+
+    return _command(cmd_args);
+}
+
+void ClusterPipeline::_exec(std::vector<ReplyUPtr> &replies) {
+    std::vector<std::size_t> cmds(_cmds.size());
+    for (std::size_t idx = 0; idx != cmds.size(); ++idx) {
+        cmds[idx] = idx;
+    }
+
+    auto nodes = _route(cmds);
+
+    // Whether a command should be sent after an ASKING command.
+    std::vector<bool> asking(_cmds.size(), false);
+
+    // The first error of nodes, which fail after commands have been written.
+    std::exception_ptr err;
+
+    for (std::size_t round = 0; !nodes.empty(); ++round) {
+        // Commands that fail before being written, and can be safely re-routed
+        // after updating the slot-node mapping.
+        std::vector<std::size_t> unsent;
+        std::exception_ptr round_err;
+        auto need_update = _send(nodes, asking, replies, unsent, round_err);
+
+        if (round_err && !err) {
+            err = round_err;
+        }
+
+        if (round == MAX_REDIRECTIONS) {
+            break;
+        }
+
+        std::vector<NodeCommands> redirected;
+        for (const auto &node : nodes) {
+            for (auto cmd : node.cmds) {
+                asking[cmd] = false;
+
+                auto &reply = replies[cmd];
+                if (!reply) {
+                    // Either unsent, or might have been executed, which is NEVER resent.
+                    continue;
+                }
+
+                if (!reply::is_error(*reply)) {
+                    continue;
+                }
+
+                try {
+                    throw_error(*reply);
+                } catch (const MovedError &err) {
+                    _on_redirect(RedirectType::MOVED);
+
+                    // Slot has been migrated, update the slot, and the full slot-node
+                    // mapping will be updated in background.
+                    _pool->update(err.slot(), err.node());
+                    _add_command(redirected, _pool->fetch(err.node()), cmd);
+                } catch (const AskError &err) {
+                    _on_redirect(RedirectType::ASK);
+
+                    // Slot is migrating, resend it with ASKING command.
+                    asking[cmd] = true;
+                    _add_command(redirected, _pool->fetch(err.node()), cmd);
+                } catch (const ReplyError &) {
+                    // Other errors are returned to user.
+                }
+            }
+        }
+
+        if (need_update) {
+            _pool->update();
+        }
+
+        nodes = std::move(redirected);
+
+        for (auto &node : _route(unsent)) {
+            for (auto cmd : node.cmds) {
+                _add_command(nodes, node.pool, cmd);
+            }
+        }
+    }
+
+    if (err) {
+        std::rethrow_exception(err);
+    }
+
+    for (const auto &reply : replies) {
+        if (!reply) {
+            throw Error("Failed to execute cluster pipeline: node is unreachable");
+        }
+    }
+}
+
+ClusterPipeline& ClusterPipeline::_command(CmdArgs &cmd_args) {
+    if (cmd_args.size() < 2) {
+        throw Error("ClusterPipeline: no key specified");
+    }
+
+    auto key = StringView(cmd_args.argv()[1], cmd_args.argv_len()[1]);
+
+    auto offset = _buffer.size();
+    _buffer.append_command(cmd_args.size(), cmd_args.argv(), cmd_args.argv_len());
+
+    _cmds.push_back(QueuedCommand{_pool->slot(key), offset, _buffer.size() - offset});
+
+    return *this;
+}
+
+bool ClusterPipeline::_send(std::vector<NodeCommands> &nodes,
+                            const std::vector<bool> &asking,
+                            std::vector<ReplyUPtr> &replies,
+                            std::vector<std::size_t> &unsent,
+                            std::exception_ptr &err) {
+    auto failed = false;
+    std::vector<std::unique_ptr<SafeConnection>> connections(nodes.size());
+    try {
+        // Write commands to all nodes before reading any reply,
+        // so that nodes process their commands in parallel.
+        for (std::size_t idx = 0; idx != nodes.size(); ++idx) {
+            // Clear replies of the last round, e.g. MOVED errors.
+            for (auto cmd : nodes[idx].cmds) {
+                replies[cmd].reset();
+            }
+
+            try {
+                connections[idx].reset(new SafeConnection(*(nodes[idx].pool)));
+                auto &connection = connections[idx]->connection();
+                for (auto cmd : nodes[idx].cmds) {
+                    if (asking[cmd]) {
+                        connection.send("ASKING");
+                    }
+
+                    const auto &queued = _cmds[cmd];
+                    connection.send_formatted(_buffer.data() + queued.offset, queued.len);
+                }
+            } catch (const IoError &) {
+                failed = true;
+                connections[idx].reset();
+                unsent.insert(unsent.end(), nodes[idx].cmds.begin(), nodes[idx].cmds.end());
+            } catch (const ClosedError &) {
+                failed = true;
+                connections[idx].reset();
+                unsent.insert(unsent.end(), nodes[idx].cmds.begin(), nodes[idx].cmds.end());
+            }
+
+            if (!connections[idx]) {
+                continue;
+            }
+
+            try {
+                // Commands are only buffered so far. Once writing starts, part of
+                // them might have been sent, and they can NOT be retried.
+                connections[idx]->connection().flush();
+            } catch (const IoError &) {
+                failed = true;
+                connections[idx].reset();
+                if (!err) {
+                    err = std::current_exception();
+                }
+            } catch (const ClosedError &) {
+                failed = true;
+                connections[idx].reset();
+                if (!err) {
+                    err = std::current_exception();
+                }
+            }
+        }
+
+        for (std::size_t idx = 0; idx != nodes.size(); ++idx) {
+            if (!connections[idx]) {
+                continue;
+            }
+
+            try {
+                auto &connection = connections[idx]->connection();
+                for (auto cmd : nodes[idx].cmds) {
+                    if (asking[cmd]) {
+                        auto reply = connection.recv(false);
+                        if (reply::is_error(*reply)) {
+                            // ASKING failed, and the command should fail with the same error.
+                            replies[cmd] = std::move(reply);
+                            connection.recv(false);
+                            continue;
+                        }
+                    }
+
+                    replies[cmd] = connection.recv(false);
+                }
+            } catch (const IoError &) {
+                // Commands might have been executed, e.g. reading reply timed out.
+                failed = true;
+                connections[idx].reset();
+                if (!err) {
+                    err = std::current_exception();
+                }
+            } catch (const ClosedError &) {
+                failed = true;
+                connections[idx].reset();
+                if (!err) {
+                    err = std::current_exception();
+                }
+            }
+        }
+    } catch (...) {
+        // Some connections might have pending replies, and they CANNOT be reused.
+        for (auto &connection : connections) {
+            if (connection) {
+                connection->connection().invalidate();
+            }
+        }
+
+        throw;
+    }
+
+    return failed;
+}
+
+auto ClusterPipeline::_route(const std::vector<std::size_t> &cmds) -> std::vector<NodeCommands> {
+    std::vector<NodeCommands> nodes;
+
+    // Cache slot-pool mapping to avoid locking the ShardsPool for each command.
+    std::unordered_map<Slot, ConnectionPoolSPtr> pools;
+    for (auto cmd : cmds) {
+        auto slot = _cmds[cmd].slot;
+        auto iter = pools.find(slot);
+        if (iter == pools.end()) {
+            iter = pools.emplace(slot, _pool->fetch(slot)).first;
+        }
+
+        _add_command(nodes, iter->second, cmd);
+    }
+
+    return nodes;
+}
+
+void ClusterPipeline::_on_redirect(RedirectType type) {
+    const auto &metrics = _pool->metrics();
+    if (metrics) {
+        metrics->on_redirect(type);
+    }
+}
+
+void ClusterPipeline::_add_command(std::vector<NodeCommands> &nodes,
+                                    const ConnectionPoolSPtr &pool,
+                                    std::size_t cmd) {
+    assert(pool);
+
+    for (auto &node : nodes) {
+        if (node.pool == pool) {
+            node.cmds.push_back(cmd);
+            return;
+        }
+    }
+
+    nodes.push_back(NodeCommands{pool, {cmd}});
+}
+
+}
+
+}
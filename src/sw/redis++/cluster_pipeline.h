@@ -0,0 +1,274 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_H
+#define SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_H
+
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "sw/redis++/command.h"
+#include "sw/redis++/command_args.h"
+#include "sw/redis++/command_options.h"
+#include "sw/redis++/connection_pool.h"
+#include "sw/redis++/errors.h"
+#include "sw/redis++/queued_redis.h"
+#include "sw/redis++/resp.h"
+#include "sw/redis++/shards_pool.h"
+#include "sw/redis++/utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// Pipeline commands on arbitrary keys with RedisCluster.
+//
+// Commands are encoded and queued locally. When calling `exec`, they're bucketed
+// by the node holding the key, and all nodes' pipelines are written before reading
+// any reply, so that nodes process commands in parallel. If a command gets a MOVED
+// or ASK error, only that command is re-routed to the new node. Replies are returned
+// in submission order.
+//
+// NOTE: Commands of ClusterPipeline are NOT atomic, and commands of different
+// nodes might be executed in any order. Also ClusterPipeline is NOT thread-safe.
+class ClusterPipeline {
+public:
+    ClusterPipeline(const ClusterPipeline &) = delete;
+    ClusterPipeline& operator=(const ClusterPipeline &) = delete;
+
+    ClusterPipeline(ClusterPipeline &&) = default;
+    ClusterPipeline& operator=(ClusterPipeline &&) = default;
+
+    ~ClusterPipeline() = default;
+
+    // Send all queued commands, and return replies in submission order.
+    // If it fails to connect to a node, it updates the slot-node mapping and retries
+    // commands of that node. However, if a node fails after commands have been written,
+    // these commands might have been executed, and they're NOT retried. Instead, the
+    // error is thrown, after other nodes' commands are done. In any case, queued
+    // commands are cleared, and the pipeline can be reused.
+    QueuedReplies exec();
+
+    // Discard all queued commands.
+    void discard();
+
+    // Number of queued commands.
+    std::size_t size() const {
+        return _cmds.size();
+    }
+
+    // The second argument, i.e. `key`, is used to route the command.
+    template <typename ...Args>
+    ClusterPipeline& command(const StringView &cmd_name, const StringView &key, Args &&...args) {
+        CmdArgs cmd_args;
+        cmd_args.append(cmd_name, key, std::forward<Args>(args)...);
+
+        return _command(cmd_args);
+    }
+
+    // The second element of the range, i.e. the key, is used to route the command.
+    template <typename Input>
+    auto command(Input first, Input last)
+        -> typename std::enable_if<IsIter<Input>::value, ClusterPipeline&>::type {
+        CmdArgs cmd_args;
+        while (first != last) {
+            cmd_args.append_copy(*first);
+            ++first;
+        }
+
+        return _command(cmd_args);
+    }
+
+    // KEY commands.
+
+    ClusterPipeline& del(const StringView &key) {
+        return command("DEL", key);
+    }
+
+    ClusterPipeline& exists(const StringView &key) {
+        return command("EXISTS", key);
+    }
+
+    ClusterPipeline& expire(const StringView &key, const std::chrono::seconds &timeout) {
+        return command("EXPIRE", key, timeout.count());
+    }
+
+    ClusterPipeline& pexpire(const StringView &key, const std::chrono::milliseconds &timeout) {
+        return command("PEXPIRE", key, timeout.count());
+    }
+
+    ClusterPipeline& ttl(const StringView &key) {
+        return command("TTL", key);
+    }
+
+    // STRING commands.
+
+    ClusterPipeline& get(const StringView &key) {
+        return command("GET", key);
+    }
+
+    ClusterPipeline& incr(const StringView &key) {
+        return command("INCR", key);
+    }
+
+    ClusterPipeline& incrby(const StringView &key, long long increment) {
+        return command("INCRBY", key, increment);
+    }
+
+    ClusterPipeline& decr(const StringView &key) {
+        return command("DECR", key);
+    }
+
+    ClusterPipeline& set(const StringView &key,
+                            const StringView &val,
+                            const std::chrono::milliseconds &ttl = std::chrono::milliseconds(0),
+                            UpdateType type = UpdateType::ALWAYS);
+
+    // LIST commands.
+
+    ClusterPipeline& lpush(const StringView &key, const StringView &val) {
+        return command("LPUSH", key, val);
+    }
+
+    ClusterPipeline& rpush(const StringView &key, const StringView &val) {
+        return command("RPUSH", key, val);
+    }
+
+    ClusterPipeline& lpop(const StringView &key) {
+        return command("LPOP", key);
+    }
+
+    ClusterPipeline& rpop(const StringView &key) {
+        return command("RPOP", key);
+    }
+
+    // HASH commands.
+
+    ClusterPipeline& hdel(const StringView &key, const StringView &field) {
+        return command("HDEL", key, field);
+    }
+
+    ClusterPipeline& hget(const StringView &key, const StringView &field) {
+        return command("HGET", key, field);
+    }
+
+    ClusterPipeline& hgetall(const StringView &key) {
+        return command("HGETALL", key);
+    }
+
+    ClusterPipeline& hincrby(const StringView &key, const StringView &field, long long increment) {
+        return command("HINCRBY", key, field, increment);
+    }
+
+    ClusterPipeline& hset(const StringView &key, const StringView &field, const StringView &val) {
+        return command("HSET", key, field, val);
+    }
+
+    // SET commands.
+
+    ClusterPipeline& sadd(const StringView &key, const StringView &member) {
+        return command("SADD", key, member);
+    }
+
+    ClusterPipeline& sismember(const StringView &key, const StringView &member) {
+        return command("SISMEMBER", key, member);
+    }
+
+    ClusterPipeline& srem(const StringView &key, const StringView &member) {
+        return command("SREM", key, member);
+    }
+
+    // SORTED SET commands.
+
+    ClusterPipeline& zadd(const StringView &key, const StringView &member, double score) {
+        return command("ZADD", key, score, member);
+    }
+
+    ClusterPipeline& zincrby(const StringView &key, double increment, const StringView &member) {
+        return command("ZINCRBY", key, increment, member);
+    }
+
+    ClusterPipeline& zscore(const StringView &key, const StringView &member) {
+        return command("ZSCORE", key, member);
+    }
+
+private:
+    friend class RedisCluster;
+
+    explicit ClusterPipeline(const ShardsPoolSPtr &pool) : _pool(pool) {
+        assert(_pool);
+    }
+
+    // A queued command, which has been encoded into `_buffer`.
+    struct QueuedCommand {
+        Slot slot;
+
+        std::size_t offset;
+
+        std::size_t len;
+    };
+
+    // Commands to be sent to a node.
+    struct NodeCommands {
+        ConnectionPoolSPtr pool;
+
+        // Indexes of commands.
+        std::vector<std::size_t> cmds;
+    };
+
+    ClusterPipeline& _command(CmdArgs &cmd_args);
+
+    void _exec(std::vector<ReplyUPtr> &replies);
+
+    // Send commands to nodes in parallel, and receive replies. If a node fails,
+    // replies of its commands are left null. If it fails before any command is
+    // written, these commands are added to `unsent`, and can be safely retried.
+    // Otherwise, the error is saved in `err`. Return true, if any node fails.
+    bool _send(std::vector<NodeCommands> &nodes,
+                const std::vector<bool> &asking,
+                std::vector<ReplyUPtr> &replies,
+                std::vector<std::size_t> &unsent,
+                std::exception_ptr &err);
+
+    // Bucket commands by the node holding their slots.
+    std::vector<NodeCommands> _route(const std::vector<std::size_t> &cmds);
+
+    void _on_redirect(RedirectType type);
+
+    void _add_command(std::vector<NodeCommands> &nodes,
+                        const ConnectionPoolSPtr &pool,
+                        std::size_t cmd);
+
+    ShardsPoolSPtr _pool;
+
+    // Encoded commands.
+    resp::OutputBuffer _buffer;
+
+    std::vector<QueuedCommand> _cmds;
+
+    // Indexes of SET commands, whose replies are parsed specially.
+    std::unordered_set<std::size_t> _set_cmd_indexes;
+};
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_CLUSTER_PIPELINE_H
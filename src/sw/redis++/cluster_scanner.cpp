@@ -0,0 +1,188 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/cluster_scanner.h"
+#include <cassert>
+#include <iterator>
+#include "sw/redis++/command.h"
+#include "sw/redis++/errors.h"
+
+namespace sw {
+
+namespace redis {
+
+ClusterScanner::ClusterScanner(RedisCluster &cluster, const ClusterScanOptions &opts) :
+                                _opts(opts) {
+    if (_opts.count <= 0) {
+        throw Error("count of cluster scan should be positive");
+    }
+
+    if (_opts.prefetch == 0) {
+        throw Error("prefetch of cluster scan should be positive");
+    }
+
+    // Update the underlying slot-node mapping to ensure we get the latest one.
+    cluster._pool->update();
+
+    auto pools = cluster._pool->pools();
+
+    _buffered.resize(pools.size(), 0);
+    _running = pools.size();
+
+    try {
+        for (std::size_t idx = 0; idx != pools.size(); ++idx) {
+            auto pool = pools[idx];
+            _workers.emplace_back([this, pool, idx]() { this->_scan(pool, idx); });
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+ClusterScanner::~ClusterScanner() {
+    stop();
+}
+
+void ClusterScanner::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _stop = true;
+    }
+
+    _cv.notify_all();
+
+    // NOTE: a worker waiting for a reply can only be stopped after it gets the reply,
+    // or the socket times out.
+    for (auto &worker : _workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool ClusterScanner::_next(std::vector<std::string> &keys) {
+    Page page;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _cv.wait(lock, [this]() { return _stop || !_pages.empty() || _running == 0; });
+
+        if (_stop || _pages.empty()) {
+            return false;
+        }
+
+        page = std::move(_pages.front());
+        _pages.pop_front();
+
+        if (!page.err) {
+            assert(_buffered[page.node] > 0);
+
+            --_buffered[page.node];
+        }
+    }
+
+    // Wake up the worker, so that it can push the next page.
+    _cv.notify_all();
+
+    if (page.err) {
+        std::rethrow_exception(page.err);
+    }
+
+    keys = std::move(page.keys);
+
+    return true;
+}
+
+void ClusterScanner::_scan(const ConnectionPoolSPtr &pool, std::size_t node) {
+    try {
+        Cursor cursor = 0;
+        do {
+            std::vector<std::string> keys;
+            {
+                // Return the connection to pool between pages,
+                // so that it can be used by others while we're waiting.
+                GuardedConnection guarded_connection(pool);
+                auto &connection = guarded_connection.connection();
+
+                cmd::scan(connection, cursor, _opts.pattern, _opts.count);
+
+                auto reply = connection.recv();
+
+                cursor = reply::parse_scan_reply(*reply, std::back_inserter(keys));
+            }
+
+            if (!_push(node, std::move(keys))) {
+                break;
+            }
+        } while (cursor != 0);
+    } catch (...) {
+        _fail(node, std::current_exception());
+    }
+
+    _finish();
+}
+
+bool ClusterScanner::_push(std::size_t node, std::vector<std::string> keys) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (keys.empty()) {
+            // SCAN might return an empty page, skip it.
+            return !_stop;
+        }
+
+        _cv.wait(lock, [this, node]() { return _stop || _buffered[node] < _opts.prefetch; });
+
+        if (_stop) {
+            return false;
+        }
+
+        ++_buffered[node];
+        _pages.push_back(Page{node, std::move(keys), nullptr});
+    }
+
+    _cv.notify_all();
+
+    return true;
+}
+
+void ClusterScanner::_fail(std::size_t node, std::exception_ptr err) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _pages.push_back(Page{node, {}, err});
+    }
+
+    _cv.notify_all();
+}
+
+void ClusterScanner::_finish() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        assert(_running > 0);
+
+        --_running;
+    }
+
+    _cv.notify_all();
+}
+
+}
+
+}
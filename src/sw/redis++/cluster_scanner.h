@@ -0,0 +1,139 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_CLUSTER_SCANNER_H
+#define SEWENEW_REDISPLUSPLUS_CLUSTER_SCANNER_H
+
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sw/redis++/redis_cluster.h"
+
+namespace sw {
+
+namespace redis {
+
+struct ClusterScanOptions {
+    // MATCH pattern of the SCAN command.
+    std::string pattern = "*";
+
+    // COUNT hint of the SCAN command.
+    long long count = 10;
+
+    // Max number of pages, which have been fetched from a node, but not yet consumed.
+    // A node's worker keeps fetching the next page while the caller is consuming the
+    // current one, and blocks when this limit is reached.
+    std::size_t prefetch = 1;
+};
+
+// Scan keys of all nodes in the cluster concurrently, i.e. each node is scanned with
+// SCAN command by a dedicated worker thread, and pages of keys are yielded in the order
+// they are received.
+//
+// ClusterScanner scanner(cluster, opts);
+// std::vector<std::string> keys;
+// while (scanner.next(std::back_inserter(keys))) {
+//     // process keys
+//     keys.clear();
+// }
+//
+// NOTE: Like SCAN, keys might be returned more than once, and if the cluster is resharded
+// during the scan, e.g. slots are migrated, keys of these slots might be missed.
+class ClusterScanner {
+public:
+    explicit ClusterScanner(RedisCluster &cluster, const ClusterScanOptions &opts = {});
+
+    ClusterScanner(const ClusterScanner &) = delete;
+    ClusterScanner& operator=(const ClusterScanner &) = delete;
+
+    ClusterScanner(ClusterScanner &&) = delete;
+    ClusterScanner& operator=(ClusterScanner &&) = delete;
+
+    ~ClusterScanner();
+
+    // Write keys of the next non-empty page to the output iterator, and block if no page
+    // is ready. Return false, if all nodes have been scanned. If it fails to scan a node,
+    // the error is thrown, and the scanner can still be used to scan other nodes.
+    template <typename Output>
+    bool next(Output output);
+
+    // Stop all workers. Pages which have not been consumed are discarded.
+    void stop();
+
+private:
+    struct Page {
+        std::size_t node;
+
+        std::vector<std::string> keys;
+
+        std::exception_ptr err;
+    };
+
+    bool _next(std::vector<std::string> &keys);
+
+    void _scan(const ConnectionPoolSPtr &pool, std::size_t node);
+
+    // Return false, if the scanner has been stopped.
+    bool _push(std::size_t node, std::vector<std::string> keys);
+
+    void _fail(std::size_t node, std::exception_ptr err);
+
+    void _finish();
+
+    ClusterScanOptions _opts;
+
+    std::mutex _mutex;
+
+    std::condition_variable _cv;
+
+    std::deque<Page> _pages;
+
+    // Number of pages of each node in `_pages`.
+    std::vector<std::size_t> _buffered;
+
+    // Number of workers which have not finished.
+    std::size_t _running = 0;
+
+    bool _stop = false;
+
+    std::vector<std::thread> _workers;
+};
+
+template <typename Output>
+bool ClusterScanner::next(Output output) {
+    std::vector<std::string> keys;
+    if (!_next(keys)) {
+        return false;
+    }
+
+    for (auto &key : keys) {
+        *output = std::move(key);
+        ++output;
+    }
+
+    return true;
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_CLUSTER_SCANNER_H
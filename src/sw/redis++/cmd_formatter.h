@@ -17,11 +17,13 @@
 #ifndef SEWENEW_REDISPLUSPLUS_CMD_FORMATTER_H
 #define SEWENEW_REDISPLUSPLUS_CMD_FORMATTER_H
 
+#include <memory>
 #include <hiredis/hiredis.h>
 #include "sw/redis++/command_options.h"
 #include "sw/redis++/command_args.h"
 #include "sw/redis++/command.h"
 #include "sw/redis++/errors.h"
+#include "sw/redis++/resp.h"
 
 namespace sw {
 
@@ -35,6 +37,16 @@ public:
         }
     }
 
+    // Command encoded by `resp::write_command`, instead of hiredis.
+    FormattedCommand(std::unique_ptr<char[]> data, int len) :
+        _data(data.release()), _size(len), _hiredis_allocated(false) {
+        if (_data == nullptr || len < 0) {
+            _free();
+
+            throw Error("failed to format command");
+        }
+    }
+
     FormattedCommand(const FormattedCommand &) = delete;
     FormattedCommand& operator=(const FormattedCommand &) = delete;
 
@@ -44,6 +56,7 @@ public:
 
     FormattedCommand& operator=(FormattedCommand &&that) noexcept {
         if (this != &that) {
+            _free();
             _move(std::move(that));
         }
 
@@ -51,9 +64,7 @@ public:
     }
 
     ~FormattedCommand() noexcept {
-        if (_data != nullptr) {
-            redisFreeCommand(_data);
-        }
+        _free();
     }
 
     const char* data() const noexcept {
@@ -68,12 +79,30 @@ private:
     void _move(FormattedCommand &&that) noexcept {
         _data = that._data;
         _size = that._size;
+        _hiredis_allocated = that._hiredis_allocated;
         that._data = nullptr;
         that._size = 0;
     }
 
+    void _free() noexcept {
+        if (_data == nullptr) {
+            return;
+        }
+
+        if (_hiredis_allocated) {
+            redisFreeCommand(_data);
+        } else {
+            delete [] _data;
+        }
+
+        _data = nullptr;
+    }
+
     char *_data = nullptr;
     int _size = 0;
+
+    // Whether `_data` is allocated by hiredis, i.e. redisFormatCommand, or by us.
+    bool _hiredis_allocated = true;
 };
 
 namespace fmt {
@@ -87,17 +116,17 @@ FormattedCommand format_cmd(const char *format, Args &&...args) {
 }
 
 inline FormattedCommand format_cmd(int argc, const char **argv, const std::size_t *argv_len) {
-    char *data = nullptr;
-    auto len = redisFormatCommandArgv(&data, argc, argv, argv_len);
+    // Calculate the exact size, and encode the command with a single allocation.
+    auto size = static_cast<std::size_t>(argc);
+    auto len = resp::command_size(size, argv_len);
+    std::unique_ptr<char[]> data(new char[len]);
+    resp::write_command(data.get(), size, argv, argv_len);
 
-    return FormattedCommand(data, static_cast<int>(len));
+    return FormattedCommand(std::move(data), static_cast<int>(len));
 }
 
 inline FormattedCommand format_cmd(CmdArgs &args) {
-    char *data = nullptr;
-    auto len = redisFormatCommandArgv(&data, static_cast<int>(args.size()), args.argv(), args.argv_len());
-
-    return FormattedCommand(data, static_cast<int>(len));
+    return format_cmd(static_cast<int>(args.size()), args.argv(), args.argv_len());
 }
 
 struct SetResultParser {
@@ -1031,6 +1060,26 @@ inline FormattedCommand sunsubscribe_range(Input first, Input last) {
     return format_cmd(args);
 }
 
+// TRANSACTION commands.
+
+inline FormattedCommand unwatch() {
+    return format_cmd("UNWATCH");
+}
+
+inline FormattedCommand watch(const StringView &key) {
+    return format_cmd("WATCH %b", key.data(), key.size());
+}
+
+template <typename Input>
+FormattedCommand watch_range(Input first, Input last) {
+    assert(first != last);
+
+    CmdArgs args;
+    args << "WATCH" << std::make_pair(first, last);
+
+    return format_cmd(args);
+}
+
 // Stream commands.
 
 inline FormattedCommand xread(const StringView &key, const StringView &id, long long count, long long timeout) {
@@ -31,6 +31,7 @@
 # error "<coroutine> not found."
 #endif
 #include "sw/redis++/async_redis.h"
+#include "sw/redis++/co_utils.h"
 #include "sw/redis++/cxx_utils.h"
 #include "sw/redis++/cmd_formatter.h"
 #include "sw/redis++/async_sentinel.h"
@@ -64,70 +65,103 @@ public:
 
     ~CoRedis() = default;
 
-    template <typename Result, typename ResultParser = DefaultResultParser<Result>, typename = void>
-    class Awaiter {
+    // Create a transaction, whose queued commands are sent with `co_await co_redis.exec(tx)`.
+    // Check `AsyncRedis::transaction` for detail.
+    AsyncTransaction transaction() {
+        return _async_redis.transaction();
+    }
+
+    ExecAwaiter exec(AsyncTransaction &tx) {
+        return ExecAwaiter(tx);
+    }
+
+    // Run a transaction with optimistic locking, and resume the coroutine when it's done.
+    // Check `AsyncRedis::transaction(func, max_retries, cb)` for detail.
+    template <typename Func>
+    class TransactionAwaiter {
     public:
         bool await_ready() noexcept {
             return false;
         }
 
-        void await_suspend(std::coroutine_handle<> handle) {
-            _async_redis->co_command_with_parser<Result, ResultParser>(std::move(_cmd),
-                    [this, handle](Future<Result> &&fut) mutable {
-                        _result = std::move(fut);
+        bool await_suspend(std::coroutine_handle<> handle) {
+            _async_redis->transaction(std::move(_func), _max_retries,
+                    [this](Future<void> &&fut) {
+                        try {
+                            fut.get();
+                        } catch (...) {
+                            _err = std::current_exception();
+                        }
 
-                        handle.resume();
+                        _resumer.resume();
                     });
+
+            return _resumer.suspend(handle);
         }
 
-        Result await_resume() {
-            return _result.get();
+        void await_resume() {
+            if (_err) {
+                std::rethrow_exception(_err);
+            }
         }
 
     private:
         friend class CoRedis;
 
-        Awaiter(AsyncRedis *r, FormattedCommand cmd) : _async_redis(r), _cmd(std::move(cmd)) {}
+        TransactionAwaiter(AsyncRedis *r, Func func, std::size_t max_retries) :
+            _async_redis(r), _func(std::move(func)), _max_retries(max_retries) {}
 
         AsyncRedis *_async_redis = nullptr;
 
-        FormattedCommand _cmd;
+        Func _func;
+
+        std::size_t _max_retries = 0;
 
-        Future<Result> _result;
+        detail::CoResumer _resumer;
+
+        std::exception_ptr _err;
     };
 
-    template <typename Result>
-    class Awaiter<Result, DefaultResultParser<Result>,
-          typename std::enable_if<std::is_same<Result, void>::value, void>::type> {
+    template <typename Func>
+    TransactionAwaiter<typename std::decay<Func>::type> transaction(Func &&func,
+            std::size_t max_retries = 3) {
+        return TransactionAwaiter<typename std::decay<Func>::type>(&_async_redis,
+                std::forward<Func>(func), max_retries);
+    }
+
+    // The event of the command is embedded in the awaiter, i.e. the coroutine frame,
+    // so that awaiting a command does not allocate an event on heap.
+    template <typename Result, typename ResultParser = DefaultResultParser<Result>>
+    class Awaiter {
     public:
         bool await_ready() noexcept {
             return false;
         }
 
-        void await_suspend(std::coroutine_handle<> handle) {
-            _async_redis->co_command_with_parser<void, DefaultResultParser<void>>(std::move(_cmd),
-                    [this, handle](Future<void> &&fut) mutable {
-                        _result = std::move(fut);
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // If it throws, the event has NOT been queued, and the coroutine is resumed
+            // with the exception.
+            _async_redis->co_send(_event);
 
-                        handle.resume();
-                    });
+            // The reply might have been received, or the connection might have failed,
+            // before the coroutine is suspended.
+            return _event.suspend(handle);
         }
 
-        void await_resume() {
-            _result.get();
+        Result await_resume() {
+            return _event.get();
         }
 
     private:
         friend class CoRedis;
 
-        Awaiter(AsyncRedis *r, FormattedCommand cmd) : _async_redis(r), _cmd(std::move(cmd)) {}
+        Awaiter(AsyncRedis *r, FormattedCommand cmd) : _async_redis(r), _event(std::move(cmd)) {}
 
         AsyncRedis *_async_redis = nullptr;
 
-        FormattedCommand _cmd;
-
-        Future<void> _result;
+        detail::CoCommandEvent<Result, ResultParser> _event;
     };
+
     template <typename Result, typename ...Args>
     Awaiter<Result> command(const StringView &cmd_name, Args &&...args) {
         auto formatter = [](const StringView &name, Args &&...params) {
@@ -145,7 +179,7 @@ public:
         auto formatter = [](Input start, Input stop) {
             CmdArgs cmd_args;
             while (start != stop) {
-                cmd_args.append(*start);
+                cmd_args.append_copy(*start);
                 ++start;
             }
             return fmt::format_cmd(cmd_args);
@@ -31,6 +31,7 @@
 # error "<coroutine> not found."
 #endif
 #include "sw/redis++/async_redis_cluster.h"
+#include "sw/redis++/co_utils.h"
 #include "sw/redis++/cxx_utils.h"
 #include "sw/redis++/cmd_formatter.h"
 #include "sw/redis++/redis_uri.h"
@@ -54,6 +55,16 @@ public:
 
     ~CoRedisCluster() = default;
 
+    // Create a transaction to the node where the slot of `hash_tag` is located.
+    // Check `AsyncRedisCluster::transaction` for detail.
+    AsyncTransaction transaction(const StringView &hash_tag) {
+        return _async_redis.transaction(hash_tag);
+    }
+
+    ExecAwaiter exec(AsyncTransaction &tx) {
+        return ExecAwaiter(tx);
+    }
+
     template <typename Result, typename ResultParser = DefaultResultParser<Result>, typename = void>
     class Awaiter {
     public:
@@ -150,7 +161,7 @@ public:
             CmdArgs cmd_args;
             cmd_args.append(cmd_name);
             while (start != stop) {
-                cmd_args.append(*start);
+                cmd_args.append_copy(*start);
                 ++start;
             }
             return fmt::format_cmd(cmd_args);
@@ -0,0 +1,275 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+
+#ifndef SEWENEW_REDISPLUSPLUS_CO_UTILS_H
+#define SEWENEW_REDISPLUSPLUS_CO_UTILS_H
+
+#if __has_include(<coroutine>)
+# include <coroutine>
+#elif __has_include(<experimental/coroutine>)
+# include <experimental/coroutine>
+# ifndef coroutine_handle
+#  define coroutine_handle experimental::coroutine_handle
+# endif
+# ifndef suspend_never
+#  define suspend_never experimental::suspend_never
+# endif
+#else
+# error "<coroutine> not found."
+#endif
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include "sw/redis++/async_connection.h"
+#include "sw/redis++/async_transaction.h"
+#include "sw/redis++/cxx_utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// Allocate coroutine frames, whose promise type derives from `CoFramePromise`.
+// By default, frames are allocated with the global `operator new`. In order to
+// avoid calling malloc for each coroutine, set a pool allocator before creating
+// any coroutine, and never change it afterwards.
+class CoFrameAllocator {
+public:
+    using AllocateFunc = void* (*)(std::size_t size);
+
+    using DeallocateFunc = void (*)(void *ptr, std::size_t size) noexcept;
+
+    static void set(AllocateFunc allocate, DeallocateFunc deallocate) noexcept {
+        assert(allocate != nullptr && deallocate != nullptr);
+
+        _allocate = allocate;
+        _deallocate = deallocate;
+    }
+
+    static void* allocate(std::size_t size) {
+        return _allocate(size);
+    }
+
+    static void deallocate(void *ptr, std::size_t size) noexcept {
+        _deallocate(ptr, size);
+    }
+
+private:
+    static void* _default_allocate(std::size_t size) {
+        return ::operator new(size);
+    }
+
+    static void _default_deallocate(void *ptr, std::size_t /*size*/) noexcept {
+        ::operator delete(ptr);
+    }
+
+    static inline AllocateFunc _allocate = _default_allocate;
+
+    static inline DeallocateFunc _deallocate = _default_deallocate;
+};
+
+// Derive the promise type of a coroutine from this class,
+// so that its frame is allocated with `CoFrameAllocator`.
+struct CoFramePromise {
+    static void* operator new(std::size_t size) {
+        return CoFrameAllocator::allocate(size);
+    }
+
+    static void operator delete(void *ptr, std::size_t size) noexcept {
+        CoFrameAllocator::deallocate(ptr, size);
+    }
+};
+
+namespace detail {
+
+// Resume a coroutine, which awaits an event embedded in its awaiter, once the event is done.
+// The event might be done before the coroutine is suspended, and in this case, the coroutine
+// is NOT suspended, so that it's never resumed inside `await_suspend`.
+class CoResumer {
+public:
+    // Called by `await_suspend` after the event has been sent. Return false, if the event
+    // has already been done, and the coroutine should NOT be suspended.
+    bool suspend(std::coroutine_handle<> handle) noexcept {
+        _handle = handle;
+
+        return _state.exchange(State::SUSPENDED, std::memory_order_acq_rel) != State::DONE;
+    }
+
+    void resume() noexcept {
+        if (_state.exchange(State::DONE, std::memory_order_acq_rel) == State::SUSPENDED) {
+            // NOTE: the coroutine might destroy this object, so do NOT touch any member after resuming.
+            _handle.resume();
+        }
+    }
+
+private:
+    enum class State {
+        SENDING = 0,
+        SUSPENDED,
+        DONE
+    };
+
+    std::coroutine_handle<> _handle;
+
+    std::atomic<State> _state{State::SENDING};
+};
+
+// An event embedded in a coroutine awaiter, instead of being created on heap.
+// The reply is saved in the event, and the coroutine is resumed with `done`, which
+// is called once the connection no longer refers to the event. Releasing the event
+// with `destroy`, e.g. when sending it throws, never resumes the coroutine.
+class CoEventBase : public CommandEventBase {
+public:
+    explicit CoEventBase(FormattedCommand cmd) : CommandEventBase(std::move(cmd)) {}
+
+    bool suspend(std::coroutine_handle<> handle) noexcept {
+        return _resumer.suspend(handle);
+    }
+
+    virtual void set_exception(std::exception_ptr err) override {
+        _err = err;
+    }
+
+    virtual void destroy() noexcept override {
+        // Owned by the awaiter.
+    }
+
+    virtual void done() noexcept override {
+        _resumer.resume();
+    }
+
+protected:
+    void _check_error() const {
+        if (_err) {
+            std::rethrow_exception(_err);
+        }
+    }
+
+private:
+    CoResumer _resumer;
+
+    std::exception_ptr _err;
+};
+
+// Like `CoEventBase`, a transaction event embedded in `ExecAwaiter`.
+class CoTransactionEvent : public TransactionEventBase {
+public:
+    bool suspend(std::coroutine_handle<> handle) noexcept {
+        return _resumer.suspend(handle);
+    }
+
+    virtual void destroy() noexcept override {
+        // Owned by the awaiter.
+    }
+
+    virtual void done() noexcept override {
+        _resumer.resume();
+    }
+
+    void get() const {
+        if (_err) {
+            std::rethrow_exception(_err);
+        }
+    }
+
+protected:
+    virtual void _set_result(std::exception_ptr err) override {
+        _err = err;
+    }
+
+private:
+    CoResumer _resumer;
+
+    std::exception_ptr _err;
+};
+
+template <typename Result, typename ResultParser>
+class CoCommandEvent : public CoEventBase {
+public:
+    explicit CoCommandEvent(FormattedCommand cmd) : CoEventBase(std::move(cmd)) {}
+
+    virtual void set_value(redisReply &reply) override {
+        ResultParser parser;
+        _result = parser(reply);
+    }
+
+    Result get() {
+        _check_error();
+
+        assert(_result);
+
+        return std::move(*_result);
+    }
+
+private:
+    Optional<Result> _result;
+};
+
+template <typename ResultParser>
+class CoCommandEvent<void, ResultParser> : public CoEventBase {
+public:
+    explicit CoCommandEvent(FormattedCommand cmd) : CoEventBase(std::move(cmd)) {}
+
+    virtual void set_value(redisReply &reply) override {
+        ResultParser parser;
+        parser(reply);
+    }
+
+    void get() {
+        _check_error();
+    }
+};
+
+}
+
+// Send commands queued in the transaction, and resume the coroutine when the reply
+// of EXEC has been received. Futures of the queued commands are ready by then.
+// The event of the transaction is embedded in the awaiter, instead of being created on heap.
+class ExecAwaiter {
+public:
+    explicit ExecAwaiter(AsyncTransaction &tx) : _tx(&tx) {}
+
+    bool await_ready() noexcept {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        // If it throws, the event has NOT been sent, and the coroutine is resumed
+        // with the exception. If there's no queued command, the coroutine is NOT suspended.
+        if (!_tx->co_exec(_event)) {
+            return false;
+        }
+
+        return _event.suspend(handle);
+    }
+
+    void await_resume() {
+        _event.get();
+    }
+
+private:
+    AsyncTransaction *_tx = nullptr;
+
+    detail::CoTransactionEvent _event;
+};
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_CO_UTILS_H
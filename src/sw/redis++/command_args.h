@@ -17,24 +17,171 @@
 #ifndef SEWENEW_REDISPLUSPLUS_COMMAND_ARGS_H
 #define SEWENEW_REDISPLUSPLUS_COMMAND_ARGS_H
 
+#include <cstdio>
+#include <cstring>
 #include <vector>
 #include <list>
+#include <limits>
 #include <string>
 #include <tuple>
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#include "sw/redis++/errors.h"
 #include "sw/redis++/utils.h"
 
 namespace sw {
 
 namespace redis {
 
+namespace detail {
+
+// A vector that keeps the first N elements in an inline buffer, and only
+// allocates memory from heap when it has more than N elements.
+// NOTE: T should be trivially copyable.
+template <typename T, std::size_t N>
+class InlineVector {
+public:
+    InlineVector() = default;
+
+    InlineVector(const InlineVector &) = delete;
+    InlineVector& operator=(const InlineVector &) = delete;
+
+    InlineVector(InlineVector &&) = delete;
+    InlineVector& operator=(InlineVector &&) = delete;
+
+    ~InlineVector() = default;
+
+    void push_back(T val) {
+        if (_size < N) {
+            _inline[_size++] = val;
+            return;
+        }
+
+        if (_size == N) {
+            // Move to heap.
+            _heap.reserve(N * 2);
+            _heap.assign(_inline, _inline + N);
+        }
+
+        _heap.push_back(val);
+        ++_size;
+    }
+
+    T* data() {
+        return _size <= N ? _inline : _heap.data();
+    }
+
+    std::size_t size() const {
+        return _size;
+    }
+
+private:
+    T _inline[N];
+
+    std::size_t _size = 0;
+
+    std::vector<T> _heap;
+};
+
+// Max length of the text representation of an arithmetic value.
+constexpr std::size_t MAX_NUMBER_LENGTH = 64;
+
+// Convert an arithmetic value to text, and return the length.
+// The result is NOT null-terminated.
+template <typename T,
+            typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+std::size_t format_number(T val, char *buf) {
+    // Keep the same behavior as `std::to_string`, e.g. `bool` and `char` are
+    // converted to integers, instead of 'true' or a single character.
+    using Type = typename std::conditional<std::is_signed<T>::value,
+                                            long long, unsigned long long>::type;
+    auto num = static_cast<Type>(val);
+
+#if defined(__cpp_lib_to_chars)
+    return std::to_chars(buf, buf + MAX_NUMBER_LENGTH, num).ptr - buf;
+#else
+    // Write digits backwards, and then move them to the beginning of the buffer.
+    auto *last = buf + MAX_NUMBER_LENGTH;
+    auto *first = last;
+
+    auto negative = num < 0;
+    auto unsigned_num = static_cast<unsigned long long>(num);
+    if (negative) {
+        unsigned_num = 0ULL - unsigned_num;
+    }
+
+    do {
+        *--first = static_cast<char>('0' + unsigned_num % 10);
+        unsigned_num /= 10;
+    } while (unsigned_num != 0);
+
+    if (negative) {
+        *--first = '-';
+    }
+
+    auto len = static_cast<std::size_t>(last - first);
+    std::memmove(buf, first, len);
+
+    return len;
+#endif
+}
+
+template <typename T,
+            typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+std::size_t format_number(T val, char *buf) {
+#if defined(__cpp_lib_to_chars)
+    // The shortest representation that can be parsed back to the same value.
+    return std::to_chars(buf, buf + MAX_NUMBER_LENGTH, val).ptr - buf;
+#else
+    // Print enough digits so that the value can be parsed back without precision loss.
+    auto len = std::snprintf(buf, MAX_NUMBER_LENGTH, "%.*Lg",
+                    std::numeric_limits<T>::max_digits10,
+                    static_cast<long double>(val));
+    if (len < 0 || static_cast<std::size_t>(len) >= MAX_NUMBER_LENGTH) {
+        throw Error("failed to convert floating point number to string");
+    }
+
+    return static_cast<std::size_t>(len);
+#endif
+}
+
+}
+
 class CmdArgs {
 public:
+    CmdArgs() = default;
+
+    // CmdArgs keeps pointers to its inline buffers, so it's neither copyable nor movable.
+    CmdArgs(const CmdArgs &) = delete;
+    CmdArgs& operator=(const CmdArgs &) = delete;
+
+    CmdArgs(CmdArgs &&) = delete;
+    CmdArgs& operator=(CmdArgs &&) = delete;
+
+    ~CmdArgs() = default;
+
     template <typename Arg>
     CmdArgs& append(Arg &&arg);
 
     template <typename Arg, typename ...Args>
     CmdArgs& append(Arg &&arg, Args &&...args);
 
+    // Deep copy, used to append elements of a range. Since an iterator might return a
+    // temporary, or a reference that is invalidated by incrementing it, e.g. a transform
+    // iterator or std::istream_iterator, elements CANNOT be shallow copied.
+    template <typename Arg>
+    CmdArgs& append_copy(Arg &&arg);
+
+    CmdArgs& append_copy(std::string &&arg) {
+        return _append(std::move(arg));
+    }
+
     // All overloads of operator<< are for internal use only.
     CmdArgs& operator<<(const StringView &arg);
 
@@ -70,7 +217,10 @@ public:
 
 private:
     // Deep copy.
-    CmdArgs& _append(std::string arg);
+    CmdArgs& _append(std::string &&arg);
+
+    // Shallow copy.
+    CmdArgs& _append(const std::string &arg);
 
     // Shallow copy.
     CmdArgs& _append(const StringView &arg);
@@ -91,9 +241,35 @@ private:
     template <typename Iter>
     CmdArgs& _append(std::false_type, const std::pair<Iter, Iter> &range);
 
-    std::vector<const char *> _argv;
-    std::vector<std::size_t> _argv_len;
+    // Copy the data to the arena, or to `_args` if the arena is full.
+    CmdArgs& _append_copy(const char *data, std::size_t len);
+
+    template <typename Arg>
+    CmdArgs& _append_copy(std::true_type, Arg &&arg) {
+        StringView str(std::forward<Arg>(arg));
+
+        return _append_copy(str.data(), str.size());
+    }
+
+    // Not a string, e.g. numbers, which are always copied.
+    template <typename Arg>
+    CmdArgs& _append_copy(std::false_type, Arg &&arg) {
+        return _append(std::forward<Arg>(arg));
+    }
+
+    // Number of arguments that can be saved without allocating memory from heap.
+    static constexpr std::size_t INLINE_ARGS_NUM = 8;
 
+    // Size of the buffer saving copied arguments, e.g. text representations of numbers.
+    static constexpr std::size_t ARENA_SIZE = 128;
+
+    detail::InlineVector<const char *, INLINE_ARGS_NUM> _argv;
+    detail::InlineVector<std::size_t, INLINE_ARGS_NUM> _argv_len;
+
+    char _arena[ARENA_SIZE];
+    std::size_t _arena_used = 0;
+
+    // Copied arguments that cannot be saved in the arena.
     std::list<std::string> _args;
 };
 
@@ -109,6 +285,12 @@ inline CmdArgs& CmdArgs::append(Arg &&arg, Args &&...args) {
     return append(std::forward<Args>(args)...);
 }
 
+template <typename Arg>
+inline CmdArgs& CmdArgs::append_copy(Arg &&arg) {
+    return _append_copy(typename std::is_convertible<Arg, StringView>::type(),
+                        std::forward<Arg>(arg));
+}
+
 inline CmdArgs& CmdArgs::operator<<(const StringView &arg) {
     _argv.push_back(arg.data());
     _argv_len.push_back(arg.size());
@@ -125,7 +307,10 @@ template <typename T,
              typename std::enable_if<std::is_arithmetic<typename std::decay<T>::type>::value,
                                     int>::type>
 inline CmdArgs& CmdArgs::operator<<(T &&arg) {
-    return _append(std::to_string(std::forward<T>(arg)));
+    char buf[detail::MAX_NUMBER_LENGTH];
+    auto len = detail::format_number(arg, buf);
+
+    return _append_copy(buf, len);
 }
 
 template <std::size_t N, typename ...Args>
@@ -136,11 +321,34 @@ auto CmdArgs::operator<<(const std::tuple<Args...> &arg) ->
     return operator<<<N + 1, Args...>(arg);
 }
 
-inline CmdArgs& CmdArgs::_append(std::string arg) {
+inline CmdArgs& CmdArgs::_append(std::string &&arg) {
+    if (arg.size() <= ARENA_SIZE - _arena_used) {
+        return _append_copy(arg.data(), arg.size());
+    }
+
     _args.push_back(std::move(arg));
     return operator<<(_args.back());
 }
 
+inline CmdArgs& CmdArgs::_append(const std::string &arg) {
+    return operator<<(arg);
+}
+
+inline CmdArgs& CmdArgs::_append_copy(const char *data, std::size_t len) {
+    if (len <= ARENA_SIZE - _arena_used) {
+        auto *dest = _arena + _arena_used;
+        if (len > 0) {
+            std::memcpy(dest, data, len);
+        }
+        _arena_used += len;
+
+        return operator<<(StringView(dest, len));
+    }
+
+    _args.emplace_back(data, len);
+    return operator<<(_args.back());
+}
+
 inline CmdArgs& CmdArgs::_append(const StringView &arg) {
     return operator<<(arg);
 }
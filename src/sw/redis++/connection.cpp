@@ -16,11 +16,16 @@
 
 #include "sw/redis++/connection.h"
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <tuple>
+#include <vector>
 #include <algorithm>
 #include "sw/redis++/reply.h"
 #include "sw/redis++/command.h"
 #include "sw/redis++/command_args.h"
+#include "sw/redis++/reply_arena.h"
 
 #ifdef _MSC_VER
 
@@ -28,6 +33,87 @@
 
 #endif
 
+#ifndef _WIN32
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#endif
+
+namespace {
+
+#ifndef _WIN32
+
+// Max number of buffers passed to a single sendmsg call.
+constexpr std::size_t MAX_IOV_NUM = 64;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Write all `count` buffers to the blocking socket. Buffers are modified, if
+// they're partially written. Return false and set errno, if it fails.
+bool write_all(int fd, iovec *bufs, std::size_t count) {
+    std::size_t idx = 0;
+    while (idx != count) {
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = bufs + idx;
+        msg.msg_iovlen = std::min(count - idx, MAX_IOV_NUM);
+
+        auto written = ::sendmsg(fd, &msg, SEND_FLAGS);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        // Skip buffers that have been written, and adjust the partially written one.
+        auto len = static_cast<std::size_t>(written);
+        while (idx != count && len >= bufs[idx].iov_len) {
+            len -= bufs[idx].iov_len;
+            ++idx;
+        }
+
+        if (len > 0) {
+            assert(idx != count);
+
+            bufs[idx].iov_base = static_cast<char *>(bufs[idx].iov_base) + len;
+            bufs[idx].iov_len -= len;
+        }
+    }
+
+    return true;
+}
+
+#endif
+
+// Whether the reply is a message received by subscriber, i.e. message, pmessage or smessage.
+bool is_message(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_ARRAY || reply.elements < 3 || reply.element == nullptr) {
+        return false;
+    }
+
+    const auto *type = reply.element[0];
+    if (type == nullptr || type->type != REDIS_REPLY_STRING) {
+        return false;
+    }
+
+    auto len = type->len;
+    const auto *str = type->str;
+
+    return (len == 7 && std::memcmp(str, "message", 7) == 0)
+        || (len == 8 && std::memcmp(str, "pmessage", 8) == 0)
+        || (len == 8 && std::memcmp(str, "smessage", 8) == 0);
+}
+
+}
+
 namespace sw {
 
 namespace redis {
@@ -178,6 +264,9 @@ void swap(Connection &lhs, Connection &rhs) noexcept {
     std::swap(lhs._ctx, rhs._ctx);
     std::swap(lhs._create_time, rhs._create_time);
     std::swap(lhs._opts, rhs._opts);
+    std::swap(lhs._obuf, rhs._obuf);
+    std::swap(lhs._hiredis_buffered, rhs._hiredis_buffered);
+    std::swap(lhs._pending, rhs._pending);
 }
 
 Connection::Connection(const ConnectionOptions &opts) :
@@ -193,43 +282,68 @@ Connection::Connection(const ConnectionOptions &opts) :
         _tls_ctx = tls::secure_connection(*_ctx, tls_opts);
     }
 
+    if (_opts.reply_arena) {
+        ReplyArena::install(*(_ctx->reader));
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+        // hiredis' default push callback frees replies with `freeReplyObject`.
+        redisSetPushCallback(_ctx.get(), ReplyArena::free_push_reply);
+#endif
+    }
+
     _set_options();
 }
 
 void Connection::reconnect() {
+    // A lazily created connection, i.e. `_ctx` is null, is connecting for the first time.
+    if (_ctx && _opts.metrics) {
+        _opts.metrics->on_reconnect();
+    }
+
     Connection connection(_opts);
 
     swap(*this, connection);
 }
 
 void Connection::send(int argc, const char **argv, const std::size_t *argv_len) {
+    _send(static_cast<std::size_t>(argc), argv, argv_len);
+}
+
+void Connection::send(CmdArgs &args) {
+    _send(args.size(), args.argv(), args.argv_len());
+}
+
+void Connection::send_formatted(const char *cmd, std::size_t len) {
     auto ctx = _context();
 
     assert(ctx != nullptr);
 
-    if (redisAppendCommandArgv(ctx,
-                                argc,
-                                argv,
-                                argv_len) != REDIS_OK) {
-        throw_error(*ctx, "Failed to send command");
+    if (!_direct_write() || _hiredis_buffered) {
+        // Commands in `_obuf` must be sent before this one.
+        _flush_to_hiredis();
+
+        if (redisAppendFormattedCommand(ctx, cmd, len) != REDIS_OK) {
+            throw_error(*ctx, "Failed to send command");
+        }
+
+        _hiredis_buffered = true;
+    } else {
+        _obuf.append(cmd, len);
+    }
+
+    if (_opts.metrics) {
+        _on_send(resp::command_name(cmd, len), len);
     }
 
     assert(!broken());
 }
 
-void Connection::send(CmdArgs &args) {
-    auto ctx = _context();
+void Connection::flush() {
+    assert(_ctx);
 
-    assert(ctx != nullptr);
+    _flush();
 
-    if (redisAppendCommandArgv(ctx,
-                                static_cast<int>(args.size()),
-                                args.argv(),
-                                args.argv_len()) != REDIS_OK) {
-        throw_error(*ctx, "Failed to send command");
-    }
-
-    assert(!broken());
+    _flush_hiredis();
 }
 
 ReplyUPtr Connection::recv(bool handle_error_reply) {
@@ -237,6 +351,13 @@ ReplyUPtr Connection::recv(bool handle_error_reply) {
 
     assert(ctx != nullptr);
 
+    _flush();
+
+    // redisGetReply does NOT write hiredis' output buffer, if a reply has already been
+    // buffered in the reader. Write it explicitly, so that commands written directly
+    // to the socket later, won't be sent before commands in it.
+    _flush_hiredis();
+
     void *r = nullptr;
     if (redisGetReply(ctx, &r) != REDIS_OK) {
         throw_error(*ctx, "Failed to get reply");
@@ -244,7 +365,13 @@ ReplyUPtr Connection::recv(bool handle_error_reply) {
 
     assert(!broken() && r != nullptr);
 
-    auto reply = ReplyUPtr(static_cast<redisReply*>(r));
+    auto *rep = static_cast<redisReply*>(r);
+    auto reply = _opts.reply_arena ?
+        ReplyUPtr(rep, ReplyDeleter(ReplyArena::of(*rep))) : ReplyUPtr(rep);
+
+    if (_opts.metrics) {
+        _on_recv(*reply);
+    }
 
     if (handle_error_reply && reply::is_error(*reply)) {
         throw_error(*reply);
@@ -263,6 +390,282 @@ void Connection::set_push_callback(redisPushFn *push_func) {
 
 #endif
 
+void Connection::_send(std::size_t argc, const char **argv, const std::size_t *argv_len) {
+    auto ctx = _context();
+
+    assert(ctx != nullptr);
+
+    if (!_direct_write() || _hiredis_buffered) {
+        // Encode the command by ourselves, and let hiredis send it,
+        // so that it's sent after commands in hiredis' output buffer.
+        assert(_obuf.empty());
+
+        _obuf.append_command(argc, argv, argv_len);
+
+        auto status = redisAppendFormattedCommand(ctx, _obuf.data(), _obuf.size());
+
+        _obuf.clear();
+
+        if (status != REDIS_OK) {
+            throw_error(*ctx, "Failed to send command");
+        }
+
+        _hiredis_buffered = true;
+    } else {
+        auto large_arg = std::any_of(argv_len, argv_len + argc,
+                [](std::size_t len) { return len >= resp::LARGE_ARG_LENGTH; });
+        if (large_arg) {
+            _write_command(argc, argv, argv_len);
+        } else {
+            // Buffer the command, and send it with others before receiving reply.
+            _obuf.append_command(argc, argv, argv_len);
+        }
+    }
+
+    if (_opts.metrics && argc > 0) {
+        _on_send(StringView(argv[0], argv_len[0]), resp::command_size(argc, argv_len));
+    }
+
+    assert(!broken());
+}
+
+void Connection::_on_send(const StringView &cmd_name, std::size_t len) {
+    assert(_opts.metrics);
+
+    _opts.metrics->on_bytes_sent(len);
+
+    _pending.push(PendingCommand(cmd_name, std::chrono::steady_clock::now()));
+}
+
+void Connection::_on_recv(const redisReply &reply) {
+    assert(_opts.metrics);
+
+    auto &metrics = *_opts.metrics;
+
+    metrics.on_bytes_received(resp::reply_size(reply));
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    if (reply.type == REDIS_REPLY_PUSH) {
+        // Push messages are not replies of any command.
+        return;
+    }
+#endif
+
+    if (is_message(reply)) {
+        // Messages received by subscriber are not replies of any command.
+        return;
+    }
+
+    if (!_pending.empty()) {
+        const auto &cmd = _pending.front();
+        metrics.on_command(cmd.name(), std::chrono::steady_clock::now() - cmd.send_time());
+        _pending.pop();
+    }
+}
+
+void Connection::PendingQueue::push(const PendingCommand &cmd) {
+    if (_size == _cmds.size()) {
+        _grow();
+    }
+
+    _cmds[(_head + _size) % _cmds.size()] = cmd;
+    ++_size;
+}
+
+void Connection::PendingQueue::_grow() {
+    std::vector<PendingCommand> cmds(std::max<std::size_t>(_cmds.size() * 2, 16));
+    for (std::size_t idx = 0; idx != _size; ++idx) {
+        cmds[idx] = _cmds[(_head + idx) % _cmds.size()];
+    }
+
+    _cmds.swap(cmds);
+    _head = 0;
+}
+
+constexpr std::size_t Connection::PendingCommand::MAX_NAME_LEN;
+
+Connection::PendingCommand::PendingCommand(const StringView &cmd_name,
+        std::chrono::time_point<std::chrono::steady_clock> time) :
+            _name_len(static_cast<unsigned char>(std::min(cmd_name.size(), MAX_NAME_LEN))),
+            _send_time(time) {
+    for (std::size_t idx = 0; idx != _name_len; ++idx) {
+        auto c = cmd_name.data()[idx];
+        _name[idx] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+    }
+}
+
+bool Connection::_direct_write() const {
+#ifdef _WIN32
+    return false;
+#else
+    // With TLS, data must be written with hiredis' SSL functions.
+    return !tls::enabled(_opts.tls);
+#endif
+}
+
+void Connection::_flush_to_hiredis() {
+    if (_obuf.empty()) {
+        return;
+    }
+
+    auto *ctx = _ctx.get();
+
+    assert(ctx != nullptr);
+
+    auto status = redisAppendFormattedCommand(ctx, _obuf.data(), _obuf.size());
+
+    _obuf.clear();
+
+    if (status != REDIS_OK) {
+        throw_error(*ctx, "Failed to send command");
+    }
+}
+
+void Connection::_flush_hiredis() {
+    if (!_hiredis_buffered) {
+        return;
+    }
+
+    auto *ctx = _ctx.get();
+
+    assert(ctx != nullptr);
+
+    int done = 0;
+    do {
+        if (redisBufferWrite(ctx, &done) != REDIS_OK) {
+            throw_error(*ctx, "Failed to send command");
+        }
+    } while (done == 0);
+
+    _hiredis_buffered = false;
+}
+
+void Connection::_flush() {
+    if (_obuf.empty()) {
+        return;
+    }
+
+#ifdef _WIN32
+    // Should never reach here, since we never buffer commands in `_obuf` on Windows.
+    assert(false);
+    _flush_to_hiredis();
+#else
+    iovec buf;
+    buf.iov_base = const_cast<char *>(_obuf.data());
+    buf.iov_len = _obuf.size();
+
+    auto ok = write_all(_ctx->fd, &buf, 1);
+    auto err = errno;
+
+    _obuf.clear();
+
+    if (!ok) {
+        _throw_write_error(err);
+    }
+#endif
+}
+
+void Connection::_write_command(std::size_t argc, const char **argv, const std::size_t *argv_len) {
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    (void)argv_len;
+
+    // Should never reach here, since we never write commands directly on Windows.
+    assert(false);
+#else
+    // A segment is either a range of `_obuf`, i.e. `data` is nullptr,
+    // or a large argument, which is NOT copied.
+    struct Segment {
+        const char *data;
+        std::size_t offset;
+        std::size_t len;
+    };
+
+    // Both segments and buffers live on stack. If there're too many large arguments,
+    // segments collected so far are written, before building the rest of the command.
+    Segment segments[MAX_IOV_NUM];
+    std::size_t segment_num = 0;
+
+    // Commands buffered before this one, and the array header.
+    std::size_t segment_start = 0;
+
+    auto write_segments = [this, &segments, &segment_num, &segment_start]() {
+        // `_obuf` won't be reallocated, and we can take pointers to it.
+        iovec bufs[MAX_IOV_NUM];
+        std::size_t buf_num = 0;
+        for (std::size_t idx = 0; idx != segment_num; ++idx) {
+            const auto &segment = segments[idx];
+            if (segment.len == 0) {
+                continue;
+            }
+
+            const char *data = segment.data;
+            if (data == nullptr) {
+                data = _obuf.data() + segment.offset;
+            }
+
+            bufs[buf_num].iov_base = const_cast<char *>(data);
+            bufs[buf_num].iov_len = segment.len;
+            ++buf_num;
+        }
+
+        auto ok = write_all(_ctx->fd, bufs, buf_num);
+        auto err = errno;
+
+        _obuf.clear();
+        segment_num = 0;
+        segment_start = 0;
+
+        if (!ok) {
+            _throw_write_error(err);
+        }
+    };
+
+    auto *buf = _obuf.prepare(resp::MAX_HEADER_LENGTH);
+    _obuf.commit(resp::write_array_header(buf, argc) - buf);
+
+    for (std::size_t idx = 0; idx != argc; ++idx) {
+        auto len = argv_len[idx];
+        buf = _obuf.prepare(resp::MAX_HEADER_LENGTH);
+        _obuf.commit(resp::write_bulk_header(buf, len) - buf);
+
+        if (len >= resp::LARGE_ARG_LENGTH) {
+            segments[segment_num++] = Segment{nullptr, segment_start, _obuf.size() - segment_start};
+            segments[segment_num++] = Segment{argv[idx], 0, len};
+            segment_start = _obuf.size();
+
+            if (segment_num + 2 > MAX_IOV_NUM) {
+                // No room for another large argument.
+                write_segments();
+            }
+        } else {
+            _obuf.append(argv[idx], len);
+        }
+
+        _obuf.append("\r\n", 2);
+    }
+
+    segments[segment_num++] = Segment{nullptr, segment_start, _obuf.size() - segment_start};
+
+    write_segments();
+#endif
+}
+
+void Connection::_throw_write_error(int err) {
+    auto *ctx = _ctx.get();
+
+    assert(ctx != nullptr);
+
+    // Mark the connection as broken, the same as what hiredis does when it fails to write.
+    ctx->err = REDIS_ERR_IO;
+    std::snprintf(ctx->errstr, sizeof(ctx->errstr), "%s", std::strerror(err));
+
+    errno = err;
+
+    throw_error(*ctx, "Failed to send command");
+}
+
 void Connection::_set_options() {
     _auth();
 
@@ -27,7 +27,9 @@
 #include <chrono>
 #include <hiredis/hiredis.h>
 #include "sw/redis++/errors.h"
+#include "sw/redis++/metrics.h"
 #include "sw/redis++/reply.h"
+#include "sw/redis++/resp.h"
 #include "sw/redis++/utils.h"
 #include "sw/redis++/tls.h"
 #include "sw/redis++/hiredis_features.h"
@@ -89,6 +91,17 @@ struct ConnectionOptions {
 
     std::string name;
 
+    // Hook to collect metrics, e.g. latency of each command. By default, it's null,
+    // and no metric is collected. The hook is shared by all connections of the pool.
+    MetricsHookSPtr metrics;
+
+    // Allocate each reply, including its sub replies and strings, in an arena,
+    // instead of calling malloc for each of them. It reduces the cost of allocating
+    // and freeing large array replies, e.g. ZRANGE WITHSCORES with many members.
+    // NOTE: with this option, a push callback set with `set_push_callback`
+    // MUST free the reply with `ReplyArena::free_reply`.
+    bool reply_arena = false;
+
     // For internal use, and might be removed in the future. DO NOT use it in client code.
     std::string _server_info() const;
 };
@@ -143,6 +156,13 @@ public:
 
     void send(CmdArgs &args);
 
+    // Send a command, which has already been encoded with RESP.
+    void send_formatted(const char *cmd, std::size_t len);
+
+    // Write buffered commands to the socket without receiving any reply, so that
+    // the server starts processing them, while we send commands to other servers.
+    void flush();
+
     ReplyUPtr recv(bool handle_error_reply = true);
 
     const ConnectionOptions& options() const {
@@ -162,6 +182,8 @@ private:
 
     friend class ConnectionPool;
 
+    friend class MultiplexedConnection;
+
     class Connector;
 
     struct ContextDeleter {
@@ -188,6 +210,107 @@ private:
 
     redisContext* _context();
 
+    void _send(std::size_t argc, const char **argv, const std::size_t *argv_len);
+
+    // Whether we can write commands to the socket by ourselves, instead of via hiredis.
+    bool _direct_write() const;
+
+    // Move commands in `_obuf` to hiredis' output buffer.
+    void _flush_to_hiredis();
+
+    // Write commands in `_obuf` to the socket.
+    void _flush();
+
+    // Write commands in hiredis' output buffer to the socket.
+    void _flush_hiredis();
+
+    // Write commands in `_obuf`, and the given command to the socket. Large
+    // arguments of the command are written with scatter/gather I/O, without copy.
+    void _write_command(std::size_t argc, const char **argv, const std::size_t *argv_len);
+
+    [[noreturn]] void _throw_write_error(int err);
+
+    // Only called when metrics is enabled.
+    void _on_send(const StringView &cmd_name, std::size_t len);
+
+    // Only called when metrics is enabled.
+    void _on_recv(const redisReply &reply);
+
+    // A command that has been sent, but whose reply has not been received yet. The name is
+    // copied, in upper case, into a fixed-size buffer, so that it's never allocated.
+    // Names longer than the buffer, which no Redis command has, are truncated.
+    class PendingCommand {
+    public:
+        PendingCommand() = default;
+
+        PendingCommand(const StringView &cmd_name,
+                        std::chrono::time_point<std::chrono::steady_clock> time);
+
+        StringView name() const {
+            return StringView(_name, _name_len);
+        }
+
+        std::chrono::time_point<std::chrono::steady_clock> send_time() const {
+            return _send_time;
+        }
+
+    private:
+        static constexpr std::size_t MAX_NAME_LEN = 31;
+
+        char _name[MAX_NAME_LEN] = {};
+
+        unsigned char _name_len = 0;
+
+        std::chrono::time_point<std::chrono::steady_clock> _send_time{};
+    };
+
+    // A FIFO queue of pending commands, stored in a ring buffer. The buffer only grows
+    // when there are more pending commands than ever before, so that pushing and popping
+    // commands never allocate once it has grown to the max number of pending commands.
+    class PendingQueue {
+    public:
+        bool empty() const {
+            return _size == 0;
+        }
+
+        void push(const PendingCommand &cmd);
+
+        const PendingCommand& front() const {
+            assert(!empty());
+
+            return _cmds[_head];
+        }
+
+        void pop() {
+            assert(!empty());
+
+            _head = (_head + 1) % _cmds.size();
+            --_size;
+        }
+
+        const PendingCommand& back() const {
+            assert(!empty());
+
+            return _cmds[(_head + _size - 1) % _cmds.size()];
+        }
+
+        void pop_back() {
+            assert(!empty());
+
+            --_size;
+        }
+
+    private:
+        void _grow();
+
+        std::vector<PendingCommand> _cmds;
+
+        // Index of the first command.
+        std::size_t _head = 0;
+
+        std::size_t _size = 0;
+    };
+
     ContextUPtr _ctx;
 
     // The time that the connection is created.
@@ -197,10 +320,30 @@ private:
     // the connection is recently used, i.e. `_context()` is called.
     std::chrono::time_point<std::chrono::steady_clock> _last_active{};
 
+    // Whether the connection is in use, and counted by the load of the pool, from
+    // which it's fetched. Only accessed by `ConnectionPool`, which tracks load.
+    bool _load_tracked = false;
+
+    // The time that the connection is fetched from a pool, which tracks latency.
+    // Only accessed by `ConnectionPool`.
+    std::chrono::time_point<std::chrono::steady_clock> _fetch_time{};
+
     ConnectionOptions _opts;
 
     // TODO: define _tls_ctx before _ctx
     tls::TlsContextUPtr _tls_ctx;
+
+    // Commands that have been encoded, but not written to the socket yet.
+    // They're written before receiving replies.
+    resp::OutputBuffer _obuf;
+
+    // Whether hiredis' output buffer might have some commands, e.g. commands sent
+    // with format string. In this case, commands in `_obuf` must be sent after them.
+    bool _hiredis_buffered = false;
+
+    // Pending commands in order, so that the latency of each command can be recorded
+    // when its reply is received. Only used when metrics is enabled.
+    PendingQueue _pending;
 };
 
 using ConnectionSPtr = std::shared_ptr<Connection>;
@@ -214,16 +357,41 @@ enum class Role {
 
 template <typename ...Args>
 inline void Connection::send(const char *format, Args &&...args) {
+    if (_opts.metrics) {
+        // Format the command by ourselves, so that its name and size can be recorded.
+        char *cmd = nullptr;
+        auto len = redisFormatCommand(&cmd, format, std::forward<Args>(args)...);
+        if (len < 0) {
+            throw Error("Failed to format command");
+        }
+
+        try {
+            send_formatted(cmd, static_cast<std::size_t>(len));
+        } catch (...) {
+            redisFreeCommand(cmd);
+            throw;
+        }
+
+        redisFreeCommand(cmd);
+
+        return;
+    }
+
     auto ctx = _context();
 
     assert(ctx != nullptr);
 
+    // Commands in `_obuf` must be sent before this one.
+    _flush_to_hiredis();
+
     if (redisAppendCommand(ctx,
                 format,
                 std::forward<Args>(args)...) != REDIS_OK) {
         throw_error(*ctx, "Failed to send command");
     }
 
+    _hiredis_buffered = true;
+
     assert(!broken());
 }
 
@@ -16,8 +16,28 @@
 
 #include "sw/redis++/connection_pool.h"
 #include <cassert>
+#include <new>
+#include <algorithm>
 #include "sw/redis++/errors.h"
 
+namespace {
+
+// Weight of a new latency sample is 1 / LATENCY_EWMA_DIVISOR.
+constexpr long long LATENCY_EWMA_DIVISOR = 8;
+
+// Latency halves every LATENCY_DECAY_PERIOD, if no sample is recorded.
+constexpr long long LATENCY_DECAY_PERIOD = 1000 * 1000;
+
+// Latency sample of a broken connection, if socket timeout is NOT set.
+constexpr long long LATENCY_ERROR_PENALTY = 1000 * 1000;
+
+long long now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
 namespace sw {
 
 namespace redis {
@@ -30,6 +50,10 @@ ConnectionPool::ConnectionPool(const ConnectionPoolOptions &pool_opts,
         throw Error("CANNOT create an empty pool");
     }
 
+    if (_pool_opts.mode == ConnectionPoolMode::LOCK_FREE) {
+        _slots.reset(new Slot[_pool_opts.size]);
+    }
+
     // Lazily create connections.
 }
 
@@ -74,6 +98,42 @@ ConnectionPool& ConnectionPool::operator=(ConnectionPool &&that) {
 }
 
 Connection ConnectionPool::fetch() {
+    auto connection = _fetch_connection();
+
+    if (_load_tracking != LoadTracking::NONE) {
+        _on_fetch(connection);
+    }
+
+    return connection;
+}
+
+std::chrono::microseconds ConnectionPool::latency() const {
+    auto latency = _decay_latency(_latency.load(std::memory_order_relaxed),
+                                    _latency_time.load(std::memory_order_relaxed),
+                                    now_us());
+
+    return std::chrono::microseconds(latency);
+}
+
+Connection ConnectionPool::_fetch_connection() {
+    if (_lock_free()) {
+        auto connection = _fetch_lock_free();
+
+        if (_need_reconnect(connection,
+                    _pool_opts.connection_lifetime,
+                    _pool_opts.connection_idle_time)) {
+            try {
+                connection.reconnect();
+            } catch (const Error &) {
+                // Failed to reconnect, return it to the pool, and retry latter.
+                release(std::move(connection));
+                throw;
+            }
+        }
+
+        return connection;
+    }
+
     std::unique_lock<std::mutex> lock(_mutex);
 
     auto connection = _fetch(lock);
@@ -123,6 +183,15 @@ ConnectionOptions ConnectionPool::connection_options() {
 }
 
 void ConnectionPool::release(Connection connection) {
+    if (connection._load_tracked) {
+        _on_release(connection);
+    }
+
+    if (_lock_free()) {
+        _release_lock_free(connection);
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> lock(_mutex);
 
@@ -150,6 +219,22 @@ Connection ConnectionPool::create() {
     }
 }
 
+Connection ConnectionPool::create(const ConnectionOptions &opts) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (_sentinel) {
+        auto sentinel = _sentinel;
+
+        lock.unlock();
+
+        return _create(sentinel, opts);
+    } else {
+        lock.unlock();
+
+        return Connection(opts);
+    }
+}
+
 ConnectionPool ConnectionPool::clone() {
     std::unique_lock<std::mutex> lock(_mutex);
 
@@ -173,10 +258,166 @@ void ConnectionPool::_move(ConnectionPool &&that) {
     _opts = std::move(that._opts);
     _pool_opts = std::move(that._pool_opts);
     _pool = std::move(that._pool);
-    _used_connections = that._used_connections;
+    _used_connections = that._used_connections.load();
+    _load_tracking = that._load_tracking;
+    _outstanding = that._outstanding.load();
+    _latency = that._latency.load();
+    _latency_time = that._latency_time.load();
+    _slots = std::move(that._slots);
     _sentinel = std::move(that._sentinel);
 }
 
+Connection ConnectionPool::_fetch_lock_free() {
+    auto *slot = _acquire_slot();
+    if (slot != nullptr) {
+        return slot->take();
+    }
+
+    if (_try_reserve_connection()) {
+        // Lazily create a new (broken) connection to avoid connecting in the fast path.
+        return Connection(_opts, Connection::Dummy{});
+    }
+
+    // Pool is exhausted, wait for a connection.
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    ++_waiters;
+
+    auto ready = [this, &slot] {
+        if (!(this->_pool).empty()) {
+            return true;
+        }
+
+        slot = this->_acquire_slot();
+
+        return slot != nullptr;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto timeout = _pool_opts.wait_timeout;
+    bool got = true;
+    if (timeout > std::chrono::milliseconds(0)) {
+        got = _cv.wait_for(lock, timeout, ready);
+    } else {
+        _cv.wait(lock, ready);
+    }
+
+    --_waiters;
+
+    _on_pool_wait(start);
+
+    if (!got) {
+        throw Error("Failed to fetch a connection in "
+                + std::to_string(timeout.count()) + " milliseconds");
+    }
+
+    if (slot != nullptr) {
+        return slot->take();
+    }
+
+    return _fetch();
+}
+
+void ConnectionPool::_release_lock_free(Connection &connection) {
+    if (!_put_to_slots(connection)) {
+        // All slots are transiently busy, fall back to the overflow queue.
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _pool.push_back(std::move(connection));
+        }
+
+        _cv.notify_one();
+
+        return;
+    }
+
+    // The slot has been published with a sequentially consistent store. So either
+    // we see the waiter, or the waiter sees the connection when it checks the slots.
+    if (_waiters.load() > 0) {
+        // Lock the mutex to ensure the waiter is NOT between checking slots and
+        // going to sleep, otherwise, the notification might be lost.
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+        }
+
+        _cv.notify_one();
+    }
+}
+
+ConnectionPool::Slot* ConnectionPool::_acquire_slot() {
+    auto size = _pool_opts.size;
+    auto hint = _slot_hint();
+    for (std::size_t idx = 0; idx != size; ++idx) {
+        auto &slot = _slots[(hint + idx) % size];
+        // NOTE: Use a sequentially consistent load, so that a waiter, which has registered
+        // itself in `_waiters`, never misses a connection released by `_release_lock_free`.
+        if (slot.state.load() == Slot::FULL && slot.acquire()) {
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
+
+bool ConnectionPool::_put_to_slots(Connection &connection) {
+    auto size = _pool_opts.size;
+    auto hint = _slot_hint();
+    for (std::size_t idx = 0; idx != size; ++idx) {
+        auto &slot = _slots[(hint + idx) % size];
+        if (slot.state.load(std::memory_order_relaxed) == Slot::EMPTY && slot.put(connection)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ConnectionPool::_try_reserve_connection() {
+    auto used = _used_connections.load(std::memory_order_relaxed);
+    while (used < _pool_opts.size) {
+        if (_used_connections.compare_exchange_weak(used, used + 1)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::size_t ConnectionPool::_slot_hint() {
+    // Different threads start scanning from different slots to reduce contention.
+    static std::atomic<std::size_t> next_hint{0};
+    thread_local std::size_t hint = next_hint.fetch_add(1, std::memory_order_relaxed);
+
+    return hint;
+}
+
+Connection ConnectionPool::Slot::take() {
+    assert(state.load(std::memory_order_relaxed) == BUSY);
+
+    auto &stored = _connection();
+    auto connection = std::move(stored);
+    stored.~Connection();
+
+    state.store(EMPTY, std::memory_order_release);
+
+    return connection;
+}
+
+bool ConnectionPool::Slot::put(Connection &connection) {
+    auto expected = static_cast<int>(EMPTY);
+    if (!state.compare_exchange_strong(expected, BUSY)) {
+        return false;
+    }
+
+    new (&_storage) Connection(std::move(connection));
+
+    state.store(FULL);
+
+    return true;
+}
+
 Connection ConnectionPool::_create(SimpleSentinel &sentinel,
                                     const ConnectionOptions &opts) {
     auto connection = sentinel.create(opts);
@@ -192,6 +433,71 @@ Connection ConnectionPool::_create(SimpleSentinel &sentinel,
     return connection;
 }
 
+void ConnectionPool::_on_fetch(Connection &connection) {
+    connection._load_tracked = true;
+
+    _outstanding.fetch_add(1, std::memory_order_relaxed);
+
+    if (_load_tracking == LoadTracking::OUTSTANDING_AND_LATENCY) {
+        connection._fetch_time = std::chrono::steady_clock::now();
+    }
+}
+
+void ConnectionPool::_on_release(Connection &connection) {
+    connection._load_tracked = false;
+
+    _outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+    if (_load_tracking != LoadTracking::OUTSTANDING_AND_LATENCY) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    long long sample = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - connection._fetch_time).count();
+
+    if (connection.broken()) {
+        auto timeout = connection.options().socket_timeout;
+        long long penalty = timeout > std::chrono::milliseconds(0) ?
+            std::chrono::duration_cast<std::chrono::microseconds>(timeout).count() :
+            LATENCY_ERROR_PENALTY;
+        sample = std::max(sample, penalty);
+    }
+
+    long long now_time = std::chrono::duration_cast<std::chrono::microseconds>(
+            now.time_since_epoch()).count();
+
+    // Concurrent updates might overwrite each other's `_latency_time`,
+    // which is fine for an estimation.
+    auto latency = _latency.load(std::memory_order_relaxed);
+    long long updated = 0;
+    do {
+        auto decayed = _decay_latency(latency,
+                                        _latency_time.load(std::memory_order_relaxed),
+                                        now_time);
+        updated = decayed + (sample - decayed) / LATENCY_EWMA_DIVISOR;
+        if (decayed == 0) {
+            // The first sample, or the latency has fully decayed.
+            updated = sample;
+        }
+    } while (!_latency.compare_exchange_weak(latency, updated, std::memory_order_relaxed));
+
+    _latency_time.store(now_time, std::memory_order_relaxed);
+}
+
+long long ConnectionPool::_decay_latency(long long latency, long long latency_time, long long now) {
+    if (latency == 0 || now <= latency_time) {
+        return latency;
+    }
+
+    auto periods = (now - latency_time) / LATENCY_DECAY_PERIOD;
+    if (periods >= 63) {
+        return 0;
+    }
+
+    return latency >> periods;
+}
+
 Connection ConnectionPool::_fetch(std::unique_lock<std::mutex> &lock) {
     if (_pool.empty()) {
         if (_used_connections == _pool_opts.size) {
@@ -218,12 +524,16 @@ Connection ConnectionPool::_fetch() {
 }
 
 void ConnectionPool::_wait_for_connection(std::unique_lock<std::mutex> &lock) {
+    auto start = std::chrono::steady_clock::now();
+
     auto timeout = _pool_opts.wait_timeout;
     if (timeout > std::chrono::milliseconds(0)) {
         // Wait until _pool is no longer empty or timeout.
         if (!_cv.wait_for(lock,
                     timeout,
                     [this] { return !(this->_pool).empty(); })) {
+            _on_pool_wait(start);
+
             throw Error("Failed to fetch a connection in "
                     + std::to_string(timeout.count()) + " milliseconds");
         }
@@ -231,6 +541,15 @@ void ConnectionPool::_wait_for_connection(std::unique_lock<std::mutex> &lock) {
         // Wait forever.
         _cv.wait(lock, [this] { return !(this->_pool).empty(); });
     }
+
+    _on_pool_wait(start);
+}
+
+void ConnectionPool::_on_pool_wait(const std::chrono::time_point<std::chrono::steady_clock> &start) const {
+    // `_opts` is protected by `_mutex`, which is held by the caller.
+    if (_opts.metrics) {
+        _opts.metrics->on_pool_wait(std::chrono::steady_clock::now() - start);
+    }
 }
 
 bool ConnectionPool::_need_reconnect(const Connection &connection,
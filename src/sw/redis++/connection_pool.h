@@ -18,11 +18,13 @@
 #define SEWENEW_REDISPLUSPLUS_CONNECTION_POOL_H
 
 #include <cassert>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <memory>
 #include <condition_variable>
 #include <deque>
+#include <type_traits>
 #include "sw/redis++/connection.h"
 #include "sw/redis++/sentinel.h"
 
@@ -30,6 +32,27 @@ namespace sw {
 
 namespace redis {
 
+enum class ConnectionPoolMode {
+    // Fetch and release connections with a mutex held.
+    MUTEX = 0,
+
+    // Fetch and release connections with atomic operations on a fixed array of slots.
+    // Only when the pool is exhausted, i.e. the caller has to wait, the mutex is used.
+    LOCK_FREE
+};
+
+// Load of a pool, which is tracked on each fetch and release.
+enum class LoadTracking {
+    // Track nothing, so that fetching and releasing a connection costs nothing extra.
+    NONE = 0,
+
+    // Track the number of outstanding requests.
+    OUTSTANDING,
+
+    // Track both the number of outstanding requests, and the latency.
+    OUTSTANDING_AND_LATENCY
+};
+
 struct ConnectionPoolOptions {
     // Max number of connections, including both in-use and idle ones.
     std::size_t size = 1;
@@ -42,6 +65,26 @@ struct ConnectionPoolOptions {
 
     // Max idle time of a connection. 0ms means we never expire the connection.
     std::chrono::milliseconds connection_idle_time{0};
+
+    // How to synchronize fetching and releasing connections.
+    // If many threads share a single pool, `ConnectionPoolMode::LOCK_FREE` reduces
+    // contention on the pool's mutex. NOTE: pools created with Redis Sentinel,
+    // and async connection pools, always use `ConnectionPoolMode::MUTEX`.
+    ConnectionPoolMode mode = ConnectionPoolMode::MUTEX;
+
+    // If true, commands sent by concurrent callers of `Redis` are implicitly pipelined,
+    // i.e. queued commands are sent with a single write, and replies are matched in
+    // FIFO order. In this case, `size` is the max number of batches in flight.
+    // NOTE: only used by `Redis`. Blocking commands, e.g. BLPOP, are NOT pipelined,
+    // so DO NOT send them with the generic command interface.
+    bool auto_pipeline = false;
+
+    // If true, commands of `Redis` are sent with a single connection shared by all
+    // threads, and replies are received by a dedicated thread. Connections of the pool
+    // are only created for blocking commands, pipelines, transactions and subscribers.
+    // NOTE: only used by `Redis`, and it does NOT support TLS. DO NOT send blocking commands
+    // with the generic command interface. It CANNOT be used with `auto_pipeline`.
+    bool multiplexed = false;
 };
 
 class ConnectionPool {
@@ -73,19 +116,114 @@ public:
     // Create a new connection.
     Connection create();
 
+    // Create a new connection with the given options, e.g. different timeouts or protocol
+    // version. If the pool is created with sentinel, host and port are got from sentinel.
+    Connection create(const ConnectionOptions &opts);
+
     ConnectionPool clone();
 
+    // Only pools of replicas, which are selected with a load-aware policy, track load.
+    // NOTE: it should be called before the pool is shared with other threads.
+    void track_load(LoadTracking tracking) {
+        _load_tracking = tracking;
+    }
+
+    // Number of connections which have been fetched, but not yet released,
+    // i.e. outstanding requests. Always 0, if load is NOT tracked.
+    std::size_t outstanding() const {
+        return _outstanding.load(std::memory_order_relaxed);
+    }
+
+    // EWMA of the time a connection is held, i.e. from being fetched to being released.
+    // A connection released broken counts as at least one socket timeout. The latency
+    // decays while no connection is released, so that a node, which is avoided for being
+    // slow, gets requests again. Always 0, if latency is NOT tracked.
+    std::chrono::microseconds latency() const;
+
 private:
+    // A slot holding an idle connection, used by `ConnectionPoolMode::LOCK_FREE`.
+    class Slot {
+    public:
+        enum State {
+            EMPTY = 0,
+            BUSY,
+            FULL
+        };
+
+        Slot() = default;
+
+        Slot(const Slot &) = delete;
+        Slot& operator=(const Slot &) = delete;
+
+        Slot(Slot &&) = delete;
+        Slot& operator=(Slot &&) = delete;
+
+        ~Slot() {
+            if (state.load(std::memory_order_relaxed) == FULL) {
+                _connection().~Connection();
+            }
+        }
+
+        // Try to mark a FULL slot as BUSY. If it succeeds, the caller must call `take`.
+        bool acquire() {
+            auto expected = static_cast<int>(FULL);
+            return state.compare_exchange_strong(expected, BUSY);
+        }
+
+        // Move the connection out of an acquired slot, and mark the slot as EMPTY.
+        Connection take();
+
+        // Try to move the connection into this slot, if it's EMPTY.
+        bool put(Connection &connection);
+
+        std::atomic<int> state{EMPTY};
+
+    private:
+        Connection& _connection() {
+            return *reinterpret_cast<Connection*>(&_storage);
+        }
+
+        typename std::aligned_storage<sizeof(Connection), alignof(Connection)>::type _storage;
+    };
+
     void _move(ConnectionPool &&that);
 
+    bool _lock_free() const {
+        return _slots != nullptr;
+    }
+
+    Connection _fetch_lock_free();
+
+    void _release_lock_free(Connection &connection);
+
+    Slot* _acquire_slot();
+
+    bool _put_to_slots(Connection &connection);
+
+    bool _try_reserve_connection();
+
+    static std::size_t _slot_hint();
+
     Connection _create(SimpleSentinel &sentinel, const ConnectionOptions &opts);
 
+    Connection _fetch_connection();
+
+    void _on_fetch(Connection &connection);
+
+    void _on_release(Connection &connection);
+
+    // Latency, i.e. `_latency`, decayed by the time elapsed since `_latency_time`.
+    static long long _decay_latency(long long latency, long long latency_time, long long now);
+
     Connection _fetch(std::unique_lock<std::mutex> &lock);
 
     Connection _fetch();
 
     void _wait_for_connection(std::unique_lock<std::mutex> &lock);
 
+    // Report the time spent waiting for a connection, if metrics is enabled.
+    void _on_pool_wait(const std::chrono::time_point<std::chrono::steady_clock> &start) const;
+
     bool _need_reconnect(const Connection &connection,
                             const std::chrono::milliseconds &connection_lifetime,
                             const std::chrono::milliseconds &connection_idle_time) const;
@@ -105,12 +243,28 @@ private:
 
     std::deque<Connection> _pool;
 
-    std::size_t _used_connections = 0;
+    std::atomic<std::size_t> _used_connections{0};
 
     std::mutex _mutex;
 
     std::condition_variable _cv;
 
+    // Only used by `ConnectionPoolMode::LOCK_FREE`.
+    std::unique_ptr<Slot[]> _slots;
+
+    // Number of threads waiting on `_cv`, only used by `ConnectionPoolMode::LOCK_FREE`.
+    std::atomic<std::size_t> _waiters{0};
+
+    LoadTracking _load_tracking = LoadTracking::NONE;
+
+    std::atomic<std::size_t> _outstanding{0};
+
+    // EWMA latency in microseconds, and the time it's updated, i.e. microseconds
+    // since epoch of `std::chrono::steady_clock`.
+    std::atomic<long long> _latency{0};
+
+    std::atomic<long long> _latency_time{0};
+
     SimpleSentinel _sentinel;
 };
 
@@ -84,13 +84,60 @@ static const uint16_t crc16tab[256]= {
     0x6e17,0x7e36,0x4e55,0x5e74,0x2e93,0x3eb2,0x0ed1,0x1ef0
 };
 
-uint16_t crc16(const char *buf, int len) {
-    uint16_t crc = 0;
+namespace {
+
+// Slice-by-8 tables: `table[k][b]` is the CRC of byte `b` followed by `k` zero bytes,
+// so that 8 bytes can be processed with 8 independent lookups.
+struct Crc16Tables {
+    Crc16Tables() {
+        for (int b = 0; b != 256; ++b) {
+            table[0][b] = crc16tab[b];
+        }
+
+        for (int k = 1; k != 8; ++k) {
+            for (int b = 0; b != 256; ++b) {
+                auto prev = table[k - 1][b];
+                table[k][b] = static_cast<uint16_t>((prev << 8) ^ crc16tab[(prev >> 8) & 0x00FF]);
+            }
+        }
+    }
+
+    uint16_t table[8][256];
+};
+
+const Crc16Tables& crc16_tables() {
+    static const Crc16Tables tables;
+
+    return tables;
+}
+
+inline uint16_t crc16_update8(const Crc16Tables &tables, uint16_t crc, const unsigned char *p) {
+    const auto &t = tables.table;
+
+    return static_cast<uint16_t>(t[7][p[0] ^ (crc >> 8)] ^ t[6][p[1] ^ (crc & 0x00FF)]
+            ^ t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]]);
+}
+
+inline uint16_t crc16_tail(uint16_t crc, const unsigned char *p, int len) {
     for (int counter = 0; counter < len; counter++)
-            crc = static_cast<uint16_t>((crc<<8) ^ crc16tab[((crc>>8) ^ *buf++)&0x00FF]);
+            crc = static_cast<uint16_t>((crc<<8) ^ crc16tab[((crc>>8) ^ *p++)&0x00FF]);
     return crc;
 }
 
 }
 
+uint16_t crc16(const char *buf, int len) {
+    const auto &tables = crc16_tables();
+    auto *p = reinterpret_cast<const unsigned char *>(buf);
+
+    uint16_t crc = 0;
+    for (; len >= 8; len -= 8, p += 8) {
+        crc = crc16_update8(tables, crc, p);
+    }
+
+    return crc16_tail(crc, p, len);
+}
+
+}
+
 }
@@ -36,6 +36,12 @@ EventLoop::EventLoop() {
 
 EventLoop::~EventLoop() {
     stop();
+
+    // Release connections scheduled after the loop has been stopped.
+    auto *command_events = _get_command_events();
+    while (command_events != nullptr) {
+        _pop_command_event(command_events);
+    }
 }
 
 void EventLoop::stop() {
@@ -71,13 +77,27 @@ void EventLoop::unwatch(AsyncConnectionSPtr connection, std::exception_ptr err)
 void EventLoop::add(AsyncConnectionSPtr event) {
     assert(event);
 
-    {
-        std::lock_guard<std::mutex> lock(_mtx);
-
-        _command_events.insert(std::move(event));
+    auto *connection = event.get();
+    if (connection->_scheduled.exchange(true, std::memory_order_acq_rel)) {
+        // Already scheduled.
+        return;
     }
 
-    _notify();
+    connection->_scheduled_self = std::move(event);
+
+    auto *head = _command_events.load(std::memory_order_relaxed);
+    do {
+        connection->_next_scheduled = head;
+    } while (!_command_events.compare_exchange_weak(head,
+                                                    connection,
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed));
+
+    if (head == nullptr) {
+        // If the list is not empty, the event loop has already been notified,
+        // and it will handle this connection with others.
+        _notify();
+    }
 }
 
 void EventLoop::watch(redisAsyncContext &ctx) {
@@ -138,12 +158,11 @@ void EventLoop::_event_callback(uv_async_t *handle) {
     auto *event_loop = static_cast<EventLoop*>(handle->data);
     assert(event_loop != nullptr);
 
-    std::unordered_set<AsyncConnectionSPtr> command_events;
-    std::unordered_map<AsyncConnectionSPtr, std::exception_ptr> disconnect_events;
-    std::tie(command_events, disconnect_events) = event_loop->_get_events();
+    auto *command_events = event_loop->_get_command_events();
+    auto disconnect_events = event_loop->_get_disconnect_events();
 
-    for (auto &connection : command_events) {
-        assert(connection);
+    while (command_events != nullptr) {
+        auto connection = _pop_command_event(command_events);
 
         connection->event_callback();
     }
@@ -171,20 +190,19 @@ void EventLoop::_stop_callback(uv_async_t *handle) {
     auto *event_loop = static_cast<EventLoop*>(handle->data);
     assert(event_loop != nullptr);
 
-    std::unordered_set<AsyncConnectionSPtr> command_events;
-    std::unordered_map<AsyncConnectionSPtr, std::exception_ptr> disconnect_events;
-    std::tie(command_events, disconnect_events) = event_loop->_get_events();
+    auto *command_events = event_loop->_get_command_events();
+    auto disconnect_events = event_loop->_get_disconnect_events();
 
     event_loop->_clean_up(command_events, disconnect_events);
 
     uv_stop(event_loop->_loop.get());
 }
 
-void EventLoop::_clean_up(std::unordered_set<AsyncConnectionSPtr> &command_events,
+void EventLoop::_clean_up(AsyncConnection *command_events,
         std::unordered_map<AsyncConnectionSPtr, std::exception_ptr> &disconnect_events) {
     auto err = std::make_exception_ptr(Error("event loop is closing"));
-    for (auto &connection : command_events) {
-        assert(connection);
+    while (command_events != nullptr) {
+        auto connection = _pop_command_event(command_events);
 
         connection->disconnect(err);
     }
@@ -262,19 +280,48 @@ void EventLoop::_stop() {
     uv_async_send(_stop_async.get());
 }
 
-auto EventLoop::_get_events()
-    -> std::pair<std::unordered_set<AsyncConnectionSPtr>,
-                    std::unordered_map<AsyncConnectionSPtr, std::exception_ptr>> {
-    std::unordered_set<AsyncConnectionSPtr> command_events;
+std::unordered_map<AsyncConnectionSPtr, std::exception_ptr> EventLoop::_get_disconnect_events() {
     std::unordered_map<AsyncConnectionSPtr, std::exception_ptr> disconnect_events;
     {
         std::lock_guard<std::mutex> lock(_mtx);
 
-        command_events.swap(_command_events);
         disconnect_events.swap(_disconnect_events);
     }
 
-    return std::make_pair(std::move(command_events), std::move(disconnect_events));
+    return disconnect_events;
+}
+
+AsyncConnection* EventLoop::_get_command_events() {
+    auto *head = _command_events.exchange(nullptr, std::memory_order_acquire);
+
+    // Connections are pushed in LIFO order, reverse it to handle them in FIFO order.
+    AsyncConnection *command_events = nullptr;
+    while (head != nullptr) {
+        auto *next = head->_next_scheduled;
+        head->_next_scheduled = command_events;
+        command_events = head;
+        head = next;
+    }
+
+    return command_events;
+}
+
+AsyncConnectionSPtr EventLoop::_pop_command_event(AsyncConnection *&command_events) {
+    assert(command_events != nullptr);
+
+    auto *connection = command_events;
+    command_events = connection->_next_scheduled;
+    connection->_next_scheduled = nullptr;
+
+    auto self = std::move(connection->_scheduled_self);
+    assert(self);
+
+    // Clear the flag before handling events, so that any event sent after this point
+    // schedules the connection again, and events sent before this point will be
+    // fetched by the following `event_callback` or `disconnect`.
+    connection->_scheduled.store(false, std::memory_order_release);
+
+    return self;
 }
 
 EventLoop::UvAsyncUPtr EventLoop::_create_uv_async(AsyncCallback callback) {
@@ -302,6 +349,37 @@ EventLoop::LoopUPtr EventLoop::_create_event_loop() {
     return LoopUPtr(loop);
 }
 
+EventLoopGroup::EventLoopGroup(std::size_t size) {
+    if (size == 0) {
+        throw Error("CANNOT create an empty event loop group");
+    }
+
+    _loops.reserve(size);
+    for (std::size_t idx = 0; idx != size; ++idx) {
+        _loops.push_back(std::make_shared<EventLoop>());
+    }
+}
+
+EventLoopGroup::EventLoopGroup(std::vector<EventLoopSPtr> loops) : _loops(std::move(loops)) {
+    if (_loops.empty()) {
+        throw Error("CANNOT create an empty event loop group");
+    }
+
+    for (const auto &loop : _loops) {
+        if (!loop) {
+            throw Error("event loop of event loop group is null");
+        }
+    }
+}
+
+EventLoopSPtr EventLoopGroup::next() {
+    assert(!_loops.empty());
+
+    auto idx = _next.fetch_add(1, std::memory_order_relaxed);
+
+    return _loops[idx % _loops.size()];
+}
+
 }
 
 }
@@ -17,12 +17,13 @@
 #ifndef SEWENEW_REDISPLUSPLUS_EVENT_LOOP_H
 #define SEWENEW_REDISPLUSPLUS_EVENT_LOOP_H
 
-#include <unordered_set>
 #include <unordered_map>
+#include <atomic>
 #include <memory>
 #include <exception>
 #include <mutex>
 #include <thread>
+#include <vector>
 #include <uv.h>
 #include "sw/redis++/connection.h"
 
@@ -47,6 +48,9 @@ public:
 
     void unwatch(std::shared_ptr<AsyncConnection> connection, std::exception_ptr err = nullptr);
 
+    // Schedule the connection to handle its events in the event loop thread.
+    // If the connection has already been scheduled, i.e. the event loop has not
+    // handled it yet, this is a no-op, and events will be handled in a batch.
     void add(std::shared_ptr<AsyncConnection> event);
 
     // Not thread safe. Only call it in callback functions.
@@ -85,12 +89,17 @@ private:
 
     void _notify();
 
-    void _clean_up(std::unordered_set<std::shared_ptr<AsyncConnection>> &command_events,
+    void _clean_up(AsyncConnection *command_events,
             std::unordered_map<std::shared_ptr<AsyncConnection>, std::exception_ptr> &disconnect_events);
 
-    auto _get_events()
-        -> std::pair<std::unordered_set<std::shared_ptr<AsyncConnection>>,
-            std::unordered_map<std::shared_ptr<AsyncConnection>, std::exception_ptr>>;
+    std::unordered_map<std::shared_ptr<AsyncConnection>, std::exception_ptr> _get_disconnect_events();
+
+    // Take all scheduled connections, and return them as a list in scheduling order.
+    AsyncConnection* _get_command_events();
+
+    // Remove the first connection from the list, and return the reference
+    // that was held while the connection was scheduled.
+    static std::shared_ptr<AsyncConnection> _pop_command_event(AsyncConnection *&command_events);
 
     // We must define _event_async and _stop_async before _loop,
     // because these memory can only be release after _loop's deleter
@@ -105,7 +114,9 @@ private:
 
     std::unordered_map<std::shared_ptr<AsyncConnection>, std::exception_ptr> _disconnect_events;
 
-    std::unordered_set<std::shared_ptr<AsyncConnection>> _command_events;
+    // Lock-free stack of scheduled connections, linked by `AsyncConnection::_next_scheduled`.
+    // Multiple threads push connections, and only the event loop thread takes them.
+    std::atomic<AsyncConnection*> _command_events{nullptr};
 
     // _loop must be defined at last, since its destructor needs other data members.
     LoopUPtr _loop;
@@ -116,6 +127,42 @@ private:
 using EventLoopSPtr = std::shared_ptr<EventLoop>;
 using EventLoopWPtr = std::weak_ptr<EventLoop>;
 
+// A group of event loops, and each loop runs in its own thread. Connections are
+// spread across these loops in round-robin, so that replies are parsed, and callbacks
+// are called, by multiple threads. A connection is pinned to a single loop, i.e.
+// callbacks of commands sent with the same connection are called in the same thread.
+class EventLoopGroup {
+public:
+    // Create a group of `size` event loops.
+    explicit EventLoopGroup(std::size_t size);
+
+    // Create a group with existing event loops.
+    explicit EventLoopGroup(std::vector<EventLoopSPtr> loops);
+
+    EventLoopGroup(const EventLoopGroup &) = delete;
+    EventLoopGroup& operator=(const EventLoopGroup &) = delete;
+
+    EventLoopGroup(EventLoopGroup &&that) = delete;
+    EventLoopGroup& operator=(EventLoopGroup &&that) = delete;
+
+    ~EventLoopGroup() = default;
+
+    // Pick an event loop in round-robin.
+    EventLoopSPtr next();
+
+    std::size_t size() const {
+        return _loops.size();
+    }
+
+private:
+    std::vector<EventLoopSPtr> _loops;
+
+    std::atomic<std::size_t> _next{0};
+};
+
+using EventLoopGroupSPtr = std::shared_ptr<EventLoopGroup>;
+using EventLoopGroupWPtr = std::weak_ptr<EventLoopGroup>;
+
 }
 
 }
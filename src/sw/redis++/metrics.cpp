@@ -0,0 +1,317 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/metrics.h"
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+// Each power of two range is split into 2^SUB_BUCKET_BITS linear sub-buckets.
+constexpr std::size_t SUB_BUCKET_BITS = 6;
+
+constexpr std::size_t SUB_BUCKETS = std::size_t(1) << SUB_BUCKET_BITS;
+
+// Values no less than 2^(MAX_BIT + 1) nanoseconds fall into the last bucket.
+constexpr std::size_t MAX_BIT = 45;
+
+constexpr std::size_t BUCKETS = SUB_BUCKETS + (MAX_BIT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+std::size_t highest_bit(std::uint64_t value) {
+    assert(value != 0);
+
+    std::size_t bit = 0;
+    for (std::size_t shift = 32; shift != 0; shift /= 2) {
+        if ((value >> shift) != 0) {
+            value >>= shift;
+            bit += shift;
+        }
+    }
+
+    return bit;
+}
+
+char to_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// FNV-1a hash of the upper case name.
+std::size_t name_hash(const sw::redis::StringView &name) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t idx = 0; idx != name.size(); ++idx) {
+        hash ^= static_cast<unsigned char>(to_upper(name.data()[idx]));
+        hash *= 1099511628211ULL;
+    }
+
+    return static_cast<std::size_t>(hash);
+}
+
+// Whether `name`, which is in upper case, equals to `cmd_name` case-insensitively.
+bool name_equal(const std::string &name, const sw::redis::StringView &cmd_name) {
+    if (name.size() != cmd_name.size()) {
+        return false;
+    }
+
+    for (std::size_t idx = 0; idx != name.size(); ++idx) {
+        if (name[idx] != to_upper(cmd_name.data()[idx])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+namespace sw {
+
+namespace redis {
+
+LatencyHistogram::LatencyHistogram() : _buckets(new std::atomic<std::uint64_t>[BUCKETS]()) {}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    auto value = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(latency.count(), 0));
+
+    _buckets[_index(value)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+
+    auto max = _max.load(std::memory_order_relaxed);
+    while (value > max
+            && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+std::uint64_t LatencyHistogram::count() const {
+    return _count.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds LatencyHistogram::max() const {
+    return std::chrono::nanoseconds(_max.load(std::memory_order_relaxed));
+}
+
+std::chrono::nanoseconds LatencyHistogram::mean() const {
+    auto count = _count.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    return std::chrono::nanoseconds(_sum.load(std::memory_order_relaxed) / count);
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double p) const {
+    // Buckets and `_count` are updated separately, so count with buckets.
+    std::uint64_t total = 0;
+    for (std::size_t idx = 0; idx != BUCKETS; ++idx) {
+        total += _buckets[idx].load(std::memory_order_relaxed);
+    }
+
+    if (total == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    p = std::min(std::max(p, 0.0), 100.0);
+    auto target = static_cast<std::uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total)));
+    target = std::min(std::max<std::uint64_t>(target, 1), total);
+
+    std::uint64_t cnt = 0;
+    for (std::size_t idx = 0; idx != BUCKETS; ++idx) {
+        cnt += _buckets[idx].load(std::memory_order_relaxed);
+        if (cnt >= target) {
+            auto value = std::min(_upper_bound(idx), _max.load(std::memory_order_relaxed));
+            return std::chrono::nanoseconds(value);
+        }
+    }
+
+    return max();
+}
+
+void LatencyHistogram::reset() {
+    for (std::size_t idx = 0; idx != BUCKETS; ++idx) {
+        _buckets[idx].store(0, std::memory_order_relaxed);
+    }
+
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+std::size_t LatencyHistogram::_index(std::uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<std::size_t>(value);
+    }
+
+    auto bit = highest_bit(value);
+    if (bit > MAX_BIT) {
+        return BUCKETS - 1;
+    }
+
+    auto shift = bit - SUB_BUCKET_BITS;
+
+    return SUB_BUCKETS + shift * SUB_BUCKETS + static_cast<std::size_t>((value >> shift) - SUB_BUCKETS);
+}
+
+std::uint64_t LatencyHistogram::_upper_bound(std::size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    auto shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    auto sub_bucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+
+    return ((static_cast<std::uint64_t>(SUB_BUCKETS + sub_bucket + 1)) << shift) - 1;
+}
+
+constexpr std::size_t Metrics::MAX_COMMANDS;
+
+constexpr std::size_t Metrics::SLOTS;
+
+Metrics::Metrics() : _commands(new std::atomic<CommandEntry *>[SLOTS]()) {}
+
+Metrics::~Metrics() {
+    for (std::size_t idx = 0; idx != SLOTS; ++idx) {
+        delete _commands[idx].load(std::memory_order_relaxed);
+    }
+}
+
+void Metrics::on_command(const StringView &cmd_name, std::chrono::nanoseconds latency) {
+    _command_latency(cmd_name).record(latency);
+}
+
+void Metrics::on_pool_wait(std::chrono::nanoseconds wait_time) {
+    _pool_wait.record(wait_time);
+}
+
+void Metrics::on_reconnect() {
+    _reconnects.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::on_redirect(RedirectType type) {
+    switch (type) {
+    case RedirectType::MOVED:
+        _moved.fetch_add(1, std::memory_order_relaxed);
+        break;
+
+    case RedirectType::ASK:
+        _ask.fetch_add(1, std::memory_order_relaxed);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void Metrics::on_bytes_sent(std::size_t bytes) {
+    _bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::on_bytes_received(std::size_t bytes) {
+    _bytes_received.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+const LatencyHistogram* Metrics::command_latency(const StringView &cmd_name) const {
+    const auto *entry = _find(cmd_name, name_hash(cmd_name));
+    if (entry != nullptr) {
+        return &(entry->histogram);
+    }
+
+    if (name_equal(_others.name, cmd_name) && _others.histogram.count() > 0) {
+        return &(_others.histogram);
+    }
+
+    return nullptr;
+}
+
+std::vector<std::string> Metrics::commands() const {
+    std::vector<std::string> names;
+    names.reserve(_command_num.load(std::memory_order_relaxed) + 1);
+
+    for (std::size_t idx = 0; idx != SLOTS; ++idx) {
+        const auto *entry = _commands[idx].load(std::memory_order_acquire);
+        if (entry != nullptr) {
+            names.push_back(entry->name);
+        }
+    }
+
+    if (_others.histogram.count() > 0) {
+        names.push_back(_others.name);
+    }
+
+    return names;
+}
+
+auto Metrics::_find(const StringView &cmd_name, std::size_t hash) const -> CommandEntry* {
+    for (std::size_t probe = 0; probe != SLOTS; ++probe) {
+        auto *entry = _commands[(hash + probe) & (SLOTS - 1)].load(std::memory_order_acquire);
+        if (entry == nullptr) {
+            return nullptr;
+        }
+
+        if (name_equal(entry->name, cmd_name)) {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+LatencyHistogram& Metrics::_command_latency(const StringView &cmd_name) {
+    auto hash = name_hash(cmd_name);
+
+    auto *entry = _find(cmd_name, hash);
+    if (entry != nullptr) {
+        return entry->histogram;
+    }
+
+    // First time to see this command.
+    if (_command_num.fetch_add(1, std::memory_order_relaxed) >= MAX_COMMANDS) {
+        _command_num.fetch_sub(1, std::memory_order_relaxed);
+
+        return _others.histogram;
+    }
+
+    std::string name(cmd_name.data(), cmd_name.size());
+    std::transform(name.begin(), name.end(), name.begin(), to_upper);
+
+    std::unique_ptr<CommandEntry> new_entry(new CommandEntry(std::move(name)));
+
+    for (std::size_t probe = 0; probe != SLOTS; ++probe) {
+        auto &slot = _commands[(hash + probe) & (SLOTS - 1)];
+
+        CommandEntry *current = nullptr;
+        if (slot.compare_exchange_strong(current, new_entry.get(),
+                    std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return new_entry.release()->histogram;
+        }
+
+        // `current` is the entry in this slot.
+        if (name_equal(current->name, cmd_name)) {
+            // Another thread has already added it.
+            _command_num.fetch_sub(1, std::memory_order_relaxed);
+
+            return current->histogram;
+        }
+    }
+
+    // Never reach here, since there are more slots than commands.
+    assert(false);
+
+    return _others.histogram;
+}
+
+}
+
+}
@@ -0,0 +1,228 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_METRICS_H
+#define SEWENEW_REDISPLUSPLUS_METRICS_H
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sw/redis++/utils.h"
+
+namespace sw {
+
+namespace redis {
+
+enum class RedirectType {
+    MOVED = 0,
+    ASK
+};
+
+// Interface to collect metrics. Set `ConnectionOptions::metrics` to enable it.
+// If it's not set, which is the default, no metric is collected, and the only
+// overhead is a null pointer check.
+//
+// NOTE: methods are called from any thread sending commands, or from the event loop
+// thread for async interface, so they MUST be thread-safe and return quickly.
+class MetricsHook {
+public:
+    virtual ~MetricsHook() = default;
+
+    // Latency of a command, i.e. from the time the command is sent,
+    // to the time its reply is received. `cmd_name` is NOT always in upper case.
+    virtual void on_command(const StringView & /*cmd_name*/,
+                            std::chrono::nanoseconds /*latency*/) {}
+
+    // Time spent waiting for a connection, when the connection pool is exhausted.
+    virtual void on_pool_wait(std::chrono::nanoseconds /*wait_time*/) {}
+
+    // A broken or expired connection is reconnected.
+    virtual void on_reconnect() {}
+
+    // A command of Redis Cluster is redirected with a MOVED or ASK error.
+    virtual void on_redirect(RedirectType /*type*/) {}
+
+    virtual void on_bytes_sent(std::size_t /*bytes*/) {}
+
+    // NOTE: the size is calculated with the parsed reply, and might be slightly
+    // different from the number of bytes read from the socket.
+    virtual void on_bytes_received(std::size_t /*bytes*/) {}
+};
+
+using MetricsHookSPtr = std::shared_ptr<MetricsHook>;
+
+// A lock-free latency histogram with HDR-style log-linear buckets: each power of two range
+// is split into 64 linear sub-buckets, so that the relative error is less than 1/64.
+// Latencies up to about 9 hours are recorded exactly, and larger ones fall into the last bucket.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram &) = delete;
+
+    LatencyHistogram(LatencyHistogram &&) = delete;
+    LatencyHistogram& operator=(LatencyHistogram &&) = delete;
+
+    ~LatencyHistogram() = default;
+
+    void record(std::chrono::nanoseconds latency);
+
+    std::uint64_t count() const;
+
+    std::chrono::nanoseconds max() const;
+
+    std::chrono::nanoseconds mean() const;
+
+    // Latency at the given percentile, e.g. 99.9, i.e. the upper bound of the bucket.
+    std::chrono::nanoseconds percentile(double p) const;
+
+    void reset();
+
+private:
+    static std::size_t _index(std::uint64_t value);
+
+    static std::uint64_t _upper_bound(std::size_t index);
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> _buckets;
+
+    std::atomic<std::uint64_t> _count{0};
+
+    std::atomic<std::uint64_t> _sum{0};
+
+    std::atomic<std::uint64_t> _max{0};
+};
+
+// Built-in MetricsHook, which records latency histograms per command name, and counters.
+// Command names are case-insensitive, and reported in upper case. Latencies of commands,
+// which are sent after `MAX_COMMANDS` distinct commands have been seen, are recorded
+// together as the `OTHERS` command.
+//
+// ConnectionOptions opts;
+// auto metrics = std::make_shared<Metrics>();
+// opts.metrics = metrics;
+// ...
+// auto *latency = metrics->command_latency("GET");
+// if (latency != nullptr) {
+//     std::cout << latency->percentile(99.9).count() << std::endl;
+// }
+class Metrics : public MetricsHook {
+public:
+    static constexpr std::size_t MAX_COMMANDS = 512;
+
+    Metrics();
+
+    Metrics(const Metrics &) = delete;
+    Metrics& operator=(const Metrics &) = delete;
+
+    Metrics(Metrics &&) = delete;
+    Metrics& operator=(Metrics &&) = delete;
+
+    virtual ~Metrics() override;
+
+    virtual void on_command(const StringView &cmd_name, std::chrono::nanoseconds latency) override;
+
+    virtual void on_pool_wait(std::chrono::nanoseconds wait_time) override;
+
+    virtual void on_reconnect() override;
+
+    virtual void on_redirect(RedirectType type) override;
+
+    virtual void on_bytes_sent(std::size_t bytes) override;
+
+    virtual void on_bytes_received(std::size_t bytes) override;
+
+    // Latency histogram of the given command, or nullptr if the command has never been sent.
+    // The histogram lives as long as this object. It never allocates.
+    const LatencyHistogram* command_latency(const StringView &cmd_name) const;
+
+    // Names of commands that have been sent.
+    std::vector<std::string> commands() const;
+
+    const LatencyHistogram& pool_wait() const {
+        return _pool_wait;
+    }
+
+    std::uint64_t reconnects() const {
+        return _reconnects.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t moved_redirects() const {
+        return _moved.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t ask_redirects() const {
+        return _ask.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t bytes_sent() const {
+        return _bytes_sent.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t bytes_received() const {
+        return _bytes_received.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct CommandEntry {
+        explicit CommandEntry(std::string cmd_name) : name(std::move(cmd_name)) {}
+
+        // In upper case.
+        const std::string name;
+
+        LatencyHistogram histogram;
+    };
+
+    // Number of slots of `_commands`, which is a power of 2, and at least twice of
+    // `MAX_COMMANDS`, so that probing always ends with an empty slot.
+    static constexpr std::size_t SLOTS = MAX_COMMANDS * 2;
+
+    CommandEntry* _find(const StringView &cmd_name, std::size_t hash) const;
+
+    LatencyHistogram& _command_latency(const StringView &cmd_name);
+
+    // Open addressing hash table from command name to histogram. Entries are only added,
+    // with compare-and-swap, and freed on destruction, so that recording a latency never
+    // takes a lock or allocates, except for the first time a command is seen.
+    std::unique_ptr<std::atomic<CommandEntry *>[]> _commands;
+
+    std::atomic<std::size_t> _command_num{0};
+
+    CommandEntry _others{"OTHERS"};
+
+    LatencyHistogram _pool_wait;
+
+    std::atomic<std::uint64_t> _reconnects{0};
+
+    std::atomic<std::uint64_t> _moved{0};
+
+    std::atomic<std::uint64_t> _ask{0};
+
+    std::atomic<std::uint64_t> _bytes_sent{0};
+
+    std::atomic<std::uint64_t> _bytes_received{0};
+};
+
+using MetricsSPtr = std::shared_ptr<Metrics>;
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_METRICS_H
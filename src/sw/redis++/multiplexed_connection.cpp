@@ -0,0 +1,343 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/multiplexed_connection.h"
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <hiredis/hiredis.h>
+#include "sw/redis++/errors.h"
+#include "sw/redis++/reply_arena.h"
+#include "sw/redis++/resp.h"
+
+#ifndef _WIN32
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif
+
+namespace {
+
+// Size of the buffer, into which the reader thread reads the socket.
+constexpr std::size_t READ_BUFFER_SIZE = 16 * 1024;
+
+}
+
+namespace sw {
+
+namespace redis {
+
+MultiplexedConnection::MultiplexedConnection(Connection connection) :
+                                                _connection(std::move(connection)) {
+#ifdef _WIN32
+    throw Error("multiplexed connection is NOT supported on Windows");
+#else
+    if (_connection.broken()) {
+        throw Error("cannot multiplex a broken connection");
+    }
+
+    if (tls::enabled(_connection.options().tls)) {
+        throw Error("multiplexed connection does NOT support TLS");
+    }
+
+    _fd = _connection._ctx->fd;
+
+    _metrics = _connection.options().metrics;
+
+    _reader = std::thread([this]() { this->_run(); });
+#endif
+}
+
+MultiplexedConnection::~MultiplexedConnection() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _stop = true;
+    }
+
+#ifndef _WIN32
+    if (_fd >= 0) {
+        // Wake up the reader thread blocked on reading.
+        ::shutdown(_fd, SHUT_RDWR);
+    }
+#endif
+
+    if (_reader.joinable()) {
+        _reader.join();
+    }
+}
+
+bool MultiplexedConnection::broken() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return static_cast<bool>(_err);
+}
+
+void MultiplexedConnection::_enqueue(Request &request) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_err) {
+        std::rethrow_exception(_err);
+    }
+
+    request.time = std::chrono::steady_clock::now();
+
+    _pending.push_back(&request);
+}
+
+void MultiplexedConnection::_abort(Request &request, std::exception_ptr err) {
+    if (_connection.broken() || !_connection._obuf.empty() || _connection._hiredis_buffered) {
+        // Part of the command might have been written or buffered,
+        // and we can no longer match replies with commands.
+        _fail(err);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!request.done) {
+        // `_write_mutex` is held, so it must be the last one.
+        assert(!_pending.empty() && _pending.back() == &request);
+
+        _pending.pop_back();
+    }
+}
+
+void MultiplexedConnection::_on_send(Request &request) {
+    auto &pending = _connection._pending;
+    if (!pending.empty()) {
+        request.command = pending.back();
+        pending.pop_back();
+    }
+}
+
+void MultiplexedConnection::_flush() {
+    try {
+        // Commands are either buffered in `_obuf`, or in hiredis' output buffer.
+        _connection._flush();
+
+        _connection._flush_hiredis();
+    } catch (...) {
+        // The caller gets the error from `_wait`.
+        _fail(std::current_exception());
+    }
+}
+
+ReplyUPtr MultiplexedConnection::_wait(Request &request) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        request.cv.wait(lock, [&request]() { return request.done; });
+    }
+
+    if (request.err) {
+        std::rethrow_exception(request.err);
+    }
+
+    assert(request.reply);
+
+    if (_metrics) {
+        _on_recv(request);
+    }
+
+    if (reply::is_error(*request.reply)) {
+        throw_error(*request.reply);
+    }
+
+    return std::move(request.reply);
+}
+
+void MultiplexedConnection::_on_recv(const Request &request) {
+    assert(_metrics && request.reply);
+
+    _metrics->on_bytes_received(resp::reply_size(*request.reply));
+    _metrics->on_command(request.command.name(),
+            request.recv_time - request.command.send_time());
+}
+
+void MultiplexedConnection::_run() {
+    try {
+        _read_replies();
+    } catch (...) {
+        _fail(std::current_exception());
+    }
+}
+
+void MultiplexedConnection::_read_replies() {
+#ifndef _WIN32
+    // Use a reader of our own, so that the reader thread never touches hiredis' context,
+    // which is used by threads writing commands.
+    std::unique_ptr<redisReader, void (*)(redisReader *)> reader(redisReaderCreate(),
+                                                                    redisReaderFree);
+    if (!reader) {
+        throw Error("failed to create reply reader");
+    }
+
+    // Connection options never change, so they can be read without lock.
+    const auto &opts = _connection.options();
+    if (opts.reply_arena) {
+        ReplyArena::install(*reader);
+    }
+
+    std::vector<char> buf(READ_BUFFER_SIZE);
+    while (true) {
+        void *r = nullptr;
+        if (redisReaderGetReply(reader.get(), &r) != REDIS_OK) {
+            throw ProtoError(std::string("Failed to parse reply: ") + reader->errstr);
+        }
+
+        if (r != nullptr) {
+            auto *rep = static_cast<redisReply *>(r);
+            auto reply = opts.reply_arena ?
+                ReplyUPtr(rep, ReplyDeleter(ReplyArena::of(*rep))) : ReplyUPtr(rep);
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+            if (reply->type == REDIS_REPLY_PUSH) {
+                // Push messages are not replies of any command.
+                continue;
+            }
+#endif
+
+            if (!_deliver(std::move(reply))) {
+                throw ProtoError("Got a reply without pending command");
+            }
+
+            continue;
+        }
+
+        auto len = ::read(_fd, buf.data(), buf.size());
+        if (len > 0) {
+            if (redisReaderFeed(reader.get(), buf.data(), static_cast<std::size_t>(len)) != REDIS_OK) {
+                throw ProtoError(std::string("Failed to parse reply: ") + reader->errstr);
+            }
+
+            continue;
+        }
+
+        if (len < 0) {
+            auto err = errno;
+            if (err == EINTR) {
+                continue;
+            }
+
+            if (err == EAGAIN || err == EWOULDBLOCK) {
+                // Socket timeout. It's fine if no command is waiting for a long time.
+                if (_timed_out()) {
+                    throw TimeoutError("Failed to get reply: " + std::string(std::strerror(err)));
+                }
+
+                continue;
+            }
+
+            throw IoError("Failed to get reply: " + std::string(std::strerror(err)));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            if (_stop) {
+                return;
+            }
+        }
+
+        throw ClosedError("Failed to get reply: connection has been closed");
+    }
+#endif
+}
+
+bool MultiplexedConnection::_deliver(ReplyUPtr reply) {
+    std::chrono::steady_clock::time_point recv_time;
+    if (_metrics) {
+        recv_time = std::chrono::steady_clock::now();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_pending.empty()) {
+        return false;
+    }
+
+    auto *request = _pending.front();
+    _pending.pop_front();
+
+    request->recv_time = recv_time;
+    request->reply = std::move(reply);
+    request->done = true;
+    request->cv.notify_one();
+
+    return true;
+}
+
+bool MultiplexedConnection::_timed_out() {
+    auto timeout = _connection.options().socket_timeout;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_pending.empty() || timeout <= std::chrono::milliseconds(0)) {
+        return false;
+    }
+
+    return std::chrono::steady_clock::now() - _pending.front()->time >= timeout;
+}
+
+void MultiplexedConnection::_fail(std::exception_ptr err) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (!_err) {
+            _err = err;
+        }
+
+        for (auto *request : _pending) {
+            request->err = err;
+            request->done = true;
+            request->cv.notify_one();
+        }
+
+        _pending.clear();
+    }
+
+#ifndef _WIN32
+    // Stop the reader thread, and commands written later never get replies.
+    ::shutdown(_fd, SHUT_RDWR);
+#endif
+}
+
+ConnectionMultiplexer::ConnectionMultiplexer(const ConnectionPoolSPtr &pool) : _pool(pool) {
+    assert(_pool);
+
+    // Lazily create the multiplexed connection.
+}
+
+MultiplexedConnectionSPtr ConnectionMultiplexer::_fetch() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_connection || _connection->broken()) {
+        // Threads still holding the old one get its error, and it's destroyed
+        // when the last of them releases it.
+        _connection = std::make_shared<MultiplexedConnection>(_pool->create());
+    }
+
+    return _connection;
+}
+
+}
+
+}
@@ -0,0 +1,209 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_MULTIPLEXED_CONNECTION_H
+#define SEWENEW_REDISPLUSPLUS_MULTIPLEXED_CONNECTION_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "sw/redis++/connection.h"
+#include "sw/redis++/connection_pool.h"
+#include "sw/redis++/reply.h"
+
+namespace sw {
+
+namespace redis {
+
+// A connection shared by many threads. Callers write commands to the connection
+// with a mutex held, and a dedicated reader thread receives replies, and hands them
+// to the waiting callers in the order that commands are written.
+//
+// The reader thread never takes the write mutex, since a writer might block on
+// writing with it held. Pending commands are guarded by another mutex, and metrics
+// of a command are recorded by its caller, once the reply has been handed over.
+//
+// Once it's broken, all pending commands fail, and it can no longer be used.
+// NOTE: TLS is NOT supported, since the reader thread reads the socket directly.
+class MultiplexedConnection {
+public:
+    explicit MultiplexedConnection(Connection connection);
+
+    MultiplexedConnection(const MultiplexedConnection &) = delete;
+    MultiplexedConnection& operator=(const MultiplexedConnection &) = delete;
+
+    MultiplexedConnection(MultiplexedConnection &&) = delete;
+    MultiplexedConnection& operator=(MultiplexedConnection &&) = delete;
+
+    ~MultiplexedConnection();
+
+    // Send the command, and block until its reply is received.
+    // If the reply is an error reply, it's thrown as an exception.
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr command(Cmd cmd, Args &&...args);
+
+    bool broken();
+
+private:
+    struct Request {
+        // The time that the command is written.
+        std::chrono::steady_clock::time_point time;
+
+        ReplyUPtr reply;
+
+        std::exception_ptr err;
+
+        bool done = false;
+
+        std::condition_variable cv;
+
+        // Only set when metrics is enabled. `command` is only accessed by the caller,
+        // and `recv_time` is set by the reader thread with `_mutex` held.
+        Connection::PendingCommand command;
+
+        std::chrono::steady_clock::time_point recv_time;
+    };
+
+    // Queue the request before writing the command, since the reply might
+    // be received before the write returns.
+    void _enqueue(Request &request);
+
+    // Remove the request, if it fails to write the command.
+    void _abort(Request &request, std::exception_ptr err);
+
+    // Take the command's metrics from the connection, so that the reader thread
+    // never touches the connection. Only called when metrics is enabled.
+    void _on_send(Request &request);
+
+    // Write buffered commands to the socket.
+    void _flush();
+
+    ReplyUPtr _wait(Request &request);
+
+    // Record metrics of the reply. Only called when metrics is enabled.
+    void _on_recv(const Request &request);
+
+    // Loop of the reader thread.
+    void _run();
+
+    void _read_replies();
+
+    // Return false, if no command is waiting for the reply.
+    bool _deliver(ReplyUPtr reply);
+
+    // Whether the oldest pending command has timed out.
+    bool _timed_out();
+
+    // Fail all pending commands, and mark the connection as broken.
+    void _fail(std::exception_ptr err);
+
+    // Only accessed with `_write_mutex` held, except `_fd` and `_metrics`, which never change.
+    Connection _connection;
+
+    int _fd = -1;
+
+    MetricsHookSPtr _metrics;
+
+    // Protect `_connection`. Writers might hold it while blocking on writing.
+    std::mutex _write_mutex;
+
+    // Protect pending commands and the state. Held by both writers and the reader thread,
+    // but never held while doing I/O.
+    std::mutex _mutex;
+
+    std::deque<Request *> _pending;
+
+    // Non-null, if it's broken.
+    std::exception_ptr _err;
+
+    bool _stop = false;
+
+    std::thread _reader;
+};
+
+using MultiplexedConnectionSPtr = std::shared_ptr<MultiplexedConnection>;
+
+// Send commands with a multiplexed connection, which is created from the pool,
+// and replaced with a new one if it's broken.
+class ConnectionMultiplexer {
+public:
+    explicit ConnectionMultiplexer(const ConnectionPoolSPtr &pool);
+
+    ConnectionMultiplexer(const ConnectionMultiplexer &) = delete;
+    ConnectionMultiplexer& operator=(const ConnectionMultiplexer &) = delete;
+
+    ConnectionMultiplexer(ConnectionMultiplexer &&) = delete;
+    ConnectionMultiplexer& operator=(ConnectionMultiplexer &&) = delete;
+
+    ~ConnectionMultiplexer() = default;
+
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr command(Cmd cmd, Args &&...args) {
+        // Hold the connection until the reply is received,
+        // even if it's replaced by other threads.
+        auto connection = _fetch();
+
+        return connection->command(cmd, std::forward<Args>(args)...);
+    }
+
+private:
+    // Get the current connection, and create a new one, if it's broken.
+    MultiplexedConnectionSPtr _fetch();
+
+    ConnectionPoolSPtr _pool;
+
+    std::mutex _mutex;
+
+    MultiplexedConnectionSPtr _connection;
+};
+
+using ConnectionMultiplexerSPtr = std::shared_ptr<ConnectionMultiplexer>;
+
+template <typename Cmd, typename ...Args>
+ReplyUPtr MultiplexedConnection::command(Cmd cmd, Args &&...args) {
+    Request request;
+
+    {
+        std::lock_guard<std::mutex> lock(_write_mutex);
+
+        _enqueue(request);
+
+        try {
+            cmd(_connection, std::forward<Args>(args)...);
+        } catch (...) {
+            _abort(request, std::current_exception());
+            throw;
+        }
+
+        if (_metrics) {
+            _on_send(request);
+        }
+
+        _flush();
+    }
+
+    return _wait(request);
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_MULTIPLEXED_CONNECTION_H
@@ -2068,6 +2068,8 @@ private:
     template <typename Impl>
     friend class QueuedRedis;
 
+    friend class ClusterPipeline;
+
     QueuedReplies(std::vector<ReplyUPtr> replies,
             std::unordered_set<std::size_t> set_cmd_indexes) :
         _replies(std::move(replies)), _set_cmd_indexes(std::move(set_cmd_indexes)) {}
@@ -98,7 +98,7 @@ auto QueuedRedis<Impl>::command(Input first, Input last)
     auto cmd = [](Connection &connection, Input start, Input stop) {
                     CmdArgs cmd_args;
                     while (start != stop) {
-                        cmd_args.append(*start);
+                        cmd_args.append_copy(*start);
                         ++start;
                     }
                     connection.send(cmd_args);
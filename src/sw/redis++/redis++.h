@@ -19,6 +19,7 @@
 
 #include "sw/redis++/redis.h"
 #include "sw/redis++/redis_cluster.h"
+#include "sw/redis++/cluster_scanner.h"
 #include "sw/redis++/queued_redis.h"
 #include "sw/redis++/sentinel.h"
 
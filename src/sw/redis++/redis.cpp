@@ -24,6 +24,14 @@ namespace sw {
 
 namespace redis {
 
+Redis::Redis(const ConnectionOptions &connection_opts,
+                const ConnectionPoolOptions &pool_opts,
+                const ClientCacheOptions &cache_opts) :
+                    _pool(std::make_shared<ConnectionPool>(pool_opts, connection_opts)),
+                    _auto_pipeline(_make_auto_pipeline(_pool, pool_opts)),
+                    _multiplexer(_make_multiplexer(_pool, pool_opts)),
+                    _cache(std::make_shared<ClientCache>(cache_opts, _pool)) {}
+
 Redis::Redis(const Uri &uri) :
     Redis(uri.connection_options(), uri.connection_pool_options()) {}
 
@@ -31,6 +39,28 @@ Redis::Redis(const GuardedConnectionSPtr &connection) : _connection(connection)
     assert(_connection);
 }
 
+AutoPipelineSPtr Redis::_make_auto_pipeline(const ConnectionPoolSPtr &pool,
+                                            const ConnectionPoolOptions &pool_opts) {
+    if (!pool_opts.auto_pipeline) {
+        return nullptr;
+    }
+
+    if (pool_opts.multiplexed) {
+        throw Error("auto pipeline CANNOT be used with multiplexed connection");
+    }
+
+    return std::make_shared<AutoPipeline>(pool, pool_opts.size);
+}
+
+ConnectionMultiplexerSPtr Redis::_make_multiplexer(const ConnectionPoolSPtr &pool,
+                                                    const ConnectionPoolOptions &pool_opts) {
+    if (!pool_opts.multiplexed) {
+        return nullptr;
+    }
+
+    return std::make_shared<ConnectionMultiplexer>(pool);
+}
+
 Pipeline Redis::pipeline(bool new_connection) {
     if (!_pool) {
         throw Error("cannot create pipeline in single connection mode");
@@ -264,7 +294,7 @@ long long Redis::unlink(const StringView &key) {
 }
 
 long long Redis::wait(long long numslaves, long long timeout) {
-    auto reply = command(cmd::wait, numslaves, timeout);
+    auto reply = _blocking_command(cmd::wait, numslaves, timeout);
 
     return reply::parse<long long>(*reply);
 }
@@ -311,6 +341,12 @@ long long Redis::decrby(const StringView &key, long long decrement) {
 }
 
 OptionalString Redis::get(const StringView &key) {
+    if (_cache) {
+        auto cached_reply = _cached_command("GET", key);
+
+        return reply::parse<OptionalString>(cached_reply->reply());
+    }
+
     auto reply = command(cmd::get, key);
 
     return reply::parse<OptionalString>(*reply);
@@ -425,7 +461,7 @@ long long Redis::strlen(const StringView &key) {
 // LIST commands.
 
 OptionalStringPair Redis::blpop(const StringView &key, long long timeout) {
-    auto reply = command(cmd::blpop, key, timeout);
+    auto reply = _blocking_command(cmd::blpop, key, timeout);
 
     return reply::parse<OptionalStringPair>(*reply);
 }
@@ -435,7 +471,7 @@ OptionalStringPair Redis::blpop(const StringView &key, const std::chrono::second
 }
 
 OptionalStringPair Redis::brpop(const StringView &key, long long timeout) {
-    auto reply = command(cmd::brpop, key, timeout);
+    auto reply = _blocking_command(cmd::brpop, key, timeout);
 
     return reply::parse<OptionalStringPair>(*reply);
 }
@@ -447,7 +483,7 @@ OptionalStringPair Redis::brpop(const StringView &key, const std::chrono::second
 OptionalString Redis::brpoplpush(const StringView &source,
                                     const StringView &destination,
                                     long long timeout) {
-    auto reply = command(cmd::brpoplpush, source, destination, timeout);
+    auto reply = _blocking_command(cmd::brpoplpush, source, destination, timeout);
 
     return reply::parse<OptionalString>(*reply);
 }
@@ -542,7 +578,7 @@ OptionalString Redis::lmove(const StringView &src, const StringView &dest,
 
 OptionalString Redis::blmove(const StringView &src, const StringView &dest,
         ListWhence src_whence, ListWhence dest_whence, const std::chrono::seconds &timeout) {
-    auto reply = command(cmd::blmove, src, dest, src_whence, dest_whence, timeout.count());
+    auto reply = _blocking_command(cmd::blmove, src, dest, src_whence, dest_whence, timeout.count());
 
     return reply::parse<OptionalString>(*reply);
 }
@@ -560,6 +596,12 @@ bool Redis::hexists(const StringView &key, const StringView &field) {
 }
 
 OptionalString Redis::hget(const StringView &key, const StringView &field) {
+    if (_cache) {
+        auto cached_reply = _cached_command("HGET", key, field);
+
+        return reply::parse<OptionalString>(cached_reply->reply());
+    }
+
     auto reply = command(cmd::hget, key, field);
 
     return reply::parse<OptionalString>(*reply);
@@ -677,14 +719,14 @@ long long Redis::sunionstore(const StringView &destination, const StringView &ke
 
 auto Redis::bzpopmax(const StringView &key, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmax, key, timeout);
+    auto reply = _blocking_command(cmd::bzpopmax, key, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
 
 auto Redis::bzpopmin(const StringView &key, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmin, key, timeout);
+    auto reply = _blocking_command(cmd::bzpopmin, key, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
@@ -23,6 +23,9 @@
 #include <initializer_list>
 #include <tuple>
 #include "sw/redis++/connection_pool.h"
+#include "sw/redis++/auto_pipeline.h"
+#include "sw/redis++/multiplexed_connection.h"
+#include "sw/redis++/client_cache.h"
 #include "sw/redis++/reply.h"
 #include "sw/redis++/command_options.h"
 #include "sw/redis++/utils.h"
@@ -53,7 +56,23 @@ public:
     /// @see https://github.com/sewenew/redis-plus-plus#connection
     explicit Redis(const ConnectionOptions &connection_opts,
             const ConnectionPoolOptions &pool_opts = {}) :
-                _pool(std::make_shared<ConnectionPool>(pool_opts, connection_opts)) {}
+                _pool(std::make_shared<ConnectionPool>(pool_opts, connection_opts)),
+                _auto_pipeline(_make_auto_pipeline(_pool, pool_opts)),
+                _multiplexer(_make_multiplexer(_pool, pool_opts)) {}
+
+    /// @brief Construct `Redis` instance with client side caching.
+    /// @param connection_opts Connection options.
+    /// @param pool_opts Connection pool options.
+    /// @param cache_opts Client side caching options.
+    /// @note Replies of GET, HGET and HGETALL are cached locally, and kept coherent with
+    ///       CLIENT TRACKING, i.e. Redis 6.0 or later and hiredis with RESP3 support are required.
+    ///       Invalidation is asynchronous, so a read might get the old value from cache
+    ///       for a short while after the key has been modified.
+    /// @see `ClientCacheOptions`
+    /// @see https://redis.io/docs/manual/client-side-caching/
+    Redis(const ConnectionOptions &connection_opts,
+            const ConnectionPoolOptions &pool_opts,
+            const ClientCacheOptions &cache_opts);
 
     /// @brief Construct `Redis` instance with URI.
     /// @param uri URI, e.g. 'tcp://127.0.0.1', 'tcp://127.0.0.1:6379', or 'unix://path/to/socket'.
@@ -81,7 +100,9 @@ public:
             const ConnectionPoolOptions &pool_opts = {}) :
                 _pool(std::make_shared<ConnectionPool>(SimpleSentinel(sentinel, master_name, role),
                                                         pool_opts,
-                                                        connection_opts)) {}
+                                                        connection_opts)),
+                _auto_pipeline(_make_auto_pipeline(_pool, pool_opts)),
+                _multiplexer(_make_multiplexer(_pool, pool_opts)) {}
 
     /// @brief `Redis` is not copyable.
     Redis(const Redis &) = delete;
@@ -3825,6 +3846,21 @@ private:
     template <typename Cmd, typename ...Args>
     ReplyUPtr _command(Connection &connection, Cmd cmd, Args &&...args);
 
+    // Send a blocking command, e.g. BLPOP, with a connection of its own,
+    // even if auto pipeline or multiplexed connection is enabled.
+    template <typename Cmd, typename ...Args>
+    ReplyUPtr _blocking_command(Cmd cmd, Args &&...args);
+
+    static AutoPipelineSPtr _make_auto_pipeline(const ConnectionPoolSPtr &pool,
+                                                const ConnectionPoolOptions &pool_opts);
+
+    static ConnectionMultiplexerSPtr _make_multiplexer(const ConnectionPoolSPtr &pool,
+                                                        const ConnectionPoolOptions &pool_opts);
+
+    // Send a read-only command with the client side cache.
+    template <typename ...Args>
+    CachedReplySPtr _cached_command(const StringView &cmd_name, const StringView &key, Args &&...args);
+
     template <typename Cmd, typename ...Args>
     ReplyUPtr _score_command(std::true_type, Cmd cmd, Args &&... args);
 
@@ -3839,11 +3875,20 @@ private:
     // In this case, *_connection* is a null pointer, and is never used.
     ConnectionPoolSPtr _pool;
 
+    // Only available in pool mode. Null if it's not enabled.
+    AutoPipelineSPtr _auto_pipeline;
+
+    // Only available in pool mode. Null if it's not enabled.
+    ConnectionMultiplexerSPtr _multiplexer;
+
     // Single Connection Mode.
     // Private constructor creates a *Redis* instance with a single connection.
     // This is used when we create Transaction, Pipeline and Subscriber.
     // In this case, *_pool* is empty, and is never used.
     GuardedConnectionSPtr _connection;
+
+    // Client side cache, only available in pool mode. Null if it's not enabled.
+    ClientCacheSPtr _cache;
 };
 
 }
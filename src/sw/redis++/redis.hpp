@@ -41,6 +41,14 @@ auto Redis::command(Cmd cmd, Args &&...args)
     } else {
         assert(_pool);
 
+        if (_multiplexer) {
+            return _multiplexer->command(cmd, std::forward<Args>(args)...);
+        }
+
+        if (_auto_pipeline) {
+            return _auto_pipeline->command(cmd, std::forward<Args>(args)...);
+        }
+
         // Pool Mode, i.e. get connection from pool.
         SafeConnection connection(*_pool);
 
@@ -68,7 +76,7 @@ auto Redis::command(Input first, Input last)
     auto cmd = [](Connection &connection, Input start, Input stop) {
                     CmdArgs cmd_args;
                     while (start != stop) {
-                        cmd_args.append(*start);
+                        cmd_args.append_copy(*start);
                         ++start;
                     }
                     connection.send(cmd_args);
@@ -83,7 +91,7 @@ Result Redis::command(const StringView &cmd_name, Args &&...args) {
 
     assert(r);
 
-    return reply::parse<Result>(*r);
+    return reply::parse<Result>(std::move(r));
 }
 
 template <typename ...Args>
@@ -105,7 +113,7 @@ auto Redis::command(Input first, Input last)
 
     assert(r);
 
-    return reply::parse<Result>(*r);
+    return reply::parse<Result>(std::move(r));
 }
 
 template <typename Input, typename Output>
@@ -280,7 +288,7 @@ template <typename Input>
 OptionalStringPair Redis::blpop(Input first, Input last, long long timeout) {
     range_check("BLPOP", first, last);
 
-    auto reply = command(cmd::blpop_range<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::blpop_range<Input>, first, last, timeout);
 
     return reply::parse<OptionalStringPair>(*reply);
 }
@@ -296,7 +304,7 @@ template <typename Input>
 OptionalStringPair Redis::brpop(Input first, Input last, long long timeout) {
     range_check("BRPOP", first, last);
 
-    auto reply = command(cmd::brpop_range<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::brpop_range<Input>, first, last, timeout);
 
     return reply::parse<OptionalStringPair>(*reply);
 }
@@ -362,6 +370,14 @@ inline long long Redis::hdel(const StringView &key, Input first, Input last) {
 
 template <typename Output>
 inline void Redis::hgetall(const StringView &key, Output output) {
+    if (_cache) {
+        auto cached_reply = _cached_command("HGETALL", key);
+
+        reply::to_array(cached_reply->reply(), output);
+
+        return;
+    }
+
     auto reply = command(cmd::hgetall, key);
 
     reply::to_array(*reply, output);
@@ -695,7 +711,7 @@ inline auto Redis::bzpopmax(const StringView &key, const std::chrono::seconds &t
 template <typename Input>
 auto Redis::bzpopmax(Input first, Input last, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmax_range<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::bzpopmax_range<Input>, first, last, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
@@ -716,7 +732,7 @@ inline auto Redis::bzpopmin(const StringView &key, const std::chrono::seconds &t
 template <typename Input>
 auto Redis::bzpopmin(Input first, Input last, long long timeout)
     -> Optional<std::tuple<std::string, std::string, double>> {
-    auto reply = command(cmd::bzpopmin_range<Input>, first, last, timeout);
+    auto reply = _blocking_command(cmd::bzpopmin_range<Input>, first, last, timeout);
 
     return reply::parse<Optional<std::tuple<std::string, std::string, double>>>(*reply);
 }
@@ -1056,7 +1072,7 @@ Result Redis::eval(const StringView &script,
                    Args args_last) {
     auto reply = command(cmd::eval<Keys, Args>, script, keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1098,7 +1114,7 @@ Result Redis::evalsha(const StringView &script,
     auto reply = command(cmd::evalsha<Keys, Args>, script,
             keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1148,7 +1164,7 @@ Result Redis::fcall(const StringView &func,
             Args args_last) {
     auto reply = command(cmd::fcall<Keys, Args>, func, keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1189,7 +1205,7 @@ Result Redis::fcall_ro(const StringView &func,
             Args args_last) {
     auto reply = command(cmd::fcall_ro<Keys, Args>, func, keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1381,7 +1397,7 @@ void Redis::xread(const StringView &key,
                     const std::chrono::milliseconds &timeout,
                     long long count,
                     Output output) {
-    auto reply = command(cmd::xread_block, key, id, timeout.count(), count);
+    auto reply = _blocking_command(cmd::xread_block, key, id, timeout.count(), count);
 
     if (!reply::is_nil(*reply)) {
         reply::to_array(*reply, output);
@@ -1397,7 +1413,7 @@ auto Redis::xread(Input first,
     -> typename std::enable_if<!std::is_convertible<Input, StringView>::value>::type {
     range_check("XREAD", first, last);
 
-    auto reply = command(cmd::xread_block_range<Input>, first, last, timeout.count(), count);
+    auto reply = _blocking_command(cmd::xread_block_range<Input>, first, last, timeout.count(), count);
 
     if (!reply::is_nil(*reply)) {
         reply::to_array(*reply, output);
@@ -1446,14 +1462,14 @@ void Redis::xreadgroup(const StringView &group,
                         long long count,
                         bool noack,
                         Output output) {
-    auto reply = command(cmd::xreadgroup_block,
-                            group,
-                            consumer,
-                            key,
-                            id,
-                            timeout.count(),
-                            count,
-                            noack);
+    auto reply = _blocking_command(cmd::xreadgroup_block,
+                                      group,
+                                      consumer,
+                                      key,
+                                      id,
+                                      timeout.count(),
+                                      count,
+                                      noack);
 
     if (!reply::is_nil(*reply)) {
         reply::to_array(*reply, output);
@@ -1472,14 +1488,14 @@ auto Redis::xreadgroup(const StringView &group,
     -> typename std::enable_if<!std::is_convertible<Input, StringView>::value>::type {
     range_check("XREADGROUP", first, last);
 
-    auto reply = command(cmd::xreadgroup_block_range<Input>,
-                            group,
-                            consumer,
-                            first,
-                            last,
-                            timeout.count(),
-                            count,
-                            noack);
+    auto reply = _blocking_command(cmd::xreadgroup_block_range<Input>,
+                                      group,
+                                      consumer,
+                                      first,
+                                      last,
+                                      timeout.count(),
+                                      count,
+                                      noack);
 
     if (!reply::is_nil(*reply)) {
         reply::to_array(*reply, output);
@@ -1518,6 +1534,28 @@ ReplyUPtr Redis::_command(Connection &connection, Cmd cmd, Args &&...args) {
     return reply;
 }
 
+template <typename Cmd, typename ...Args>
+ReplyUPtr Redis::_blocking_command(Cmd cmd, Args &&...args) {
+    if (!_auto_pipeline && !_multiplexer) {
+        return command(cmd, std::forward<Args>(args)...);
+    }
+
+    // A blocking command would block all commands sharing the connection.
+    SafeConnection connection(*_pool);
+
+    return _command(connection.connection(), cmd, std::forward<Args>(args)...);
+}
+
+template <typename ...Args>
+CachedReplySPtr Redis::_cached_command(const StringView &cmd_name, const StringView &key, Args &&...args) {
+    assert(_cache);
+
+    CmdArgs cmd_args;
+    cmd_args.append(cmd_name, key, std::forward<Args>(args)...);
+
+    return _cache->command(cmd_args);
+}
+
 template <typename Cmd, typename ...Args>
 inline ReplyUPtr Redis::_score_command(std::true_type, Cmd cmd, Args &&... args) {
     return command(cmd, std::forward<Args>(args)..., true);
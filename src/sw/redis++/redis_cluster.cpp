@@ -16,12 +16,36 @@
 
 #include "sw/redis++/redis_cluster.h"
 #include <cassert>
+#include <exception>
+#include <unordered_map>
 #include <hiredis/hiredis.h>
 #include "sw/redis++/command.h"
 #include "sw/redis++/errors.h"
 #include "sw/redis++/queued_redis.h"
 #include "sw/redis++/redis_uri.h"
 
+namespace {
+
+using namespace sw::redis;
+
+void send_fanout_command(Connection &connection,
+                            const StringView &cmd_name,
+                            const std::vector<StringView> &args,
+                            std::size_t step,
+                            const std::vector<std::size_t> &indexes) {
+    CmdArgs cmd_args;
+    cmd_args << cmd_name;
+    for (auto idx : indexes) {
+        for (std::size_t offset = 0; offset != step; ++offset) {
+            cmd_args << args[idx * step + offset];
+        }
+    }
+
+    connection.send(cmd_args);
+}
+
+}
+
 namespace sw {
 
 namespace redis {
@@ -53,6 +77,12 @@ Pipeline RedisCluster::pipeline(const StringView &hash_tag, bool new_connection)
     return Pipeline(pool, new_connection);
 }
 
+ClusterPipeline RedisCluster::cluster_pipeline() {
+    assert(_pool);
+
+    return ClusterPipeline(_pool);
+}
+
 Transaction RedisCluster::transaction(const StringView &hash_tag, bool piped, bool new_connection) {
     assert(_pool);
 
@@ -882,6 +912,222 @@ void RedisCluster::_asking(Connection &connection) {
     reply::parse<void>(*reply);
 }
 
+void RedisCluster::_on_redirect(RedirectType type) {
+    const auto &metrics = _pool->metrics();
+    if (metrics) {
+        metrics->on_redirect(type);
+    }
+}
+
+void RedisCluster::_fanout(const StringView &cmd_name,
+                            const std::vector<StringView> &args,
+                            std::size_t step,
+                            FanoutResult &result) {
+    assert(_pool && step > 0 && !args.empty() && args.size() % step == 0);
+
+    auto &indexes = result.indexes;
+    indexes.clear();
+
+    // Calculate slots of all keys in batch.
+    std::vector<StringView> keys;
+    keys.reserve(args.size() / step);
+    for (std::size_t idx = 0; idx * step < args.size(); ++idx) {
+        keys.push_back(args[idx * step]);
+    }
+
+    std::vector<Slot> key_slot_list(keys.size());
+    key_slots(keys.data(), keys.size(), key_slot_list.data());
+
+    // Group keys by slot.
+    std::vector<Slot> slots;
+    std::unordered_map<Slot, std::size_t> slot_groups;
+    for (std::size_t idx = 0; idx != keys.size(); ++idx) {
+        auto slot = key_slot_list[idx];
+        auto iter = slot_groups.find(slot);
+        if (iter == slot_groups.end()) {
+            iter = slot_groups.emplace(slot, slots.size()).first;
+            slots.push_back(slot);
+            indexes.emplace_back();
+        }
+
+        indexes[iter->second].push_back(idx);
+    }
+
+    auto &replies = result.replies;
+    replies.clear();
+    replies.resize(slots.size());
+
+    // Send the sub-command with the normal routine, which handles redirection
+    // and throws an exception for error replies.
+    auto send_group = [this, &cmd_name, &args, step, &indexes](std::size_t group) {
+        const auto &group_indexes = indexes[group];
+        auto cmd = [&cmd_name, &args, step, &group_indexes](Connection &connection) {
+            send_fanout_command(connection, cmd_name, args, step, group_indexes);
+        };
+
+        return this->_command(cmd, args[group_indexes.front() * step]);
+    };
+
+    if (slots.size() == 1) {
+        // All keys belong to the same slot, no need to split the command.
+        replies.front() = send_group(0);
+        return;
+    }
+
+    // Group sub-commands by node, so that sub-commands of the same node are
+    // pipelined with a single connection.
+    std::vector<std::pair<ConnectionPoolSPtr, std::vector<std::size_t>>> nodes;
+    std::unordered_map<ConnectionPool*, std::size_t> node_groups;
+    for (std::size_t group = 0; group != slots.size(); ++group) {
+        auto pool = _pool->fetch(slots[group]);
+        assert(pool);
+
+        auto iter = node_groups.find(pool.get());
+        if (iter == node_groups.end()) {
+            iter = node_groups.emplace(pool.get(), nodes.size()).first;
+            nodes.emplace_back(std::move(pool), std::vector<std::size_t>{});
+        }
+
+        nodes[iter->second].second.push_back(group);
+    }
+
+    auto need_update = false;
+
+    // Sub-commands that fail before being written, and can be safely resent.
+    std::vector<bool> unsent(slots.size(), false);
+
+    // The first error of nodes, which fail after sub-commands have been written.
+    // These sub-commands might have been executed, e.g. reading reply timed out,
+    // and they're NEVER resent, otherwise, DEL might return a wrong count.
+    std::exception_ptr err;
+    {
+        std::vector<std::unique_ptr<SafeConnection>> connections(nodes.size());
+        try {
+            // Send sub-commands to all nodes, before receiving any reply,
+            // so that nodes process these sub-commands in parallel.
+            for (std::size_t idx = 0; idx != nodes.size(); ++idx) {
+                try {
+                    connections[idx].reset(new SafeConnection(*(nodes[idx].first)));
+                    auto &connection = connections[idx]->connection();
+                    for (auto group : nodes[idx].second) {
+                        send_fanout_command(connection, cmd_name, args, step, indexes[group]);
+                    }
+                } catch (const IoError &) {
+                    need_update = true;
+                    connections[idx].reset();
+                    for (auto group : nodes[idx].second) {
+                        unsent[group] = true;
+                    }
+                } catch (const ClosedError &) {
+                    need_update = true;
+                    connections[idx].reset();
+                    for (auto group : nodes[idx].second) {
+                        unsent[group] = true;
+                    }
+                }
+
+                if (!connections[idx]) {
+                    continue;
+                }
+
+                try {
+                    // Sub-commands are only buffered so far. Once writing starts,
+                    // part of them might have been sent, and they can NOT be resent.
+                    connections[idx]->connection().flush();
+                } catch (const IoError &) {
+                    need_update = true;
+                    connections[idx].reset();
+                    if (!err) {
+                        err = std::current_exception();
+                    }
+                } catch (const ClosedError &) {
+                    need_update = true;
+                    connections[idx].reset();
+                    if (!err) {
+                        err = std::current_exception();
+                    }
+                }
+            }
+
+            for (std::size_t idx = 0; idx != nodes.size(); ++idx) {
+                if (!connections[idx]) {
+                    continue;
+                }
+
+                try {
+                    auto &connection = connections[idx]->connection();
+                    for (auto group : nodes[idx].second) {
+                        // Error replies, e.g. MOVED and ASK, are handled later.
+                        replies[group] = connection.recv(false);
+                    }
+                } catch (const IoError &) {
+                    need_update = true;
+                    connections[idx].reset();
+                    if (!err) {
+                        err = std::current_exception();
+                    }
+                } catch (const ClosedError &) {
+                    need_update = true;
+                    connections[idx].reset();
+                    if (!err) {
+                        err = std::current_exception();
+                    }
+                }
+            }
+        } catch (...) {
+            // Some connections might have pending replies, and they CANNOT be reused.
+            for (auto &connection : connections) {
+                if (connection) {
+                    connection->connection().invalidate();
+                }
+            }
+
+            throw;
+        }
+
+        // Return connections to pools before retrying.
+    }
+
+    if (need_update) {
+        _pool->update();
+    }
+
+    if (err) {
+        std::rethrow_exception(err);
+    }
+
+    for (std::size_t group = 0; group != replies.size(); ++group) {
+        auto &reply = replies[group];
+        assert(reply || unsent[group]);
+
+        if (!reply || reply::is_error(*reply)) {
+            // Failed to connect to the node, or slot has been migrated, i.e. MOVED or ASK error.
+            reply = send_group(group);
+        }
+    }
+}
+
+std::vector<redisReply*> RedisCluster::_merge_fanout_replies(const FanoutResult &result,
+                                                                std::size_t size) {
+    std::vector<redisReply*> elements(size, nullptr);
+    for (std::size_t group = 0; group != result.replies.size(); ++group) {
+        const auto &reply = result.replies[group];
+        const auto &indexes = result.indexes[group];
+
+        assert(reply);
+
+        if (!reply::is_array(*reply) || reply->elements != indexes.size()) {
+            throw ProtoError("invalid reply of split MGET command");
+        }
+
+        for (std::size_t idx = 0; idx != indexes.size(); ++idx) {
+            elements[indexes[idx]] = reply->element[idx];
+        }
+    }
+
+    return elements;
+}
+
 }
 
 }
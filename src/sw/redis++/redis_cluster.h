@@ -22,6 +22,7 @@
 #include <initializer_list>
 #include <tuple>
 #include "sw/redis++/shards_pool.h"
+#include "sw/redis++/cluster_pipeline.h"
 #include "sw/redis++/reply.h"
 #include "sw/redis++/command_options.h"
 #include "sw/redis++/utils.h"
@@ -43,6 +44,8 @@ using Transaction = QueuedRedis<TransactionImpl>;
 
 using Pipeline = QueuedRedis<PipelineImpl>;
 
+class ClusterScanner;
+
 class RedisCluster {
 public:
     explicit RedisCluster(const ConnectionOptions &connection_opts,
@@ -65,6 +68,12 @@ public:
 
     Pipeline pipeline(const StringView &hash_tag, bool new_connection = true);
 
+    /// @brief Create a pipeline, which accepts commands on arbitrary keys.
+    /// Commands are bucketed by node, and sent to all nodes in parallel.
+    /// @note The returned ClusterPipeline shares the slot-node mapping with RedisCluster.
+    /// @see ClusterPipeline
+    ClusterPipeline cluster_pipeline();
+
     Transaction transaction(const StringView &hash_tag, bool piped = false, bool new_connection = true);
 
     Subscriber subscriber();
@@ -1527,6 +1536,8 @@ public:
             XtrimStrategy strategy, long long limit);
 
 private:
+    friend class ClusterScanner;
+
     explicit RedisCluster(const Uri &uri);
 
     class Command {
@@ -1579,6 +1590,58 @@ private:
 
     void _asking(Connection &connection);
 
+    void _on_redirect(RedirectType type);
+
+    // Key indexes and replies of sub-commands, when a multiple-key command
+    // is split by slot, i.e. ClusterOptions::cross_slot_fanout is true.
+    struct FanoutResult {
+        // Indexes of keys of each sub-command.
+        std::vector<std::vector<std::size_t>> indexes;
+
+        // Reply of each sub-command.
+        std::vector<ReplyUPtr> replies;
+    };
+
+    bool _cross_slot_fanout() const {
+        return _pool->cluster_options().cross_slot_fanout;
+    }
+
+    template <typename Input>
+    std::vector<StringView> _fanout_keys(Input first, Input last) const;
+
+    // Split the command by slot, and send sub-commands to nodes in parallel.
+    // `args` are keys (`step` is 1), or key-value pairs (`step` is 2), which
+    // reference elements of the input range, so that the range is iterated only once.
+    // If all keys belong to the same slot, the command is sent as a whole.
+    // If a node fails after sub-commands have been written, the error is thrown,
+    // and these sub-commands are NOT resent, since they might have been executed.
+    void _fanout(const StringView &cmd_name,
+                    const std::vector<StringView> &args,
+                    std::size_t step,
+                    FanoutResult &result);
+
+    // Reorder elements of sub-replies of MGET in input order.
+    static std::vector<redisReply*> _merge_fanout_replies(const FanoutResult &result,
+                                                            std::size_t size);
+
+    template <typename Input>
+    long long _del(Input first, Input last, std::true_type);
+
+    template <typename Input>
+    long long _del(Input first, Input last, std::false_type);
+
+    template <typename Input, typename Output>
+    void _mget(Input first, Input last, Output output, std::true_type);
+
+    template <typename Input, typename Output>
+    void _mget(Input first, Input last, Output output, std::false_type);
+
+    template <typename Input>
+    void _mset(Input first, Input last, std::true_type);
+
+    template <typename Input>
+    void _mset(Input first, Input last, std::false_type);
+
     template <typename Cmd, typename ...Args>
     ReplyUPtr _score_command(std::true_type, Cmd cmd, Args &&... args);
 
@@ -1588,7 +1651,7 @@ private:
     template <typename Output, typename Cmd, typename ...Args>
     ReplyUPtr _score_command(Cmd cmd, Args &&... args);
 
-    ShardsPoolUPtr _pool;
+    ShardsPoolSPtr _pool;
 };
 
 }
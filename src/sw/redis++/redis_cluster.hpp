@@ -18,6 +18,8 @@
 #define SEWENEW_REDISPLUSPLUS_REDIS_CLUSTER_HPP
 
 #include <utility>
+#include <tuple>
+#include <vector>
 #include "sw/redis++/command.h"
 #include "sw/redis++/reply.h"
 #include "sw/redis++/utils.h"
@@ -69,7 +71,7 @@ auto RedisCluster::command(const StringView &cmd_name, Key &&key, Args &&...args
 
     assert(r);
 
-    return reply::parse<Result>(*r);
+    return reply::parse<Result>(std::move(r));
 }
 
 template <typename Key, typename ...Args>
@@ -101,7 +103,7 @@ auto RedisCluster::command(Input first, Input last)
                         CmdArgs cmd_args;
                         cmd_args.append(key);
                         while (start != stop) {
-                            cmd_args.append(*start);
+                            cmd_args.append_copy(*start);
                             ++start;
                         }
                         connection.send(cmd_args);
@@ -117,7 +119,7 @@ auto RedisCluster::command(Input first, Input last)
 
     assert(r);
 
-    return reply::parse<Result>(*r);
+    return reply::parse<Result>(std::move(r));
 }
 
 template <typename Input, typename Output>
@@ -136,9 +138,9 @@ template <typename Input>
 long long RedisCluster::del(Input first, Input last) {
     range_check("DEL", first, last);
 
-    auto reply = command(cmd::del_range<Input>, first, last);
-
-    return reply::parse<long long>(*reply);
+    // Only split the command, if keys can be referenced as StringView while iterating.
+    return _del(first, last, std::integral_constant<bool,
+            IsStableIter<Input>::value && std::is_convertible<decltype(*first), StringView>::value>());
 }
 
 template <typename Input>
@@ -210,18 +212,25 @@ template <typename Input, typename Output>
 void RedisCluster::mget(Input first, Input last, Output output) {
     range_check("MGET", first, last);
 
-    auto reply = command(cmd::mget<Input>, first, last);
-
-    reply::to_array(*reply, output);
+    // Only split the command, if keys can be referenced as StringView while iterating.
+    _mget(first, last, output, std::integral_constant<bool,
+            IsStableIter<Input>::value && std::is_convertible<decltype(*first), StringView>::value>());
 }
 
 template <typename Input>
 void RedisCluster::mset(Input first, Input last) {
     range_check("MSET", first, last);
 
-    auto reply = command(cmd::mset<Input>, first, last);
+    // Only split the command, if both key and value can be referenced as StringView
+    // while iterating.
+    using Pair = typename std::decay<decltype(*std::declval<Input>())>::type;
+    using Key = typename std::tuple_element<0, Pair>::type;
+    using Value = typename std::tuple_element<1, Pair>::type;
 
-    reply::parse<void>(*reply);
+    _mset(first, last, std::integral_constant<bool,
+            IsStableIter<Input>::value
+                && std::is_convertible<Key, StringView>::value
+                && std::is_convertible<Value, StringView>::value>());
 }
 
 template <typename Input>
@@ -1030,7 +1039,7 @@ Result RedisCluster::eval(const StringView &script,
 
     auto reply = _command(cmd::eval<Keys, Args>, *keys_first, script, keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1081,7 +1090,7 @@ Result RedisCluster::evalsha(const StringView &script,
     auto reply = _command(cmd::evalsha<Keys, Args>, *keys_first, script,
             keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1131,7 +1140,7 @@ Result RedisCluster::fcall(const StringView &func,
 
     auto reply = _command(cmd::fcall<Keys, Args>, *keys_first, func, keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1173,7 +1182,7 @@ Result RedisCluster::fcall_ro(const StringView &func,
 
     auto reply = _command(cmd::fcall_ro<Keys, Args>, *keys_first, func, keys_first, keys_last, args_first, args_last);
 
-    return reply::parse<Result>(*reply);
+    return reply::parse<Result>(std::move(reply));
 }
 
 template <typename Result>
@@ -1524,6 +1533,104 @@ ReplyUPtr RedisCluster::_command(Cmd cmd, std::false_type, Input &&first, Args &
                             std::forward<Args>(args)...);
 }
 
+template <typename Input>
+std::vector<StringView> RedisCluster::_fanout_keys(Input first, Input last) const {
+    std::vector<StringView> keys;
+    while (first != last) {
+        keys.emplace_back(*first);
+        ++first;
+    }
+
+    return keys;
+}
+
+template <typename Input>
+long long RedisCluster::_del(Input first, Input last, std::true_type) {
+    if (_cross_slot_fanout()) {
+        FanoutResult result;
+        _fanout("DEL", _fanout_keys(first, last), 1, result);
+
+        long long num = 0;
+        for (const auto &reply : result.replies) {
+            assert(reply);
+
+            num += reply::parse<long long>(*reply);
+        }
+
+        return num;
+    }
+
+    return _del(first, last, std::false_type{});
+}
+
+template <typename Input>
+long long RedisCluster::_del(Input first, Input last, std::false_type) {
+    auto reply = command(cmd::del_range<Input>, first, last);
+
+    return reply::parse<long long>(*reply);
+}
+
+template <typename Input, typename Output>
+void RedisCluster::_mget(Input first, Input last, Output output, std::true_type) {
+    if (_cross_slot_fanout()) {
+        auto keys = _fanout_keys(first, last);
+        FanoutResult result;
+        _fanout("MGET", keys, 1, result);
+
+        auto elements = _merge_fanout_replies(result, keys.size());
+
+        // A fake array reply, whose elements are owned by the sub-replies.
+        redisReply reply{};
+        reply.type = REDIS_REPLY_ARRAY;
+        reply.elements = elements.size();
+        reply.element = elements.data();
+
+        reply::to_array(reply, output);
+
+        return;
+    }
+
+    _mget(first, last, output, std::false_type{});
+}
+
+template <typename Input, typename Output>
+void RedisCluster::_mget(Input first, Input last, Output output, std::false_type) {
+    auto reply = command(cmd::mget<Input>, first, last);
+
+    reply::to_array(*reply, output);
+}
+
+template <typename Input>
+void RedisCluster::_mset(Input first, Input last, std::true_type) {
+    if (_cross_slot_fanout()) {
+        std::vector<StringView> args;
+        for (auto iter = first; iter != last; ++iter) {
+            args.emplace_back(std::get<0>(*iter));
+            args.emplace_back(std::get<1>(*iter));
+        }
+
+        FanoutResult result;
+        _fanout("MSET", args, 2, result);
+
+        for (const auto &reply : result.replies) {
+            assert(reply);
+
+            reply::parse<void>(*reply);
+        }
+
+        return;
+    }
+
+    _mset(first, last, std::false_type{});
+}
+
+template <typename Input>
+void RedisCluster::_mset(Input first, Input last, std::false_type) {
+    auto reply = command(cmd::mset<Input>, first, last);
+
+    reply::parse<void>(*reply);
+}
+
 template <typename Cmd, typename Input, typename ...Args>
 ReplyUPtr RedisCluster::_range_command(Cmd cmd, std::true_type, Input input, Args &&...args) {
     return _command(cmd, *input, input, std::forward<Args>(args)...);
@@ -1565,10 +1672,15 @@ ReplyUPtr RedisCluster::_command(Cmd cmd, const StringView &key, Args &&...args)
             // TODO:
             // 2. If it's NOT exist, update slot mapping, and retry.
             // 3. If it's still exist, that means the node is down, NOT removed, throw exception.
-        } catch (const MovedError &) {
-            // Slot mapping has been changed, update it and try again.
-            _pool->update();
+        } catch (const MovedError &err) {
+            _on_redirect(RedirectType::MOVED);
+
+            // Slot mapping has been changed, update the slot and try again.
+            // The full slot mapping will be updated in background.
+            _pool->update(err.slot(), err.node());
         } catch (const AskError &err) {
+            _on_redirect(RedirectType::ASK);
+
             auto pool = _pool->fetch(err.node());
             assert(pool);
             SafeConnection safe_connection(*pool);
@@ -17,11 +17,26 @@
 #include "sw/redis++/reply.h"
 #include <cstdlib>
 #include <stdexcept>
+#include "sw/redis++/reply_arena.h"
 
 namespace sw {
 
 namespace redis {
 
+ReplyDeleter ReplyDeleter::share() const {
+    if (_arena == nullptr) {
+        return ReplyDeleter{};
+    }
+
+    return ReplyDeleter(_arena->retain());
+}
+
+void ReplyDeleter::_release() const {
+    assert(_arena != nullptr);
+
+    _arena->release();
+}
+
 std::string ParseError::_err_info(const std::string &expect_type,
         const redisReply &reply) const {
     return "expect " + expect_type + " reply, but got " +
@@ -90,6 +105,25 @@ std::string parse(ParseTag<std::string>, redisReply &reply) {
     return std::string(reply.str, reply.len);
 }
 
+StringView parse(ParseTag<StringView>, redisReply &reply) {
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    if (!reply::is_string(reply) && !reply::is_status(reply)
+            && !reply::is_verb(reply) && !reply::is_bignum(reply)) {
+        throw ParseError("STRING or STATUS or VERB or BIGNUM", reply);
+    }
+#else
+    if (!reply::is_string(reply) && !reply::is_status(reply)) {
+        throw ParseError("STRING or STATUS", reply);
+    }
+#endif
+
+    if (reply.str == nullptr) {
+        throw ProtoError("A null string reply");
+    }
+
+    return StringView(reply.str, reply.len);
+}
+
 long long parse(ParseTag<long long>, redisReply &reply) {
     if (!reply::is_integer(reply)) {
         throw ParseError("INTEGER", reply);
@@ -38,12 +38,30 @@ namespace sw {
 
 namespace redis {
 
-struct ReplyDeleter {
+class ReplyArena;
+
+class ReplyDeleter {
+public:
+    ReplyDeleter() = default;
+
+    // The reply is allocated in the arena, and the deleter owns a reference of the arena.
+    explicit ReplyDeleter(ReplyArena *arena) noexcept : _arena(arena) {}
+
     void operator()(redisReply *reply) const {
-        if (reply != nullptr) {
+        if (_arena != nullptr) {
+            _release();
+        } else if (reply != nullptr) {
             freeReplyObject(reply);
         }
     }
+
+    // Deleter of a sub reply, which is detached from the reply freed by this deleter.
+    ReplyDeleter share() const;
+
+private:
+    void _release() const;
+
+    ReplyArena *_arena = nullptr;
 };
 
 using ReplyUPtr = std::unique_ptr<redisReply, ReplyDeleter>;
@@ -70,8 +88,49 @@ namespace reply {
 template <typename T>
 struct ParseTag {};
 
+// Whether `T` refers to the reply's memory, i.e. it's, or it has, a StringView.
+template <typename T, typename = Void<>>
+struct HasStringView : std::false_type {};
+
+template <typename ...Args>
+struct AnyHasStringView : std::false_type {};
+
+template <typename T, typename ...Args>
+struct AnyHasStringView<T, Args...>
+    : std::integral_constant<bool,
+        HasStringView<typename std::decay<T>::type>::value
+            || AnyHasStringView<Args...>::value> {};
+
+template <>
+struct HasStringView<StringView> : std::true_type {};
+
+template <typename T>
+struct HasStringView<Optional<T>> : HasStringView<T> {};
+
+template <typename T, typename U>
+struct HasStringView<std::pair<T, U>> : AnyHasStringView<T, U> {};
+
+template <typename ...Args>
+struct HasStringView<std::tuple<Args...>> : AnyHasStringView<Args...> {};
+
+#ifdef REDIS_PLUS_PLUS_HAS_VARIANT
+
+template <typename ...Args>
+struct HasStringView<Variant<Args...>> : AnyHasStringView<Args...> {};
+
+#endif
+
+template <typename T>
+struct HasStringView<T,
+    typename std::enable_if<IsSequenceContainer<T>::value
+                                || IsAssociativeContainer<T>::value>::type>
+    : AnyHasStringView<typename T::value_type> {};
+
+// Since the reply is freed after parsing, `T` CANNOT refer to the reply's memory.
+// Parse such types, e.g. StringView, with `OwnedReply`, which owns the reply.
 template <typename T>
-inline T parse(redisReply &reply) {
+inline auto parse(redisReply &reply)
+    -> typename std::enable_if<!HasStringView<T>::value, T>::type {
     return parse(ParseTag<T>(), reply);
 }
 
@@ -82,6 +141,10 @@ void parse(ParseTag<void>, redisReply &reply);
 
 std::string parse(ParseTag<std::string>, redisReply &reply);
 
+// NOTE: the returned view refers to the reply's memory, and it's only valid
+// while the reply is alive. `parse<T>` rejects it, and only `OwnedReply` parses it.
+StringView parse(ParseTag<StringView>, redisReply &reply);
+
 long long parse(ParseTag<long long>, redisReply &reply);
 
 double parse(ParseTag<double>, redisReply &reply);
@@ -202,6 +265,75 @@ auto parse_xpending_reply(redisReply &reply, Output output)
 
 }
 
+// A parsed result, which owns the reply. So the result can refer to the reply's memory
+// instead of copying it, e.g. `OwnedReply<std::vector<OptionalStringView>>` for MGET.
+//
+// auto vals = redis.command<OwnedReply<std::vector<OptionalStringView>>>("MGET", "k1", "k2");
+// for (const auto &val : *vals) {
+//     if (val) {
+//         std::cout << *val << std::endl;
+//     }
+// }
+template <typename T>
+class OwnedReply {
+public:
+    // NOTE: `reply` MUST NOT be null.
+    explicit OwnedReply(ReplyUPtr reply);
+
+    OwnedReply(const OwnedReply &) = delete;
+    OwnedReply& operator=(const OwnedReply &) = delete;
+
+    // Moving the result does NOT move the reply's memory, so views are still valid.
+    OwnedReply(OwnedReply &&) = default;
+    OwnedReply& operator=(OwnedReply &&) = default;
+
+    ~OwnedReply() = default;
+
+    T& value() {
+        return _value;
+    }
+
+    const T& value() const {
+        return _value;
+    }
+
+    T& operator*() {
+        return _value;
+    }
+
+    const T& operator*() const {
+        return _value;
+    }
+
+    T* operator->() {
+        return &_value;
+    }
+
+    const T* operator->() const {
+        return &_value;
+    }
+
+    redisReply& reply() const {
+        assert(_reply);
+
+        return *_reply;
+    }
+
+private:
+    // `_reply` MUST be defined before `_value`, since `_value` is parsed from it.
+    ReplyUPtr _reply;
+
+    T _value;
+};
+
+namespace reply {
+
+// Parse the reply. If `T` is `OwnedReply`, it takes the ownership of the reply.
+template <typename T>
+auto parse(ReplyUPtr reply) -> typename std::enable_if<!HasStringView<T>::value, T>::type;
+
+}
+
 // Inline implementations.
 
 namespace reply {
@@ -231,7 +363,7 @@ void to_array(redisReply &reply, Output output) {
             throw ProtoError("Null array element reply");
         }
 
-        *output = parse<typename IterType<Output>::type>(*sub_reply);
+        *output = parse(ParseTag<typename IterType<Output>::type>(), *sub_reply);
 
         ++output;
     }
@@ -260,8 +392,8 @@ void to_flat_array(redisReply &reply, Output output) {
         using Pair = typename IterType<Output>::type;
         using FirstType = typename std::decay<typename Pair::first_type>::type;
         using SecondType = typename std::decay<typename Pair::second_type>::type;
-        *output = std::make_pair(parse<FirstType>(*key_reply),
-                                    parse<SecondType>(*val_reply));
+        *output = std::make_pair(parse(ParseTag<FirstType>(), *key_reply),
+                                    parse(ParseTag<SecondType>(), *val_reply));
 
         ++output;
     }
@@ -290,7 +422,7 @@ std::tuple<T> parse_tuple(redisReply **reply, std::size_t idx) {
         throw ProtoError("Null reply");
     }
 
-    return std::make_tuple(parse<T>(*sub_reply));
+    return std::make_tuple(parse(ParseTag<T>(), *sub_reply));
 }
 
 template <typename T, typename ...Args>
@@ -307,6 +439,8 @@ bool is_parsable(redisReply &reply);
 
 bool is_parsable(ParseTag<std::string>, redisReply &reply);
 
+bool is_parsable(ParseTag<StringView>, redisReply &reply);
+
 bool is_parsable(ParseTag<long long>, redisReply &reply);
 
 bool is_parsable(ParseTag<double>, redisReply &reply);
@@ -357,6 +491,10 @@ inline bool is_parsable(ParseTag<std::string>, redisReply &reply) {
 #endif
 }
 
+inline bool is_parsable(ParseTag<StringView>, redisReply &reply) {
+    return is_parsable(ParseTag<std::string>{}, reply);
+}
+
 inline bool is_parsable(ParseTag<long long>, redisReply &reply) {
     return is_integer(reply);
 }
@@ -567,7 +705,7 @@ Result parse_variant(redisReply &reply) {
         return Result(std::forward<decltype(arg)>(arg));
     };
 
-    return std::visit(return_var, Variant<T>(parse<T>(reply)));
+    return std::visit(return_var, Variant<T>(parse(ParseTag<T>(), reply)));
 }
 
 template <typename Result, typename T, typename ...Args>
@@ -578,7 +716,7 @@ auto parse_variant(redisReply &reply) ->
             return Result(std::forward<decltype(arg)>(arg));
         };
 
-        return std::visit(return_var, Variant<T>(parse<T>(reply)));
+        return std::visit(return_var, Variant<T>(parse(ParseTag<T>(), reply)));
     }
 
     return parse_variant<Result, Args...>(reply);
@@ -635,7 +773,7 @@ Optional<T> parse(ParseTag<Optional<T>>, redisReply &reply) {
 #endif
     }
 
-    return Optional<T>(parse<T>(reply));
+    return Optional<T>(parse(ParseTag<T>(), reply));
 }
 
 template <typename T, typename U>
@@ -668,8 +806,8 @@ std::pair<T, U> parse(ParseTag<std::pair<T, U>>, redisReply &reply) {
         throw ProtoError("Null pair reply");
     }
 
-    return std::make_pair(parse<typename std::decay<T>::type>(*first),
-                            parse<typename std::decay<U>::type>(*second));
+    return std::make_pair(parse(ParseTag<typename std::decay<T>::type>(), *first),
+                            parse(ParseTag<typename std::decay<U>::type>(), *second));
 }
 
 template <typename ...Args>
@@ -716,7 +854,8 @@ T parse(ParseTag<T>, redisReply &reply) {
 
     T container;
 
-    to_array(reply, std::back_inserter(container));
+    auto output = std::back_inserter(container);
+    detail::to_array(typename IsKvPairIter<decltype(output)>::type(), reply, output);
 
     return container;
 }
@@ -733,7 +872,8 @@ T parse(ParseTag<T>, redisReply &reply) {
 
     T container;
 
-    to_array(reply, std::inserter(container, container.end()));
+    auto output = std::inserter(container, container.end());
+    detail::to_array(typename IsKvPairIter<decltype(output)>::type(), reply, output);
 
     return container;
 }
@@ -765,6 +905,9 @@ Cursor parse_scan_reply(redisReply &reply, Output output) {
 
 template <typename Output>
 void to_array(redisReply &reply, Output output) {
+    static_assert(!HasStringView<typename IterType<Output>::type>::value,
+            "StringView refers to the reply's memory, parse it with OwnedReply");
+
 #ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
     if (!is_array(reply) && !is_map(reply) && !is_set(reply)) {
         throw ParseError("ARRAY or MAP or SET", reply);
@@ -812,8 +955,34 @@ auto parse_xpending_reply(redisReply &reply, Output output)
     return std::make_tuple(num, std::move(start), std::move(end));
 }
 
+namespace detail {
+
+template <typename T>
+T parse_owned(ParseTag<T>, ReplyUPtr reply) {
+    return parse<T>(*reply);
+}
+
+template <typename T>
+OwnedReply<T> parse_owned(ParseTag<OwnedReply<T>>, ReplyUPtr reply) {
+    return OwnedReply<T>(std::move(reply));
+}
+
+}
+
+template <typename T>
+auto parse(ReplyUPtr reply) -> typename std::enable_if<!HasStringView<T>::value, T>::type {
+    assert(reply);
+
+    return detail::parse_owned(ParseTag<T>{}, std::move(reply));
+}
+
 }
 
+template <typename T>
+OwnedReply<T>::OwnedReply(ReplyUPtr reply) :
+    _reply(std::move(reply)),
+    _value(reply::parse(reply::ParseTag<T>(), *_reply)) {}
+
 }
 
 }
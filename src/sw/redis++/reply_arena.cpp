@@ -0,0 +1,391 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/reply_arena.h"
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+namespace {
+
+constexpr std::size_t ALIGNMENT = alignof(redisReply);
+
+constexpr std::size_t align(std::size_t size) {
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// Capacity of the first chunk, if the root reply is small.
+constexpr std::size_t MIN_CHUNK_CAPACITY = 1024;
+
+// Chunk capacity doubles until it reaches this limit.
+constexpr std::size_t MAX_CHUNK_CAPACITY = 1024 * 1024;
+
+// Objects larger than this threshold are allocated in dedicated chunks,
+// so that the remaining space of the current chunk is NOT wasted.
+constexpr std::size_t LARGE_OBJECT_SIZE = 64 * 1024;
+
+}
+
+namespace sw {
+
+namespace redis {
+
+struct ReplyArena::Chunk {
+    Chunk *next;
+
+    std::size_t capacity;
+
+    std::size_t used;
+
+    char* data() {
+        return reinterpret_cast<char *>(this) + align(sizeof(Chunk));
+    }
+};
+
+redisReplyObjectFunctions ReplyArena::_functions = {
+    ReplyArena::_create_string,
+    ReplyArena::_create_array,
+    ReplyArena::_create_integer,
+#ifdef REDIS_PLUS_PLUS_REPLY_ARENA_DOUBLE_AND_BOOL
+    ReplyArena::_create_double,
+    ReplyArena::_create_nil,
+    ReplyArena::_create_bool,
+#else
+    ReplyArena::_create_nil,
+#endif
+    ReplyArena::free_reply
+};
+
+void ReplyArena::install(redisReader &reader) {
+    // The reader must not hold any partial reply allocated by the old functions.
+    assert(reader.reply == nullptr);
+
+    reader.fn = &_functions;
+}
+
+ReplyArena* ReplyArena::of(redisReply &reply) {
+    // The root reply is always allocated right after the arena object.
+    return reinterpret_cast<ReplyArena *>(reinterpret_cast<char *>(&reply) - align(sizeof(ReplyArena)));
+}
+
+void ReplyArena::free_reply(void *reply) {
+    if (reply != nullptr) {
+        of(*static_cast<redisReply *>(reply))->release();
+    }
+}
+
+void ReplyArena::free_push_reply(void * /*privdata*/, void *reply) {
+    free_reply(reply);
+}
+
+ReplyArena* ReplyArena::retain() noexcept {
+    _refs.fetch_add(1, std::memory_order_relaxed);
+
+    return this;
+}
+
+void ReplyArena::release() noexcept {
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    // The first chunk holds this object, so save the list before destroying it.
+    auto *chunk = _head;
+
+    this->~ReplyArena();
+
+    while (chunk != nullptr) {
+        auto *next = chunk->next;
+        std::free(chunk);
+        chunk = next;
+    }
+}
+
+ReplyArena* ReplyArena::_create(std::size_t size) {
+    auto arena_size = align(sizeof(ReplyArena));
+    if (size > SIZE_MAX - arena_size - MIN_CHUNK_CAPACITY) {
+        return nullptr;
+    }
+
+    auto *chunk = _create_chunk(std::max(arena_size + size, MIN_CHUNK_CAPACITY));
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+
+    chunk->used = arena_size;
+
+    return new (chunk->data()) ReplyArena(chunk);
+}
+
+auto ReplyArena::_create_chunk(std::size_t capacity) -> Chunk* {
+    capacity = align(capacity);
+    if (capacity > SIZE_MAX - align(sizeof(Chunk))) {
+        return nullptr;
+    }
+
+    auto *chunk = static_cast<Chunk *>(std::malloc(align(sizeof(Chunk)) + capacity));
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+
+    chunk->next = nullptr;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+void* ReplyArena::_allocate(std::size_t size) {
+    if (size > SIZE_MAX - ALIGNMENT) {
+        return nullptr;
+    }
+
+    size = align(size);
+
+    auto *chunk = _current;
+    if (chunk->capacity - chunk->used < size) {
+        chunk = _add_chunk(size);
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+    }
+
+    auto *ptr = chunk->data() + chunk->used;
+    chunk->used += size;
+
+    return ptr;
+}
+
+auto ReplyArena::_add_chunk(std::size_t size) -> Chunk* {
+    Chunk *chunk = nullptr;
+    if (size >= LARGE_OBJECT_SIZE) {
+        chunk = _create_chunk(size);
+    } else {
+        chunk = _create_chunk(std::min(_current->capacity * 2, MAX_CHUNK_CAPACITY));
+    }
+
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+
+    // Link it after the first chunk, since the order doesn't matter.
+    chunk->next = _head->next;
+    _head->next = chunk;
+
+    if (size < LARGE_OBJECT_SIZE) {
+        _current = chunk;
+    }
+
+    return chunk;
+}
+
+redisReply* ReplyArena::_create_object(const redisReadTask *task,
+                                        std::size_t extra,
+                                        ReplyArena *&arena) {
+    assert(task != nullptr);
+
+    arena = nullptr;
+    redisReply *parent = nullptr;
+    if (task->parent == nullptr) {
+        // A new reply tree.
+        if (extra > SIZE_MAX - sizeof(redisReply)) {
+            return nullptr;
+        }
+
+        arena = _create(align(sizeof(redisReply)) + extra);
+    } else {
+        parent = static_cast<redisReply *>(task->parent->obj);
+
+        const auto *root = task->parent;
+        while (root->parent != nullptr) {
+            root = root->parent;
+        }
+
+        arena = of(*static_cast<redisReply *>(root->obj));
+    }
+
+    if (arena == nullptr) {
+        return nullptr;
+    }
+
+    auto *reply = static_cast<redisReply *>(arena->_allocate(sizeof(redisReply)));
+    if (reply == nullptr) {
+        if (parent == nullptr) {
+            arena->release();
+        }
+
+        return nullptr;
+    }
+
+    std::memset(reply, 0, sizeof(redisReply));
+    reply->type = task->type;
+
+    if (parent != nullptr) {
+        assert(parent->element != nullptr
+                && task->idx >= 0
+                && static_cast<std::size_t>(task->idx) < parent->elements);
+
+        parent->element[task->idx] = reply;
+    }
+
+    return reply;
+}
+
+void* ReplyArena::_fail(const redisReadTask *task, ReplyArena &arena) {
+    // A sub reply is freed with the root reply by hiredis, while the root reply
+    // is NOT returned to hiredis, and should be freed here.
+    if (task->parent == nullptr) {
+        arena.release();
+    }
+
+    return nullptr;
+}
+
+char* ReplyArena::_copy_string(ReplyArena &arena, const char *str, std::size_t len) {
+    auto *buf = static_cast<char *>(arena._allocate(len + 1));
+    if (buf == nullptr) {
+        return nullptr;
+    }
+
+    if (len > 0) {
+        std::memcpy(buf, str, len);
+    }
+
+    buf[len] = '\0';
+
+    return buf;
+}
+
+void* ReplyArena::_create_string(const redisReadTask *task, char *str, std::size_t len) {
+    ReplyArena *arena = nullptr;
+    auto *reply = _create_object(task, len + 1, arena);
+    if (reply == nullptr) {
+        return nullptr;
+    }
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    if (task->type == REDIS_REPLY_VERB) {
+        // The first 4 bytes are the type, e.g. "txt:".
+        if (len < 4) {
+            return _fail(task, *arena);
+        }
+
+        std::memcpy(reply->vtype, str, 3);
+        reply->vtype[3] = '\0';
+
+        str += 4;
+        len -= 4;
+    }
+#endif
+
+    reply->str = _copy_string(*arena, str, len);
+    if (reply->str == nullptr) {
+        return _fail(task, *arena);
+    }
+
+    reply->len = len;
+
+    return reply;
+}
+
+void* ReplyArena::_create_array(const redisReadTask *task, std::size_t elements) {
+    if (elements > SIZE_MAX / sizeof(redisReply *)) {
+        return nullptr;
+    }
+
+    auto size = elements * sizeof(redisReply *);
+    ReplyArena *arena = nullptr;
+    auto *reply = _create_object(task, size, arena);
+    if (reply == nullptr) {
+        return nullptr;
+    }
+
+    if (elements > 0) {
+        auto *element = static_cast<redisReply **>(arena->_allocate(size));
+        if (element == nullptr) {
+            return _fail(task, *arena);
+        }
+
+        std::memset(element, 0, size);
+
+        reply->element = element;
+    }
+
+    reply->elements = elements;
+
+    return reply;
+}
+
+void* ReplyArena::_create_integer(const redisReadTask *task, long long value) {
+    ReplyArena *arena = nullptr;
+    auto *reply = _create_object(task, 0, arena);
+    if (reply == nullptr) {
+        return nullptr;
+    }
+
+    reply->integer = value;
+
+    return reply;
+}
+
+#ifdef REDIS_PLUS_PLUS_REPLY_ARENA_DOUBLE_AND_BOOL
+
+void* ReplyArena::_create_double(const redisReadTask *task, double value, char *str, std::size_t len) {
+    ReplyArena *arena = nullptr;
+    auto *reply = _create_object(task, len + 1, arena);
+    if (reply == nullptr) {
+        return nullptr;
+    }
+
+    reply->dval = value;
+
+    // Also keep the original string, as hiredis does.
+    reply->str = _copy_string(*arena, str, len);
+    if (reply->str == nullptr) {
+        return _fail(task, *arena);
+    }
+
+    reply->len = len;
+
+    return reply;
+}
+
+void* ReplyArena::_create_bool(const redisReadTask *task, int value) {
+    ReplyArena *arena = nullptr;
+    auto *reply = _create_object(task, 0, arena);
+    if (reply == nullptr) {
+        return nullptr;
+    }
+
+    reply->integer = (value != 0);
+
+    return reply;
+}
+
+#endif
+
+void* ReplyArena::_create_nil(const redisReadTask *task) {
+    ReplyArena *arena = nullptr;
+
+    return _create_object(task, 0, arena);
+}
+
+}
+
+}
@@ -0,0 +1,130 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_REPLY_ARENA_H
+#define SEWENEW_REDISPLUSPLUS_REPLY_ARENA_H
+
+#include <cstddef>
+#include <atomic>
+#include <hiredis/hiredis.h>
+#include "sw/redis++/reply.h"
+
+// Since hiredis 1.0, redisReplyObjectFunctions always has createDouble and createBool
+// slots, no matter which RESP version is used.
+#if defined(HIREDIS_MAJOR) && HIREDIS_MAJOR >= 1
+
+#define REDIS_PLUS_PLUS_REPLY_ARENA_DOUBLE_AND_BOOL
+
+#endif
+
+namespace sw {
+
+namespace redis {
+
+// An arena, in which a reply tree, i.e. the root reply, all its sub replies and strings,
+// is allocated. Instead of calling malloc for each node, nodes are bump-allocated from
+// a few chunks, whose sizes grow geometrically, and the whole tree is freed by releasing
+// these chunks.
+//
+// Each reply tree has its own arena, since replies might outlive the next reply read
+// from the same connection, e.g. replies of pipeline. The arena is reference counted,
+// so that sub replies can be detached from the tree, e.g. replies of EXEC, and the
+// memory is freed when all of them have been freed.
+class ReplyArena {
+public:
+    ReplyArena(const ReplyArena &) = delete;
+    ReplyArena& operator=(const ReplyArena &) = delete;
+
+    ReplyArena(ReplyArena &&) = delete;
+    ReplyArena& operator=(ReplyArena &&) = delete;
+
+    // Install reply object functions on the reader, so that replies are allocated in arenas.
+    // NOTE: replies read by the reader MUST NOT be freed with `freeReplyObject`.
+    static void install(redisReader &reader);
+
+    // Arena of a root reply, which is read by a reader with arenas installed.
+    static ReplyArena* of(redisReply &reply);
+
+    // Free a root reply, which is read by a reader with arenas installed.
+    static void free_reply(void *reply);
+
+    // Push callback, i.e. redisPushFn, which frees the push reply. hiredis' default
+    // push callback frees it with `freeReplyObject`, and CANNOT be used with arenas.
+    static void free_push_reply(void *privdata, void *reply);
+
+    ReplyArena* retain() noexcept;
+
+    void release() noexcept;
+
+private:
+    struct Chunk;
+
+    explicit ReplyArena(Chunk *head) : _head(head), _current(head) {}
+
+    ~ReplyArena() = default;
+
+    static ReplyArena* _create(std::size_t size);
+
+    static Chunk* _create_chunk(std::size_t capacity);
+
+    // Return nullptr, if it fails to allocate memory.
+    void* _allocate(std::size_t size);
+
+    Chunk* _add_chunk(std::size_t size);
+
+    // Create a reply object of the task, link it to its parent, and return the arena
+    // in which it's allocated. Reserve `extra` bytes, if it's the root reply.
+    static redisReply* _create_object(const redisReadTask *task,
+                                        std::size_t extra,
+                                        ReplyArena *&arena);
+
+    // Clean up when it fails to create a reply object, and return nullptr.
+    static void* _fail(const redisReadTask *task, ReplyArena &arena);
+
+    static char* _copy_string(ReplyArena &arena, const char *str, std::size_t len);
+
+    static void* _create_string(const redisReadTask *task, char *str, std::size_t len);
+
+    static void* _create_array(const redisReadTask *task, std::size_t elements);
+
+    static void* _create_integer(const redisReadTask *task, long long value);
+
+#ifdef REDIS_PLUS_PLUS_REPLY_ARENA_DOUBLE_AND_BOOL
+
+    static void* _create_double(const redisReadTask *task, double value, char *str, std::size_t len);
+
+    static void* _create_bool(const redisReadTask *task, int value);
+
+#endif
+
+    static void* _create_nil(const redisReadTask *task);
+
+    static redisReplyObjectFunctions _functions;
+
+    std::atomic<std::size_t> _refs{1};
+
+    // The first chunk, which also holds this object and the root reply.
+    Chunk *_head = nullptr;
+
+    // The chunk, from which small objects are allocated.
+    Chunk *_current = nullptr;
+};
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_REPLY_ARENA_H
@@ -0,0 +1,248 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#include "sw/redis++/resp.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include "sw/redis++/reply.h"
+
+namespace {
+
+std::size_t count_digits(std::size_t num) {
+    std::size_t digits = 1;
+    while (num >= 10) {
+        num /= 10;
+        ++digits;
+    }
+
+    return digits;
+}
+
+char* write_header(char *buf, char prefix, std::size_t size) {
+    auto digits = count_digits(size);
+
+    *buf++ = prefix;
+
+    auto *end = buf + digits;
+    auto *p = end;
+    do {
+        *--p = static_cast<char>('0' + size % 10);
+        size /= 10;
+    } while (size != 0);
+
+    *end++ = '\r';
+    *end++ = '\n';
+
+    return end;
+}
+
+}
+
+namespace sw {
+
+namespace redis {
+
+namespace resp {
+
+std::size_t header_size(std::size_t size) {
+    // prefix + digits + \r\n
+    return 1 + count_digits(size) + 2;
+}
+
+std::size_t command_size(std::size_t argc, const std::size_t *argv_len) {
+    auto total = header_size(argc);
+    for (std::size_t idx = 0; idx != argc; ++idx) {
+        auto len = argv_len[idx];
+        total += header_size(len) + len + 2;
+    }
+
+    return total;
+}
+
+char* write_array_header(char *buf, std::size_t size) {
+    return write_header(buf, '*', size);
+}
+
+char* write_bulk_header(char *buf, std::size_t size) {
+    return write_header(buf, '$', size);
+}
+
+char* write_command(char *buf, std::size_t argc, const char **argv, const std::size_t *argv_len) {
+    buf = write_array_header(buf, argc);
+
+    for (std::size_t idx = 0; idx != argc; ++idx) {
+        auto len = argv_len[idx];
+        buf = write_bulk_header(buf, len);
+
+        if (len > 0) {
+            std::memcpy(buf, argv[idx], len);
+            buf += len;
+        }
+
+        *buf++ = '\r';
+        *buf++ = '\n';
+    }
+
+    return buf;
+}
+
+OutputBuffer::OutputBuffer(OutputBuffer &&that) noexcept :
+    _data(std::move(that._data)),
+    _size(that._size),
+    _capacity(that._capacity) {
+    that._size = 0;
+    that._capacity = 0;
+}
+
+OutputBuffer& OutputBuffer::operator=(OutputBuffer &&that) noexcept {
+    if (this != &that) {
+        _data = std::move(that._data);
+        _size = that._size;
+        _capacity = that._capacity;
+
+        that._size = 0;
+        that._capacity = 0;
+    }
+
+    return *this;
+}
+
+char* OutputBuffer::prepare(std::size_t len) {
+    if (_capacity - _size < len) {
+        auto capacity = std::max(_capacity * 2, _size + len);
+        std::unique_ptr<char[]> data(new char[capacity]);
+        if (_size > 0) {
+            std::memcpy(data.get(), _data.get(), _size);
+        }
+
+        _data = std::move(data);
+        _capacity = capacity;
+    }
+
+    return _data.get() + _size;
+}
+
+void OutputBuffer::append_command(std::size_t argc, const char **argv, const std::size_t *argv_len) {
+    auto len = command_size(argc, argv_len);
+    auto *begin = prepare(len);
+    auto *end = write_command(begin, argc, argv, argv_len);
+
+    assert(static_cast<std::size_t>(end - begin) == len);
+    (void)end;
+
+    commit(len);
+}
+
+StringView command_name(const char *cmd, std::size_t len) {
+    assert(cmd != nullptr);
+
+    const auto *end = cmd + len;
+
+    // Skip the array header, i.e. *<argc>\r\n.
+    const auto *p = static_cast<const char *>(std::memchr(cmd, '\n', len));
+    if (p == nullptr || ++p == end || *p != '$') {
+        return {};
+    }
+
+    std::size_t arg_len = 0;
+    for (++p; p != end && *p >= '0' && *p <= '9'; ++p) {
+        arg_len = arg_len * 10 + static_cast<std::size_t>(*p - '0');
+    }
+
+    // Skip the trailing \r\n of the bulk string header.
+    if (end - p < 2) {
+        return {};
+    }
+    p += 2;
+
+    if (static_cast<std::size_t>(end - p) < arg_len) {
+        return {};
+    }
+
+    return StringView(p, arg_len);
+}
+
+std::size_t reply_size(const redisReply &reply) {
+    switch (reply.type) {
+    case REDIS_REPLY_STRING:
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    case REDIS_REPLY_VERB:
+#endif
+        // $<len>\r\n<str>\r\n
+        return header_size(reply.len) + reply.len + 2;
+
+    case REDIS_REPLY_STATUS:
+    case REDIS_REPLY_ERROR:
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    case REDIS_REPLY_BIGNUM:
+    case REDIS_REPLY_DOUBLE:
+#endif
+        // +<str>\r\n
+        return 1 + reply.len + 2;
+
+    case REDIS_REPLY_INTEGER: {
+        auto num = reply.integer;
+        std::size_t sign = num < 0 ? 1 : 0;
+        auto abs = num < 0 ? 0 - static_cast<unsigned long long>(num)
+                            : static_cast<unsigned long long>(num);
+
+        // :<num>\r\n
+        return 1 + sign + count_digits(static_cast<std::size_t>(abs)) + 2;
+    }
+
+    case REDIS_REPLY_NIL:
+        // $-1\r\n
+        return 5;
+
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    case REDIS_REPLY_BOOL:
+        // #t\r\n
+        return 4;
+#endif
+
+    default:
+        break;
+    }
+
+    // Aggregate replies, i.e. array, map, set and push.
+    // NOTE: hiredis stores a map of N pairs as 2 * N elements.
+    auto size = header_size(reply.elements);
+    for (std::size_t idx = 0; idx != reply.elements; ++idx) {
+        if (reply.element[idx] != nullptr) {
+            size += reply_size(*reply.element[idx]);
+        }
+    }
+
+    return size;
+}
+
+void OutputBuffer::append(const char *data, std::size_t len) {
+    if (len == 0) {
+        return;
+    }
+
+    auto *buf = prepare(len);
+    std::memcpy(buf, data, len);
+    commit(len);
+}
+
+}
+
+}
+
+}
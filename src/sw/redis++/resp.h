@@ -0,0 +1,123 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_RESP_H
+#define SEWENEW_REDISPLUSPLUS_RESP_H
+
+#include <cstddef>
+#include <memory>
+#include <hiredis/hiredis.h>
+#include "sw/redis++/utils.h"
+
+namespace sw {
+
+namespace redis {
+
+// Encode commands with RESP, i.e. *<argc>\r\n$<len>\r\n<arg>\r\n...
+// without calling hiredis' redisFormatCommandArgv.
+namespace resp {
+
+// Max length of an array header, i.e. *<number>\r\n, or a bulk string header, i.e. $<number>\r\n.
+constexpr std::size_t MAX_HEADER_LENGTH = 24;
+
+// Arguments whose length is no less than this threshold are NOT copied into the
+// output buffer, instead, they're sent with scatter/gather I/O, i.e. writev.
+constexpr std::size_t LARGE_ARG_LENGTH = 16 * 1024;
+
+// Exact length of the array header, i.e. *<size>\r\n, or the bulk string header, i.e. $<size>\r\n.
+std::size_t header_size(std::size_t size);
+
+// Exact length of the encoded command.
+std::size_t command_size(std::size_t argc, const std::size_t *argv_len);
+
+// Write the array header, i.e. *<size>\r\n, and return the end of the written data.
+char* write_array_header(char *buf, std::size_t size);
+
+// Write the bulk string header, i.e. $<size>\r\n, and return the end of the written data.
+char* write_bulk_header(char *buf, std::size_t size);
+
+// Write the encoded command, and return the end of the written data.
+// The `buf` MUST have at least `command_size(argc, argv_len)` bytes.
+char* write_command(char *buf, std::size_t argc, const char **argv, const std::size_t *argv_len);
+
+// Name of an encoded command, i.e. the first argument. Return an empty view,
+// if the command is malformed.
+StringView command_name(const char *cmd, std::size_t len);
+
+// Length of the reply encoded with RESP. Since hiredis does not expose the number of bytes
+// it reads, it's calculated with the parsed reply, and might be slightly different from
+// the received data, e.g. the type of RESP3 reply is lost when it's parsed as a string.
+std::size_t reply_size(const redisReply &reply);
+
+// A reusable buffer for encoded commands. Unlike std::string or std::vector<char>,
+// it never initializes the memory before the data is written.
+class OutputBuffer {
+public:
+    OutputBuffer() = default;
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer& operator=(const OutputBuffer &) = delete;
+
+    OutputBuffer(OutputBuffer &&that) noexcept;
+    OutputBuffer& operator=(OutputBuffer &&that) noexcept;
+
+    ~OutputBuffer() = default;
+
+    // Ensure there's at least `len` bytes of free space, and return the beginning of the free space.
+    // Call `commit` after the data has been written.
+    char* prepare(std::size_t len);
+
+    void commit(std::size_t len) {
+        _size += len;
+    }
+
+    // Append an encoded command.
+    void append_command(std::size_t argc, const char **argv, const std::size_t *argv_len);
+
+    void append(const char *data, std::size_t len);
+
+    const char* data() const {
+        return _data.get();
+    }
+
+    std::size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    // Clear the data, but keep the memory for reuse.
+    void clear() {
+        _size = 0;
+    }
+
+private:
+    std::unique_ptr<char[]> _data;
+
+    std::size_t _size = 0;
+
+    std::size_t _capacity = 0;
+};
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_RESP_H
@@ -218,6 +218,15 @@ Connection Sentinel::slave(const std::string &master_name, const ConnectionOptio
                 std::swap(*(slaves.begin()), *slave_iter);
             }
 
+            if (_sentinel_opts.node_label) {
+                // Try local replicas first. The partition is stable, so the given node
+                // is still tried first, if it's a local one.
+                std::stable_partition(slaves.begin(), slaves.end(),
+                        [this](const Node &node) {
+                            return _sentinel_opts.node_label(node) == _sentinel_opts.local_label;
+                        });
+            }
+
             for (const auto &slave : slaves) {
                 try {
                     slave_node = slave;
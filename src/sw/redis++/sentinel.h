@@ -17,6 +17,7 @@
 #ifndef SEWENEW_REDISPLUSPLUS_SENTINEL_H
 #define SEWENEW_REDISPLUSPLUS_SENTINEL_H
 
+#include <functional>
 #include <string>
 #include <list>
 #include <vector>
@@ -51,6 +52,12 @@ struct SentinelOptions {
     tls::TlsOptions tls;
 
     int resp = 2;
+
+    // Label of a node, e.g. its availability zone. If it's set, replicas labeled with
+    // `local_label` are tried before other replicas, when connecting to a slave.
+    std::function<std::string (const Node &)> node_label;
+
+    std::string local_label;
 };
 
 class Sentinel {
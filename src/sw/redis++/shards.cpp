@@ -15,11 +15,57 @@
  *************************************************************************/
 
 #include "sw/redis++/shards.h"
+#include <cstring>
+
+namespace {
+
+using sw::redis::StringView;
+
+// Max slot, i.e. 16383, which is also the mask of CRC16.
+const std::size_t MAX_SLOT = 16383;
+
+// Get the part of the key to be hashed, i.e. the hash tag, or the whole key.
+// See https://redis.io/topics/cluster-spec for details.
+StringView hash_tag(const StringView &key) {
+    const auto *k = key.data();
+    auto len = key.size();
+
+    // Search the first occurrence of '{'. memchr is usually vectorized.
+    const auto *s = static_cast<const char *>(std::memchr(k, '{', len));
+    if (s == nullptr) {
+        return key;
+    }
+
+    // '{' found? Check if we have the corresponding '}'.
+    ++s;
+    const auto *e = static_cast<const char *>(std::memchr(s, '}', len - (s - k)));
+
+    // No '}' or nothing between {} ? Hash the whole key.
+    if (e == nullptr || e == s) {
+        return key;
+    }
+
+    return StringView(s, e - s);
+}
+
+}
 
 namespace sw {
 
 namespace redis {
 
+Slot key_slot(const StringView &key) {
+    auto tag = hash_tag(key);
+
+    return crc16(tag.data(), static_cast<int>(tag.size())) & MAX_SLOT;
+}
+
+void key_slots(const StringView *keys, std::size_t num, Slot *slots) {
+    for (std::size_t idx = 0; idx != num; ++idx) {
+        slots[idx] = key_slot(keys[idx]);
+    }
+}
+
 RedirectionError::RedirectionError(const std::string &msg): ReplyError(msg) {
     std::tie(_slot, _node) = _parse_error(msg);
 }
@@ -19,7 +19,9 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include "sw/redis++/errors.h"
+#include "sw/redis++/utils.h"
 
 namespace sw {
 
@@ -36,6 +38,29 @@ inline bool operator<(const SlotRange &lhs, const SlotRange &rhs) {
     return lhs.max < rhs.max;
 }
 
+// Hash slot of the key, i.e. CRC16 of the key, or its hash tag if any, modulo 16384.
+Slot key_slot(const StringView &key);
+
+// Hash slots of `num` keys, and write them to `slots`.
+void key_slots(const StringView *keys, std::size_t num, Slot *slots);
+
+// Hash slots of keys in range [first, last), and write them to the output iterator.
+template <typename Input, typename Output>
+void key_slots(Input first, Input last, Output output) {
+    std::vector<StringView> keys;
+    for (auto iter = first; iter != last; ++iter) {
+        keys.emplace_back(*iter);
+    }
+
+    std::vector<Slot> slots(keys.size());
+    key_slots(keys.data(), keys.size(), slots.data());
+
+    for (auto slot : slots) {
+        *output = slot;
+        ++output;
+    }
+}
+
 struct Node {
     std::string host;
     int port;
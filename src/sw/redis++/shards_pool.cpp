@@ -15,6 +15,7 @@
  *************************************************************************/
 
 #include "sw/redis++/shards_pool.h"
+#include <algorithm>
 #include <unordered_set>
 #include "sw/redis++/errors.h"
 
@@ -22,6 +23,14 @@ namespace sw {
 
 namespace redis {
 
+namespace {
+
+// A reader only holds a table while copying a pool out of it. So it's safe to free
+// a table, which has been retired for this period.
+const auto SLOT_TABLE_GRACE_PERIOD = std::chrono::seconds(1);
+
+}
+
 const std::size_t ShardsPool::SHARDS;
 
 ShardsPool::ShardsPool(const ConnectionPoolOptions &pool_opts,
@@ -38,9 +47,13 @@ ShardsPool::ShardsPool(const ConnectionPoolOptions &pool_opts,
 
     Connection connection(_connection_opts);
 
-    _shards = _cluster_slots(connection);
+    _shards = _cluster_slots(connection, _select_per_request() ? &_replicas : nullptr);
 
-    _init_pool(_shards);
+    _init_pool(_shards, _replicas);
+
+    _publish(_build_slot_table());
+
+    _last_update = std::chrono::steady_clock::now();
 
     _worker = std::thread([this]() { this->_run(); });
 }
@@ -86,22 +99,59 @@ ConnectionPoolSPtr ShardsPool::fetch(const Node &node) {
     return iter->second;
 }
 
+ConnectionPoolSPtr ShardsPool::fetch(Slot slot) {
+    return _fetch(slot);
+}
+
 void ShardsPool::update() {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (_updating) {
+        // Another thread is updating the slot-node mapping, e.g. lots of threads get
+        // IoError at the same time. Wait for its result instead of sending another
+        // CLUSTER SLOTS command, which might overload the unhealthy cluster.
+        auto generation = _generation;
+        _update_cv.wait(lock, [this, generation]() { return this->_generation != generation; });
+
+        if (!_update_ok) {
+            throw Error("Failed to update shards info");
+        }
+
+        return;
+    }
+
+    _updating = true;
+
+    lock.unlock();
+
+    try {
+        _update();
+    } catch (...) {
+        _finish_update(false);
+        throw;
+    }
+
+    _finish_update(true);
+}
+
+void ShardsPool::_update() {
     // My might send command to a removed node.
     // Try at most 3 times from the current shard masters and finally with the user given connection options.
     for (auto idx = 0; idx < 4; ++idx) {
         try {
             Shards shards;
+            Replicas replicas;
+            auto *replicas_ptr = _select_per_request() ? &replicas : nullptr;
             if (idx < 3) {
                 // Randomly pick a connection.
                 auto pool = fetch();
                 assert(pool);
                 SafeConnection safe_connection(*pool);
-                shards = _cluster_slots(safe_connection.connection());
+                shards = _cluster_slots(safe_connection.connection(), replicas_ptr);
             }
             else {
                 Connection connection(_connection_opts);
-                shards = _cluster_slots(connection);
+                shards = _cluster_slots(connection, replicas_ptr);
             }
 
 
@@ -110,12 +160,18 @@ void ShardsPool::update() {
                 nodes.insert(shard.second);
             }
 
+            for (const auto &replica : replicas) {
+                nodes.insert(replica.second.begin(), replica.second.end());
+            }
+
             std::lock_guard<std::mutex> lock(_mutex);
 
             // TODO: If shards is unchanged, no need to update, and return immediately.
 
             _shards = std::move(shards);
 
+            _replicas = std::move(replicas);
+
             // Remove non-existent nodes.
             for (auto iter = _pools.begin(); iter != _pools.end(); ) {
                 if (nodes.find(iter->first) == nodes.end()) {
@@ -134,6 +190,12 @@ void ShardsPool::update() {
                 }
             }
 
+            // Readers holding the old table can still use it, and pools of removed nodes
+            // are destroyed when the old table is reclaimed.
+            _publish(_build_slot_table());
+
+            _last_update = std::chrono::steady_clock::now();
+
             // Update successfully.
             return;
         } catch (const Error &) {
@@ -144,6 +206,52 @@ void ShardsPool::update() {
     throw Error("Failed to update shards info");
 }
 
+void ShardsPool::update(Slot slot, const Node &node) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const auto &table = _current_table;
+        assert(table);
+
+        if (slot < table->pools.size()) {
+            auto iter = _pools.find(node);
+            if (iter == _pools.end()) {
+                iter = _add_node(node);
+            }
+
+            // Other threads might have already updated it with the same MOVED error.
+            if (table->pools[slot] != iter->second
+                    || (!table->replicas.empty() && table->replicas[slot])) {
+                std::unique_ptr<SlotTable> new_table(new SlotTable(*table));
+                new_table->pools[slot] = iter->second;
+                if (!new_table->replicas.empty()) {
+                    // Stop selecting among the old replicas.
+                    new_table->replicas[slot].reset();
+                }
+
+                _publish(std::move(new_table));
+            }
+        }
+
+        // `_shards` is NOT updated, and it will be refreshed by the full update.
+        _update_scheduled = true;
+    }
+
+    _cv.notify_one();
+}
+
+void ShardsPool::_finish_update(bool ok) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _updating = false;
+        _update_ok = ok;
+        ++_generation;
+    }
+
+    _update_cv.notify_all();
+}
+
 ConnectionOptions ShardsPool::connection_options(const StringView &key) {
     auto slot = _slot(key);
 
@@ -165,27 +273,47 @@ Shards ShardsPool::shards() {
 std::vector<ConnectionPoolSPtr> ShardsPool::pools() {
     std::lock_guard<std::mutex> lock(_mutex);
 
+    // Only return pools of nodes in the slot-node mapping, i.e. one node for each slot range,
+    // even if other replicas are also connected.
+    std::unordered_set<Node, NodeHash> visited;
     std::vector<ConnectionPoolSPtr> nodes;
-    nodes.reserve(_pools.size());
-    for (const auto &pool : _pools) {
-        nodes.push_back(pool.second);
+    for (const auto &shard : _shards) {
+        const auto &node = shard.second;
+        if (!visited.insert(node).second) {
+            continue;
+        }
+
+        auto iter = _pools.find(node);
+        if (iter != _pools.end()) {
+            nodes.push_back(iter->second);
+        }
     }
 
     return nodes;
 }
 
-void ShardsPool::_init_pool(const Shards &shards) {
+void ShardsPool::_init_pool(const Shards &shards, const Replicas &replicas) {
     for (const auto &shard : shards) {
-        _add_node(shard.second);
+        if (_pools.find(shard.second) == _pools.end()) {
+            _add_node(shard.second);
+        }
+    }
+
+    for (const auto &replica : replicas) {
+        for (const auto &node : replica.second) {
+            if (_pools.find(node) == _pools.end()) {
+                _add_node(node);
+            }
+        }
     }
 }
 
-Shards ShardsPool::_cluster_slots(Connection &connection) const {
+Shards ShardsPool::_cluster_slots(Connection &connection, Replicas *replicas) const {
     auto reply = _cluster_slots_command(connection);
 
     assert(reply);
 
-    return _parse_reply(*reply);
+    return _parse_reply(*reply, replicas);
 }
 
 ReplyUPtr ShardsPool::_cluster_slots_command(Connection &connection) const {
@@ -194,7 +322,7 @@ ReplyUPtr ShardsPool::_cluster_slots_command(Connection &connection) const {
     return connection.recv();
 }
 
-Shards ShardsPool::_parse_reply(redisReply &reply) const {
+Shards ShardsPool::_parse_reply(redisReply &reply, Replicas *replicas) const {
     if (!reply::is_array(reply)) {
         throw ProtoError("Expect ARRAY reply");
     }
@@ -210,7 +338,18 @@ Shards ShardsPool::_parse_reply(redisReply &reply) const {
             throw ProtoError("Null slot info");
         }
 
-        shards.emplace(_parse_slot_info(*sub_reply));
+        auto slot_info = _parse_slot_info(*sub_reply);
+        auto &nodes = slot_info.second;
+
+        assert(!nodes.empty());
+
+        // Randomly pick a node, which is used if replicas are NOT selected per request,
+        // or the slot is patched by a MOVED error.
+        shards.emplace(slot_info.first, nodes[_random(0, nodes.size() - 1)]);
+
+        if (replicas != nullptr) {
+            replicas->emplace(slot_info.first, std::move(nodes));
+        }
     }
 
     return shards;
@@ -243,7 +382,7 @@ Node ShardsPool::_parse_node(redisReply *reply) const {
     return {host, port};
 }
 
-std::pair<SlotRange, Node> ShardsPool::_parse_slot_info(redisReply &reply) const {
+auto ShardsPool::_parse_slot_info(redisReply &reply) const -> std::pair<SlotRange, std::vector<Node>> {
     // Slot info is an array reply: min slot, max slot, master node, [slave nodes]
     if (reply.elements < 3 || reply.element == nullptr) {
         throw ProtoError("Invalid slot info");
@@ -262,7 +401,7 @@ std::pair<SlotRange, Node> ShardsPool::_parse_slot_info(redisReply &reply) const
     switch (_role) {
     case Role::MASTER:
         // Return master node, i.e. `reply.element[2]`.
-        return std::make_pair(slot_range, _parse_node(reply.element[2]));
+        return std::make_pair(slot_range, std::vector<Node>{_parse_node(reply.element[2])});
 
     case Role::SLAVE: {
         auto size = reply.elements;
@@ -270,10 +409,13 @@ std::pair<SlotRange, Node> ShardsPool::_parse_slot_info(redisReply &reply) const
             throw Error("no slave node available");
         }
 
-        // Randomly pick a slave node.
-        auto *slave_node_reply = reply.element[_random(3, size - 1)];
+        std::vector<Node> slaves;
+        slaves.reserve(size - 3);
+        for (std::size_t idx = 3; idx != size; ++idx) {
+            slaves.push_back(_parse_node(reply.element[idx]));
+        }
 
-        return std::make_pair(slot_range, _parse_node(slave_node_reply));
+        return std::make_pair(slot_range, _preferred_nodes(std::move(slaves)));
     }
 
     default:
@@ -281,34 +423,76 @@ std::pair<SlotRange, Node> ShardsPool::_parse_slot_info(redisReply &reply) const
     }
 }
 
-Slot ShardsPool::_slot(const StringView &key) const {
-    // The following code is copied from: https://redis.io/topics/cluster-spec
-    // And I did some minor changes.
+std::vector<Node> ShardsPool::_preferred_nodes(std::vector<Node> nodes) const {
+    if (!_cluster_opts.node_label) {
+        return nodes;
+    }
 
-    const auto *k = key.data();
-    auto keylen = static_cast<int>(key.size());
+    std::vector<Node> preferred;
+    for (const auto &node : nodes) {
+        if (_cluster_opts.node_label(node) == _cluster_opts.local_label) {
+            preferred.push_back(node);
+        }
+    }
+
+    if (preferred.empty()) {
+        // No local replica, fall back to all replicas.
+        return nodes;
+    }
+
+    return preferred;
+}
+
+const ConnectionPoolSPtr& ShardsPool::_select(const ReplicaGroup &group) const {
+    assert(!group.empty());
+
+    auto size = group.size();
+    if (size == 1) {
+        return group.front();
+    }
+
+    switch (_cluster_opts.replica_policy) {
+    case ReplicaPolicy::LEAST_OUTSTANDING: {
+        // Start from a random replica, so that ties are broken randomly.
+        auto start = _random(0, size - 1);
+        auto best = start;
+        auto min_outstanding = group[start]->outstanding();
+        for (std::size_t idx = 1; idx != size && min_outstanding > 0; ++idx) {
+            auto cur = (start + idx) % size;
+            auto outstanding = group[cur]->outstanding();
+            if (outstanding < min_outstanding) {
+                best = cur;
+                min_outstanding = outstanding;
+            }
+        }
 
-    // start-end indexes of { and }.
-    int s = 0;
-    int e = 0;
+        return group[best];
+    }
 
-    // Search the first occurrence of '{'.
-    for (s = 0; s < keylen; s++)
-        if (k[s] == '{') break;
+    case ReplicaPolicy::POWER_OF_TWO_CHOICES: {
+        auto first = _random(0, size - 1);
+        auto second = _random(0, size - 2);
+        if (second >= first) {
+            ++second;
+        }
 
-    // No '{' ? Hash the whole key. This is the base case.
-    if (s == keylen) return crc16(k, keylen) & SHARDS;
+        auto cost = [](const ConnectionPool &pool) {
+            // Plus one, so that an idle replica with a high latency, and a busy replica
+            // without any latency sample, are still comparable.
+            return static_cast<double>(pool.latency().count() + 1)
+                * static_cast<double>(pool.outstanding() + 1);
+        };
 
-    // '{' found? Check if we have the corresponding '}'.
-    for (e = s + 1; e < keylen; e++)
-        if (k[e] == '}') break;
+        return cost(*group[first]) <= cost(*group[second]) ? group[first] : group[second];
+    }
 
-    // No '}' or nothing between {} ? Hash the whole key.
-    if (e == keylen || e == s + 1) return crc16(k, keylen) & SHARDS;
+    default:
+        return group[_random(0, size - 1)];
+    }
+}
 
-    // If we are here there is both a { and a } on its right. Hash
-    // what is in the middle between { and }.
-    return crc16(k + s + 1, e - s - 1) & SHARDS;
+Slot ShardsPool::_slot(const StringView &key) const {
+    return key_slot(key);
 }
 
 Slot ShardsPool::_slot() const {
@@ -323,32 +507,29 @@ std::size_t ShardsPool::_random(std::size_t min, std::size_t max) const {
     return uniform_dist(engine);
 }
 
-ConnectionPoolSPtr& ShardsPool::_get_pool(Slot slot) {
-    auto shards_iter = _shards.lower_bound(SlotRange{slot, slot});
-    if (shards_iter == _shards.end() || slot < shards_iter->first.min) {
-        throw SlotUncoveredError(slot);
-    }
+ConnectionPoolSPtr ShardsPool::_fetch(Slot slot) {
+    // The table won't be freed while we're using it, see `_publish`.
+    const auto *table = _slot_table.load(std::memory_order_acquire);
 
-    const auto &node = shards_iter->second;
+    assert(table && slot < table->pools.size());
 
-    auto node_iter = _pools.find(node);
-    if (node_iter == _pools.end()) {
-        throw SlotUncoveredError(slot);
+    if (!table->replicas.empty()) {
+        const auto &group = table->replicas[slot];
+        if (group) {
+            return _select(*group);
+        }
     }
 
-    return node_iter->second;
-}
-
-ConnectionPoolSPtr ShardsPool::_fetch(Slot slot) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    const auto &pool = table->pools[slot];
+    if (!pool) {
+        throw SlotUncoveredError(slot);
+    }
 
-    return _get_pool(slot);
+    return pool;
 }
 
 ConnectionOptions ShardsPool::_connection_options(Slot slot) {
-    std::lock_guard<std::mutex> lock(_mutex);
-
-    auto &pool = _get_pool(slot);
+    auto pool = _fetch(slot);
 
     assert(pool);
 
@@ -365,7 +546,80 @@ auto ShardsPool::_add_node(const Node &node) -> NodeMap::iterator {
         opts.readonly = true;
     }
 
-    return _pools.emplace(node, std::make_shared<ConnectionPool>(_pool_opts, opts)).first;
+    auto pool = std::make_shared<ConnectionPool>(_pool_opts, opts);
+
+    // Only track the load, which is used to select replicas.
+    if (_select_per_request()) {
+        pool->track_load(_cluster_opts.replica_policy == ReplicaPolicy::LEAST_OUTSTANDING ?
+                LoadTracking::OUTSTANDING : LoadTracking::OUTSTANDING_AND_LATENCY);
+    }
+
+    return _pools.emplace(node, std::move(pool)).first;
+}
+
+auto ShardsPool::_build_slot_table() const -> SlotTableUPtr {
+    std::unique_ptr<SlotTable> table(new SlotTable);
+    table->pools.resize(SHARDS + 1);
+    for (const auto &shard : _shards) {
+        auto iter = _pools.find(shard.second);
+        if (iter == _pools.end()) {
+            // Leave these slots uncovered.
+            continue;
+        }
+
+        const auto &range = shard.first;
+        auto max_slot = std::min<Slot>(range.max, SHARDS);
+        for (auto slot = range.min; slot <= max_slot; ++slot) {
+            table->pools[slot] = iter->second;
+        }
+    }
+
+    if (_select_per_request()) {
+        table->replicas.resize(SHARDS + 1);
+        for (const auto &replica : _replicas) {
+            auto group = std::make_shared<ReplicaGroup>();
+            for (const auto &node : replica.second) {
+                auto iter = _pools.find(node);
+                if (iter != _pools.end()) {
+                    group->push_back(iter->second);
+                }
+            }
+
+            if (group->empty()) {
+                continue;
+            }
+
+            ReplicaGroupSPtr shared_group = std::move(group);
+            const auto &range = replica.first;
+            auto max_slot = std::min<Slot>(range.max, SHARDS);
+            for (auto slot = range.min; slot <= max_slot; ++slot) {
+                table->replicas[slot] = shared_group;
+            }
+        }
+    }
+
+    return SlotTableUPtr(std::move(table));
+}
+
+void ShardsPool::_publish(SlotTableUPtr table) {
+    assert(table);
+
+    auto now = std::chrono::steady_clock::now();
+
+    // Tables are retired in order, and only free those out of the grace period.
+    auto iter = _retired_tables.begin();
+    while (iter != _retired_tables.end() && now - iter->first >= SLOT_TABLE_GRACE_PERIOD) {
+        ++iter;
+    }
+    _retired_tables.erase(_retired_tables.begin(), iter);
+
+    _slot_table.store(table.get(), std::memory_order_release);
+
+    if (_current_table) {
+        _retired_tables.emplace_back(now, std::move(_current_table));
+    }
+
+    _current_table = std::move(table);
 }
 
 void ShardsPool::_run() {
@@ -374,10 +628,22 @@ void ShardsPool::_run() {
 
         if (_cv.wait_for(lock,
                     _cluster_opts.slot_map_refresh_interval,
-                    [this]() { return this->_stop; })) {
-            break;
+                    [this]() { return this->_stop || this->_update_scheduled; })) {
+            if (_stop) {
+                break;
+            }
+
+            // Full update is scheduled by MOVED error. Rate-limit it, so that MOVED errors
+            // received during resharding are coalesced into one update.
+            if (_cv.wait_until(lock,
+                        _last_update + _cluster_opts.slot_map_min_refresh_interval,
+                        [this]() { return this->_stop; })) {
+                break;
+            }
         }
 
+        _update_scheduled = false;
+
         lock.unlock();
 
         try {
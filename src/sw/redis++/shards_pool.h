@@ -17,9 +17,11 @@
 #ifndef SEWENEW_REDISPLUSPLUS_SHARDS_POOL_H
 #define SEWENEW_REDISPLUSPLUS_SHARDS_POOL_H
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
@@ -35,9 +37,41 @@ namespace sw {
 
 namespace redis {
 
+enum class ReplicaPolicy {
+    // Randomly pick a replica for each slot range, when the slot map is updated.
+    RANDOM = 0,
+
+    // For each request, pick the replica with the fewest outstanding requests.
+    LEAST_OUTSTANDING,
+
+    // For each request, randomly pick two replicas, and use the one with the lower cost,
+    // i.e. EWMA latency multiplied by the number of outstanding requests plus one.
+    POWER_OF_TWO_CHOICES
+};
+
 struct ClusterOptions {
     // Automatically update slot map every `slot_map_refresh_interval`.
     std::chrono::milliseconds slot_map_refresh_interval = std::chrono::seconds(10);
+
+    // When getting a MOVED error, only the redirected slot is updated immediately, and
+    // a full update of slot map is scheduled in background. Full updates scheduled in
+    // this interval are coalesced into one.
+    std::chrono::milliseconds slot_map_min_refresh_interval = std::chrono::seconds(1);
+
+    // If true, MGET, MSET and DEL with keys belonging to different slots are split
+    // into sub-commands by slot, instead of failing with CROSSSLOT error. Sub-commands
+    // are sent to nodes in parallel, and results are reassembled in input order.
+    // NOTE: in this case, these commands are NOT atomic.
+    bool cross_slot_fanout = false;
+
+    // How to pick a replica of a slot, only used with `Role::SLAVE`.
+    ReplicaPolicy replica_policy = ReplicaPolicy::RANDOM;
+
+    // Label of a node, e.g. its availability zone. If it's set, only replicas labeled
+    // with `local_label` are used, unless a slot has no such replica.
+    std::function<std::string (const Node &)> node_label;
+
+    std::string local_label;
 };
 
 class ShardsPool {
@@ -64,8 +98,26 @@ public:
     // Fetch a connection by node.
     ConnectionPoolSPtr fetch(const Node &node);
 
+    // Fetch a connection by slot.
+    ConnectionPoolSPtr fetch(Slot slot);
+
+    // Get slot by key.
+    Slot slot(const StringView &key) const {
+        return _slot(key);
+    }
+
+    const ClusterOptions& cluster_options() const {
+        return _cluster_opts;
+    }
+
+    // Update the slot-node mapping with CLUSTER SLOTS command. If another thread is
+    // updating it, wait for the result of that update, i.e. single-flight.
     void update();
 
+    // Update the node of a single slot, e.g. with a MOVED error, and schedule
+    // a rate-limited full update in background.
+    void update(Slot slot, const Node &node);
+
     ConnectionOptions connection_options(const StringView &key);
 
     ConnectionOptions connection_options();
@@ -74,20 +126,43 @@ public:
 
     std::vector<ConnectionPoolSPtr> pools();
 
+    // Hook to collect metrics, or null if metrics is disabled.
+    // NOTE: connection options never change after construction, so no lock is needed.
+    const MetricsHookSPtr& metrics() const {
+        return _connection_opts.metrics;
+    }
+
 private:
-    void _init_pool(const Shards &shards);
+    // Replicas of each slot range, only used with `Role::SLAVE`.
+    using Replicas = std::map<SlotRange, std::vector<Node>>;
 
-    Shards _cluster_slots(Connection &connection) const;
+    void _init_pool(const Shards &shards, const Replicas &replicas);
+
+    // Get the slot-node mapping, and if `replicas` is NOT null, also get replicas
+    // of each slot range.
+    Shards _cluster_slots(Connection &connection, Replicas *replicas) const;
 
     ReplyUPtr _cluster_slots_command(Connection &connection) const;
 
-    Shards _parse_reply(redisReply &reply) const;
+    Shards _parse_reply(redisReply &reply, Replicas *replicas) const;
 
     Slot _parse_slot(redisReply *reply) const;
 
     Node _parse_node(redisReply *reply) const;
 
-    std::pair<SlotRange, Node> _parse_slot_info(redisReply &reply) const;
+    // Return the slot range, and candidate nodes, i.e. the master node,
+    // or the preferred replicas.
+    std::pair<SlotRange, std::vector<Node>> _parse_slot_info(redisReply &reply) const;
+
+    // Keep nodes labeled with the local label, if there's any.
+    std::vector<Node> _preferred_nodes(std::vector<Node> nodes) const;
+
+    using ReplicaGroup = std::vector<ConnectionPoolSPtr>;
+
+    using ReplicaGroupSPtr = std::shared_ptr<const ReplicaGroup>;
+
+    // Pick a replica with `ClusterOptions::replica_policy`.
+    const ConnectionPoolSPtr& _select(const ReplicaGroup &group) const;
 
     // Get slot by key.
     std::size_t _slot(const StringView &key) const;
@@ -98,8 +173,6 @@ private:
     // Get a random number between [min, max]
     std::size_t _random(std::size_t min, std::size_t max) const;
 
-    ConnectionPoolSPtr& _get_pool(Slot slot);
-
     ConnectionPoolSPtr _fetch(Slot slot);
 
     ConnectionOptions _connection_options(Slot slot);
@@ -108,6 +181,40 @@ private:
 
     NodeMap::iterator _add_node(const Node &node);
 
+    // Flat routing table, i.e. slot -> connection pool, and the pool is null if the slot
+    // is not covered. A table is immutable once published, and it's published with an
+    // atomic raw pointer, so that looking up a slot takes neither lock nor reference counting.
+    struct SlotTable {
+        std::vector<ConnectionPoolSPtr> pools;
+
+        // Slot -> replicas, from which a pool is picked for each request. It's empty,
+        // if replicas are NOT selected per request, and an item is null, if the slot
+        // has been patched by a MOVED error, i.e. `pools` should be used.
+        std::vector<ReplicaGroupSPtr> replicas;
+    };
+
+    using SlotTableUPtr = std::unique_ptr<const SlotTable>;
+
+    // Whether a replica is selected for each request, instead of once per update.
+    bool _select_per_request() const {
+        return _role == Role::SLAVE && _cluster_opts.replica_policy != ReplicaPolicy::RANDOM;
+    }
+
+    // Build a routing table with `_shards`, `_replicas` and `_pools`.
+    // NOTE: `_mutex` should be held, if the worker thread has been started.
+    SlotTableUPtr _build_slot_table() const;
+
+    // Replace the routing table, and retire the old one, since readers might still use it.
+    // Tables retired for a while are reclaimed, i.e. readers have moved to newer tables.
+    // NOTE: `_mutex` should be held, if the worker thread has been started.
+    void _publish(SlotTableUPtr table);
+
+    // Send CLUSTER SLOTS command, and update the slot-node mapping.
+    void _update();
+
+    // Wake up threads waiting for the update.
+    void _finish_update(bool ok);
+
     void _run();
 
     void _do_async_update();
@@ -118,10 +225,39 @@ private:
 
     Shards _shards;
 
+    // Only used if a replica is selected per request.
+    Replicas _replicas;
+
     NodeMap _pools;
 
+    // Loaded by `_fetch` without lock, and it points to `_current_table`.
+    std::atomic<const SlotTable *> _slot_table{nullptr};
+
+    SlotTableUPtr _current_table;
+
+    // Old tables with the time they're retired, and they're freed by a later `_publish`,
+    // or when the pool is destroyed. Pools of removed nodes are released with these tables.
+    std::vector<std::pair<std::chrono::steady_clock::time_point, SlotTableUPtr>> _retired_tables;
+
     bool _stop = false;
 
+    // Whether a full update has been scheduled by `update(slot, node)`.
+    bool _update_scheduled = false;
+
+    std::chrono::steady_clock::time_point _last_update;
+
+    // Whether a thread is updating the slot-node mapping with `_update`.
+    bool _updating = false;
+
+    // Result of the last finished update.
+    bool _update_ok = true;
+
+    // Number of finished updates. Threads waiting for the update in flight
+    // wake up when it changes.
+    std::size_t _generation = 0;
+
+    std::condition_variable _update_cv;
+
     std::thread _worker;
 
     std::condition_variable _cv;
@@ -137,6 +273,8 @@ private:
 
 using ShardsPoolUPtr = std::unique_ptr<ShardsPool>;
 
+using ShardsPoolSPtr = std::shared_ptr<ShardsPool>;
+
 }
 
 }
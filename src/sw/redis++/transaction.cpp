@@ -104,7 +104,8 @@ std::vector<ReplyUPtr> TransactionImpl::_exec(Connection &connection) {
             throw ProtoError("Null sub reply");
         }
 
-        auto r = ReplyUPtr(sub_reply);
+        // If the reply is allocated in an arena, the sub reply shares the arena.
+        auto r = ReplyUPtr(sub_reply, reply.get_deleter().share());
         reply->element[idx] = nullptr;
         replies.push_back(std::move(r));
     }
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <iterator>
 #include <string>
 #include <type_traits>
 #include "sw/redis++/cxx_utils.h"
@@ -29,6 +30,8 @@ namespace redis {
 
 using OptionalString = Optional<std::string>;
 
+using OptionalStringView = Optional<StringView>;
+
 using OptionalLongLong = Optional<long long>;
 
 using OptionalDouble = Optional<double>;
@@ -82,6 +85,18 @@ struct IsIter<Iter,
 template <typename T>
 struct IsKvPairIter : IsKvPair<typename IterType<T>::type> {};
 
+// Whether it's a forward iterator, which returns lvalue references. Elements of such
+// iterators are NOT invalidated by incrementing the iterator, and we can keep references
+// to them, while iterating the range.
+template <typename Iter, typename T = Void<>>
+struct IsStableIter : std::false_type {};
+
+template <typename Iter>
+struct IsStableIter<Iter,
+    typename std::enable_if<std::is_base_of<std::forward_iterator_tag,
+        typename std::iterator_traits<Iter>::iterator_category>::value>::type>
+            : std::is_lvalue_reference<decltype(*std::declval<Iter &>())> {};
+
 template <typename T, typename Tuple>
 struct TupleWithType : std::false_type {};
 
@@ -0,0 +1,131 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_ASYNC_BENCHMARK_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_ASYNC_BENCHMARK_TEST_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sw/redis++/async_redis++.h>
+#include "benchmark_test.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// Limit the number of outstanding requests, and wait for all of them to finish.
+class RequestWindow {
+public:
+    explicit RequestWindow(std::size_t size) : _size(size) {}
+
+    // Block until the number of outstanding requests is less than the window size.
+    void acquire();
+
+    // A request is finished, `err` is non-null, if it fails.
+    void release(std::exception_ptr err = nullptr);
+
+    // Block until all outstanding requests are finished,
+    // and rethrow the first error, if any.
+    void wait_all();
+
+private:
+    std::size_t _size;
+
+    std::size_t _outstanding = 0;
+
+    std::exception_ptr _err;
+
+    std::mutex _mutex;
+
+    std::condition_variable _cv;
+};
+
+template <typename RedisInstance>
+class AsyncBenchmarkTest {
+public:
+    AsyncBenchmarkTest(const BenchmarkOptions &opts,
+                        const ConnectionOptions &connection_opts,
+                        BenchmarkReport &report);
+
+    void run();
+
+private:
+    // Callback of a request, which records its latency.
+    class Completion {
+    public:
+        Completion(RequestWindow &window, std::uint64_t &latency) :
+            _window(&window),
+            _latency(&latency),
+            _start(std::chrono::steady_clock::now()) {}
+
+        template <typename Result>
+        void operator()(Future<Result> &&fut);
+
+    private:
+        RequestWindow *_window;
+
+        std::uint64_t *_latency;
+
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    void _run_cases(RedisInstance &redis, BenchmarkCase c, const std::string &value);
+
+    // `func(idx)` sends a request, and returns its future. At most `async_window`
+    // requests of each thread are outstanding, and the latency of a request is
+    // measured when its thread gets the result from the future.
+    template <typename Func>
+    void _run_futures(const BenchmarkCase &c, Func &&func);
+
+    // `func(idx, completion)` sends a request with `completion` as its callback,
+    // which measures the latency in the event loop thread.
+    template <typename Func>
+    void _run_callbacks(const BenchmarkCase &c, Func &&func);
+
+    std::size_t _requests_per_thread(const BenchmarkCase &c) const;
+
+    static const char* _client();
+
+    void _cleanup(RedisInstance &redis);
+
+    const std::string& _key(std::size_t idx) const {
+        return _keys[idx % _keys.size()];
+    }
+
+    BenchmarkOptions _opts;
+
+    ConnectionOptions _connection_opts;
+
+    BenchmarkReport &_report;
+
+    std::vector<std::string> _keys;
+};
+
+}
+
+}
+
+}
+
+#include "async_benchmark_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_ASYNC_BENCHMARK_TEST_H
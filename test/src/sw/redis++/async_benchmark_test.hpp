@@ -0,0 +1,220 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_ASYNC_BENCHMARK_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_ASYNC_BENCHMARK_TEST_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <utility>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+inline void RequestWindow::acquire() {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _cv.wait(lock, [this]() { return _outstanding < _size; });
+
+    ++_outstanding;
+}
+
+inline void RequestWindow::release(std::exception_ptr err) {
+    // Notify with the lock held, since the window might be destroyed,
+    // once the waiting thread finds that all requests are finished.
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    --_outstanding;
+
+    if (err && !_err) {
+        _err = err;
+    }
+
+    _cv.notify_one();
+}
+
+inline void RequestWindow::wait_all() {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _cv.wait(lock, [this]() { return _outstanding == 0; });
+
+    if (_err) {
+        std::rethrow_exception(_err);
+    }
+}
+
+template <typename RedisInstance>
+template <typename Result>
+void AsyncBenchmarkTest<RedisInstance>::Completion::operator()(Future<Result> &&fut) {
+    std::exception_ptr err;
+    try {
+        fut.get();
+    } catch (...) {
+        err = std::current_exception();
+    }
+
+    *_latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - _start).count();
+
+    _window->release(err);
+}
+
+template <typename RedisInstance>
+AsyncBenchmarkTest<RedisInstance>::AsyncBenchmarkTest(const BenchmarkOptions &opts,
+                                                        const ConnectionOptions &connection_opts,
+                                                        BenchmarkReport &report) :
+                                                            _opts(opts),
+                                                            _connection_opts(connection_opts),
+                                                            _report(report) {
+    REDIS_ASSERT(_opts.async_window > 0, "Invalid benchmark test options.");
+
+    _keys = gen_benchmark_keys(_opts.key_len);
+}
+
+template <typename RedisInstance>
+void AsyncBenchmarkTest<RedisInstance>::run() {
+    run_benchmark_matrix<RedisInstance>(_opts, _connection_opts, _client(),
+            [this](RedisInstance &redis, const BenchmarkCase &c, const std::string &value) {
+                this->_run_cases(redis, c, value);
+            });
+}
+
+template <typename RedisInstance>
+void AsyncBenchmarkTest<RedisInstance>::_run_cases(RedisInstance &redis,
+                                                   BenchmarkCase c,
+                                                   const std::string &value) {
+    _cleanup(redis);
+
+    c.title = "SET (future)";
+    _run_futures(c, [&, this](std::size_t idx) { return redis.set(this->_key(idx), value); });
+
+    c.title = "GET (future)";
+    _run_futures(c, [&, this](std::size_t idx) { return redis.get(this->_key(idx)); });
+
+    c.title = "SET (callback)";
+    _run_callbacks(c, [&, this](std::size_t idx, Completion completion) {
+                redis.set(this->_key(idx), value, std::move(completion));
+            });
+
+    c.title = "GET (callback)";
+    _run_callbacks(c, [&, this](std::size_t idx, Completion completion) {
+                redis.get(this->_key(idx), std::move(completion));
+            });
+
+    _cleanup(redis);
+}
+
+template <typename RedisInstance>
+template <typename Func>
+void AsyncBenchmarkTest<RedisInstance>::_run_futures(const BenchmarkCase &c, Func &&func) {
+    auto window = _opts.async_window;
+    run_benchmark_case(_report, c, _requests_per_thread(c),
+            [&func, window](std::size_t first, std::size_t request_num) {
+                using Clock = std::chrono::steady_clock;
+                using Fut = decltype(func(first));
+
+                std::vector<std::uint64_t> latencies;
+                latencies.reserve(request_num);
+
+                std::deque<std::pair<Clock::time_point, Fut>> outstanding;
+                auto wait_oldest = [&outstanding, &latencies]() {
+                    auto &oldest = outstanding.front();
+                    oldest.second.get();
+
+                    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                Clock::now() - oldest.first).count());
+
+                    outstanding.pop_front();
+                };
+
+                for (auto idx = first; idx != first + request_num; ++idx) {
+                    if (outstanding.size() == window) {
+                        wait_oldest();
+                    }
+
+                    auto start = Clock::now();
+                    outstanding.emplace_back(start, func(idx));
+                }
+
+                while (!outstanding.empty()) {
+                    wait_oldest();
+                }
+
+                return latencies;
+            });
+}
+
+template <typename RedisInstance>
+template <typename Func>
+void AsyncBenchmarkTest<RedisInstance>::_run_callbacks(const BenchmarkCase &c, Func &&func) {
+    auto window_size = _opts.async_window;
+    run_benchmark_case(_report, c, _requests_per_thread(c),
+            [&func, window_size](std::size_t first, std::size_t request_num) {
+                // Callbacks write latencies without lock, so the vector should never be resized.
+                std::vector<std::uint64_t> latencies(request_num, 0);
+
+                RequestWindow window(window_size);
+                for (std::size_t idx = 0; idx != request_num; ++idx) {
+                    window.acquire();
+
+                    try {
+                        func(first + idx, Completion(window, latencies[idx]));
+                    } catch (...) {
+                        window.release(std::current_exception());
+                        break;
+                    }
+                }
+
+                window.wait_all();
+
+                return latencies;
+            });
+}
+
+template <typename RedisInstance>
+std::size_t AsyncBenchmarkTest<RedisInstance>::_requests_per_thread(const BenchmarkCase &c) const {
+    return std::max<std::size_t>(_opts.total_request_num / c.thread_num, 1);
+}
+
+template <typename RedisInstance>
+const char* AsyncBenchmarkTest<RedisInstance>::_client() {
+    return "AsyncRedis";
+}
+
+template <>
+inline const char* AsyncBenchmarkTest<AsyncRedisCluster>::_client() {
+    return "AsyncRedisCluster";
+}
+
+template <typename RedisInstance>
+void AsyncBenchmarkTest<RedisInstance>::_cleanup(RedisInstance &redis) {
+    for (const auto &key : _keys) {
+        redis.del(key).get();
+    }
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_ASYNC_BENCHMARK_TEST_HPP
@@ -21,6 +21,7 @@
 
 #include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -43,10 +44,38 @@ inline void delete_keys<AsyncRedisCluster>(AsyncRedisCluster &r, const std::vect
     r.del(keys.begin(), keys.end()).get();
 }
 
+template <typename RedisInstance>
+AsyncPipeline make_pipeline(RedisInstance &r, const StringView &hash_tag);
+
+template <>
+inline AsyncPipeline make_pipeline<AsyncRedis>(AsyncRedis &r, const StringView &) {
+    return r.pipeline();
+}
+
+template <>
+inline AsyncPipeline make_pipeline<AsyncRedisCluster>(AsyncRedisCluster &r,
+        const StringView &hash_tag) {
+    return r.pipeline(hash_tag);
+}
+
+template <typename RedisInstance>
+AsyncTransaction make_transaction(RedisInstance &r, const StringView &hash_tag);
+
+template <>
+inline AsyncTransaction make_transaction<AsyncRedis>(AsyncRedis &r, const StringView &) {
+    return r.transaction();
+}
+
+template <>
+inline AsyncTransaction make_transaction<AsyncRedisCluster>(AsyncRedisCluster &r,
+        const StringView &hash_tag) {
+    return r.transaction(hash_tag);
+}
+
 template <typename RedisInstance>
 class AsyncTest {
 public:
-    explicit AsyncTest(const sw::redis::ConnectionOptions &opts) : _redis(opts) {}
+    explicit AsyncTest(const sw::redis::ConnectionOptions &opts) : _opts(opts), _redis(opts) {}
 
     void run();
 
@@ -67,10 +96,18 @@ private:
 
     void _test_generic();
 
+    void _test_pipeline();
+
+    void _test_transaction();
+
+    void _test_event_loop_group();
+
     void _wait();
 
     std::atomic<bool> _ready{false};
 
+    sw::redis::ConnectionOptions _opts;
+
     RedisInstance _redis;
 };
 
@@ -94,6 +131,12 @@ void AsyncTest<RedisInstance>::run() {
     _test_zset();
 
     _test_generic();
+
+    _test_pipeline();
+
+    _test_transaction();
+
+    _test_event_loop_group();
 }
 
 template <typename RedisInstance>
@@ -440,6 +483,181 @@ void AsyncTest<RedisInstance>::_test_generic() {
     _wait();
 }
 
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_pipeline() {
+    auto key = test_key("pipeline");
+    auto counter_key = test_key("pipeline-counter");
+    auto hash_key = test_key("pipeline-hash");
+
+    KeyDeleter<RedisInstance> deleter(_redis, {key, counter_key, hash_key});
+
+    auto pipe = make_pipeline(_redis, key);
+
+    auto set_fut = pipe.set(key, "value");
+    auto get_fut = pipe.get(key);
+    std::vector<Future<long long>> incr_futs;
+    for (auto idx = 0; idx != 100; ++idx) {
+        incr_futs.push_back(pipe.incr(counter_key));
+    }
+    auto hset_fut = pipe.hset(hash_key, "field", "value");
+    auto hget_fut = pipe.template command<OptionalString>("hget", hash_key, "field");
+    // This command fails, since `key` is NOT a hash.
+    auto err_fut = pipe.hget(key, "field");
+
+    REDIS_ASSERT(pipe.size() == 105, "failed to test async pipeline");
+
+    auto fut = pipe.exec();
+
+    REDIS_ASSERT(pipe.size() == 0, "failed to test async pipeline");
+
+    try {
+        fut.get();
+        REDIS_ASSERT(false, "failed to test async pipeline with error reply");
+    } catch (const sw::redis::Error &) {
+    }
+
+    REDIS_ASSERT(set_fut.get(), "failed to test async pipeline");
+
+    auto val = get_fut.get();
+    REDIS_ASSERT(val && *val == "value", "failed to test async pipeline");
+
+    for (auto idx = 0U; idx != incr_futs.size(); ++idx) {
+        REDIS_ASSERT(incr_futs[idx].get() == static_cast<long long>(idx + 1),
+                "failed to test async pipeline");
+    }
+
+    REDIS_ASSERT(hset_fut.get() == 1, "failed to test async pipeline");
+
+    val = hget_fut.get();
+    REDIS_ASSERT(val && *val == "value", "failed to test async pipeline");
+
+    try {
+        err_fut.get();
+        REDIS_ASSERT(false, "failed to test async pipeline with error reply");
+    } catch (const sw::redis::Error &) {
+    }
+
+    // Empty pipeline.
+    make_pipeline(_redis, key).exec().get();
+}
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_transaction() {
+    auto key = test_key("transaction");
+    auto counter_key = test_key("transaction-counter");
+
+    KeyDeleter<RedisInstance> deleter(_redis, {key, counter_key});
+
+    auto tx = make_transaction(_redis, key);
+
+    auto set_fut = tx.set(key, "value");
+    auto get_fut = tx.get(key);
+    std::vector<Future<long long>> incr_futs;
+    for (auto idx = 0; idx != 10; ++idx) {
+        incr_futs.push_back(tx.incr(counter_key));
+    }
+    // This command fails, since `key` is NOT a hash.
+    auto err_fut = tx.hget(key, "field");
+
+    REDIS_ASSERT(tx.size() == 13, "failed to test async transaction");
+
+    auto fut = tx.exec();
+
+    REDIS_ASSERT(tx.size() == 0, "failed to test async transaction");
+
+    try {
+        fut.get();
+        REDIS_ASSERT(false, "failed to test async transaction with error reply");
+    } catch (const sw::redis::Error &) {
+    }
+
+    REDIS_ASSERT(set_fut.get(), "failed to test async transaction");
+
+    auto val = get_fut.get();
+    REDIS_ASSERT(val && *val == "value", "failed to test async transaction");
+
+    for (auto idx = 0U; idx != incr_futs.size(); ++idx) {
+        REDIS_ASSERT(incr_futs[idx].get() == static_cast<long long>(idx + 1),
+                "failed to test async transaction");
+    }
+
+    try {
+        err_fut.get();
+        REDIS_ASSERT(false, "failed to test async transaction with error reply");
+    } catch (const sw::redis::Error &) {
+    }
+
+    // Watched key is NOT modified.
+    tx.watch(key).get();
+    val = tx.redis().get(key).get();
+    REDIS_ASSERT(val && *val == "value", "failed to test async transaction with watch");
+
+    set_fut = tx.set(key, "new-value");
+    tx.exec().get();
+    REDIS_ASSERT(set_fut.get(), "failed to test async transaction with watch");
+
+    // Watched key is modified by others.
+    tx.watch(key).get();
+    _redis.set(key, "modified").get();
+
+    set_fut = tx.set(key, "new-value");
+    try {
+        tx.exec().get();
+        REDIS_ASSERT(false, "failed to test async transaction with watch");
+    } catch (const sw::redis::WatchError &) {
+    }
+
+    try {
+        set_fut.get();
+        REDIS_ASSERT(false, "failed to test async transaction with watch");
+    } catch (const sw::redis::WatchError &) {
+    }
+
+    val = _redis.get(key).get();
+    REDIS_ASSERT(val && *val == "modified", "failed to test async transaction with watch");
+
+    // Empty transaction.
+    tx.exec().get();
+}
+
+template <typename RedisInstance>
+void AsyncTest<RedisInstance>::_test_event_loop_group() {
+    auto loops = std::make_shared<EventLoopGroup>(3);
+    REDIS_ASSERT(loops->size() == 3, "failed to test event loop group");
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = 3;
+    RedisInstance redis(loops, _opts, pool_opts);
+
+    auto key = test_key("event_loop_group");
+
+    KeyDeleter<RedisInstance> deleter(redis, key);
+
+    const auto thread_num = 4;
+    const auto times = 100;
+    std::vector<std::thread> workers;
+    for (auto idx = 0; idx != thread_num; ++idx) {
+        workers.emplace_back([&redis, &key]() {
+                    std::vector<Future<long long>> futs;
+                    for (auto i = 0; i != times; ++i) {
+                        futs.push_back(redis.incr(key));
+                    }
+
+                    for (auto &fut : futs) {
+                        fut.get();
+                    }
+                });
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    auto val = redis.get(key).get();
+    REDIS_ASSERT(val && *val == std::to_string(thread_num * times),
+            "failed to test event loop group");
+}
+
 }
 
 }
@@ -17,6 +17,10 @@
 #ifndef SEWENEW_REDISPLUSPLUS_TEST_BENCHMARK_TEST_H
 #define SEWENEW_REDISPLUSPLUS_TEST_BENCHMARK_TEST_H
 
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include <sw/redis++/redis++.h>
 
 namespace sw {
@@ -26,50 +30,168 @@ namespace redis {
 namespace test {
 
 struct BenchmarkOptions {
-    std::size_t pool_size = 5;
-    std::size_t thread_num = 10;
+    // Every combination of pool size, thread number and value length is benchmarked.
+    std::vector<std::size_t> pool_sizes = {5};
+    std::vector<std::size_t> thread_nums = {10};
     std::size_t total_request_num = 100000;
     std::size_t key_len = 10;
-    std::size_t val_len = 10;
+    std::vector<std::size_t> val_lens = {10};
+
+    // Max number of outstanding requests of each thread, when benchmarking async clients.
+    std::size_t async_window = 64;
+
+    // If it's not empty, results are also written to this file as JSON.
+    std::string json_path;
+};
+
+struct BenchmarkCase {
+    // Name of the client, e.g. Redis, AsyncRedisCluster.
+    std::string client;
+
+    // Name of the benchmarked operation, e.g. GET, PIPELINE 100 SET.
+    std::string title;
+
+    std::size_t pool_size = 0;
+    std::size_t thread_num = 0;
+    std::size_t val_len = 0;
 };
 
+// Collect results of benchmark cases, print each of them,
+// and dump all of them as JSON.
+class BenchmarkReport {
+public:
+    // `latencies` are latencies of all requests in nanoseconds, and `elapsed` is the
+    // wall time of the case. A request might send more than one command, e.g. a pipeline,
+    // and `cmds_per_request` is used to calculate the throughput.
+    void add(const BenchmarkCase &c,
+                std::vector<std::uint64_t> latencies,
+                std::chrono::nanoseconds elapsed,
+                std::size_t cmds_per_request = 1);
+
+    void write_json(const std::string &path) const;
+
+private:
+    struct Result {
+        BenchmarkCase c;
+
+        std::size_t requests = 0;
+        std::size_t cmds_per_request = 0;
+
+        double seconds = 0;
+        double cmds_per_sec = 0;
+
+        // Latencies in microseconds.
+        double avg = 0;
+        double p50 = 0;
+        double p99 = 0;
+        double p999 = 0;
+        double max = 0;
+    };
+
+    // `sorted` should not be empty.
+    static double _percentile(const std::vector<std::uint64_t> &sorted, double p);
+
+    static std::string _escape(const std::string &str);
+
+    std::vector<Result> _results;
+};
+
+// Generate 100 random binary keys.
+std::vector<std::string> gen_benchmark_keys(std::size_t key_len);
+
+// The byte-at-a-time CRC16 loop and hash tag parsing used before `key_slots`.
+Slot bytewise_key_slot(const StringView &key);
+
+// Compare `key_slots` with the byte-at-a-time CRC16 loop. It does not depend on any client,
+// and only runs with its own command line option.
+void bench_key_slots();
+
+// Benchmark every combination of pool size, thread number and value length. A client
+// is created for each pool size, and `run_cases(redis, c, value)` runs all cases of a
+// combination `c` with the client, where `value` is a string of `c.val_len` bytes.
+template <typename RedisInstance, typename Func>
+void run_benchmark_matrix(const BenchmarkOptions &opts,
+                            const ConnectionOptions &connection_opts,
+                            const std::string &client,
+                            Func &&run_cases);
+
+// Run a benchmark case with `c.thread_num` threads, and add the result to `report`.
+// Each thread calls `func(first, request_num)`, which sends `request_num` requests,
+// and returns their latencies. Indexes of requests sent by a thread start from `first`.
+template <typename Func>
+void run_benchmark_case(BenchmarkReport &report,
+                        const BenchmarkCase &c,
+                        std::size_t requests_per_thread,
+                        Func &&func,
+                        std::size_t cmds_per_request = 1);
+
 template <typename RedisInstance>
 class BenchmarkTest {
 public:
-    BenchmarkTest(const BenchmarkOptions &opts, RedisInstance &instance);
-
-    ~BenchmarkTest() {
-        _cleanup();
-    }
+    BenchmarkTest(const BenchmarkOptions &opts,
+                    const ConnectionOptions &connection_opts,
+                    BenchmarkReport &report);
 
     void run();
 
 private:
+    // Benchmark all cases with the given client.
+    void _run_cases(RedisInstance &redis, BenchmarkCase c, const std::string &value);
+
+    // Send `func(idx)` with `c.thread_num` threads, and each call is a request
+    // which sends `cmds_per_request` commands.
     template <typename Func>
-    void _run(const std::string &title, Func &&func);
+    void _run(const BenchmarkCase &c, Func &&func, std::size_t cmds_per_request = 1);
 
     template <typename Func>
-    std::size_t _run(Func &&func, std::size_t request_num);
+    static std::vector<std::uint64_t> _run_requests(Func &func,
+                                                    std::size_t first,
+                                                    std::size_t request_num);
+
+    // Populate keys read by GET, MGET, HGETALL and LRANGE.
+    void _prepare(RedisInstance &redis, const std::string &value);
+
+    static const char* _client();
 
-    void _test_get();
+    Pipeline _pipeline(RedisInstance &redis);
 
-    std::vector<std::string> _gen_keys() const;
+    Transaction _transaction(RedisInstance &redis);
 
-    std::string _gen_value() const;
+    std::vector<std::string> _gen_keys(const std::string &prefix, const std::string &suffix) const;
 
-    void _cleanup();
+    void _cleanup(RedisInstance &redis);
 
-    const std::string& _key(std::size_t idx) const {
-        return _keys[idx % _keys.size()];
+    static const std::string& _key(const std::vector<std::string> &keys, std::size_t idx) {
+        return keys[idx % keys.size()];
     }
 
     BenchmarkOptions _opts;
 
-    RedisInstance &_redis;
+    ConnectionOptions _connection_opts;
 
+    BenchmarkReport &_report;
+
+    // Keys of string type.
     std::vector<std::string> _keys;
 
-    std::string _value;
+    // Keys of string type with the same hash tag,
+    // which are used by MGET, pipeline and transaction.
+    std::vector<std::string> _tagged_keys;
+
+    std::vector<std::string> _hash_keys;
+
+    std::vector<std::string> _zset_keys;
+
+    std::vector<std::string> _list_keys;
+
+    // Keys of list type, which are used by LPUSH and LPOP.
+    std::vector<std::string> _push_keys;
+
+    // Keys of string type, which are used by INCR.
+    std::vector<std::string> _counter_keys;
+
+    // Keys of set type, which are used by SADD and SPOP.
+    std::vector<std::string> _set_keys;
 };
 
 }
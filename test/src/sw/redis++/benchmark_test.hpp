@@ -17,10 +17,16 @@
 #ifndef SEWENEW_REDISPLUSPLUS_TEST_BENCHMARK_TEST_HPP
 #define SEWENEW_REDISPLUSPLUS_TEST_BENCHMARK_TEST_HPP
 
+#include <algorithm>
 #include <chrono>
-#include <random>
+#include <cmath>
+#include <fstream>
 #include <future>
-#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <unordered_map>
 #include "utils.h"
 
 namespace sw {
@@ -29,143 +35,516 @@ namespace redis {
 
 namespace test {
 
+inline void BenchmarkReport::add(const BenchmarkCase &c,
+                                    std::vector<std::uint64_t> latencies,
+                                    std::chrono::nanoseconds elapsed,
+                                    std::size_t cmds_per_request) {
+    REDIS_ASSERT(!latencies.empty() && cmds_per_request > 0, "invalid benchmark result");
+
+    std::sort(latencies.begin(), latencies.end());
+
+    Result result;
+    result.c = c;
+    result.requests = latencies.size();
+    result.cmds_per_request = cmds_per_request;
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+    if (result.seconds > 0) {
+        result.cmds_per_sec = result.requests * cmds_per_request / result.seconds;
+    }
+
+    double sum = 0;
+    for (auto latency : latencies) {
+        sum += latency;
+    }
+    result.avg = sum / latencies.size() / 1000;
+    result.p50 = _percentile(latencies, 0.5);
+    result.p99 = _percentile(latencies, 0.99);
+    result.p999 = _percentile(latencies, 0.999);
+    result.max = latencies.back() / 1000.0;
+
+    std::cout << "-----" << c.client << ": " << c.title
+        << " (pool size: " << c.pool_size
+        << ", threads: " << c.thread_num
+        << ", value length: " << c.val_len << ")-----" << std::endl;
+    std::cout << result.requests << " requests cost " << result.seconds << " seconds, "
+        << static_cast<std::size_t>(result.cmds_per_sec) << " commands per second" << std::endl;
+    std::cout << "latency in us: avg " << result.avg
+        << ", p50 " << result.p50
+        << ", p99 " << result.p99
+        << ", p99.9 " << result.p999
+        << ", max " << result.max << std::endl;
+
+    _results.push_back(std::move(result));
+}
+
+inline void BenchmarkReport::write_json(const std::string &path) const {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "{\n  \"results\": [";
+    for (std::size_t idx = 0; idx != _results.size(); ++idx) {
+        const auto &result = _results[idx];
+        os << (idx == 0 ? "\n" : ",\n");
+        os << "    {"
+            << "\"client\": \"" << _escape(result.c.client) << "\", "
+            << "\"case\": \"" << _escape(result.c.title) << "\", "
+            << "\"pool_size\": " << result.c.pool_size << ", "
+            << "\"threads\": " << result.c.thread_num << ", "
+            << "\"value_length\": " << result.c.val_len << ", "
+            << "\"requests\": " << result.requests << ", "
+            << "\"commands_per_request\": " << result.cmds_per_request << ", "
+            << "\"seconds\": " << result.seconds << ", "
+            << "\"commands_per_second\": " << result.cmds_per_sec << ", "
+            << "\"latency_us\": {"
+            << "\"avg\": " << result.avg << ", "
+            << "\"p50\": " << result.p50 << ", "
+            << "\"p99\": " << result.p99 << ", "
+            << "\"p99.9\": " << result.p999 << ", "
+            << "\"max\": " << result.max << "}}";
+    }
+    os << "\n  ]\n}\n";
+
+    std::ofstream file(path);
+    file << os.str();
+
+    REDIS_ASSERT(static_cast<bool>(file), "failed to write benchmark results to " + path);
+}
+
+inline double BenchmarkReport::_percentile(const std::vector<std::uint64_t> &sorted, double p) {
+    // Nearest-rank method, i.e. the smallest value, which is no less than p * n values.
+    // The epsilon tolerates rounding errors, e.g. 0.07 * 100 is slightly larger than 7.
+    auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size() - 1e-9));
+    auto idx = std::min(std::max<std::size_t>(rank, 1), sorted.size()) - 1;
+
+    return sorted[idx] / 1000.0;
+}
+
+inline std::string BenchmarkReport::_escape(const std::string &str) {
+    std::string res;
+    res.reserve(str.size());
+    for (auto c : str) {
+        if (c == '"' || c == '\\') {
+            res.push_back('\\');
+        }
+        res.push_back(c);
+    }
+
+    return res;
+}
+
+inline std::vector<std::string> gen_benchmark_keys(std::size_t key_len) {
+    const auto KEY_NUM = 100;
+    std::vector<std::string> res;
+    res.reserve(KEY_NUM);
+    std::default_random_engine engine(std::random_device{}());
+    std::uniform_int_distribution<int> uniform_dist(0, 255);
+    for (auto i = 0; i != KEY_NUM; ++i) {
+        std::string str;
+        str.reserve(key_len);
+        for (std::size_t j = 0; j != key_len; ++j) {
+            str.push_back(static_cast<char>(uniform_dist(engine)));
+        }
+        res.push_back(str);
+    }
+
+    return res;
+}
+
+inline Slot bytewise_key_slot(const StringView &key) {
+    static const std::vector<uint16_t> table = []() {
+        std::vector<uint16_t> tab(256);
+        for (std::size_t b = 0; b != 256; ++b) {
+            auto crc = static_cast<uint16_t>(b << 8);
+            for (auto i = 0; i != 8; ++i) {
+                crc = static_cast<uint16_t>((crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+            }
+            tab[b] = crc;
+        }
+        return tab;
+    }();
+
+    auto crc16 = [](const char *buf, int len) {
+        uint16_t crc = 0;
+        for (int counter = 0; counter < len; counter++)
+            crc = static_cast<uint16_t>((crc<<8) ^ table[((crc>>8) ^ *buf++)&0x00FF]);
+        return crc;
+    };
+
+    const auto *k = key.data();
+    auto keylen = static_cast<int>(key.size());
+
+    int s = 0;
+    int e = 0;
+
+    for (s = 0; s < keylen; s++)
+        if (k[s] == '{') break;
+
+    if (s == keylen) return crc16(k, keylen) & 16383;
+
+    for (e = s + 1; e < keylen; e++)
+        if (k[e] == '}') break;
+
+    if (e == keylen || e == s + 1) return crc16(k, keylen) & 16383;
+
+    return crc16(k + s + 1, e - s - 1) & 16383;
+}
+
+inline void bench_key_slots() {
+    const std::size_t KEY_NUM = 1000000;
+    std::default_random_engine engine(std::random_device{}());
+    std::uniform_int_distribution<int> uniform_dist('a', 'z');
+    for (auto key_len : {8, 16, 32, 64}) {
+        std::vector<std::string> keys;
+        keys.reserve(KEY_NUM);
+        for (std::size_t idx = 0; idx != KEY_NUM; ++idx) {
+            std::string key;
+            key.reserve(key_len);
+            for (auto i = 0; i != key_len; ++i) {
+                key.push_back(static_cast<char>(uniform_dist(engine)));
+            }
+            keys.push_back(std::move(key));
+        }
+
+        std::vector<StringView> views(keys.begin(), keys.end());
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<Slot> expected;
+        expected.reserve(KEY_NUM);
+        for (const auto &key : views) {
+            expected.push_back(bytewise_key_slot(key));
+        }
+
+        auto mid = std::chrono::steady_clock::now();
+
+        std::vector<Slot> slots(KEY_NUM);
+        key_slots(views.data(), views.size(), slots.data());
+
+        auto stop = std::chrono::steady_clock::now();
+
+        REDIS_ASSERT(slots == expected, "failed to benchmark key slots");
+
+        auto bytewise = std::chrono::duration_cast<std::chrono::microseconds>(mid - start).count();
+        auto batch = std::chrono::duration_cast<std::chrono::microseconds>(stop - mid).count();
+
+        std::cout << "-----key_slots with " << key_len << " bytes keys-----" << std::endl;
+        std::cout << KEY_NUM << " keys cost " << bytewise / 1000.0 << " ms with bytewise loop, "
+            << batch / 1000.0 << " ms with key_slots" << std::endl;
+    }
+}
+
+template <typename RedisInstance, typename Func>
+void run_benchmark_matrix(const BenchmarkOptions &opts,
+                            const ConnectionOptions &connection_opts,
+                            const std::string &client,
+                            Func &&run_cases) {
+    for (auto pool_size : opts.pool_sizes) {
+        ConnectionPoolOptions pool_opts;
+        pool_opts.size = pool_size;
+
+        RedisInstance redis(connection_opts, pool_opts);
+
+        for (auto thread_num : opts.thread_nums) {
+            for (auto val_len : opts.val_lens) {
+                BenchmarkCase c;
+                c.client = client;
+                c.pool_size = pool_size;
+                c.thread_num = thread_num;
+                c.val_len = val_len;
+
+                const std::string value(val_len, 'x');
+
+                run_cases(redis, c, value);
+            }
+        }
+    }
+}
+
+template <typename Func>
+void run_benchmark_case(BenchmarkReport &report,
+                        const BenchmarkCase &c,
+                        std::size_t requests_per_thread,
+                        Func &&func,
+                        std::size_t cmds_per_request) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::future<std::vector<std::uint64_t>>> res;
+    res.reserve(c.thread_num);
+    for (std::size_t idx = 0; idx != c.thread_num; ++idx) {
+        res.push_back(std::async(std::launch::async,
+                        [&func, idx, requests_per_thread]() {
+                            return func(idx * requests_per_thread, requests_per_thread);
+                        }));
+    }
+
+    std::vector<std::uint64_t> latencies;
+    latencies.reserve(requests_per_thread * c.thread_num);
+    for (auto &fut : res) {
+        auto lats = fut.get();
+        latencies.insert(latencies.end(), lats.begin(), lats.end());
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+
+    report.add(c, std::move(latencies), stop - start, cmds_per_request);
+}
+
 template <typename RedisInstance>
 BenchmarkTest<RedisInstance>::BenchmarkTest(const BenchmarkOptions &opts,
-        RedisInstance &instance) : _opts(opts), _redis(instance) {
-    REDIS_ASSERT(_opts.pool_size > 0
-            && _opts.thread_num > 0
+                                            const ConnectionOptions &connection_opts,
+                                            BenchmarkReport &report) :
+                                                _opts(opts),
+                                                _connection_opts(connection_opts),
+                                                _report(report) {
+    auto positive = [](const std::vector<std::size_t> &nums) {
+        return !nums.empty()
+            && std::find(nums.begin(), nums.end(), 0U) == nums.end();
+    };
+
+    REDIS_ASSERT(positive(_opts.pool_sizes)
+            && positive(_opts.thread_nums)
+            && positive(_opts.val_lens)
             && _opts.total_request_num > 0
-            && _opts.key_len > 0
-            && _opts.val_len > 0,
+            && _opts.key_len > 0,
                 "Invalid benchmark test options.");
 
-    _keys = _gen_keys();
-    _value = _gen_value();
+    _keys = gen_benchmark_keys(_opts.key_len);
+    _tagged_keys = _gen_keys(test_key("benchmark"), "");
+    _hash_keys = _gen_keys("", "::hash");
+    _zset_keys = _gen_keys("", "::zset");
+    _list_keys = _gen_keys("", "::list");
+    _push_keys = _gen_keys("", "::push");
+    _counter_keys = _gen_keys("", "::counter");
+    _set_keys = _gen_keys("", "::set");
 }
 
 template <typename RedisInstance>
 void BenchmarkTest<RedisInstance>::run() {
-    _cleanup();
-
-    _run("SET key value", [this](std::size_t idx) { this->_redis.set(this->_key(idx), _value); });
+    run_benchmark_matrix<RedisInstance>(_opts, _connection_opts, _client(),
+            [this](RedisInstance &redis, const BenchmarkCase &c, const std::string &value) {
+                this->_run_cases(redis, c, value);
+            });
+}
 
-    _run("GET key", [this](std::size_t idx) {
-                        auto res = this->_redis.get(this->_key(idx));
-                        (void)res;
-                    });
+template <typename RedisInstance>
+void BenchmarkTest<RedisInstance>::_run_cases(RedisInstance &redis,
+                                                BenchmarkCase c,
+                                                const std::string &value) {
+    const std::size_t MGET_KEY_NUM = 10;
+    const std::size_t PIPELINE_CMD_NUM = 100;
+    const std::size_t TRANSACTION_CMD_NUM = 10;
+    const long long LRANGE_STOP = 99;
+
+    _cleanup(redis);
+    _prepare(redis, value);
+
+    c.title = "SET";
+    _run(c, [&, this](std::size_t idx) { redis.set(this->_key(this->_keys, idx), value); });
+
+    c.title = "GET";
+    _run(c, [&, this](std::size_t idx) {
+                auto res = redis.get(this->_key(this->_keys, idx));
+                (void)res;
+            });
 
-    _cleanup();
+    c.title = "MGET " + std::to_string(MGET_KEY_NUM) + " keys";
+    _run(c, [&, this](std::size_t idx) {
+                std::vector<StringView> keys;
+                keys.reserve(MGET_KEY_NUM);
+                for (std::size_t i = 0; i != MGET_KEY_NUM; ++i) {
+                    keys.emplace_back(this->_key(this->_tagged_keys, idx + i));
+                }
+
+                std::vector<OptionalString> res;
+                res.reserve(MGET_KEY_NUM);
+                redis.mget(keys.begin(), keys.end(), std::back_inserter(res));
+            });
 
-    _run("LPUSH key value", [this](std::size_t idx) {
-                                this->_redis.lpush(this->_key(idx), _value);
-                            });
+    c.title = "HGETALL";
+    _run(c, [&, this](std::size_t idx) {
+                std::unordered_map<std::string, std::string> res;
+                redis.hgetall(this->_key(this->_hash_keys, idx), std::inserter(res, res.end()));
+            });
 
-    _run("LRANGE key 0 10", [this](std::size_t idx) {
-                std::vector<std::string> res;
-                res.reserve(10);
-                this->_redis.lrange(this->_key(idx), 0, 10, std::back_inserter(res));
+    c.title = "ZADD";
+    _run(c, [&, this](std::size_t idx) {
+                // Members are reused, so that the size of each sorted set is limited.
+                const auto &member = this->_key(this->_keys, idx / this->_zset_keys.size());
+                redis.zadd(this->_key(this->_zset_keys, idx), member, static_cast<double>(idx));
             });
 
-    _run("LPOP key", [this](std::size_t idx) {
-                        auto res = this->_redis.lpop(this->_key(idx));
-                        (void)res;
-                     });
+    c.title = "LPUSH";
+    _run(c, [&, this](std::size_t idx) { redis.lpush(this->_key(this->_push_keys, idx), value); });
 
-    _cleanup();
+    c.title = "LPOP";
+    _run(c, [&, this](std::size_t idx) {
+                auto res = redis.lpop(this->_key(this->_push_keys, idx));
+                (void)res;
+            });
 
-    _run("INCR key", [this](std::size_t idx) {
-                        auto num = this->_redis.incr(this->_key(idx));
-                        (void)num;
-                     });
+    c.title = "INCR";
+    _run(c, [&, this](std::size_t idx) { redis.incr(this->_key(this->_counter_keys, idx)); });
 
-    _cleanup();
+    c.title = "SADD";
+    _run(c, [&, this](std::size_t idx) {
+                // Like ZADD, members are reused.
+                const auto &member = this->_key(this->_keys, idx / this->_set_keys.size());
+                redis.sadd(this->_key(this->_set_keys, idx), member);
+            });
 
-    _run("SADD key member", [this](std::size_t idx) {
-                                auto num = this->_redis.sadd(this->_key(idx), _value);
-                                (void)num;
-                            });
+    c.title = "SPOP";
+    _run(c, [&, this](std::size_t idx) {
+                auto res = redis.spop(this->_key(this->_set_keys, idx));
+                (void)res;
+            });
 
-    _run("SPOP key", [this](std::size_t idx) {
-                        auto res = this->_redis.spop(this->_key(idx));
-                        (void)res;
-                     });
+    c.title = "LRANGE 0 " + std::to_string(LRANGE_STOP);
+    _run(c, [&, this](std::size_t idx) {
+                std::vector<std::string> res;
+                res.reserve(LRANGE_STOP + 1);
+                redis.lrange(this->_key(this->_list_keys, idx), 0, LRANGE_STOP,
+                        std::back_inserter(res));
+            });
 
-    _cleanup();
+    c.title = "PIPELINE " + std::to_string(PIPELINE_CMD_NUM) + " SET";
+    _run(c, [&, this](std::size_t idx) {
+                auto pipe = this->_pipeline(redis);
+                for (std::size_t i = 0; i != PIPELINE_CMD_NUM; ++i) {
+                    pipe.set(this->_key(this->_tagged_keys, idx + i), value);
+                }
+                pipe.exec();
+            },
+            PIPELINE_CMD_NUM);
+
+    c.title = "TRANSACTION " + std::to_string(TRANSACTION_CMD_NUM / 2) + " SET "
+        + std::to_string(TRANSACTION_CMD_NUM / 2) + " GET";
+    _run(c, [&, this](std::size_t idx) {
+                auto tx = this->_transaction(redis);
+                for (std::size_t i = 0; i != TRANSACTION_CMD_NUM / 2; ++i) {
+                    const auto &key = this->_key(this->_tagged_keys, idx + i);
+                    tx.set(key, value).get(key);
+                }
+                tx.exec();
+            },
+            TRANSACTION_CMD_NUM);
+
+    _cleanup(redis);
 }
 
 template <typename RedisInstance>
 template <typename Func>
-void BenchmarkTest<RedisInstance>::_run(const std::string &title, Func &&func) {
-    auto thread_num = _opts.thread_num;
-    auto requests_per_thread = _opts.total_request_num / thread_num;
-    auto total_request_num = requests_per_thread * thread_num;
-    std::vector<std::future<std::size_t>> res;
-    res.reserve(thread_num);
-    res.push_back(std::async(std::launch::async,
-                    [this](Func &&func, std::size_t request_num) {
-                        return this->_run(std::forward<Func>(func), request_num);
-                    },
-                    std::forward<Func>(func),
-                    requests_per_thread));
-
-    auto total_in_msec = 0;
-    for (auto &fut : res) {
-        total_in_msec += fut.get();
-    }
+void BenchmarkTest<RedisInstance>::_run(const BenchmarkCase &c,
+                                        Func &&func,
+                                        std::size_t cmds_per_request) {
+    auto requests_per_thread = std::max<std::size_t>(
+            _opts.total_request_num / cmds_per_request / c.thread_num, 1);
+
+    run_benchmark_case(_report, c, requests_per_thread,
+            [&func](std::size_t first, std::size_t request_num) {
+                return BenchmarkTest::_run_requests(func, first, request_num);
+            },
+            cmds_per_request);
+}
 
-    auto total_in_sec = total_in_msec * 1.0 / 1000;
+template <typename RedisInstance>
+template <typename Func>
+std::vector<std::uint64_t> BenchmarkTest<RedisInstance>::_run_requests(Func &func,
+                                                                        std::size_t first,
+                                                                        std::size_t request_num) {
+    std::vector<std::uint64_t> latencies;
+    latencies.reserve(request_num);
+
+    for (auto idx = first; idx != first + request_num; ++idx) {
+        auto start = std::chrono::steady_clock::now();
+
+        func(idx);
 
-    auto avg = total_in_msec * 1.0 / total_request_num;
+        auto stop = std::chrono::steady_clock::now();
 
-    auto ops = static_cast<std::size_t>(1000 / avg);
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    stop - start).count());
+    }
 
-    std::cout << "-----" << title << "-----" << std::endl;
-    std::cout << total_request_num << " requests cost " << total_in_sec << " seconds" << std::endl;
-    std::cout << ops << " requests per second" << std::endl;
+    return latencies;
 }
 
 template <typename RedisInstance>
-template <typename Func>
-std::size_t BenchmarkTest<RedisInstance>::_run(Func &&func, std::size_t request_num) {
-    auto start = std::chrono::steady_clock::now();
+void BenchmarkTest<RedisInstance>::_prepare(RedisInstance &redis, const std::string &value) {
+    const std::size_t HASH_FIELD_NUM = 10;
+    const std::size_t LIST_LEN = 100;
 
-    for (auto idx = 0U; idx != request_num; ++idx) {
-        func(idx);
+    for (const auto &key : _keys) {
+        redis.set(key, value);
     }
 
-    auto stop = std::chrono::steady_clock::now();
+    for (const auto &key : _tagged_keys) {
+        redis.set(key, value);
+    }
 
-    return std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+    std::vector<std::pair<std::string, std::string>> fields;
+    for (std::size_t idx = 0; idx != HASH_FIELD_NUM; ++idx) {
+        fields.emplace_back("field" + std::to_string(idx), value);
+    }
+    for (const auto &key : _hash_keys) {
+        redis.hset(key, fields.begin(), fields.end());
+    }
+
+    std::vector<std::string> elements(LIST_LEN, value);
+    for (const auto &key : _list_keys) {
+        redis.rpush(key, elements.begin(), elements.end());
+    }
 }
 
 template <typename RedisInstance>
-std::vector<std::string> BenchmarkTest<RedisInstance>::_gen_keys() const {
-    const auto KEY_NUM = 100;
-    std::vector<std::string> res;
-    res.reserve(KEY_NUM);
-    std::default_random_engine engine(std::random_device{}());
-    std::uniform_int_distribution<int> uniform_dist(0, 255);
-    for (auto i = 0; i != KEY_NUM; ++i) {
-        std::string str;
-        str.reserve(_opts.key_len);
-        for (std::size_t j = 0; j != _opts.key_len; ++j) {
-            str.push_back(static_cast<char>(uniform_dist(engine)));
-        }
-        res.push_back(str);
-    }
+const char* BenchmarkTest<RedisInstance>::_client() {
+    return "Redis";
+}
 
-    return res;
+template <>
+inline const char* BenchmarkTest<RedisCluster>::_client() {
+    return "RedisCluster";
 }
 
 template <typename RedisInstance>
-std::string BenchmarkTest<RedisInstance>::_gen_value() const {
-    return std::string(_opts.val_len, 'x');
+Pipeline BenchmarkTest<RedisInstance>::_pipeline(RedisInstance &redis) {
+    // Use connections of the pool, since creating a connection for each request
+    // costs much more than the commands.
+    return redis.pipeline(false);
+}
+
+template <>
+inline Pipeline BenchmarkTest<RedisCluster>::_pipeline(RedisCluster &redis) {
+    return redis.pipeline(_tagged_keys.front(), false);
+}
+
+template <typename RedisInstance>
+Transaction BenchmarkTest<RedisInstance>::_transaction(RedisInstance &redis) {
+    return redis.transaction(false, false);
+}
+
+template <>
+inline Transaction BenchmarkTest<RedisCluster>::_transaction(RedisCluster &redis) {
+    return redis.transaction(_tagged_keys.front(), false, false);
 }
 
 template <typename RedisInstance>
-void BenchmarkTest<RedisInstance>::_cleanup() {
+std::vector<std::string> BenchmarkTest<RedisInstance>::_gen_keys(const std::string &prefix,
+                                                                const std::string &suffix) const {
+    std::vector<std::string> res;
+    res.reserve(_keys.size());
     for (const auto &key : _keys) {
-        _redis.del(key);
+        res.push_back(prefix + key + suffix);
+    }
+
+    return res;
+}
+
+template <typename RedisInstance>
+void BenchmarkTest<RedisInstance>::_cleanup(RedisInstance &redis) {
+    for (const auto *keys : {&_keys, &_tagged_keys, &_hash_keys, &_zset_keys, &_list_keys,
+                                &_push_keys, &_counter_keys, &_set_keys}) {
+        for (const auto &key : *keys) {
+            redis.del(key);
+        }
     }
 }
 
@@ -0,0 +1,74 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_H
+
+#include <functional>
+#include <sw/redis++/redis++.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+template <typename RedisInstance>
+class ClientCacheTest {
+public:
+    ClientCacheTest(const ConnectionOptions &opts, RedisInstance &instance) :
+        _opts(opts), _redis(instance) {}
+
+    void run();
+
+private:
+    void _test_string(ClientTrackingMode mode);
+
+    void _test_hash(ClientTrackingMode mode);
+
+    void _test_untracked_prefix();
+
+    ClientCacheOptions _cache_options(ClientTrackingMode mode) const;
+
+    bool _equal(const OptionalString &val, const std::string &expected) const;
+
+    // Wait until `cond` is satisfied, i.e. the invalidation message has been received.
+    bool _wait_for(const std::function<bool ()> &cond) const;
+
+    ConnectionOptions _opts;
+
+    RedisInstance &_redis;
+};
+
+template <>
+class ClientCacheTest<sw::redis::RedisCluster> {
+public:
+    ClientCacheTest(const ConnectionOptions &, sw::redis::RedisCluster &) {}
+
+    void run() {
+        // Do nothing, since client side caching is only supported by Redis.
+    }
+};
+
+}
+
+}
+
+}
+
+#include "client_cache_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_H
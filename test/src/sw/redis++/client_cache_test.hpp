@@ -0,0 +1,173 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_HPP
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+template <typename RedisInstance>
+void ClientCacheTest<RedisInstance>::run() {
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    _test_string(ClientTrackingMode::DEFAULT);
+
+    _test_hash(ClientTrackingMode::DEFAULT);
+
+    _test_string(ClientTrackingMode::BCAST);
+
+    _test_hash(ClientTrackingMode::BCAST);
+
+    _test_untracked_prefix();
+#endif
+}
+
+template <typename RedisInstance>
+void ClientCacheTest<RedisInstance>::_test_string(ClientTrackingMode mode) {
+    RedisInstance cache(_opts, ConnectionPoolOptions{}, _cache_options(mode));
+
+    auto key = test_key("client_cache_string");
+
+    KeyDeleter<RedisInstance> deleter(_redis, key);
+
+    // Wait until the invalidation connection is ready, so that replies can be cached.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    REDIS_ASSERT(!cache.get(key), "failed to test client cache with nonexistent key");
+
+    _redis.set(key, "v1");
+
+    REDIS_ASSERT(_wait_for([&]() { return _equal(cache.get(key), "v1"); }),
+            "failed to test client cache invalidation of nonexistent key");
+
+    // Served from cache.
+    for (auto idx = 0; idx != 10; ++idx) {
+        REDIS_ASSERT(_equal(cache.get(key), "v1"), "failed to test client cache get");
+    }
+
+    _redis.set(key, "v2");
+
+    REDIS_ASSERT(_wait_for([&]() { return _equal(cache.get(key), "v2"); }),
+            "failed to test client cache invalidation");
+
+    _redis.del(key);
+
+    REDIS_ASSERT(_wait_for([&]() { return !cache.get(key); }),
+            "failed to test client cache invalidation of deleted key");
+}
+
+template <typename RedisInstance>
+void ClientCacheTest<RedisInstance>::_test_hash(ClientTrackingMode mode) {
+    RedisInstance cache(_opts, ConnectionPoolOptions{}, _cache_options(mode));
+
+    auto key = test_key("client_cache_hash");
+
+    KeyDeleter<RedisInstance> deleter(_redis, key);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    _redis.hset(key, "f1", "v1");
+
+    REDIS_ASSERT(_equal(cache.hget(key, "f1"), "v1") && !cache.hget(key, "f2"),
+            "failed to test client cache hget");
+
+    std::unordered_map<std::string, std::string> hash;
+    cache.hgetall(key, std::inserter(hash, hash.end()));
+    REDIS_ASSERT(hash.size() == 1 && hash["f1"] == "v1", "failed to test client cache hgetall");
+
+    _redis.hset(key, "f2", "v2");
+
+    REDIS_ASSERT(_wait_for([&]() { return _equal(cache.hget(key, "f2"), "v2"); }),
+            "failed to test client cache hget invalidation");
+
+    REDIS_ASSERT(_wait_for([&]() {
+                    std::unordered_map<std::string, std::string> result;
+                    cache.hgetall(key, std::inserter(result, result.end()));
+                    return result.size() == 2 && result["f2"] == "v2";
+                }),
+            "failed to test client cache hgetall invalidation");
+}
+
+template <typename RedisInstance>
+void ClientCacheTest<RedisInstance>::_test_untracked_prefix() {
+    RedisInstance cache(_opts, ConnectionPoolOptions{}, _cache_options(ClientTrackingMode::BCAST));
+
+    // The key doesn't match the BCAST prefix, and Redis never sends its invalidation
+    // messages, so its replies must NOT be cached.
+    auto key = "untracked" + test_key("client_cache_untracked");
+
+    KeyDeleter<RedisInstance> deleter(_redis, key);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    REDIS_ASSERT(!cache.get(key), "failed to test client cache with untracked key");
+
+    _redis.set(key, "v1");
+
+    REDIS_ASSERT(_equal(cache.get(key), "v1"), "failed to test client cache with untracked key");
+
+    _redis.set(key, "v2");
+
+    REDIS_ASSERT(_equal(cache.get(key), "v2"), "failed to test client cache with untracked key");
+}
+
+template <typename RedisInstance>
+ClientCacheOptions ClientCacheTest<RedisInstance>::_cache_options(ClientTrackingMode mode) const {
+    ClientCacheOptions cache_opts;
+    cache_opts.max_entries = 100;
+    cache_opts.shards = 4;
+    cache_opts.mode = mode;
+    if (mode == ClientTrackingMode::BCAST) {
+        cache_opts.prefixes.push_back(test_key(""));
+    }
+
+    return cache_opts;
+}
+
+template <typename RedisInstance>
+bool ClientCacheTest<RedisInstance>::_equal(const OptionalString &val, const std::string &expected) const {
+    return val && *val == expected;
+}
+
+template <typename RedisInstance>
+bool ClientCacheTest<RedisInstance>::_wait_for(const std::function<bool ()> &cond) const {
+    for (auto idx = 0; idx != 100; ++idx) {
+        if (cond()) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CLIENT_CACHE_TEST_HPP
@@ -28,18 +28,29 @@ namespace test {
 template <typename RedisInstance>
 class ClusterTest {
 public:
-    explicit ClusterTest(RedisInstance &instance) : _redis(instance) {}
+    ClusterTest(const ConnectionOptions &opts, RedisInstance &instance) :
+        _opts(opts), _redis(instance) {}
 
     void run();
 
 private:
+    void _test_cross_slot_fanout();
+
+    void _test_cluster_pipeline();
+
+    void _test_cluster_scanner();
+
+    void _test_key_slots();
+
+    ConnectionOptions _opts;
+
     RedisInstance &_redis;
 };
 
 template <>
 class ClusterTest<sw::redis::Redis> {
 public:
-    explicit ClusterTest(sw::redis::Redis &) {}
+    ClusterTest(const ConnectionOptions &, sw::redis::Redis &) {}
 
     void run() {
         // Do nothing, since this is cluster specific test.
@@ -17,6 +17,10 @@
 #ifndef SEWENEW_REDISPLUSPLUS_TEST_CLUSTER_TEST_HPP
 #define SEWENEW_REDISPLUSPLUS_TEST_CLUSTER_TEST_HPP
 
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 #include "utils.h"
 
 namespace sw {
@@ -30,6 +34,191 @@ void ClusterTest<RedisInstance>::run() {
     _redis.for_each([](sw::redis::Redis &r) {
                 REDIS_ASSERT(r.ping() == "PONG", "failed to test for_each");
             });
+
+    _test_cross_slot_fanout();
+
+    _test_cluster_pipeline();
+
+    _test_cluster_scanner();
+
+    _test_key_slots();
+}
+
+template <typename RedisInstance>
+void ClusterTest<RedisInstance>::_test_cross_slot_fanout() {
+    ClusterOptions cluster_opts;
+    cluster_opts.cross_slot_fanout = true;
+    RedisInstance cluster(_opts, ConnectionPoolOptions{}, Role::MASTER, cluster_opts);
+
+    // Keys without hash tag, so that they belong to different slots.
+    std::vector<std::string> keys;
+    std::vector<std::pair<std::string, std::string>> kvs;
+    for (auto idx = 0; idx != 20; ++idx) {
+        auto key = key_prefix() + "::fanout::" + std::to_string(idx);
+        keys.push_back(key);
+        kvs.emplace_back(key, "val" + std::to_string(idx));
+    }
+
+    KeyDeleter<RedisInstance> deleter(cluster, keys.begin(), keys.end());
+
+    cluster.mset(kvs.begin(), kvs.end());
+
+    auto not_exist_key = key_prefix() + "::fanout::not_exist";
+    auto mget_keys = keys;
+    mget_keys.insert(mget_keys.begin() + 5, not_exist_key);
+
+    std::vector<OptionalString> vals;
+    cluster.mget(mget_keys.begin(), mget_keys.end(), std::back_inserter(vals));
+    REDIS_ASSERT(vals.size() == mget_keys.size(), "failed to test cross slot fanout");
+    for (std::size_t idx = 0; idx != mget_keys.size(); ++idx) {
+        if (idx == 5) {
+            REDIS_ASSERT(!vals[idx], "failed to test cross slot fanout");
+        } else {
+            // Keys after the inserted non-existent key are shifted by one.
+            auto expected = "val" + std::to_string(idx < 5 ? idx : idx - 1);
+            REDIS_ASSERT(vals[idx] && *vals[idx] == expected, "failed to test cross slot fanout");
+        }
+    }
+
+    auto num = cluster.del(mget_keys.begin(), mget_keys.end());
+    REDIS_ASSERT(num == 20, "failed to test cross slot fanout");
+
+    vals.clear();
+    cluster.mget(keys.begin(), keys.end(), std::back_inserter(vals));
+    REDIS_ASSERT(vals.size() == keys.size(), "failed to test cross slot fanout");
+    for (const auto &val : vals) {
+        REDIS_ASSERT(!val, "failed to test cross slot fanout");
+    }
+}
+
+template <typename RedisInstance>
+void ClusterTest<RedisInstance>::_test_cluster_pipeline() {
+    // Keys without hash tag, so that they belong to different nodes.
+    std::vector<std::string> keys;
+    for (auto idx = 0; idx != 20; ++idx) {
+        keys.push_back(key_prefix() + "::cluster_pipeline::" + std::to_string(idx));
+    }
+
+    auto hash_key = key_prefix() + "::cluster_pipeline::hash";
+    keys.push_back(hash_key);
+
+    for (const auto &key : keys) {
+        _redis.del(key);
+    }
+
+    auto pipe = _redis.cluster_pipeline();
+    for (auto idx = 0; idx != 20; ++idx) {
+        pipe.set(keys[idx], std::to_string(idx)).incr(keys[idx]);
+    }
+
+    pipe.hset(hash_key, "field", "val").command("HGET", hash_key, "field");
+
+    // GET on a hash should fail with WRONGTYPE error, while other commands succeed.
+    pipe.get(hash_key).del(hash_key);
+
+    REDIS_ASSERT(pipe.size() == 44, "failed to test cluster pipeline");
+
+    auto replies = pipe.exec();
+
+    REDIS_ASSERT(pipe.size() == 0 && replies.size() == 44, "failed to test cluster pipeline");
+
+    for (auto idx = 0; idx != 20; ++idx) {
+        REDIS_ASSERT(replies.template get<bool>(idx * 2), "failed to test cluster pipeline");
+        REDIS_ASSERT(replies.template get<long long>(idx * 2 + 1) == idx + 1,
+                "failed to test cluster pipeline");
+    }
+
+    REDIS_ASSERT(replies.template get<long long>(40) == 1, "failed to test cluster pipeline");
+    auto val = replies.template get<OptionalString>(41);
+    REDIS_ASSERT(val && *val == "val", "failed to test cluster pipeline");
+
+    try {
+        replies.get(42);
+        REDIS_ASSERT(false, "failed to test cluster pipeline");
+    } catch (const ReplyError &) {
+    }
+
+    REDIS_ASSERT(replies.template get<long long>(43) == 1, "failed to test cluster pipeline");
+
+    // The pipeline can be reused.
+    for (auto idx = 0; idx != 20; ++idx) {
+        pipe.get(keys[idx]);
+    }
+
+    replies = pipe.exec();
+    for (auto idx = 0; idx != 20; ++idx) {
+        val = replies.template get<OptionalString>(idx);
+        REDIS_ASSERT(val && *val == std::to_string(idx + 1), "failed to test cluster pipeline");
+    }
+
+    for (const auto &key : keys) {
+        _redis.del(key);
+    }
+}
+
+template <typename RedisInstance>
+void ClusterTest<RedisInstance>::_test_cluster_scanner() {
+    // Keys without hash tag, so that they're distributed to all nodes.
+    auto prefix = key_prefix() + "::scanner::";
+    std::unordered_set<std::string> keys;
+    for (auto idx = 0; idx != 200; ++idx) {
+        keys.insert(prefix + std::to_string(idx));
+    }
+
+    KeyDeleter<RedisInstance> deleter(_redis, keys.begin(), keys.end());
+
+    for (const auto &key : keys) {
+        _redis.set(key, "val");
+    }
+
+    ClusterScanOptions scan_opts;
+    scan_opts.pattern = prefix + "*";
+    scan_opts.count = 20;
+
+    std::unordered_set<std::string> scanned;
+    {
+        ClusterScanner scanner(_redis, scan_opts);
+        std::vector<std::string> page;
+        while (scanner.next(std::back_inserter(page))) {
+            REDIS_ASSERT(!page.empty(), "failed to test cluster scanner");
+
+            scanned.insert(page.begin(), page.end());
+            page.clear();
+        }
+    }
+
+    REDIS_ASSERT(scanned == keys, "failed to test cluster scanner");
+
+    // Stop before all pages have been consumed.
+    ClusterScanner scanner(_redis, scan_opts);
+    std::vector<std::string> page;
+    scanner.next(std::back_inserter(page));
+    scanner.stop();
+    REDIS_ASSERT(!scanner.next(std::back_inserter(page)), "failed to test cluster scanner");
+}
+
+template <typename RedisInstance>
+void ClusterTest<RedisInstance>::_test_key_slots() {
+    REDIS_ASSERT(crc16("123456789", 9) == 0x31C3, "failed to test crc16");
+
+    // Keys longer than 8 bytes, with and without hash tags.
+    std::vector<std::string> keys = {"foo", "somekey", "{user1000}.following",
+        "{user1000}.followers", "foo{}{bar}", "foo{{bar}}zap", "foo{bar}{zap}",
+        "a-key-which-is-longer-than-eight-bytes", "{", "}{", ""};
+    std::vector<Slot> expected = {12182, 11058, 3443, 3443};
+    for (std::size_t idx = expected.size(); idx != keys.size(); ++idx) {
+        // Check with the slot calculated by Redis.
+        auto reply = _redis.redis(keys[idx], false).command("CLUSTER", "KEYSLOT", keys[idx]);
+        expected.push_back(static_cast<Slot>(reply::parse<long long>(*reply)));
+    }
+
+    std::vector<Slot> slots;
+    key_slots(keys.begin(), keys.end(), std::back_inserter(slots));
+    REDIS_ASSERT(slots == expected, "failed to test key slots");
+
+    for (std::size_t idx = 0; idx != keys.size(); ++idx) {
+        REDIS_ASSERT(key_slot(keys[idx]) == expected[idx], "failed to test key slot");
+    }
 }
 
 }
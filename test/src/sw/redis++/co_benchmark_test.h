@@ -0,0 +1,108 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CO_BENCHMARK_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_CO_BENCHMARK_TEST_H
+
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <vector>
+#include <sw/redis++/co_redis++.h>
+#include "async_benchmark_test.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// A coroutine which starts running once it's called, and destroys itself when it's done.
+// Its frame is allocated with `CoFrameAllocator`.
+struct DetachedTask {
+    struct promise_type : CoFramePromise {
+        DetachedTask get_return_object() noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+template <typename RedisInstance>
+class CoBenchmarkTest {
+public:
+    CoBenchmarkTest(const BenchmarkOptions &opts,
+                    const ConnectionOptions &connection_opts,
+                    BenchmarkReport &report);
+
+    void run();
+
+private:
+    void _run_cases(RedisInstance &redis, BenchmarkCase c, const std::string &value);
+
+    // Each thread starts `async_window` coroutines, each of which awaits `func(idx)`
+    // one by one. Coroutines are resumed in the event loop thread, where latencies
+    // are measured.
+    template <typename Func>
+    void _run(const BenchmarkCase &c, Func &&func);
+
+    // Await `request_num` requests, whose latencies are written to `latencies`.
+    template <typename Func>
+    static DetachedTask _await(Func &func,
+                                std::size_t first,
+                                std::size_t request_num,
+                                std::uint64_t *latencies,
+                                RequestWindow &window);
+
+    static const char* _client();
+
+    void _cleanup(RedisInstance &redis);
+
+    const std::string& _key(std::size_t idx) const {
+        return _keys[idx % _keys.size()];
+    }
+
+    BenchmarkOptions _opts;
+
+    ConnectionOptions _connection_opts;
+
+    BenchmarkReport &_report;
+
+    std::vector<std::string> _keys;
+};
+
+}
+
+}
+
+}
+
+#include "co_benchmark_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CO_BENCHMARK_TEST_H
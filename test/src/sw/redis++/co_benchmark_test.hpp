@@ -0,0 +1,156 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CO_BENCHMARK_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_CO_BENCHMARK_TEST_HPP
+
+#include <algorithm>
+#include <chrono>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+template <typename RedisInstance>
+CoBenchmarkTest<RedisInstance>::CoBenchmarkTest(const BenchmarkOptions &opts,
+                                                const ConnectionOptions &connection_opts,
+                                                BenchmarkReport &report) :
+                                                    _opts(opts),
+                                                    _connection_opts(connection_opts),
+                                                    _report(report) {
+    REDIS_ASSERT(_opts.async_window > 0, "Invalid benchmark test options.");
+
+    _keys = gen_benchmark_keys(_opts.key_len);
+}
+
+template <typename RedisInstance>
+void CoBenchmarkTest<RedisInstance>::run() {
+    run_benchmark_matrix<RedisInstance>(_opts, _connection_opts, _client(),
+            [this](RedisInstance &redis, const BenchmarkCase &c, const std::string &value) {
+                this->_run_cases(redis, c, value);
+            });
+}
+
+template <typename RedisInstance>
+void CoBenchmarkTest<RedisInstance>::_run_cases(RedisInstance &redis,
+                                                BenchmarkCase c,
+                                                const std::string &value) {
+    _cleanup(redis);
+
+    c.title = "SET (coroutine)";
+    _run(c, [&, this](std::size_t idx) { return redis.set(this->_key(idx), value); });
+
+    c.title = "GET (coroutine)";
+    _run(c, [&, this](std::size_t idx) { return redis.get(this->_key(idx)); });
+
+    _cleanup(redis);
+}
+
+template <typename RedisInstance>
+template <typename Func>
+void CoBenchmarkTest<RedisInstance>::_run(const BenchmarkCase &c, Func &&func) {
+    auto coroutine_num = _opts.async_window;
+    auto requests_per_coroutine = std::max<std::size_t>(
+            _opts.total_request_num / c.thread_num / coroutine_num, 1);
+
+    run_benchmark_case(_report, c, requests_per_coroutine * coroutine_num,
+            [&func, coroutine_num, requests_per_coroutine](std::size_t first,
+                                                            std::size_t request_num) {
+                // Coroutines write latencies without lock, so the vector should never be resized.
+                std::vector<std::uint64_t> latencies(request_num, 0);
+
+                RequestWindow window(coroutine_num);
+                for (std::size_t idx = 0; idx != coroutine_num; ++idx) {
+                    window.acquire();
+
+                    auto offset = idx * requests_per_coroutine;
+                    CoBenchmarkTest::_await(func, first + offset, requests_per_coroutine,
+                            latencies.data() + offset, window);
+                }
+
+                window.wait_all();
+
+                return latencies;
+            });
+}
+
+template <typename RedisInstance>
+template <typename Func>
+DetachedTask CoBenchmarkTest<RedisInstance>::_await(Func &func,
+                                                    std::size_t first,
+                                                    std::size_t request_num,
+                                                    std::uint64_t *latencies,
+                                                    RequestWindow &window) {
+    std::exception_ptr err;
+    try {
+        for (std::size_t idx = 0; idx != request_num; ++idx) {
+            auto start = std::chrono::steady_clock::now();
+
+            co_await func(first + idx);
+
+            latencies[idx] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+        }
+    } catch (...) {
+        err = std::current_exception();
+    }
+
+    // NOTE: `func` and `window` might be destroyed once it's released.
+    window.release(err);
+}
+
+template <typename RedisInstance>
+const char* CoBenchmarkTest<RedisInstance>::_client() {
+    return "CoRedis";
+}
+
+template <>
+inline const char* CoBenchmarkTest<CoRedisCluster>::_client() {
+    return "CoRedisCluster";
+}
+
+template <typename RedisInstance>
+void CoBenchmarkTest<RedisInstance>::_cleanup(RedisInstance &redis) {
+    auto del_keys = [](RedisInstance &r, const std::vector<std::string> &keys,
+                    RequestWindow &window) -> DetachedTask {
+        std::exception_ptr err;
+        try {
+            for (const auto &key : keys) {
+                co_await r.del(key);
+            }
+        } catch (...) {
+            err = std::current_exception();
+        }
+
+        window.release(err);
+    };
+
+    RequestWindow window(1);
+    window.acquire();
+    del_keys(redis, _keys, window);
+    window.wait_all();
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CO_BENCHMARK_TEST_HPP
@@ -0,0 +1,75 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CO_REDIS_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_CO_REDIS_TEST_H
+
+#include <cstddef>
+#include <future>
+#include <sw/redis++/co_redis++.h>
+#include "co_benchmark_test.h"
+#include "mock_server.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// Tests of CoRedis with in-process mock servers, which need no Redis server.
+class CoRedisTest {
+public:
+    void run();
+
+private:
+    void _test_reply();
+
+    void _test_error();
+
+    void _test_loop_shutdown();
+
+    void _test_allocation();
+
+    void _test_transaction();
+
+    // Await the awaiter returned by `func`, and set its result or error to `pro`.
+    template <typename Result, typename Func>
+    static DetachedTask _await(Func func, std::promise<Result> &pro);
+
+    // Block until the awaiter returned by `func` is done.
+    template <typename Result, typename Func>
+    static Result _get(Func func);
+
+    // Await `requests` GET commands, and set the number of allocations in the event
+    // loop thread to `pro`.
+    static DetachedTask _count_allocations(CoRedis &redis,
+                                            std::size_t requests,
+                                            std::promise<std::size_t> &pro);
+
+    // Run transactions with `co_await`, and set the error, if any, to `pro`.
+    static DetachedTask _run_transactions(CoRedis &redis, std::promise<void> &pro);
+};
+
+}
+
+}
+
+}
+
+#include "co_redis_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CO_REDIS_TEST_H
@@ -0,0 +1,297 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_CO_REDIS_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_CO_REDIS_TEST_HPP
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// Number of `operator new` calls in the current thread.
+inline thread_local std::size_t co_allocations = 0;
+
+}
+
+}
+
+}
+
+// Count allocations, so that we can check that awaiting a command does not allocate
+// an event on heap. NOTE: this file is only included by test_main.cpp.
+void* operator new(std::size_t size) {
+    ++sw::redis::test::co_allocations;
+
+    auto *ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+inline void CoRedisTest::run() {
+    _test_reply();
+
+    _test_error();
+
+    _test_loop_shutdown();
+
+    _test_allocation();
+
+    _test_transaction();
+}
+
+inline void CoRedisTest::_test_reply() {
+    MockServerOptions opts;
+    opts.value = "mock";
+
+    MockServer server(opts);
+    CoRedis redis(server.options());
+
+    auto val = _get<OptionalString>([&redis]() { return redis.get("key"); });
+    REDIS_ASSERT(val && *val == opts.value, "failed to test coroutine with reply");
+
+    auto num = _get<long long>([&redis]() { return redis.command<long long>("INCR", "key"); });
+    REDIS_ASSERT(num == 1, "failed to test coroutine with integer reply");
+}
+
+inline void CoRedisTest::_test_error() {
+    MockServerOptions opts;
+    MockServer server([opts](MockSession &session, const std::vector<std::string> &cmd) {
+                if (mock::command_name(cmd) == "GET" && cmd.size() > 1 && cmd[1] == "error") {
+                    return mock::error("ERR mock error");
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            });
+
+    CoRedis redis(server.options());
+
+    try {
+        _get<OptionalString>([&redis]() { return redis.get("error"); });
+        REDIS_ASSERT(false, "failed to test coroutine with error reply");
+    } catch (const ReplyError &) {
+    }
+
+    // The reply of GET is NOT an integer reply.
+    try {
+        _get<long long>([&redis]() { return redis.command<long long>("GET", "key"); });
+        REDIS_ASSERT(false, "failed to test coroutine with parse error");
+    } catch (const ProtoError &) {
+    }
+
+    // The connection is still usable.
+    auto val = _get<OptionalString>([&redis]() { return redis.get("key"); });
+    REDIS_ASSERT(val && *val == opts.value, "failed to test coroutine after error");
+}
+
+inline void CoRedisTest::_test_loop_shutdown() {
+    MockServerOptions opts;
+    MockServer server([opts](MockSession &session, const std::vector<std::string> &cmd) {
+                if (mock::command_name(cmd) == "AUTH") {
+                    // Keep the command pending, until the event loop has been stopped.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            });
+
+    auto connection_opts = server.options();
+    connection_opts.password = "password";
+
+    std::promise<OptionalString> pro;
+    auto fut = pro.get_future();
+    {
+        CoRedis redis(connection_opts);
+
+        _await([&redis]() { return redis.get("key"); }, pro);
+
+        // Destroying CoRedis stops the event loop, and fails the pending command.
+    }
+
+    REDIS_ASSERT(fut.wait_for(std::chrono::seconds(0)) == std::future_status::ready,
+            "coroutine should be resumed when event loop is stopped");
+
+    try {
+        fut.get();
+        REDIS_ASSERT(false, "failed to test coroutine with loop shutdown");
+    } catch (const Error &) {
+    }
+}
+
+inline void CoRedisTest::_test_allocation() {
+    MockServerOptions opts;
+    opts.value = "mock";
+
+    MockServer server(opts);
+    CoRedis redis(server.options());
+
+    const std::size_t requests = 256;
+
+    std::promise<std::size_t> pro;
+    auto fut = pro.get_future();
+    _count_allocations(redis, requests, pro);
+
+    // If each command allocated an event, there would be at least one allocation per
+    // request. The connection pool's deque allocates a block once in a while.
+    auto allocations = fut.get();
+    REDIS_ASSERT(allocations < requests / 4, "awaiting a command should not allocate, "
+            "but got " + std::to_string(allocations) + " allocations");
+}
+
+inline void CoRedisTest::_test_transaction() {
+    MockServerOptions opts;
+    MockServer server([opts](MockSession &session, const std::vector<std::string> &cmd) {
+                if (mock::command_name(cmd) == "WATCH" && cmd.size() > 1 && cmd[1] == "conflict") {
+                    // Watched key is always modified by others.
+                    session.dirty = true;
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            });
+
+    CoRedis redis(server.options());
+
+    std::promise<void> pro;
+    auto fut = pro.get_future();
+    _run_transactions(redis, pro);
+
+    fut.get();
+}
+
+template <typename Result, typename Func>
+DetachedTask CoRedisTest::_await(Func func, std::promise<Result> &pro) {
+    try {
+        pro.set_value(co_await func());
+    } catch (...) {
+        pro.set_exception(std::current_exception());
+    }
+}
+
+template <typename Result, typename Func>
+Result CoRedisTest::_get(Func func) {
+    std::promise<Result> pro;
+    auto fut = pro.get_future();
+
+    _await(std::move(func), pro);
+
+    return fut.get();
+}
+
+inline DetachedTask CoRedisTest::_count_allocations(CoRedis &redis,
+                                                    std::size_t requests,
+                                                    std::promise<std::size_t> &pro) {
+    try {
+        // Connect, and warm up buffers. After that, the coroutine runs in the event loop thread.
+        co_await redis.get("key");
+
+        auto before = co_allocations;
+        for (std::size_t idx = 0; idx != requests; ++idx) {
+            co_await redis.get("key");
+        }
+
+        pro.set_value(co_allocations - before);
+    } catch (...) {
+        pro.set_exception(std::current_exception());
+    }
+}
+
+inline DetachedTask CoRedisTest::_run_transactions(CoRedis &redis, std::promise<void> &pro) {
+    try {
+        {
+            // The transaction holds the only connection of the pool, until it's destroyed.
+            auto tx = redis.transaction();
+            auto set_res = tx.set("key", "val");
+            auto incr_res = tx.incr("counter");
+
+            co_await redis.exec(tx);
+            REDIS_ASSERT(set_res.get() && incr_res.get() == 1,
+                    "failed to test coroutine with transaction");
+
+            // Nothing to send.
+            co_await redis.exec(tx);
+
+            tx.watch("conflict");
+            set_res = tx.set("key", "val");
+            try {
+                co_await redis.exec(tx);
+                REDIS_ASSERT(false, "failed to test coroutine with aborted transaction");
+            } catch (const WatchError &) {
+            }
+        }
+
+        // Retry until watched keys are NOT modified.
+        std::size_t attempts = 0;
+        co_await redis.transaction([&attempts](AsyncTransaction &tx, TransactionExec exec) {
+                    tx.watch(++attempts < 3 ? "conflict" : "key");
+                    tx.incr("counter");
+                    exec();
+                }, 3);
+        REDIS_ASSERT(attempts == 3, "failed to test coroutine with transaction retry");
+
+        attempts = 0;
+        try {
+            co_await redis.transaction([&attempts](AsyncTransaction &tx, TransactionExec exec) {
+                        ++attempts;
+                        tx.watch("conflict");
+                        tx.incr("counter");
+                        exec();
+                    }, 1);
+            REDIS_ASSERT(false, "failed to test coroutine with transaction retry");
+        } catch (const WatchError &) {
+        }
+        REDIS_ASSERT(attempts == 2, "failed to test coroutine with transaction max retries");
+
+        pro.set_value();
+    } catch (...) {
+        pro.set_exception(std::current_exception());
+    }
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_CO_REDIS_TEST_HPP
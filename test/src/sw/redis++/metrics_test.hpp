@@ -0,0 +1,202 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_METRICS_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_METRICS_TEST_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include "utils.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+template <typename RedisInstance>
+void MetricsTest<RedisInstance>::run() {
+    _test_histogram();
+
+    _test_commands();
+
+    _test_command_names();
+
+    _test_pool_wait();
+}
+
+template <typename RedisInstance>
+void MetricsTest<RedisInstance>::_test_histogram() {
+    LatencyHistogram histogram;
+
+    REDIS_ASSERT(histogram.count() == 0 && histogram.percentile(99).count() == 0,
+            "failed to test empty histogram");
+
+    // 1us, 2us, ..., 1000us
+    for (auto idx = 1; idx <= 1000; ++idx) {
+        histogram.record(std::chrono::microseconds(idx));
+    }
+
+    REDIS_ASSERT(histogram.count() == 1000, "failed to test histogram count");
+
+    REDIS_ASSERT(histogram.max() == std::chrono::microseconds(1000), "failed to test histogram max");
+
+    REDIS_ASSERT(histogram.mean() == std::chrono::nanoseconds(500500),
+            "failed to test histogram mean");
+
+    // Relative error of each bucket is less than 1/64.
+    auto near = [](std::chrono::nanoseconds val, std::chrono::microseconds expected) {
+        auto diff = val - std::chrono::nanoseconds(expected);
+        return diff.count() >= 0 && diff.count() * 64 <= std::chrono::nanoseconds(expected).count();
+    };
+
+    REDIS_ASSERT(near(histogram.percentile(50), std::chrono::microseconds(500)),
+            "failed to test histogram p50");
+
+    REDIS_ASSERT(near(histogram.percentile(99), std::chrono::microseconds(990)),
+            "failed to test histogram p99");
+
+    REDIS_ASSERT(histogram.percentile(100) == histogram.max(), "failed to test histogram p100");
+
+    histogram.reset();
+
+    REDIS_ASSERT(histogram.count() == 0 && histogram.max().count() == 0,
+            "failed to test histogram reset");
+}
+
+template <typename RedisInstance>
+void MetricsTest<RedisInstance>::_test_commands() {
+    auto metrics = std::make_shared<Metrics>();
+
+    auto opts = _opts;
+    opts.metrics = metrics;
+
+    RedisInstance redis(opts);
+
+    auto key = test_key("metrics");
+
+    KeyDeleter<RedisInstance> deleter(redis, key);
+
+    REDIS_ASSERT(metrics->command_latency("GET") == nullptr,
+            "failed to test metrics of command not sent");
+
+    redis.set(key, "value");
+
+    for (auto idx = 0; idx != 10; ++idx) {
+        REDIS_ASSERT(bool(redis.get(key)), "failed to test metrics get");
+    }
+
+    const auto *set_latency = metrics->command_latency("SET");
+    REDIS_ASSERT(set_latency != nullptr && set_latency->count() == 1,
+            "failed to test metrics of SET");
+
+    const auto *get_latency = metrics->command_latency("GET");
+    REDIS_ASSERT(get_latency != nullptr && get_latency->count() == 10,
+            "failed to test metrics of GET");
+
+    REDIS_ASSERT(get_latency->percentile(99.9) > std::chrono::nanoseconds(0)
+            && get_latency->percentile(99.9) <= get_latency->max(),
+            "failed to test metrics of GET latency");
+
+    // GET {key}, i.e. *2\r\n$3\r\nGET\r\n$<len>\r\n<key>\r\n
+    auto get_size = 4 + 9 + 1 + std::to_string(key.size()).size() + 2 + key.size() + 2;
+    REDIS_ASSERT(metrics->bytes_sent() >= 10 * get_size, "failed to test metrics of bytes sent");
+
+    // $5\r\nvalue\r\n
+    REDIS_ASSERT(metrics->bytes_received() >= 10 * 11, "failed to test metrics of bytes received");
+
+    REDIS_ASSERT(metrics->moved_redirects() == 0 && metrics->ask_redirects() == 0,
+            "failed to test metrics of redirects");
+}
+
+template <typename RedisInstance>
+void MetricsTest<RedisInstance>::_test_command_names() {
+    Metrics metrics;
+
+    metrics.on_command("get", std::chrono::microseconds(1));
+    metrics.on_command("GET", std::chrono::microseconds(2));
+    metrics.on_command("Get", std::chrono::microseconds(3));
+
+    // Command names are case-insensitive.
+    const auto *latency = metrics.command_latency("gEt");
+    REDIS_ASSERT(latency != nullptr && latency->count() == 3
+            && latency == metrics.command_latency("GET"),
+            "failed to test metrics of command names");
+
+    auto names = metrics.commands();
+    REDIS_ASSERT(names.size() == 1 && names.front() == "GET",
+            "failed to test metrics of command names in upper case");
+
+    // Commands after the first `MAX_COMMANDS` ones are recorded as OTHERS.
+    REDIS_ASSERT(metrics.command_latency("OTHERS") == nullptr,
+            "failed to test metrics of other commands");
+
+    for (std::size_t idx = 0; idx != Metrics::MAX_COMMANDS + 10; ++idx) {
+        metrics.on_command("cmd" + std::to_string(idx), std::chrono::microseconds(1));
+    }
+
+    REDIS_ASSERT(metrics.commands().size() == Metrics::MAX_COMMANDS + 1,
+            "failed to test metrics of too many commands");
+
+    latency = metrics.command_latency("OTHERS");
+    REDIS_ASSERT(latency != nullptr && latency->count() == 11,
+            "failed to test metrics of other commands");
+
+    REDIS_ASSERT(metrics.command_latency("CMD0") != nullptr
+            && metrics.command_latency("cmd" + std::to_string(Metrics::MAX_COMMANDS)) == nullptr,
+            "failed to test metrics of too many commands");
+}
+
+template <typename RedisInstance>
+void MetricsTest<RedisInstance>::_test_pool_wait() {
+    auto metrics = std::make_shared<Metrics>();
+
+    auto opts = _opts;
+    opts.metrics = metrics;
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = 1;
+
+    RedisInstance redis(opts, pool_opts);
+
+    auto key = test_key("metrics_pool_wait");
+
+    KeyDeleter<RedisInstance> deleter(redis, key);
+
+    // Hold the only connection with a blocking command, so that LPUSH has to wait
+    // for the connection until BLPOP times out.
+    std::thread blocking([&redis, &key]() {
+        redis.blpop(key, std::chrono::seconds(1));
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    redis.lpush(key, "value");
+
+    blocking.join();
+
+    REDIS_ASSERT(metrics->pool_wait().count() >= 1, "failed to test metrics of pool wait");
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_METRICS_TEST_HPP
@@ -0,0 +1,288 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_H
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sw/redis++/redis++.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// Build replies in RESP format.
+namespace mock {
+
+std::string status(const std::string &str);
+
+std::string error(const std::string &str);
+
+std::string integer(long long num);
+
+std::string bulk(const std::string &str);
+
+std::string nil();
+
+// `elements` are replies in RESP format.
+std::string array(const std::vector<std::string> &elements);
+
+// Command name in upper case.
+std::string command_name(const std::vector<std::string> &cmd);
+
+}
+
+struct MockServerOptions {
+    // Value of string, list elements and hash fields in canned replies.
+    std::string value = std::string(10, 'x');
+
+    // Number of elements of lists and hashes in canned replies.
+    std::size_t collection_len = 10;
+
+    // Time that a node of mock cluster spends on each keyed command it serves,
+    // so that we can check whether nodes process commands in parallel.
+    std::chrono::milliseconds delay{0};
+};
+
+// State of a client connection.
+struct MockSession {
+    // RESP version set by HELLO command.
+    int resp = 2;
+
+    // Whether ASKING has been sent, and it's only valid for the next command.
+    bool asking = false;
+
+    // Whether it's in a MULTI block.
+    bool multi = false;
+
+    // Whether watched keys have been modified, which is set by handlers. In this case,
+    // EXEC is aborted with a nil reply.
+    bool dirty = false;
+
+    // Whether READONLY has been sent, and replicas serve reads only in this case.
+    bool readonly = false;
+
+    // Replies of commands queued in a MULTI block.
+    std::vector<std::string> queued;
+};
+
+// A server running in the test process, which speaks RESP2 and RESP3 on a loopback
+// TCP port. Commands are replied by a handler without any server-side work, so that
+// we can measure the client side cost, or script replies for some cases.
+//
+// Each client connection is served by a thread. MULTI, EXEC and DISCARD are handled
+// by the server, and other commands are passed to the handler.
+// NOTE: it only works on POSIX platforms.
+class MockServer {
+public:
+    // Return the reply of `cmd` in RESP format.
+    using Handler = std::function<std::string (MockSession &session,
+                                                const std::vector<std::string> &cmd)>;
+
+    // Reply commands with `canned_reply`.
+    explicit MockServer(const MockServerOptions &opts = {});
+
+    explicit MockServer(Handler handler);
+
+    MockServer(const MockServer &) = delete;
+    MockServer& operator=(const MockServer &) = delete;
+
+    MockServer(MockServer &&) = delete;
+    MockServer& operator=(MockServer &&) = delete;
+
+    ~MockServer();
+
+    int port() const {
+        return _port;
+    }
+
+    // Options to connect to this server.
+    ConnectionOptions options() const;
+
+    // Number of commands received, including commands sent when creating connections.
+    std::size_t commands() const {
+        return _commands;
+    }
+
+    // Errors thrown when serving client connections, e.g. malformed commands, or
+    // exceptions thrown by the handler. The connection is closed in this case.
+    std::vector<std::string> errors() const;
+
+    // Reply commands with type-correct replies, e.g. GET gets a bulk string reply,
+    // LRANGE gets an array reply, and unknown commands get an OK reply.
+    static std::string canned_reply(const MockServerOptions &opts,
+                                    MockSession &session,
+                                    const std::vector<std::string> &cmd);
+
+private:
+    void _listen();
+
+    void _accept();
+
+    void _serve(int fd);
+
+    void _serve_loop(int fd);
+
+    // Close the client connection, which fails with `err`.
+    void _close(int fd, const std::string &err);
+
+    // Parse a command from `buf` starting from `pos`. Return false, if it's incomplete.
+    static bool _parse(const std::string &buf,
+                        std::size_t &pos,
+                        std::vector<std::string> &cmd);
+
+    std::string _reply(MockSession &session, const std::vector<std::string> &cmd);
+
+    Handler _handler;
+
+    int _fd = -1;
+
+    int _port = 0;
+
+    std::atomic<std::size_t> _commands{0};
+
+    mutable std::mutex _mutex;
+
+    bool _stop = false;
+
+    std::vector<std::string> _errors;
+
+    // File descriptors of client connections.
+    std::vector<int> _clients;
+
+    std::vector<std::thread> _workers;
+
+    std::thread _acceptor;
+};
+
+// A fake cluster of mock servers. Slots are evenly assigned to nodes, and nodes reply
+// MOVED or ASK errors for keys of slots they don't serve, so that redirections can
+// be reproduced by moving or migrating slots.
+//
+// Each node can have `replica_num` replicas, which serve reads of their master's slots
+// after a READONLY command, and reply MOVED errors otherwise.
+class MockCluster {
+public:
+    explicit MockCluster(std::size_t node_num,
+                            const MockServerOptions &opts = {},
+                            std::size_t replica_num = 0);
+
+    MockCluster(const MockCluster &) = delete;
+    MockCluster& operator=(const MockCluster &) = delete;
+
+    MockCluster(MockCluster &&) = delete;
+    MockCluster& operator=(MockCluster &&) = delete;
+
+    ~MockCluster() = default;
+
+    // Options to connect to the first node.
+    ConnectionOptions options() const;
+
+    std::size_t node(Slot slot) const;
+
+    std::size_t size() const {
+        return _nodes.size();
+    }
+
+    std::size_t replicas() const {
+        return _replicas.front().size();
+    }
+
+    int port(std::size_t node) const {
+        return _nodes.at(node)->port();
+    }
+
+    int replica_port(std::size_t node, std::size_t idx) const {
+        return _replicas.at(node).at(idx)->port();
+    }
+
+    // Number of keyed commands served by the node, excluding redirections.
+    std::size_t served(std::size_t node) const;
+
+    // Number of keyed commands served by the `idx`-th replica of the node.
+    std::size_t replica_served(std::size_t node, std::size_t idx) const;
+
+    // The slot is moved to `node`, and the old node replies MOVED errors for it.
+    void move_slot(Slot slot, std::size_t node);
+
+    // The slot starts migrating to `node`, and the old node replies ASK errors for it.
+    // `node` only serves the slot, if the command is sent after an ASKING command.
+    // Call `move_slot` to finish the migration.
+    void migrate_slot(Slot slot, std::size_t node);
+
+    // Number of MOVED and ASK errors replied.
+    std::size_t redirections() const {
+        return _redirections;
+    }
+
+private:
+    static const std::size_t SLOT_NUM = 16384;
+
+    // `server` is 0 for the master, and `idx + 1` for the `idx`-th replica.
+    std::string _reply(std::size_t node,
+                        std::size_t server,
+                        MockSession &session,
+                        const std::vector<std::string> &cmd);
+
+    std::size_t _served_index(std::size_t node, std::size_t server) const {
+        return node * (replicas() + 1) + server;
+    }
+
+    std::string _cluster_slots() const;
+
+    std::string _redirect(const std::string &type, Slot slot, std::size_t node);
+
+    MockServerOptions _opts;
+
+    std::vector<std::unique_ptr<MockServer>> _nodes;
+
+    // Replicas of each node.
+    std::vector<std::vector<std::unique_ptr<MockServer>>> _replicas;
+
+    mutable std::mutex _mutex;
+
+    // Owner of each slot.
+    std::vector<std::size_t> _owners;
+
+    // Slots being migrated, and the nodes they're migrated to.
+    std::unordered_map<Slot, std::size_t> _migrating;
+
+    // Keyed commands served by each server, indexed by `_served_index`.
+    std::vector<std::size_t> _served;
+
+    std::atomic<std::size_t> _redirections{0};
+};
+
+}
+
+}
+
+}
+
+#include "mock_server.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_H
@@ -0,0 +1,643 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <unordered_set>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+namespace mock {
+
+inline std::string status(const std::string &str) {
+    return "+" + str + "\r\n";
+}
+
+inline std::string error(const std::string &str) {
+    return "-" + str + "\r\n";
+}
+
+inline std::string integer(long long num) {
+    return ":" + std::to_string(num) + "\r\n";
+}
+
+inline std::string bulk(const std::string &str) {
+    return "$" + std::to_string(str.size()) + "\r\n" + str + "\r\n";
+}
+
+inline std::string nil() {
+    return "$-1\r\n";
+}
+
+inline std::string array(const std::vector<std::string> &elements) {
+    auto res = "*" + std::to_string(elements.size()) + "\r\n";
+    for (const auto &element : elements) {
+        res += element;
+    }
+
+    return res;
+}
+
+inline std::string command_name(const std::vector<std::string> &cmd) {
+    if (cmd.empty()) {
+        return {};
+    }
+
+    auto name = cmd.front();
+    for (auto &c : name) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+
+    return name;
+}
+
+}
+
+inline MockServer::MockServer(const MockServerOptions &opts) :
+    MockServer([opts](MockSession &session, const std::vector<std::string> &cmd) {
+                    return MockServer::canned_reply(opts, session, cmd);
+                }) {}
+
+inline MockServer::MockServer(Handler handler) : _handler(std::move(handler)) {
+    _listen();
+
+    _acceptor = std::thread([this]() { this->_accept(); });
+}
+
+inline MockServer::~MockServer() {
+    std::vector<int> clients;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _stop = true;
+        clients = _clients;
+    }
+
+    // Wake up threads blocked on accepting or reading.
+    ::shutdown(_fd, SHUT_RDWR);
+
+    if (_acceptor.joinable()) {
+        _acceptor.join();
+    }
+
+    for (auto fd : clients) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+
+    for (auto &worker : _workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    for (auto fd : clients) {
+        ::close(fd);
+    }
+
+    ::close(_fd);
+}
+
+inline ConnectionOptions MockServer::options() const {
+    ConnectionOptions opts;
+    opts.host = "127.0.0.1";
+    opts.port = _port;
+
+    return opts;
+}
+
+inline std::vector<std::string> MockServer::errors() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _errors;
+}
+
+inline std::string MockServer::canned_reply(const MockServerOptions &opts,
+                                            MockSession &session,
+                                            const std::vector<std::string> &cmd) {
+    static const std::unordered_set<std::string> INTEGER_CMDS = {
+        "DEL", "UNLINK", "EXISTS", "EXPIRE", "PEXPIRE", "TTL", "PTTL",
+        "INCR", "INCRBY", "DECR", "DECRBY", "APPEND", "STRLEN",
+        "LPUSH", "RPUSH", "LLEN", "HSET", "HDEL", "HLEN",
+        "SADD", "SREM", "SCARD", "ZADD", "ZREM", "ZCARD", "PUBLISH"
+    };
+
+    static const std::unordered_set<std::string> BULK_CMDS = {
+        "GET", "GETSET", "GETDEL", "HGET", "LPOP", "RPOP", "LINDEX", "SPOP"
+    };
+
+    static const std::unordered_set<std::string> ARRAY_CMDS = {
+        "LRANGE", "SMEMBERS", "ZRANGE", "HKEYS", "HVALS", "KEYS"
+    };
+
+    auto name = mock::command_name(cmd);
+
+    if (name == "PING") {
+        return cmd.size() > 1 ? mock::bulk(cmd[1]) : mock::status("PONG");
+    }
+
+    if (name == "HELLO") {
+        if (cmd.size() > 1) {
+            session.resp = std::stoi(cmd[1]);
+        }
+
+        auto fields = mock::bulk("server") + mock::bulk("redis")
+            + mock::bulk("proto") + mock::integer(session.resp);
+
+        return session.resp > 2 ? "%2\r\n" + fields : "*4\r\n" + fields;
+    }
+
+    if (name == "CLUSTER") {
+        return mock::error("ERR This instance has cluster support disabled");
+    }
+
+    if (INTEGER_CMDS.count(name) > 0) {
+        return mock::integer(1);
+    }
+
+    if (BULK_CMDS.count(name) > 0) {
+        return mock::bulk(opts.value);
+    }
+
+    if (ARRAY_CMDS.count(name) > 0) {
+        return mock::array(std::vector<std::string>(opts.collection_len, mock::bulk(opts.value)));
+    }
+
+    if (name == "MGET" || name == "HMGET") {
+        auto num = name == "MGET" ? cmd.size() - 1 : cmd.size() - 2;
+        return mock::array(std::vector<std::string>(num, mock::bulk(opts.value)));
+    }
+
+    if (name == "HGETALL") {
+        std::string fields;
+        for (std::size_t idx = 0; idx != opts.collection_len; ++idx) {
+            fields += mock::bulk("field" + std::to_string(idx)) + mock::bulk(opts.value);
+        }
+
+        if (session.resp > 2) {
+            return "%" + std::to_string(opts.collection_len) + "\r\n" + fields;
+        }
+
+        return "*" + std::to_string(opts.collection_len * 2) + "\r\n" + fields;
+    }
+
+    return mock::status("OK");
+}
+
+inline void MockServer::_listen() {
+    _fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0) {
+        throw Error("failed to create socket for mock server: " + std::string(std::strerror(errno)));
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // Let the system choose a free port.
+    addr.sin_port = 0;
+
+    socklen_t len = sizeof(addr);
+    if (::bind(_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+            || ::listen(_fd, SOMAXCONN) != 0
+            || ::getsockname(_fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+        auto err = errno;
+        ::close(_fd);
+        throw Error("failed to listen for mock server: " + std::string(std::strerror(err)));
+    }
+
+    _port = ntohs(addr.sin_port);
+}
+
+inline void MockServer::_accept() {
+    while (true) {
+        auto fd = ::accept(_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+
+            // The listening socket has been shutdown.
+            break;
+        }
+
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_stop) {
+            ::close(fd);
+            break;
+        }
+
+        _clients.push_back(fd);
+        _workers.emplace_back([this, fd]() { this->_serve(fd); });
+    }
+}
+
+inline void MockServer::_serve(int fd) {
+    // Exceptions escaping the thread would terminate the test process.
+    try {
+        _serve_loop(fd);
+    } catch (const std::exception &e) {
+        _close(fd, e.what());
+    } catch (...) {
+        _close(fd, "unknown error");
+    }
+}
+
+inline void MockServer::_close(int fd, const std::string &err) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _errors.push_back(err);
+
+    if (_stop) {
+        // The destructor closes all client connections.
+        return;
+    }
+
+    auto iter = std::find(_clients.begin(), _clients.end(), fd);
+    if (iter != _clients.end()) {
+        _clients.erase(iter);
+    }
+
+    ::close(fd);
+}
+
+inline void MockServer::_serve_loop(int fd) {
+    const std::size_t READ_BUFFER_SIZE = 16 * 1024;
+
+    MockSession session;
+    std::string buf;
+    std::string out;
+    std::vector<char> chunk(READ_BUFFER_SIZE);
+    std::vector<std::string> cmd;
+    while (true) {
+        auto len = ::read(fd, chunk.data(), chunk.size());
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (len <= 0) {
+            // Closed by client, or the server is stopped.
+            break;
+        }
+
+        buf.append(chunk.data(), static_cast<std::size_t>(len));
+
+        // Reply all complete commands with a single write, since they might be pipelined.
+        std::size_t pos = 0;
+        while (_parse(buf, pos, cmd)) {
+            if (!cmd.empty()) {
+                out += _reply(session, cmd);
+            }
+        }
+        buf.erase(0, pos);
+
+        std::size_t sent = 0;
+        while (sent < out.size()) {
+            auto n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (n <= 0) {
+                return;
+            }
+
+            sent += static_cast<std::size_t>(n);
+        }
+        out.clear();
+    }
+}
+
+inline bool MockServer::_parse(const std::string &buf,
+                                std::size_t &pos,
+                                std::vector<std::string> &cmd) {
+    // Read a line ending with CRLF, and move `p` to the next line.
+    auto read_line = [&buf](std::size_t &p, std::string &line) {
+        auto end = buf.find("\r\n", p);
+        if (end == std::string::npos) {
+            return false;
+        }
+
+        line = buf.substr(p, end - p);
+        p = end + 2;
+
+        return true;
+    };
+
+    cmd.clear();
+
+    auto p = pos;
+    std::string line;
+    if (!read_line(p, line)) {
+        return false;
+    }
+
+    if (line.empty() || line.front() != '*') {
+        // Inline command, e.g. sent by telnet.
+        std::size_t start = 0;
+        while (start < line.size()) {
+            auto end = line.find(' ', start);
+            if (end == std::string::npos) {
+                end = line.size();
+            }
+
+            if (end > start) {
+                cmd.push_back(line.substr(start, end - start));
+            }
+
+            start = end + 1;
+        }
+    } else {
+        auto num = std::stoll(line.substr(1));
+        for (long long idx = 0; idx < num; ++idx) {
+            if (!read_line(p, line)) {
+                return false;
+            }
+
+            if (line.empty() || line.front() != '$') {
+                throw ProtoError("invalid command sent to mock server");
+            }
+
+            auto len = static_cast<std::size_t>(std::stoll(line.substr(1)));
+            if (buf.size() < p + len + 2) {
+                return false;
+            }
+
+            cmd.push_back(buf.substr(p, len));
+            p += len + 2;
+        }
+    }
+
+    pos = p;
+
+    return true;
+}
+
+inline std::string MockServer::_reply(MockSession &session, const std::vector<std::string> &cmd) {
+    ++_commands;
+
+    auto name = mock::command_name(cmd);
+
+    if (session.multi) {
+        if (name == "EXEC") {
+            session.multi = false;
+
+            auto replies = session.dirty ? mock::nil() : mock::array(session.queued);
+            session.queued.clear();
+            session.dirty = false;
+
+            return replies;
+        }
+
+        if (name == "DISCARD") {
+            session.multi = false;
+            session.queued.clear();
+            session.dirty = false;
+
+            return mock::status("OK");
+        }
+
+        session.queued.push_back(_handler(session, cmd));
+
+        return mock::status("QUEUED");
+    }
+
+    if (name == "MULTI") {
+        session.multi = true;
+
+        return mock::status("OK");
+    }
+
+    if (name == "EXEC" || name == "DISCARD") {
+        return mock::error("ERR " + name + " without MULTI");
+    }
+
+    if (name == "UNWATCH") {
+        session.dirty = false;
+    }
+
+    return _handler(session, cmd);
+}
+
+inline MockCluster::MockCluster(std::size_t node_num,
+                                const MockServerOptions &opts,
+                                std::size_t replica_num) :
+                                    _opts(opts),
+                                    _replicas(node_num),
+                                    _owners(SLOT_NUM),
+                                    _served(node_num * (replica_num + 1), 0) {
+    if (node_num == 0) {
+        throw Error("mock cluster should have at least one node");
+    }
+
+    for (std::size_t slot = 0; slot != _owners.size(); ++slot) {
+        _owners[slot] = slot * node_num / _owners.size();
+    }
+
+    for (std::size_t idx = 0; idx != node_num; ++idx) {
+        _nodes.emplace_back(new MockServer(
+                    [this, idx](MockSession &session, const std::vector<std::string> &cmd) {
+                        return this->_reply(idx, 0, session, cmd);
+                    }));
+
+        for (std::size_t server = 1; server <= replica_num; ++server) {
+            _replicas[idx].emplace_back(new MockServer(
+                    [this, idx, server](MockSession &session,
+                                        const std::vector<std::string> &cmd) {
+                        return this->_reply(idx, server, session, cmd);
+                    }));
+        }
+    }
+}
+
+inline ConnectionOptions MockCluster::options() const {
+    return _nodes.front()->options();
+}
+
+inline std::size_t MockCluster::node(Slot slot) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _owners.at(slot);
+}
+
+inline std::size_t MockCluster::served(std::size_t node) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _served.at(_served_index(node, 0));
+}
+
+inline std::size_t MockCluster::replica_served(std::size_t node, std::size_t idx) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _served.at(_served_index(node, idx + 1));
+}
+
+inline void MockCluster::move_slot(Slot slot, std::size_t node) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _owners.at(slot) = node;
+    _migrating.erase(slot);
+}
+
+inline void MockCluster::migrate_slot(Slot slot, std::size_t node) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _migrating[slot] = node;
+}
+
+inline std::string MockCluster::_reply(std::size_t node,
+                                        std::size_t server,
+                                        MockSession &session,
+                                        const std::vector<std::string> &cmd) {
+    static const std::unordered_set<std::string> KEYLESS_CMDS = {
+        "PING", "HELLO", "AUTH", "SELECT", "CLIENT", "READONLY", "READWRITE",
+        "INFO", "ECHO", "COMMAND", "SCRIPT", "UNWATCH", "QUIT"
+    };
+
+    auto name = mock::command_name(cmd);
+
+    if (name == "CLUSTER") {
+        if (cmd.size() > 1 && mock::command_name({cmd[1]}) == "SLOTS") {
+            return _cluster_slots();
+        }
+
+        return mock::status("OK");
+    }
+
+    if (name == "ASKING") {
+        session.asking = true;
+
+        return mock::status("OK");
+    }
+
+    if (name == "READONLY" || name == "READWRITE") {
+        session.readonly = (name == "READONLY");
+
+        return mock::status("OK");
+    }
+
+    auto asking = session.asking;
+    session.asking = false;
+
+    if (cmd.size() > 1 && KEYLESS_CMDS.count(name) == 0) {
+        auto slot = key_slot(cmd[1]);
+
+        std::size_t owner = 0;
+        std::size_t importing = _nodes.size();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            owner = _owners[slot];
+
+            auto iter = _migrating.find(slot);
+            if (iter != _migrating.end()) {
+                importing = iter->second;
+            }
+        }
+
+        if (server != 0) {
+            // Replicas only serve reads of their master's slots in readonly mode.
+            if (owner != node || !session.readonly) {
+                return _redirect("MOVED", slot, owner);
+            }
+        } else if (owner == node) {
+            if (importing != _nodes.size()) {
+                // Pretend that keys have been migrated to the importing node.
+                return _redirect("ASK", slot, importing);
+            }
+        } else if (!asking || importing != node) {
+            return _redirect("MOVED", slot, owner);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            ++_served[_served_index(node, server)];
+        }
+
+        if (_opts.delay > std::chrono::milliseconds(0)) {
+            std::this_thread::sleep_for(_opts.delay);
+        }
+    }
+
+    return MockServer::canned_reply(_opts, session, cmd);
+}
+
+inline std::string MockCluster::_cluster_slots() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<std::string> ranges;
+    std::size_t start = 0;
+    for (std::size_t slot = 1; slot <= _owners.size(); ++slot) {
+        if (slot < _owners.size() && _owners[slot] == _owners[start]) {
+            continue;
+        }
+
+        auto owner = _owners[start];
+        std::vector<std::string> range = {
+            mock::integer(static_cast<long long>(start)),
+            mock::integer(static_cast<long long>(slot - 1)),
+            mock::array({mock::bulk("127.0.0.1"),
+                            mock::integer(_nodes[owner]->port()),
+                            mock::bulk("node" + std::to_string(owner))})
+        };
+
+        for (std::size_t idx = 0; idx != _replicas[owner].size(); ++idx) {
+            range.push_back(mock::array({mock::bulk("127.0.0.1"),
+                            mock::integer(_replicas[owner][idx]->port()),
+                            mock::bulk("node" + std::to_string(owner)
+                                    + "-replica" + std::to_string(idx))}));
+        }
+
+        ranges.push_back(mock::array(range));
+
+        start = slot;
+    }
+
+    return mock::array(ranges);
+}
+
+inline std::string MockCluster::_redirect(const std::string &type, Slot slot, std::size_t node) {
+    ++_redirections;
+
+    return mock::error(type + " " + std::to_string(slot)
+            + " 127.0.0.1:" + std::to_string(_nodes.at(node)->port()));
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_HPP
@@ -0,0 +1,97 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_H
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_H
+
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sw/redis++/redis++.h>
+#include "mock_server.h"
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+// Tests with in-process mock servers, which need no Redis server.
+class MockServerTest {
+public:
+    void run();
+
+private:
+    void _test_canned_replies();
+
+    void _test_server_error();
+
+    void _test_resp3();
+
+    void _test_moved();
+
+    void _test_ask();
+
+    void _test_cluster_pipeline();
+
+    void _test_cross_slot_fanout();
+
+    void _test_replica_policy();
+
+    void _test_multiplexed_timeout();
+
+    void _test_multiplexed_broken();
+
+    void _test_auto_pipeline();
+
+    void _test_async();
+
+    void _test_async_transaction();
+
+    // Send `reads` GET commands of `key` to replicas, and return the number of
+    // commands served by each replica of the node owning the key.
+    std::vector<std::size_t> _replica_reads(MockCluster &cluster,
+                                            const ClusterOptions &opts,
+                                            const std::string &key,
+                                            std::size_t reads);
+
+    // Send GET commands of `keys` with concurrent callers of an auto pipeline with a single
+    // batch in flight, while the batch is held by GET `hold`. So that these commands are
+    // sent in the next batch, in order. Return the reply or error of each command.
+    std::vector<std::pair<OptionalString, std::exception_ptr>> _auto_pipeline_batch(Redis &redis,
+            const std::vector<std::string> &keys);
+
+    // Whether the result holds an exception of type `Err`.
+    template <typename Err>
+    static bool _holds_error(const std::pair<OptionalString, std::exception_ptr> &result);
+
+    // Return a key of each node of the cluster.
+    static std::vector<std::string> _node_keys(const MockCluster &cluster);
+
+    static MockServerOptions _options();
+};
+
+}
+
+}
+
+}
+
+#include "mock_server_test.hpp"
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_H
@@ -0,0 +1,821 @@
+/**************************************************************************
+   Copyright (c) 2017 sewenew
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ *************************************************************************/
+
+#ifndef SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_HPP
+#define SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_HPP
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "utils.h"
+
+#ifdef REDIS_PLUS_PLUS_RUN_ASYNC_TEST
+
+#include <sw/redis++/async_redis++.h>
+
+#endif
+
+namespace sw {
+
+namespace redis {
+
+namespace test {
+
+inline void MockServerTest::run() {
+    _test_canned_replies();
+
+    _test_server_error();
+
+    _test_resp3();
+
+    _test_moved();
+
+    _test_ask();
+
+    _test_cluster_pipeline();
+
+    _test_cross_slot_fanout();
+
+    _test_replica_policy();
+
+    _test_multiplexed_timeout();
+
+    _test_multiplexed_broken();
+
+    _test_auto_pipeline();
+
+    _test_async();
+
+    _test_async_transaction();
+}
+
+inline void MockServerTest::_test_canned_replies() {
+    auto opts = _options();
+    MockServer server(opts);
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = 2;
+
+    Redis redis(server.options(), pool_opts);
+
+    REDIS_ASSERT(redis.set("key", "val"), "failed to test mock server with set");
+
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == opts.value, "failed to test mock server with get");
+
+    std::vector<std::string> list;
+    redis.lrange("key", 0, -1, std::back_inserter(list));
+    REDIS_ASSERT(list.size() == opts.collection_len, "failed to test mock server with lrange");
+
+    std::unordered_map<std::string, std::string> hash;
+    redis.hgetall("key", std::inserter(hash, hash.end()));
+    REDIS_ASSERT(hash.size() == opts.collection_len && hash["field0"] == opts.value,
+            "failed to test mock server with hgetall");
+
+    auto pipe = redis.pipeline(false);
+    auto replies = pipe.set("key", "val").get("key").incr("key").exec();
+    REDIS_ASSERT(replies.size() == 3 && replies.get<bool>(0) && replies.get<long long>(2) == 1,
+            "failed to test mock server with pipeline");
+
+    val = replies.get<OptionalString>(1);
+    REDIS_ASSERT(val && *val == opts.value, "failed to test mock server with pipeline");
+
+    auto tx = redis.transaction(false, false);
+    replies = tx.set("key", "val").get("key").exec();
+    REDIS_ASSERT(replies.size() == 2, "failed to test mock server with transaction");
+
+    val = replies.get<OptionalString>(1);
+    REDIS_ASSERT(val && *val == opts.value, "failed to test mock server with transaction");
+
+    REDIS_ASSERT(server.commands() > 0, "failed to test mock server commands");
+}
+
+inline void MockServerTest::_test_server_error() {
+    auto opts = _options();
+    MockServer server([opts](MockSession &session, const std::vector<std::string> &cmd) {
+                if (mock::command_name(cmd) == "GET" && cmd.size() > 1 && cmd[1] == "throw") {
+                    throw Error("handler failed");
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            });
+
+    Redis redis(server.options());
+
+    try {
+        redis.get("throw");
+        REDIS_ASSERT(false, "failed to test mock server with handler error");
+    } catch (const Error &) {
+    }
+
+    auto errors = server.errors();
+    REDIS_ASSERT(errors.size() == 1 && errors.front() == "handler failed",
+            "failed to test mock server errors");
+
+    // The server still serves other connections.
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == opts.value, "failed to test mock server after handler error");
+}
+
+inline void MockServerTest::_test_resp3() {
+#ifdef REDIS_PLUS_PLUS_RESP_VERSION_3
+    auto opts = _options();
+    MockServer server(opts);
+
+    auto connection_opts = server.options();
+    connection_opts.resp = 3;
+
+    Redis redis(connection_opts);
+
+    std::unordered_map<std::string, std::string> hash;
+    redis.hgetall("key", std::inserter(hash, hash.end()));
+    REDIS_ASSERT(hash.size() == opts.collection_len && hash["field0"] == opts.value,
+            "failed to test mock server with resp3");
+#endif
+}
+
+inline void MockServerTest::_test_moved() {
+    auto opts = _options();
+    MockCluster cluster(3, opts);
+
+    RedisCluster redis(cluster.options());
+
+    const std::string key = "key";
+
+    auto val = redis.get(key);
+    REDIS_ASSERT(val && *val == opts.value && cluster.redirections() == 0,
+            "failed to test mock cluster");
+
+    auto slot = key_slot(key);
+    cluster.move_slot(slot, (cluster.node(slot) + 1) % cluster.size());
+
+    val = redis.get(key);
+    REDIS_ASSERT(val && *val == opts.value && cluster.redirections() == 1,
+            "failed to test mock cluster with MOVED");
+
+    // The slot has been updated, and there's no more redirection.
+    val = redis.get(key);
+    REDIS_ASSERT(val && cluster.redirections() == 1, "failed to test mock cluster with MOVED");
+}
+
+inline void MockServerTest::_test_ask() {
+    auto opts = _options();
+    MockCluster cluster(3, opts);
+
+    RedisCluster redis(cluster.options());
+
+    const std::string key = "key";
+    auto slot = key_slot(key);
+    auto importing = (cluster.node(slot) + 1) % cluster.size();
+
+    cluster.migrate_slot(slot, importing);
+
+    // ASK redirection doesn't update the slot.
+    for (auto idx = 1U; idx <= 2; ++idx) {
+        auto val = redis.get(key);
+        REDIS_ASSERT(val && *val == opts.value && cluster.redirections() == idx,
+                "failed to test mock cluster with ASK");
+    }
+
+    cluster.move_slot(slot, importing);
+
+    auto val = redis.get(key);
+    REDIS_ASSERT(val && *val == opts.value && cluster.redirections() == 3,
+            "failed to test mock cluster after migration");
+}
+
+inline void MockServerTest::_test_cluster_pipeline() {
+    auto opts = _options();
+    opts.delay = std::chrono::milliseconds(200);
+    MockCluster cluster(3, opts);
+
+    RedisCluster redis(cluster.options());
+
+    auto keys = _node_keys(cluster);
+
+    auto exec = [&redis, &keys]() {
+        auto pipe = redis.cluster_pipeline();
+        for (const auto &key : keys) {
+            pipe.get(key);
+        }
+
+        return pipe.exec();
+    };
+
+    // Create connections to all nodes.
+    exec();
+
+    auto start = std::chrono::steady_clock::now();
+    auto replies = exec();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REDIS_ASSERT(replies.size() == keys.size(), "failed to test cluster pipeline with mock cluster");
+
+    for (std::size_t idx = 0; idx != replies.size(); ++idx) {
+        auto val = replies.get<OptionalString>(idx);
+        REDIS_ASSERT(val && *val == opts.value, "failed to test cluster pipeline with mock cluster");
+    }
+
+    // Nodes process their batches in parallel, instead of one after another.
+    REDIS_ASSERT(elapsed < opts.delay * 2, "cluster pipeline should send batches in parallel");
+}
+
+inline void MockServerTest::_test_cross_slot_fanout() {
+    auto opts = _options();
+    opts.delay = std::chrono::milliseconds(200);
+    MockCluster cluster(3, opts);
+
+    ClusterOptions cluster_opts;
+    cluster_opts.cross_slot_fanout = true;
+    RedisCluster redis(cluster.options(), {}, Role::MASTER, cluster_opts);
+
+    auto keys = _node_keys(cluster);
+
+    // Create connections to all nodes.
+    redis.del(keys.begin(), keys.end());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<OptionalString> vals;
+    redis.mget(keys.begin(), keys.end(), std::back_inserter(vals));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REDIS_ASSERT(vals.size() == keys.size(), "failed to test cross slot fanout with mock cluster");
+
+    for (const auto &val : vals) {
+        REDIS_ASSERT(val && *val == opts.value, "failed to test cross slot fanout with mock cluster");
+    }
+
+    // Nodes process their sub-commands in parallel, instead of one after another.
+    REDIS_ASSERT(elapsed < opts.delay * 2, "cross slot fanout should send sub-commands in parallel");
+
+    // Keys of a single slot are sent as a whole.
+    REDIS_ASSERT(redis.del(keys.begin(), keys.begin() + 1) == 1,
+            "failed to test cross slot fanout with mock cluster");
+}
+
+inline void MockServerTest::_test_replica_policy() {
+    auto opts = _options();
+    MockCluster cluster(3, opts, 2);
+
+    const std::string key = "key";
+    const std::size_t reads = 100;
+
+    ClusterOptions cluster_opts;
+
+    // RANDOM picks a replica when the slot map is updated.
+    auto served = _replica_reads(cluster, cluster_opts, key, reads);
+    REDIS_ASSERT((served[0] == reads && served[1] == 0) || (served[0] == 0 && served[1] == reads),
+            "failed to test random replica policy");
+
+    // Ties are randomly broken, so that reads are spread over replicas.
+    cluster_opts.replica_policy = ReplicaPolicy::LEAST_OUTSTANDING;
+    served = _replica_reads(cluster, cluster_opts, key, reads);
+    REDIS_ASSERT(served[0] + served[1] == reads && served[0] > 0 && served[1] > 0,
+            "failed to test least outstanding replica policy");
+
+    cluster_opts.replica_policy = ReplicaPolicy::POWER_OF_TWO_CHOICES;
+    served = _replica_reads(cluster, cluster_opts, key, reads);
+    REDIS_ASSERT(served[0] + served[1] == reads,
+            "failed to test power of two choices replica policy");
+
+    // A replica with an outstanding request is avoided.
+    {
+        cluster_opts.replica_policy = ReplicaPolicy::LEAST_OUTSTANDING;
+        RedisCluster redis(cluster.options(), {}, Role::SLAVE, cluster_opts);
+
+        auto node = cluster.node(key_slot(key));
+        auto before = cluster.replica_served(node, 0);
+
+        // Hold a connection of the selected replica.
+        auto held = redis.redis(key, false);
+        held.get(key);
+        auto busy = (cluster.replica_served(node, 0) != before) ? 0U : 1U;
+        auto idle = 1 - busy;
+
+        before = cluster.replica_served(node, idle);
+        for (std::size_t idx = 0; idx != reads; ++idx) {
+            redis.get(key);
+        }
+
+        REDIS_ASSERT(cluster.replica_served(node, idle) == before + reads,
+                "failed to test least outstanding replica policy with busy replica");
+    }
+
+    // Only replicas labeled with the local label are used.
+    cluster_opts.node_label = [&cluster](const Node &node) {
+        for (std::size_t idx = 0; idx != cluster.size(); ++idx) {
+            if (node.port == cluster.replica_port(idx, 1)) {
+                return std::string("local");
+            }
+        }
+
+        return std::string("remote");
+    };
+    cluster_opts.local_label = "local";
+
+    for (auto policy : {ReplicaPolicy::RANDOM,
+                        ReplicaPolicy::LEAST_OUTSTANDING,
+                        ReplicaPolicy::POWER_OF_TWO_CHOICES}) {
+        cluster_opts.replica_policy = policy;
+        served = _replica_reads(cluster, cluster_opts, key, reads);
+        REDIS_ASSERT(served[0] == 0 && served[1] == reads,
+                "failed to test replica policy with local label");
+    }
+
+    // Fall back to all replicas, if there's no local replica.
+    cluster_opts.local_label = "nowhere";
+    cluster_opts.replica_policy = ReplicaPolicy::LEAST_OUTSTANDING;
+    served = _replica_reads(cluster, cluster_opts, key, reads);
+    REDIS_ASSERT(served[0] + served[1] == reads && served[0] > 0 && served[1] > 0,
+            "failed to test replica policy without local replica");
+}
+
+inline void MockServerTest::_test_multiplexed_timeout() {
+    auto opts = _options();
+    MockServer server([opts](MockSession &session, const std::vector<std::string> &cmd) {
+                if (mock::command_name(cmd) == "GET" && cmd.size() > 1 && cmd[1] == "slow") {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            });
+
+    auto connection_opts = server.options();
+    connection_opts.socket_timeout = std::chrono::milliseconds(50);
+
+    auto metrics = std::make_shared<Metrics>();
+    connection_opts.metrics = metrics;
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.multiplexed = true;
+
+    Redis redis(connection_opts, pool_opts);
+
+    for (auto idx = 0; idx != 10; ++idx) {
+        auto val = redis.get("key");
+        REDIS_ASSERT(val && *val == opts.value, "failed to test multiplexed connection");
+    }
+
+    // Metrics are recorded by callers, instead of the reader thread.
+    const auto *latency = metrics->command_latency("GET");
+    REDIS_ASSERT(latency != nullptr && latency->count() == 10,
+            "failed to test metrics of multiplexed connection");
+
+    try {
+        redis.get("slow");
+        REDIS_ASSERT(false, "failed to test multiplexed connection with timeout");
+    } catch (const TimeoutError &) {
+    }
+
+    // The broken connection is replaced with a new one.
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == opts.value, "failed to test multiplexed connection after timeout");
+}
+
+inline void MockServerTest::_test_multiplexed_broken() {
+    auto opts = _options();
+    std::unique_ptr<MockServer> server(new MockServer(
+            [opts](MockSession &session, const std::vector<std::string> &cmd) {
+                if (mock::command_name(cmd) == "GET" && cmd.size() > 1 && cmd[1] == "broken") {
+                    // Keep other commands pending, and then reply an invalid reply.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+                    return std::string("?invalid\r\n");
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            }));
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.multiplexed = true;
+
+    Redis redis(server->options(), pool_opts);
+
+    // Create the multiplexed connection.
+    redis.get("key");
+
+    bool pending_failed = false;
+    std::thread pending([&redis, &pending_failed]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                try {
+                    redis.get("key");
+                } catch (const Error &) {
+                    pending_failed = true;
+                }
+            });
+
+    try {
+        redis.get("broken");
+        REDIS_ASSERT(false, "failed to test multiplexed connection with invalid reply");
+    } catch (const ProtoError &) {
+    }
+
+    pending.join();
+
+    REDIS_ASSERT(pending_failed, "pending commands should fail when connection is broken");
+
+    auto val = redis.get("key");
+    REDIS_ASSERT(val && *val == opts.value, "failed to test multiplexed connection after broken");
+
+    // The connection is closed by server.
+    server.reset();
+
+    try {
+        redis.get("key");
+        REDIS_ASSERT(false, "failed to test multiplexed connection closed by server");
+    } catch (const Error &) {
+    }
+}
+
+inline void MockServerTest::_test_auto_pipeline() {
+    auto opts = _options();
+    MockServer server([opts](MockSession &session, const std::vector<std::string> &cmd) {
+                auto key = mock::command_name(cmd) == "GET" && cmd.size() > 1 ? cmd[1] : "";
+                if (key == "hold") {
+                    // Hold the batch, until followers have been queued.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+                } else if (key == "slow") {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+                } else if (key == "error") {
+                    return mock::error("ERR mock error");
+                } else if (key == "broken") {
+                    return std::string("?invalid\r\n");
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            });
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.auto_pipeline = true;
+    pool_opts.size = 1;
+
+    auto is_value = [&opts](const std::pair<OptionalString, std::exception_ptr> &res) {
+        return !res.second && res.first && *res.first == opts.value;
+    };
+
+    {
+        // Error reply in the middle of a batch only fails its own command.
+        Redis redis(server.options(), pool_opts);
+
+        auto results = _auto_pipeline_batch(redis, {"key", "key", "error", "key", "key"});
+        for (std::size_t idx = 0; idx != results.size(); ++idx) {
+            if (idx == 2) {
+                REDIS_ASSERT(_holds_error<ReplyError>(results[idx]),
+                        "failed to test auto pipeline with error reply");
+            } else {
+                REDIS_ASSERT(is_value(results[idx]),
+                        "auto pipeline should not fail other commands with error reply");
+            }
+        }
+    }
+
+    {
+        // Broken connection in the middle of a batch fails the remaining commands,
+        // and the connection is reconnected for the next batch.
+        auto connection_opts = server.options();
+        auto metrics = std::make_shared<Metrics>();
+        connection_opts.metrics = metrics;
+
+        Redis redis(connection_opts, pool_opts);
+
+        auto results = _auto_pipeline_batch(redis, {"key", "broken", "key", "key"});
+        REDIS_ASSERT(is_value(results[0]), "failed to test auto pipeline with broken connection");
+        for (std::size_t idx = 1; idx != results.size(); ++idx) {
+            REDIS_ASSERT(_holds_error<ProtoError>(results[idx]),
+                    "auto pipeline should fail remaining commands with broken connection");
+        }
+
+        auto val = redis.get("key");
+        REDIS_ASSERT(val && *val == opts.value && metrics->reconnects() == 1,
+                "failed to test auto pipeline after reconnection");
+    }
+
+    {
+        // A follower times out, when a command before it in the batch is slow.
+        auto connection_opts = server.options();
+        connection_opts.socket_timeout = std::chrono::milliseconds(300);
+
+        Redis redis(connection_opts, pool_opts);
+
+        auto results = _auto_pipeline_batch(redis, {"key", "slow", "key"});
+        REDIS_ASSERT(is_value(results[0]), "failed to test auto pipeline with timeout");
+        for (std::size_t idx = 1; idx != results.size(); ++idx) {
+            REDIS_ASSERT(_holds_error<TimeoutError>(results[idx]),
+                    "failed to test auto pipeline with follower timeout");
+        }
+
+        auto val = redis.get("key");
+        REDIS_ASSERT(val && *val == opts.value, "failed to test auto pipeline after timeout");
+    }
+}
+
+inline std::vector<std::pair<OptionalString, std::exception_ptr>>
+MockServerTest::_auto_pipeline_batch(Redis &redis, const std::vector<std::string> &keys) {
+    std::thread holder([&redis]() {
+                try {
+                    redis.get("hold");
+                } catch (const Error &) {
+                }
+            });
+
+    // Let the holder lead the first batch.
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+    std::vector<std::pair<OptionalString, std::exception_ptr>> results(keys.size());
+    std::vector<std::thread> followers;
+    for (std::size_t idx = 0; idx != keys.size(); ++idx) {
+        followers.emplace_back([&redis, &keys, &results, idx]() {
+                    try {
+                        results[idx].first = redis.get(keys[idx]);
+                    } catch (...) {
+                        results[idx].second = std::current_exception();
+                    }
+                });
+
+        // Queue followers in order.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    holder.join();
+
+    for (auto &follower : followers) {
+        follower.join();
+    }
+
+    return results;
+}
+
+template <typename Err>
+bool MockServerTest::_holds_error(const std::pair<OptionalString, std::exception_ptr> &result) {
+    if (!result.second) {
+        return false;
+    }
+
+    try {
+        std::rethrow_exception(result.second);
+    } catch (const Err &) {
+        return true;
+    } catch (...) {
+    }
+
+    return false;
+}
+
+inline std::vector<std::size_t> MockServerTest::_replica_reads(MockCluster &cluster,
+                                                                const ClusterOptions &opts,
+                                                                const std::string &key,
+                                                                std::size_t reads) {
+    RedisCluster redis(cluster.options(), {}, Role::SLAVE, opts);
+
+    auto node = cluster.node(key_slot(key));
+    auto master = cluster.served(node);
+
+    std::vector<std::size_t> served;
+    for (std::size_t idx = 0; idx != cluster.replicas(); ++idx) {
+        served.push_back(cluster.replica_served(node, idx));
+    }
+
+    for (std::size_t idx = 0; idx != reads; ++idx) {
+        auto val = redis.get(key);
+        REDIS_ASSERT(val && *val == _options().value, "failed to read from replica");
+    }
+
+    REDIS_ASSERT(cluster.served(node) == master && cluster.redirections() == 0,
+            "reads should only be sent to replicas");
+
+    for (std::size_t idx = 0; idx != served.size(); ++idx) {
+        served[idx] = cluster.replica_served(node, idx) - served[idx];
+    }
+
+    return served;
+}
+
+inline void MockServerTest::_test_async() {
+#ifdef REDIS_PLUS_PLUS_RUN_ASYNC_TEST
+    auto opts = _options();
+
+    {
+        MockServer server(opts);
+
+        AsyncRedis redis(server.options());
+
+        auto val = redis.get("key").get();
+        REDIS_ASSERT(val && *val == opts.value, "failed to test mock server with async");
+
+        auto tx = redis.transaction();
+        auto get_fut = tx.get("key");
+        auto incr_fut = tx.incr("counter");
+        tx.exec().get();
+
+        val = get_fut.get();
+        REDIS_ASSERT(val && *val == opts.value && incr_fut.get() == 1,
+                "failed to test mock server with async transaction");
+    }
+
+    {
+        MockCluster cluster(3, opts);
+
+        AsyncRedisCluster redis(cluster.options());
+
+        const std::string key = "key";
+        auto val = redis.get(key).get();
+        REDIS_ASSERT(val && *val == opts.value, "failed to test mock cluster with async");
+
+        auto slot = key_slot(key);
+        cluster.move_slot(slot, (cluster.node(slot) + 1) % cluster.size());
+
+        val = redis.get(key).get();
+        REDIS_ASSERT(val && *val == opts.value && cluster.redirections() == 1,
+                "failed to test mock cluster with async MOVED");
+    }
+#endif
+}
+
+inline void MockServerTest::_test_async_transaction() {
+#ifdef REDIS_PLUS_PLUS_RUN_ASYNC_TEST
+    auto opts = _options();
+
+    std::atomic<std::size_t> unwatches{0};
+    MockServer server([opts, &unwatches](MockSession &session, const std::vector<std::string> &cmd) {
+                auto name = mock::command_name(cmd);
+                if (name == "WATCH" && cmd.size() > 1 && cmd[1] == "conflict") {
+                    // Watched key is always modified by others.
+                    session.dirty = true;
+                } else if (name == "UNWATCH") {
+                    ++unwatches;
+                }
+
+                return MockServer::canned_reply(opts, session, cmd);
+            });
+
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = 2;
+
+    AsyncRedis redis(server.options(), pool_opts);
+
+    // Watch `conflict` for the first `conflicts` attempts. Read the watched key with
+    // a callback, and execute the transaction in the callback, i.e. event loop thread.
+    std::atomic<std::size_t> attempts{0};
+    auto cas = [&attempts](std::size_t conflicts) {
+        return [&attempts, conflicts](AsyncTransaction &tx, TransactionExec exec) {
+            auto key = attempts++ < conflicts ? "conflict" : "key";
+            tx.watch(key);
+            tx.redis().get(key, [&tx, exec](Future<OptionalString> &&fut) {
+                        try {
+                            auto val = fut.get();
+                            tx.set("key", val ? *val + "x" : "x");
+                            exec();
+                        } catch (...) {
+                            exec(std::current_exception());
+                        }
+                    });
+        };
+    };
+
+    redis.transaction(cas(2), 3).get();
+    REDIS_ASSERT(attempts == 3, "failed to test async transaction retry");
+
+    attempts = 0;
+    try {
+        redis.transaction(cas(3), 1).get();
+        REDIS_ASSERT(false, "failed to test async transaction retry with WatchError");
+    } catch (const WatchError &) {
+    }
+    REDIS_ASSERT(attempts == 2, "failed to test async transaction max retries");
+
+    // Exceptions thrown by the function abort the transaction.
+    try {
+        redis.transaction([](AsyncTransaction &, TransactionExec) {
+                    throw Error("abort");
+                }).get();
+        REDIS_ASSERT(false, "failed to test async transaction retry with exception");
+    } catch (const WatchError &) {
+        REDIS_ASSERT(false, "failed to test async transaction retry with exception");
+    } catch (const Error &) {
+    }
+
+    // Keys watched by an aborted transaction are unwatched.
+    try {
+        redis.transaction([](AsyncTransaction &tx, TransactionExec exec) {
+                    tx.watch("key");
+                    exec(std::make_exception_ptr(Error("abort")));
+                }).get();
+        REDIS_ASSERT(false, "failed to test aborted async transaction");
+    } catch (const WatchError &) {
+        REDIS_ASSERT(false, "failed to test aborted async transaction");
+    } catch (const Error &) {
+    }
+
+    // Only the first call of TransactionExec takes effect. Calls after the transaction
+    // has finished, which has released its connection, are ignored.
+    std::unique_ptr<TransactionExec> stale;
+    redis.transaction([&stale](AsyncTransaction &tx, TransactionExec exec) {
+                tx.incr("counter");
+                exec();
+                exec();
+                exec(std::make_exception_ptr(Error("abort")));
+                stale.reset(new TransactionExec(exec));
+            }).get();
+
+    (*stale)();
+    (*stale)(std::make_exception_ptr(Error("abort")));
+
+    auto wait_unwatches = [&unwatches](std::size_t num) {
+        for (auto idx = 0; idx != 100 && unwatches < num; ++idx) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        return unwatches == num;
+    };
+
+    REDIS_ASSERT(wait_unwatches(1), "failed to test UNWATCH of aborted async transaction");
+
+    // Move assignment unwatches keys, and discards commands, of the assigned transaction.
+    auto tx = redis.transaction();
+    tx.watch("key").get();
+    auto get_fut = tx.get("key");
+
+    tx = redis.transaction();
+    REDIS_ASSERT(tx.size() == 0 && wait_unwatches(2),
+            "failed to test move assignment of async transaction");
+
+    try {
+        get_fut.get();
+        REDIS_ASSERT(false, "failed to test discarded command of async transaction");
+    } catch (const Error &) {
+        throw;
+    } catch (const std::exception &) {
+        // Broken promise.
+    }
+
+    // WATCH state belongs to the connection, so that transactions cannot be created
+    // in single connection mode, e.g. with the AsyncRedis object returned by `tx.redis()`.
+    auto single = tx.redis();
+    auto throws = [](const std::function<void ()> &func) {
+        try {
+            func();
+        } catch (const Error &) {
+            return true;
+        }
+
+        return false;
+    };
+
+    REDIS_ASSERT(throws([&single]() { single.transaction(); }),
+            "failed to test async transaction in single connection mode");
+
+    REDIS_ASSERT(throws([&single, &cas]() { single.transaction(cas(0), 1).get(); }),
+            "failed to test async transaction retry in single connection mode");
+#endif
+}
+
+inline std::vector<std::string> MockServerTest::_node_keys(const MockCluster &cluster) {
+    std::vector<std::string> keys(cluster.size());
+    std::size_t found = 0;
+    for (std::size_t idx = 0; found != keys.size(); ++idx) {
+        auto key = "key" + std::to_string(idx);
+        auto &node_key = keys[cluster.node(key_slot(key))];
+        if (node_key.empty()) {
+            node_key = key;
+            ++found;
+        }
+    }
+
+    return keys;
+}
+
+inline MockServerOptions MockServerTest::_options() {
+    MockServerOptions opts;
+    opts.value = "mock";
+    opts.collection_len = 3;
+
+    return opts;
+}
+
+}
+
+}
+
+}
+
+#endif // end SEWENEW_REDISPLUSPLUS_TEST_MOCK_SERVER_TEST_HPP
@@ -18,6 +18,7 @@
 #define SEWENEW_REDISPLUSPLUS_TEST_SANITY_TEST_H
 
 #include <sw/redis++/redis++.h>
+#include <sw/redis++/cmd_formatter.h>
 
 namespace sw {
 
@@ -46,6 +47,12 @@ private:
 
     void _test_cmdargs();
 
+    void _test_resp();
+
+    void _test_reply_arena();
+
+    void _test_pool_load();
+
     void _test_generic_command();
 
     void _test_hash_tag();
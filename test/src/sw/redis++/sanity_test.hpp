@@ -49,6 +49,12 @@ void SanityTest<RedisInstance>::run() {
 
     _test_cmdargs();
 
+    _test_resp();
+
+    _test_reply_arena();
+
+    _test_pool_load();
+
     _test_generic_command();
 }
 
@@ -141,6 +147,146 @@ void SanityTest<RedisInstance>::_test_cmdargs() {
     _redis.lrange(key, 0, -1, std::back_inserter(res));
     REDIS_ASSERT((res == std::vector<std::string>{"5", "4", "3", "2", "1"}),
             "failed to test cmdargs");
+
+    // More arguments than CmdArgs' inline buffer can hold,
+    // and more numbers than its arena can hold.
+    CmdArgs many_args;
+    many_args.append("RPUSH", key);
+    std::vector<std::string> expected = {"RPUSH", key};
+    for (auto idx = 0; idx != 100; ++idx) {
+        auto num = -1000000007LL * idx;
+        many_args << num;
+        expected.push_back(std::to_string(num));
+    }
+    many_args.append(std::string("temporary string"), true, 'A', 1.5);
+    expected.insert(expected.end(), {"temporary string", "1", "65", "1.5"});
+
+    REDIS_ASSERT(many_args.size() == expected.size(), "failed to test cmdargs");
+    for (auto idx = 0U; idx != expected.size(); ++idx) {
+        REDIS_ASSERT(std::string(many_args.argv()[idx], many_args.argv_len()[idx]) == expected[idx],
+                "failed to test cmdargs");
+    }
+}
+
+template <typename RedisInstance>
+void SanityTest<RedisInstance>::_test_resp() {
+    const char *argv[] = {"SET", "key", ""};
+    std::size_t argv_len[] = {3, 3, 0};
+    resp::OutputBuffer buf;
+    buf.append_command(3, argv, argv_len);
+    std::string expected_cmd = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$0\r\n\r\n";
+    REDIS_ASSERT(std::string(buf.data(), buf.size()) == expected_cmd
+                && resp::command_size(3, argv_len) == expected_cmd.size(),
+            "failed to test resp encoder");
+
+    auto cmd = fmt::format_cmd(3, argv, argv_len);
+    REDIS_ASSERT(std::string(cmd.data(), cmd.size()) == expected_cmd,
+            "failed to test resp encoder");
+
+    auto key = test_key("resp");
+    auto small_key = test_key("resp_small");
+
+    KeyDeleter<RedisInstance> deleter(_redis, {key, small_key});
+
+    // Large values are sent with scatter/gather I/O.
+    std::string large_val(resp::LARGE_ARG_LENGTH * 4 + 1, 'x');
+    _redis.set(key, large_val);
+    auto val = _redis.get(key);
+    REDIS_ASSERT(val && *val == large_val, "failed to test resp encoder");
+
+    // Mix commands sent with format string and commands sent with arguments.
+    auto mixed = [&large_val](Connection &connection, const StringView &k1, const StringView &k2) {
+        connection.send("SET %b %b", k2.data(), k2.size(), "v", static_cast<std::size_t>(1));
+
+        CmdArgs args;
+        args << "APPEND" << k1 << large_val;
+        connection.send(args);
+
+        connection.send("APPEND %b %b", k2.data(), k2.size(), "w", static_cast<std::size_t>(1));
+
+        auto reply = connection.recv();
+        reply::parse<void>(*reply);
+
+        reply = connection.recv();
+        REDIS_ASSERT(reply::parse<long long>(*reply) == static_cast<long long>(large_val.size() * 2),
+                "failed to test resp encoder");
+    };
+
+    auto reply = _redis.command(mixed, key, small_key);
+    REDIS_ASSERT(reply::parse<long long>(*reply) == 2, "failed to test resp encoder");
+
+    val = _redis.get(small_key);
+    REDIS_ASSERT(val && *val == "vw", "failed to test resp encoder");
+}
+
+template <typename RedisInstance>
+void SanityTest<RedisInstance>::_test_reply_arena() {
+    auto opts = _opts;
+    opts.reply_arena = true;
+
+    auto redis = RedisInstance(opts);
+
+    auto key = test_key("reply_arena");
+    auto list_key = test_key("reply_arena_list");
+
+    KeyDeleter<RedisInstance> deleter(redis, {key, list_key});
+
+    // Large enough to be allocated in a dedicated chunk.
+    std::string large_val(128 * 1024, 'x');
+    redis.set(key, large_val);
+    auto val = redis.get(key);
+    REDIS_ASSERT(val && *val == large_val, "failed to test reply arena");
+
+    // Enough elements to span several chunks.
+    std::vector<std::string> elements;
+    for (auto idx = 0; idx != 1000; ++idx) {
+        elements.push_back(std::to_string(idx));
+    }
+    redis.rpush(list_key, elements.begin(), elements.end());
+
+    std::vector<std::string> res;
+    redis.lrange(list_key, 0, -1, std::back_inserter(res));
+    REDIS_ASSERT(res == elements, "failed to test reply arena");
+
+    // Sub replies share the arena with the root reply.
+    auto owned = redis.template command<OwnedReply<std::vector<StringView>>>("LRANGE",
+                                                                            list_key, 0, 2);
+    REDIS_ASSERT(owned->size() == 3
+            && std::string(owned->at(2).data(), owned->at(2).size()) == "2",
+            "failed to test reply arena");
+}
+
+template <typename RedisInstance>
+void SanityTest<RedisInstance>::_test_pool_load() {
+    ConnectionPoolOptions pool_opts;
+    pool_opts.size = 2;
+    ConnectionPool pool(pool_opts, _opts);
+
+    {
+        // Load is NOT tracked by default.
+        SafeConnection connection(pool);
+        REDIS_ASSERT(pool.outstanding() == 0, "failed to test pool load");
+    }
+
+    pool.track_load(LoadTracking::OUTSTANDING_AND_LATENCY);
+
+    REDIS_ASSERT(pool.outstanding() == 0 && pool.latency().count() == 0,
+            "failed to test pool load");
+
+    {
+        SafeConnection first(pool);
+        SafeConnection second(pool);
+        REDIS_ASSERT(pool.outstanding() == 2, "failed to test pool load");
+
+        auto &connection = first.connection();
+        connection.send("PING");
+        auto reply = connection.recv();
+        REDIS_ASSERT(reply && reply::parse<std::string>(*reply) == "PONG",
+                "failed to test pool load");
+    }
+
+    REDIS_ASSERT(pool.outstanding() == 0 && pool.latency().count() > 0,
+            "failed to test pool load");
 }
 
 template <typename RedisInstance>
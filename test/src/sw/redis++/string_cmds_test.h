@@ -45,6 +45,8 @@ private:
 
     void _test_mgetset();
 
+    void _test_owned_reply();
+
     RedisInstance &_redis;
 };
 
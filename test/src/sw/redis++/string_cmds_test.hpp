@@ -17,6 +17,10 @@
 #ifndef SEWENEW_REDISPLUSPLUS_TEST_STRING_CMDS_TEST_HPP
 #define SEWENEW_REDISPLUSPLUS_TEST_STRING_CMDS_TEST_HPP
 
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "utils.h"
 
@@ -26,6 +30,14 @@ namespace redis {
 
 namespace test {
 
+// Whether `T` can be the result of `Redis::command`, which frees the reply after parsing.
+template <typename T, typename = Void<>>
+struct IsPlainResult : std::false_type {};
+
+template <typename T>
+struct IsPlainResult<T, Void<decltype(reply::parse<T>(std::declval<ReplyUPtr>()))>>
+    : std::true_type {};
+
 template <typename RedisInstance>
 void StringCmdTest<RedisInstance>::run() {
     _test_str();
@@ -39,6 +51,8 @@ void StringCmdTest<RedisInstance>::run() {
     _test_set_with_get_option();
 
     _test_mgetset();
+
+    _test_owned_reply();
 }
 
 template <typename RedisInstance>
@@ -268,6 +282,53 @@ void StringCmdTest<RedisInstance>::_test_mgetset() {
     REDIS_ASSERT(!_redis.msetnx(kvs), "failed to test msetnx");
 }
 
+template <typename RedisInstance>
+void StringCmdTest<RedisInstance>::_test_owned_reply() {
+    // Views refer to the reply's memory, so that they can only be parsed with OwnedReply.
+    static_assert(!IsPlainResult<StringView>::value, "failed to test owned reply");
+    static_assert(!IsPlainResult<OptionalStringView>::value, "failed to test owned reply");
+    static_assert(!IsPlainResult<std::vector<OptionalStringView>>::value,
+            "failed to test owned reply");
+    static_assert(!IsPlainResult<std::unordered_map<std::string, StringView>>::value,
+            "failed to test owned reply");
+    static_assert(!IsPlainResult<std::tuple<long long, StringView>>::value,
+            "failed to test owned reply");
+    static_assert(IsPlainResult<OwnedReply<std::vector<OptionalStringView>>>::value,
+            "failed to test owned reply");
+    static_assert(IsPlainResult<std::vector<OptionalString>>::value,
+            "failed to test owned reply");
+
+    auto k1 = test_key("owned_k1");
+    auto k2 = test_key("owned_k2");
+    auto k3 = test_key("owned_k3");
+
+    KeyDeleter<RedisInstance> deleter(_redis, {k1, k2, k3});
+
+    _redis.set(k1, "v1");
+    _redis.set(k3, "v3");
+
+    auto res = _redis.template command<OwnedReply<std::vector<OptionalStringView>>>("MGET",
+            k1, k2, k3);
+
+    // Views are still valid after the result is moved.
+    auto vals = std::move(res);
+
+    REDIS_ASSERT(vals->size() == 3, "failed to test owned reply");
+
+    const auto &v1 = vals.value()[0];
+    REDIS_ASSERT(bool(v1) && std::string(v1->data(), v1->size()) == "v1",
+            "failed to test owned reply");
+
+    REDIS_ASSERT(!vals.value()[1], "failed to test owned reply with nil");
+
+    const auto &v3 = vals.value()[2];
+    REDIS_ASSERT(bool(v3) && std::string(v3->data(), v3->size()) == "v3",
+            "failed to test owned reply");
+
+    auto val = _redis.template command<OwnedReply<StringView>>("GET", k1);
+    REDIS_ASSERT(std::string(val->data(), val->size()) == "v1", "failed to test owned reply");
+}
+
 }
 
 }
@@ -28,6 +28,7 @@
 #include <string>
 #include <chrono>
 #include <tuple>
+#include <vector>
 #include <iostream>
 #include <sw/redis++/redis++.h>
 #include "sanity_test.h"
@@ -47,11 +48,27 @@
 #include "threads_test.h"
 #include "stream_cmds_test.h"
 #include "cluster_test.h"
+#include "client_cache_test.h"
+#include "metrics_test.h"
 #include "benchmark_test.h"
 
+#ifndef _MSC_VER
+
+#include "mock_server_test.h"
+
+#endif
+
 #ifdef REDIS_PLUS_PLUS_RUN_ASYNC_TEST
 
 #include "async_test.h"
+#include "async_benchmark_test.h"
+
+#endif
+
+#ifdef REDIS_PLUS_PLUS_RUN_CORO_TEST
+
+#include "co_benchmark_test.h"
+#include "co_redis_test.h"
 
 #endif
 
@@ -70,10 +87,19 @@ int getopt(int argc, char **argv, const char *optstring);
 
 struct TestOptions {
     bool run_thread_test = false;
+
+    // Run tests or benchmarks with in-process mock servers, instead of Redis.
+    bool run_mock_test = false;
+
+    // Benchmark `key_slots`, which needs no server.
+    bool run_key_slots_benchmark = false;
 };
 
 void print_help();
 
+// Parse a comma-separated list of positive numbers, e.g. 1,10,100.
+std::vector<std::size_t> parse_sizes(const std::string &str);
+
 auto parse_options(int argc, char **argv)
     -> std::tuple<sw::redis::Optional<sw::redis::ConnectionOptions>,
                     sw::redis::Optional<sw::redis::ConnectionOptions>,
@@ -85,7 +111,11 @@ void run_test(const sw::redis::ConnectionOptions &opts, const TestOptions &test_
 
 template <typename RedisInstance>
 void run_benchmark(const sw::redis::ConnectionOptions &opts,
-        const sw::redis::test::BenchmarkOptions &benchmark_opts);
+        const sw::redis::test::BenchmarkOptions &benchmark_opts,
+        sw::redis::test::BenchmarkReport &report);
+
+void run_mock_test(const sw::redis::Optional<sw::redis::test::BenchmarkOptions> &benchmark_opts,
+        sw::redis::test::BenchmarkReport &report);
 
 }
 
@@ -97,11 +127,17 @@ int main(int argc, char **argv) {
         TestOptions test_options;
         std::tie(opts, cluster_node_opts, benchmark_opts, test_options) = parse_options(argc, argv);
 
+        sw::redis::test::BenchmarkReport benchmark_report;
+
+        if (test_options.run_mock_test) {
+            run_mock_test(benchmark_opts, benchmark_report);
+        }
+
         if (opts) {
             std::cout << "Testing Redis..." << std::endl;
 
             if (benchmark_opts) {
-                run_benchmark<sw::redis::Redis>(*opts, *benchmark_opts);
+                run_benchmark<sw::redis::Redis>(*opts, *benchmark_opts, benchmark_report);
             } else {
                 run_test<sw::redis::Redis>(*opts, test_options);
             }
@@ -111,7 +147,8 @@ int main(int argc, char **argv) {
             std::cout << "Testing RedisCluster..." << std::endl;
 
             if (benchmark_opts) {
-                run_benchmark<sw::redis::RedisCluster>(*cluster_node_opts, *benchmark_opts);
+                run_benchmark<sw::redis::RedisCluster>(*cluster_node_opts,
+                        *benchmark_opts, benchmark_report);
             } else {
                 run_test<sw::redis::RedisCluster>(*cluster_node_opts, test_options);
             }
@@ -121,22 +158,64 @@ int main(int argc, char **argv) {
         if (opts) {
             std::cout << "Testing AsyncRedis..." << std::endl;
 
-            sw::redis::test::AsyncTest<sw::redis::AsyncRedis> async_test(*opts);
-            async_test.run();
+            if (benchmark_opts) {
+                sw::redis::test::AsyncBenchmarkTest<sw::redis::AsyncRedis> benchmark_test(
+                        *benchmark_opts, *opts, benchmark_report);
+                benchmark_test.run();
+            } else {
+                sw::redis::test::AsyncTest<sw::redis::AsyncRedis> async_test(*opts);
+                async_test.run();
 
-            std::cout << "Pass AsyncRedis tests" << std::endl;
+                std::cout << "Pass AsyncRedis tests" << std::endl;
+            }
         }
 
         if (cluster_node_opts) {
             std::cout << "Testing AsyncRedisCluster..." << std::endl;
 
-            sw::redis::test::AsyncTest<sw::redis::AsyncRedisCluster> async_test(*cluster_node_opts);
-            async_test.run();
+            if (benchmark_opts) {
+                sw::redis::test::AsyncBenchmarkTest<sw::redis::AsyncRedisCluster> benchmark_test(
+                        *benchmark_opts, *cluster_node_opts, benchmark_report);
+                benchmark_test.run();
+            } else {
+                sw::redis::test::AsyncTest<sw::redis::AsyncRedisCluster> async_test(*cluster_node_opts);
+                async_test.run();
 
-            std::cout << "Pass AsyncRedisCluster tests" << std::endl;
+                std::cout << "Pass AsyncRedisCluster tests" << std::endl;
+            }
         }
 #endif
 
+#ifdef REDIS_PLUS_PLUS_RUN_CORO_TEST
+        if (benchmark_opts) {
+            if (opts) {
+                std::cout << "Testing CoRedis..." << std::endl;
+
+                sw::redis::test::CoBenchmarkTest<sw::redis::CoRedis> benchmark_test(
+                        *benchmark_opts, *opts, benchmark_report);
+                benchmark_test.run();
+            }
+
+            if (cluster_node_opts) {
+                std::cout << "Testing CoRedisCluster..." << std::endl;
+
+                sw::redis::test::CoBenchmarkTest<sw::redis::CoRedisCluster> benchmark_test(
+                        *benchmark_opts, *cluster_node_opts, benchmark_report);
+                benchmark_test.run();
+            }
+        }
+#endif
+
+        if (test_options.run_key_slots_benchmark) {
+            sw::redis::test::bench_key_slots();
+        }
+
+        if (benchmark_opts && !benchmark_opts->json_path.empty()) {
+            benchmark_report.write_json(benchmark_opts->json_path);
+
+            std::cout << "Write benchmark results to " << benchmark_opts->json_path << std::endl;
+        }
+
         std::cout << "Pass all tests" << std::endl;
     } catch (const sw::redis::Error &e) {
         std::cerr << "Test failed: " << e.what() << std::endl;
@@ -240,11 +319,36 @@ int getopt(int argc, char **argv, const char *optstring) {
 
 void print_help() {
     std::cerr << "Usage: test_redis++ -h host -p port"
-        << " -n cluster_node -c cluster_port [-a auth] [-b] [-e key_prefix]\n\n";
+        << " -n cluster_node -c cluster_port [-a auth] [-b] [-e key_prefix] [-M] [-K]\n"
+        << "Benchmark options: [-t thread_num,...] [-s pool_size,...] [-v val_len,...]"
+        << " [-r request_num] [-k key_len] [-w async_window] [-j json_file]\n\n";
     std::cerr << "See https://github.com/sewenew/redis-plus-plus#run-tests-optional"
         << " for details on how to run test" << std::endl;
 }
 
+std::vector<std::size_t> parse_sizes(const std::string &str) {
+    std::vector<std::size_t> sizes;
+
+    std::string::size_type idx = 0;
+    while (true) {
+        auto pos = str.find(',', idx);
+        auto size = std::stoi(str.substr(idx, pos == std::string::npos ? pos : pos - idx));
+        if (size <= 0) {
+            throw sw::redis::Error("Invalid command line option");
+        }
+
+        sizes.push_back(static_cast<std::size_t>(size));
+
+        if (pos == std::string::npos) {
+            break;
+        }
+
+        idx = pos + 1;
+    }
+
+    return sizes;
+}
+
 auto parse_options(int argc, char **argv)
     -> std::tuple<sw::redis::Optional<sw::redis::ConnectionOptions>,
                     sw::redis::Optional<sw::redis::ConnectionOptions>,
@@ -261,7 +365,7 @@ auto parse_options(int argc, char **argv)
     TestOptions test_options;
 
     int opt = 0;
-    while ((opt = getopt(argc, argv, "h:p:a:n:c:e:k:v:r:t:bs:m3")) != -1) {
+    while ((opt = getopt(argc, argv, "h:p:a:n:c:e:k:v:r:t:bs:m3j:w:MK")) != -1) {
         try {
             switch (opt) {
             case 'h':
@@ -293,7 +397,7 @@ auto parse_options(int argc, char **argv)
                 break;
 
             case 'v':
-                tmp_benchmark_opts.val_len = std::stoi(optarg);
+                tmp_benchmark_opts.val_lens = parse_sizes(optarg);
                 break;
 
             case 'r':
@@ -301,17 +405,33 @@ auto parse_options(int argc, char **argv)
                 break;
 
             case 't':
-                tmp_benchmark_opts.thread_num = std::stoi(optarg);
+                tmp_benchmark_opts.thread_nums = parse_sizes(optarg);
                 break;
 
             case 's':
-                tmp_benchmark_opts.pool_size = std::stoi(optarg);
+                tmp_benchmark_opts.pool_sizes = parse_sizes(optarg);
+                break;
+
+            case 'w':
+                tmp_benchmark_opts.async_window = std::stoi(optarg);
+                break;
+
+            case 'j':
+                tmp_benchmark_opts.json_path = optarg;
                 break;
 
             case 'm':
                 test_options.run_thread_test = true;
                 break;
 
+            case 'M':
+                test_options.run_mock_test = true;
+                break;
+
+            case 'K':
+                test_options.run_key_slots_benchmark = true;
+                break;
+
             case 'e':
                 sw::redis::test::key_prefix(optarg);
                 break;
@@ -354,7 +474,8 @@ auto parse_options(int argc, char **argv)
         cluster_opts = sw::redis::Optional<sw::redis::ConnectionOptions>(tmp);
     }
 
-    if (!opts && !cluster_opts) {
+    if (!opts && !cluster_opts && !test_options.run_mock_test
+            && !test_options.run_key_slots_benchmark) {
         print_help();
         throw sw::redis::Error("Invalid connection options");
     }
@@ -453,25 +574,104 @@ void run_test(const sw::redis::ConnectionOptions &opts, const TestOptions &test_
 
     std::cout << "Pass stream commands tests" << std::endl;
 
-    sw::redis::test::ClusterTest<RedisInstance> cluster_test(instance);
+    sw::redis::test::ClusterTest<RedisInstance> cluster_test(opts, instance);
     cluster_test.run();
 
     std::cout << "Pass cluster specific tests" << std::endl;
+
+    sw::redis::test::ClientCacheTest<RedisInstance> client_cache_test(opts, instance);
+    client_cache_test.run();
+
+    std::cout << "Pass client side caching tests" << std::endl;
+
+    sw::redis::test::MetricsTest<RedisInstance> metrics_test(opts);
+    metrics_test.run();
+
+    std::cout << "Pass metrics tests" << std::endl;
 }
 
 template <typename RedisInstance>
 void run_benchmark(const sw::redis::ConnectionOptions &opts,
-        const sw::redis::test::BenchmarkOptions &benchmark_opts) {
+        const sw::redis::test::BenchmarkOptions &benchmark_opts,
+        sw::redis::test::BenchmarkReport &report) {
+    auto join = [](const std::vector<std::size_t> &sizes) {
+        std::string str;
+        for (auto size : sizes) {
+            if (!str.empty()) {
+                str += ",";
+            }
+            str += std::to_string(size);
+        }
+        return str;
+    };
+
     std::cout << "Benchmark test options:" << std::endl;
-    std::cout << "  Thread number: " << benchmark_opts.thread_num << std::endl;
-    std::cout << "  Connection pool size: " << benchmark_opts.pool_size << std::endl;
+    std::cout << "  Thread number: " << join(benchmark_opts.thread_nums) << std::endl;
+    std::cout << "  Connection pool size: " << join(benchmark_opts.pool_sizes) << std::endl;
     std::cout << "  Length of key: " << benchmark_opts.key_len << std::endl;
-    std::cout << "  Length of value: " << benchmark_opts.val_len << std::endl;
-
-    auto instance = RedisInstance(opts);
+    std::cout << "  Length of value: " << join(benchmark_opts.val_lens) << std::endl;
 
-    sw::redis::test::BenchmarkTest<RedisInstance> benchmark_test(benchmark_opts, instance);
+    sw::redis::test::BenchmarkTest<RedisInstance> benchmark_test(benchmark_opts, opts, report);
     benchmark_test.run();
 }
 
+void run_mock_test(const sw::redis::Optional<sw::redis::test::BenchmarkOptions> &benchmark_opts,
+        sw::redis::test::BenchmarkReport &report) {
+#ifdef _MSC_VER
+    (void)benchmark_opts;
+    (void)report;
+
+    throw sw::redis::Error("mock server is NOT supported on Windows");
+#else
+    if (!benchmark_opts) {
+        std::cout << "Testing with mock servers..." << std::endl;
+
+        sw::redis::test::MockServerTest mock_test;
+        mock_test.run();
+
+        std::cout << "Pass mock server tests" << std::endl;
+
+#ifdef REDIS_PLUS_PLUS_RUN_CORO_TEST
+        std::cout << "Testing CoRedis with mock servers..." << std::endl;
+
+        sw::redis::test::CoRedisTest co_test;
+        co_test.run();
+
+        std::cout << "Pass CoRedis mock server tests" << std::endl;
+#endif
+
+        return;
+    }
+
+    // Mock servers reply with canned values, whose length is the first value length.
+    sw::redis::test::MockServerOptions mock_opts;
+    mock_opts.value = std::string(benchmark_opts->val_lens.front(), 'x');
+
+    sw::redis::test::MockServer server(mock_opts);
+    sw::redis::test::MockCluster cluster(3, mock_opts);
+
+    std::cout << "Testing Redis with mock server..." << std::endl;
+
+    run_benchmark<sw::redis::Redis>(server.options(), *benchmark_opts, report);
+
+    std::cout << "Testing RedisCluster with mock cluster..." << std::endl;
+
+    run_benchmark<sw::redis::RedisCluster>(cluster.options(), *benchmark_opts, report);
+
+#ifdef REDIS_PLUS_PLUS_RUN_ASYNC_TEST
+    std::cout << "Testing AsyncRedis with mock server..." << std::endl;
+
+    sw::redis::test::AsyncBenchmarkTest<sw::redis::AsyncRedis> async_test(
+            *benchmark_opts, server.options(), report);
+    async_test.run();
+
+    std::cout << "Testing AsyncRedisCluster with mock cluster..." << std::endl;
+
+    sw::redis::test::AsyncBenchmarkTest<sw::redis::AsyncRedisCluster> async_cluster_test(
+            *benchmark_opts, cluster.options(), report);
+    async_cluster_test.run();
+#endif
+#endif
+}
+
 }
@@ -43,6 +43,25 @@ void ThreadsTest<RedisInstance>::run() {
     pool_opts.size = 10;
     _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
 
+    // Lock-free pool with 10 connections.
+    pool_opts.mode = ConnectionPoolMode::LOCK_FREE;
+    _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
+
+    // Lock-free pool with a single connection, so that most threads have to wait.
+    pool_opts.size = 1;
+    _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
+
+    // Auto pipeline with at most 2 batches in flight.
+    pool_opts.mode = ConnectionPoolMode::MUTEX;
+    pool_opts.size = 2;
+    pool_opts.auto_pipeline = true;
+    _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
+
+    // A single multiplexed connection shared by all threads.
+    pool_opts.auto_pipeline = false;
+    pool_opts.multiplexed = true;
+    _test_multithreads(RedisInstance(_opts, pool_opts), thread_num, times);
+
     _test_timeout();
 }
 